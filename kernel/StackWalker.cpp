@@ -44,3 +44,38 @@ StackWalker::Frame* StackWalker::walk_stack(const kstd::Arc<Thread>& thread, uin
 	return nullptr;
 #endif
 }
+
+size_t StackWalker::walk_stack_safe(const kstd::Arc<Thread>& thread, uintptr_t* addr_buf, size_t addr_bufsz, StackWalker::Frame* start_frame) {
+#if defined(__i386__)
+	size_t count = 0;
+	auto frame_addr = (VirtualAddress) start_frame;
+	while (frame_addr && count < addr_bufsz) {
+		// Don't follow frame pointers that are misaligned or would have us read across a page boundary
+		if (frame_addr % sizeof(uintptr_t) || (frame_addr % PAGE_SIZE) > PAGE_SIZE - sizeof(Frame))
+			break;
+
+		// Go through the physical page so that a frame pointer to somewhere unmapped can't fault
+		auto frame_paddr = thread->page_directory()->get_mapped_physaddr(frame_addr);
+		if (frame_paddr == (size_t) -1)
+			break;
+		Frame frame;
+		MM.with_quickmapped(frame_paddr / PAGE_SIZE, [&] (void* pagemem) {
+			frame = *((Frame*) ((VirtualAddress) pagemem + (frame_paddr % PAGE_SIZE)));
+		});
+		if (!frame.ret_addr)
+			break;
+		addr_buf[count++] = frame.ret_addr;
+
+		// Callers' frames are further up the stack, except when going from the kernel stack to the user stack
+		auto next_addr = (VirtualAddress) frame.next_frame;
+		bool leaving_kernel = frame_addr >= HIGHER_HALF && next_addr < HIGHER_HALF;
+		if (next_addr <= frame_addr && !leaving_kernel)
+			break;
+		frame_addr = next_addr;
+	}
+	return count;
+#elif defined(__aarch64__)
+	// TODO: aarch64
+	return 0;
+#endif
+}
@@ -13,4 +13,11 @@ namespace StackWalker {
 	};
 
 	Frame* walk_stack(const kstd::Arc<Thread>& thread, uintptr_t* addr_buf, size_t ptr_bufsz, StackWalker::Frame* start_frame);
+
+	/**
+	 * Walks a thread's stack without taking any locks or trusting any of the frame pointers, so that it can be done
+	 * from an interrupt handler. Walking stops at the first frame that looks bogus instead of faulting.
+	 * @return The number of return addresses written to addr_buf.
+	 */
+	size_t walk_stack_safe(const kstd::Arc<Thread>& thread, uintptr_t* addr_buf, size_t addr_bufsz, StackWalker::Frame* start_frame);
 };
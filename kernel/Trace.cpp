@@ -0,0 +1,106 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2024 Byteduck */
+
+#include "Trace.h"
+#include "Atomic.h"
+#include <kernel/memory/SafePointer.h>
+#include <kernel/tasking/TaskManager.h>
+#include <kernel/tasking/Thread.h>
+#include <kernel/time/TimeManager.h>
+
+namespace {
+	struct Slot {
+		Atomic<uint32_t> sequence; ///One more than the index of the event in the slot, or 0 while it's being written.
+		trace_event event;
+	};
+
+	Slot* s_buffer = nullptr;
+	Atomic<uint32_t> s_head = 0; ///The number of events recorded since tracing was started.
+	uint32_t s_tail = 0; ///The number of events read (or lost) since tracing was started.
+	uint32_t s_lost = 0;
+	Mutex s_lock {"Trace"}; ///Held by readers and while starting or stopping, never while recording.
+}
+
+volatile uint32_t Trace::enabled_events = 0;
+
+void Trace::record(trace_event_type type, uint32_t arg0, uint32_t arg1) {
+	// Claim a slot, then write it in a way that lets readers tell if they raced with us
+	auto index = s_head.add(1, MemoryOrder::Relaxed);
+	auto& slot = s_buffer[index % TRACE_BUFFER_EVENTS];
+	slot.sequence.store(0, MemoryOrder::Release);
+
+	auto thread = TaskManager::current_thread();
+	auto& event = slot.event;
+	event.time = TimeManager::cycles_to_us(TimeManager::cycles());
+	event.tid = thread ? thread->tid() : 0;
+	event.type = type;
+	event.args[0] = arg0;
+	event.args[1] = arg1;
+	slot.sequence.store(index + 1, MemoryOrder::Release);
+}
+
+Result Trace::start(uint32_t events) {
+	LOCK(s_lock);
+	if(enabled_events)
+		return Result(EBUSY);
+	if(!s_buffer)
+		s_buffer = new Slot[TRACE_BUFFER_EVENTS];
+
+	for(size_t i = 0; i < TRACE_BUFFER_EVENTS; i++)
+		s_buffer[i].sequence.store(0, MemoryOrder::Relaxed);
+	s_head.store(0, MemoryOrder::Relaxed);
+	s_tail = 0;
+	s_lost = 0;
+	__atomic_store_n(&enabled_events, events & TRACE_ALL_EVENTS, __ATOMIC_RELEASE);
+	return Result(SUCCESS);
+}
+
+void Trace::stop() {
+	LOCK(s_lock);
+	__atomic_store_n(&enabled_events, 0, __ATOMIC_RELEASE);
+}
+
+size_t Trace::read(SafePointer<uint8_t> buffer, size_t count) {
+	LOCK(s_lock);
+	if(!s_buffer)
+		return 0;
+
+	size_t ret = 0;
+	while(count - ret >= sizeof(trace_event)) {
+		auto head = s_head.load(MemoryOrder::Acquire);
+		if(s_tail == head)
+			break;
+
+		// If we fell behind, skip the events that were overwritten
+		if(head - s_tail > TRACE_BUFFER_EVENTS) {
+			s_lost += head - s_tail - TRACE_BUFFER_EVENTS;
+			s_tail = head - TRACE_BUFFER_EVENTS;
+		}
+
+		auto& slot = s_buffer[s_tail % TRACE_BUFFER_EVENTS];
+		auto sequence = slot.sequence.load(MemoryOrder::Acquire);
+		if(sequence == 0 || (int32_t) (sequence - (s_tail + 1)) < 0)
+			break; // Still being written, so we'll get it next time
+
+		// Make sure it wasn't overwritten before or while we copied it
+		trace_event event = slot.event;
+		if(sequence != s_tail + 1 || slot.sequence.load(MemoryOrder::Acquire) != sequence) {
+			s_lost++;
+			s_tail++;
+			continue;
+		}
+		s_tail++;
+
+		buffer.write((uint8_t*) &event, ret, sizeof(trace_event));
+		ret += sizeof(trace_event);
+	}
+	return ret;
+}
+
+bool Trace::has_events() {
+	return s_buffer && s_head.load(MemoryOrder::Acquire) != s_tail;
+}
+
+uint32_t Trace::lost_events() {
+	return s_lost;
+}
@@ -0,0 +1,58 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2024 Byteduck */
+
+#pragma once
+
+#include <kernel/api/trace.h>
+#include <kernel/Result.hpp>
+
+template<typename T>
+class SafePointer;
+
+/**
+ * A static tracepoint. If events of this type are being traced, records one with the given arguments. Otherwise, it
+ * costs a load and a (predicted) branch.
+ */
+#define TRACE(type, arg0, arg1) \
+	do { \
+		if(__builtin_expect(Trace::enabled_events & TRACE_EVENT_MASK(type), 0)) \
+			Trace::record((type), (uint32_t) (uintptr_t) (arg0), (uint32_t) (uintptr_t) (arg1)); \
+	} while(0)
+
+namespace Trace {
+	/// A mask of the types of events being traced.
+	extern volatile uint32_t enabled_events;
+
+	/**
+	 * Records an event into the trace buffer. Doesn't take any locks, so it's safe to call from anywhere, including
+	 * interrupt handlers and the scheduler.
+	 */
+	void record(trace_event_type type, uint32_t arg0, uint32_t arg1);
+
+	/**
+	 * Clears the trace buffer and starts recording the given types of events.
+	 * @param events A mask of the types of events to record.
+	 */
+	Result start(uint32_t events);
+
+	/**
+	 * Stops recording events.
+	 */
+	void stop();
+
+	/**
+	 * Reads as many whole events from the buffer as will fit.
+	 * @return The number of bytes read.
+	 */
+	size_t read(SafePointer<uint8_t> buffer, size_t count);
+
+	/**
+	 * Whether there are any events in the buffer that haven't been read.
+	 */
+	bool has_events();
+
+	/**
+	 * The number of events that were overwritten before they could be read since tracing was started.
+	 */
+	uint32_t lost_events();
+}
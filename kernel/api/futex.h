@@ -4,8 +4,11 @@
 #pragma once
 #include "types.h"
 
-#define FUTEX_WAIT    1
-#define FUTEX_REGFD   2
+#define FUTEX_WAIT        1 // Block until the futex is greater than zero. The caller decrements it afterward.
+#define FUTEX_REGFD       2 // Get a file descriptor that is readable when the futex is greater than zero.
+#define FUTEX_WAIT_VALUE  3 // If the futex still holds the given value, block until woken by FUTEX_WAKE or FUTEX_REQUEUE.
+#define FUTEX_WAKE        4 // Wake up to the given number of threads blocked in FUTEX_WAIT_VALUE on the futex.
+#define FUTEX_REQUEUE     5 // Wake one thread blocked on the futex and move the rest to wait on the given futex instead.
 
 __DECL_BEGIN
 
@@ -0,0 +1,35 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2024 Byteduck */
+
+#pragma once
+
+#include "types.h"
+
+/*
+ * The profile device samples the stacks of running threads from the timer interrupt. Start it with IO_PROFILE_START,
+ * then read() whole profile_samples from it until IO_PROFILE_STOP. Samples that aren't read in time are overwritten.
+ */
+
+__DECL_BEGIN
+
+#define PROFILE_MAX_FRAMES 30
+#define PROFILE_BUFFER_SAMPLES 2048
+#define PROFILE_ALL_PROCESSES -1
+
+#define IO_PROFILE_START 0x8201 // Start sampling with the profile_config in *argp.
+#define IO_PROFILE_STOP  0x8202 // Stop sampling. Samples already taken can still be read.
+
+struct profile_config {
+	pid_t pid; // The process to sample, or PROFILE_ALL_PROCESSES.
+	int interval; // How often to sample, in microseconds. Samples are taken on timer ticks, so this is rounded up.
+};
+
+struct profile_sample {
+	pid_t pid;
+	tid_t tid;
+	uint32_t num_frames;
+	uint32_t num_kernel_frames; // How many of the frames (starting with the innermost) are in the kernel.
+	uintptr_t frames[PROFILE_MAX_FRAMES]; // The interrupted instruction, followed by return addresses.
+};
+
+__DECL_END
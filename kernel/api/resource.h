@@ -8,6 +8,7 @@
 
 #define RUSAGE_SELF 1
 #define RUSAGE_CHILDREN 2
+#define RUSAGE_THREAD 3
 #define RLIMIT_CORE 1
 #define RLIMIT_CPU 2
 #define RLIMIT_DATA 3
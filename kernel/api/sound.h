@@ -0,0 +1,18 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2024 Byteduck */
+
+#pragma once
+
+/*
+ * Sound devices expose their output as a ring of fixed-size periods of signed 16-bit stereo LPCM that can be mapped
+ * into a process and filled in place, instead of being copied in with write().
+ */
+
+#define SOUND_PERIOD_FRAMES 512
+#define SOUND_NUM_PERIODS 8
+#define SOUND_FRAME_SIZE 4
+#define SOUND_PERIOD_SIZE (SOUND_PERIOD_FRAMES * SOUND_FRAME_SIZE)
+#define SOUND_RING_SIZE (SOUND_PERIOD_SIZE * SOUND_NUM_PERIODS)
+
+#define IO_SOUND_MAP         0x8101 // Map the output ring into the process. The address is written to argp.
+#define IO_SOUND_NEXT_PERIOD 0x8102 // Queue the period in *argp (or none if -1), wait for the next free one, and write its index to *argp.
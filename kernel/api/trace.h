@@ -0,0 +1,46 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2024 Byteduck */
+
+#pragma once
+
+#include "types.h"
+
+/*
+ * The trace device records timestamped events from static tracepoints in the kernel into a ring buffer. Start it with
+ * IO_TRACE_START and a mask of the events to record, then read() whole trace_events from it. Events that aren't read
+ * in time are overwritten.
+ */
+
+__DECL_BEGIN
+
+enum trace_event_type {
+	TRACE_CONTEXT_SWITCH, // args: The thread switched to, the state of the thread switched from.
+	TRACE_SYSCALL_ENTER, // args: The syscall number, its first argument.
+	TRACE_SYSCALL_EXIT, // args: The syscall number, its return value.
+	TRACE_PAGE_FAULT, // args: The faulting address, the error code.
+	TRACE_BLOCK_SUBMIT, // args: The first block, the number of blocks (with TRACE_BLOCK_WRITE set for writes).
+	TRACE_BLOCK_COMPLETE, // args: The same as TRACE_BLOCK_SUBMIT.
+	TRACE_IRQ, // args: The IRQ number.
+	TRACE_PACKET_RX, // args: The size of the frame.
+	TRACE_PACKET_TX, // args: The size of the frame.
+	TRACE_LOCK_CONTENDED, // args: The address of the lock, the thread holding it.
+	TRACE_NUM_EVENTS
+};
+
+#define TRACE_EVENT_MASK(type) (1u << (type))
+#define TRACE_ALL_EVENTS (TRACE_EVENT_MASK(TRACE_NUM_EVENTS) - 1)
+#define TRACE_BLOCK_WRITE 0x80000000u
+#define TRACE_BUFFER_EVENTS 8192
+
+#define IO_TRACE_START 0x8301 // Clear the buffer and start recording the events in the mask pointed to by argp.
+#define IO_TRACE_STOP  0x8302 // Stop recording. Events already recorded can still be read.
+#define IO_TRACE_LOST  0x8303 // Write the number of events that were overwritten before they could be read to *argp.
+
+struct trace_event {
+	uint64_t time; // Microseconds since boot.
+	tid_t tid; // The thread that was running.
+	uint32_t type;
+	uint32_t args[2];
+};
+
+__DECL_END
@@ -122,6 +122,24 @@ size_t PageDirectory::get_physaddr(size_t virtaddr) {
 	}
 }
 
+size_t PageDirectory::get_mapped_physaddr(size_t virtaddr) {
+	size_t page = virtaddr / PAGE_SIZE;
+	size_t directory_index = (page / 1024) % 1024;
+	if(virtaddr < HIGHER_HALF) { //Program space
+		if (!m_entries[directory_index].data.present) return -1;
+		auto* table = m_page_tables[directory_index];
+		if (!table) return -1;
+		auto& entry = table->entries()[page % 1024];
+		if (!entry.data.present) return -1;
+		return entry.data.get_address() + (virtaddr % PAGE_SIZE);
+	} else { //Kernel space
+		if (!s_kernel_entries[directory_index].data.present) return -1;
+		auto& entry = s_kernel_page_tables[directory_index - 768][page % 1024];
+		if (!entry.data.present) return -1;
+		return entry.data.get_address() + (virtaddr % PAGE_SIZE);
+	}
+}
+
 PageTable *PageDirectory::alloc_page_table(size_t tables_index) {
 	LOCK(m_lock);
 
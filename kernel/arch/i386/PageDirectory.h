@@ -101,6 +101,14 @@ public:
 	 */
 	size_t get_physaddr(void* virtaddr);
 
+	/**
+	 * Gets the physical address for virtaddr, checking that the page itself is present. Doesn't take the lock, so it
+	 * can be used from interrupt handlers.
+	 * @param virtaddr The virtual address.
+	 * @return The physical address for virtaddr, or -1 if it isn't mapped.
+	 */
+	size_t get_mapped_physaddr(VirtualAddress virtaddr);
+
 	/**
 	 * Checks if a given virtual address is mapped to anything.
 	 * @param vaddr The virtual address to check.
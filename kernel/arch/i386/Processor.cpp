@@ -27,6 +27,12 @@ void Processor::init() {
 	id = cpuid(CPUIDOp::Features);
 	s_features.ecx_value = id.ecx;
 	s_features.edx_value = id.edx;
+
+	// SSE was turned on during startup if the CPU has it, and we save the SSE registers on every context switch.
+	if (s_features.SSE2 && s_features.FXSR) {
+		cstring_set_sse2(true);
+		KLog::dbg("Processor", "Using SSE2 memory functions");
+	}
 }
 
 void Processor::halt() {
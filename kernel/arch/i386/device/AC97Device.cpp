@@ -18,11 +18,14 @@
 */
 #include "AC97Device.h"
 #include "kernel/tasking/TaskManager.h"
+#include "kernel/tasking/Process.h"
 #include "kernel/kstd/KLog.h"
 #include "kernel/kstd/unix_types.h"
 #include "kernel/memory/MemoryManager.h"
 #include "kernel/kstd/cstring.h"
 
+static_assert(PAGE_SIZE % SOUND_PERIOD_SIZE == 0, "Sound periods must not straddle pages");
+
 ResultRet<kstd::Arc<AC97Device>> AC97Device::detect() {
 	PCI::Address found_ac97 = {0, 0, 0};
 	PCI::enumerate_devices([](PCI::Address address, PCI::ID id, uint16_t type, void* dataPtr) {
@@ -47,7 +50,7 @@ AC97Device::AC97Device(PCI::Address address):
 	m_mixer_address(PCI::read_word(address, PCI_BAR0) & ~1),
 	m_bus_address(PCI::read_word(address, PCI_BAR1) & ~1),
 	m_output_channel(m_bus_address + BusRegisters::NABM_PCM_OUT),
-	m_output_buffer_region(MM.alloc_dma_region(PAGE_SIZE * AC97_OUTPUT_BUFFER_PAGES)),
+	m_output_buffer_region(MM.alloc_dma_region(SOUND_RING_SIZE)),
 	m_output_buffer_descriptor_region(MM.alloc_dma_region(sizeof(BufferDescriptor) * AC97_NUM_BUFFER_DESCRIPTORS)),
 	m_output_buffer_descriptors((BufferDescriptor*) m_output_buffer_descriptor_region->start())
 {
@@ -77,68 +80,63 @@ ssize_t AC97Device::read(FileDescriptor& fd, size_t offset, SafePointer<uint8_t>
 }
 
 ssize_t AC97Device::write(FileDescriptor& fd, size_t, SafePointer<uint8_t> buffer, size_t count) {
-	//Write buffer by buffer
+	LOCK(m_lock);
+
+	//Write period by period
 	size_t n_written = 0;
 	while(count) {
-		//Wait until we have a free buffer to write to
-		do {
-			//Read the status, current index, and last valid index
-			TaskManager::ScopedCritical critical;
-			auto status_byte = IO::inw(m_output_channel + ChannelRegisters::STATUS);
-			BufferStatus status = {.value = status_byte};
-			auto current_index = IO::inb(m_output_channel + ChannelRegisters::CURRENT_INDEX);
-			auto last_valid_index = IO::inb(m_output_channel + ChannelRegisters::LAST_VALID_INDEX);
-			auto num_buffers_left = last_valid_index >= current_index ? last_valid_index - current_index : AC97_NUM_BUFFER_DESCRIPTORS - (current_index - last_valid_index);
-			if(!status.is_halted)
-				num_buffers_left++;
-			if(num_buffers_left < AC97_NUM_BUFFER_DESCRIPTORS)
-				break;
-			critical.exit();
-			m_blocker.set_ready(false);
-			TaskManager::current_thread()->block(m_blocker);
-			if(m_blocker.was_interrupted())
-				return -EINTR;
-		} while(m_output_dma_enabled);
-
-		//If the output DMA is not currently enabled, reset the PCM channel to be sure
-		if(!m_output_dma_enabled)
-			reset_output();
-
-		//Copy as much data as is applicable to the current output buffer
-		auto* output_buffer = (uint32_t*)(m_output_buffer_region->start() + PAGE_SIZE * m_current_output_buffer_page);
-		size_t num_bytes = min(count, PAGE_SIZE);
-		buffer.read((uint8_t*) output_buffer, n_written, num_bytes);
+		auto wait_res = wait_for_period();
+		if(wait_res.is_error())
+			return n_written ? n_written : wait_res.code();
+
+		//Copy as much data as is applicable to the next period
+		auto* period = (uint8_t*) (m_output_buffer_region->start() + m_next_period * SOUND_PERIOD_SIZE);
+		size_t num_bytes = min(count, SOUND_PERIOD_SIZE);
+		buffer.read(period, n_written, num_bytes);
 		count -= num_bytes;
 		n_written += num_bytes;
 
-		//Create the buffer descriptor
-		auto* descriptor = &m_output_buffer_descriptors[m_current_buffer_descriptor];
-		descriptor->data_addr = m_output_buffer_region->object()->physical_page(m_current_output_buffer_page).paddr();
-		descriptor->num_samples = num_bytes / sizeof(uint16_t);
-		descriptor->flags = {false, true};
-
-		//Set the buffer descriptor list address and last valid index in the channel registers
-		IO::outl(m_output_channel + ChannelRegisters::BUFFER_LIST_ADDR, m_output_buffer_descriptor_region->object()->physical_page(0).paddr());
-		IO::outb(m_output_channel + ChannelRegisters::LAST_VALID_INDEX, m_current_buffer_descriptor);
-
-		//If the output DMA is not enabled already, enable it
-		if(!m_output_dma_enabled) {
-			auto ctrl = IO::inb(m_output_channel + ChannelRegisters::CONTROL);
-			ctrl |= ControlFlags::PAUSE_BUS_MASTER | ControlFlags::ERROR_INTERRUPT | ControlFlags::COMPLETION_INTERRUPT;
-			IO::outb(m_output_channel + ChannelRegisters::CONTROL, ctrl);
-			m_output_dma_enabled = true;
-		}
-
-		//Increment buffer page and buffer descriptor index
-		m_current_output_buffer_page++;
-		m_current_output_buffer_page %= AC97_OUTPUT_BUFFER_PAGES;
-		m_current_buffer_descriptor++;
-		m_current_buffer_descriptor %= AC97_NUM_BUFFER_DESCRIPTORS;
+		queue_period(m_next_period, num_bytes);
+		m_next_period = (m_next_period + 1) % SOUND_NUM_PERIODS;
 	}
 
 	return n_written;
 }
 
+int AC97Device::ioctl(unsigned request, SafePointer<void*> argp) {
+	auto proc = TaskManager::current_thread()->process();
+
+	switch(request) {
+		case IO_SOUND_MAP: {
+			auto region_res = proc->map_object(m_output_buffer_region->object(), VMProt::RW);
+			if(region_res.is_error())
+				return region_res.code();
+			argp.set((void*) region_res.value()->start());
+			return 0;
+		}
+
+		case IO_SOUND_NEXT_PERIOD: {
+			LOCK(m_lock);
+			SafePointer<int> period_ptr(argp);
+			int filled_period = period_ptr.get();
+			if(filled_period >= SOUND_NUM_PERIODS)
+				return -EINVAL;
+			if(filled_period >= 0)
+				queue_period(filled_period, SOUND_PERIOD_SIZE);
+
+			auto wait_res = wait_for_period();
+			if(wait_res.is_error())
+				return wait_res.code();
+			period_ptr.set((int) m_next_period);
+			m_next_period = (m_next_period + 1) % SOUND_NUM_PERIODS;
+			return 0;
+		}
+
+		default:
+			return -EINVAL;
+	}
+}
+
 void AC97Device::handle_irq(IRQRegisters *regs) {
 	//Read the status
 	auto status_byte = IO::inw(m_output_channel + ChannelRegisters::STATUS);
@@ -175,6 +173,61 @@ void AC97Device::reset_output() {
 	m_current_buffer_descriptor = 0;
 }
 
+Result AC97Device::wait_for_period() {
+	//The period after the last one queued is free once fewer than SOUND_NUM_PERIODS are waiting to be played
+	while(m_output_dma_enabled) {
+		//Read the status, current index, and last valid index
+		TaskManager::ScopedCritical critical;
+		auto status_byte = IO::inw(m_output_channel + ChannelRegisters::STATUS);
+		BufferStatus status = {.value = status_byte};
+		auto current_index = IO::inb(m_output_channel + ChannelRegisters::CURRENT_INDEX);
+		auto last_valid_index = IO::inb(m_output_channel + ChannelRegisters::LAST_VALID_INDEX);
+		auto num_buffers_left = last_valid_index >= current_index ? last_valid_index - current_index : AC97_NUM_BUFFER_DESCRIPTORS - (current_index - last_valid_index);
+		if(!status.is_halted)
+			num_buffers_left++;
+		if(num_buffers_left < SOUND_NUM_PERIODS)
+			break;
+
+		//Mark the blocker as not ready before leaving the critical section so we can't miss the interrupt
+		m_blocker.set_ready(false);
+		critical.exit();
+		TaskManager::current_thread()->block(m_blocker);
+		if(m_blocker.was_interrupted())
+			return Result(-EINTR);
+	}
+	return Result(SUCCESS);
+}
+
+void AC97Device::queue_period(uint32_t period, size_t num_bytes) {
+	TaskManager::ScopedCritical critical;
+
+	//If the output DMA is not currently enabled, reset the PCM channel to be sure
+	if(!m_output_dma_enabled)
+		reset_output();
+
+	//Create the buffer descriptor. Periods never straddle a page, so the physical address is just an offset into one.
+	size_t offset = period * SOUND_PERIOD_SIZE;
+	auto* descriptor = &m_output_buffer_descriptors[m_current_buffer_descriptor];
+	descriptor->data_addr = m_output_buffer_region->object()->physical_page(offset / PAGE_SIZE).paddr() + (offset % PAGE_SIZE);
+	descriptor->num_samples = num_bytes / sizeof(uint16_t);
+	descriptor->flags = {false, true};
+
+	//Set the buffer descriptor list address and last valid index in the channel registers
+	IO::outl(m_output_channel + ChannelRegisters::BUFFER_LIST_ADDR, m_output_buffer_descriptor_region->object()->physical_page(0).paddr());
+	IO::outb(m_output_channel + ChannelRegisters::LAST_VALID_INDEX, m_current_buffer_descriptor);
+
+	//If the output DMA is not enabled already, enable it
+	if(!m_output_dma_enabled) {
+		auto ctrl = IO::inb(m_output_channel + ChannelRegisters::CONTROL);
+		ctrl |= ControlFlags::PAUSE_BUS_MASTER | ControlFlags::ERROR_INTERRUPT | ControlFlags::COMPLETION_INTERRUPT;
+		IO::outb(m_output_channel + ChannelRegisters::CONTROL, ctrl);
+		m_output_dma_enabled = true;
+	}
+
+	m_current_buffer_descriptor++;
+	m_current_buffer_descriptor %= AC97_NUM_BUFFER_DESCRIPTORS;
+}
+
 void AC97Device::set_sample_rate(uint32_t sample_rate) {
 	IO::outw(m_mixer_address + MixerRegisters::SAMPLE_RATE, sample_rate);
 	m_sample_rate = IO::inw(m_mixer_address + MixerRegisters::SAMPLE_RATE);
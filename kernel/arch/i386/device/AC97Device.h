@@ -23,10 +23,11 @@
 #include "kernel/Result.hpp"
 #include "kernel/pci/PCI.h"
 #include "kernel/interrupt/IRQHandler.h"
+#include "kernel/tasking/Mutex.h"
+#include "kernel/api/sound.h"
 
 #define AC97_PCI_CLASS 0x4u
 #define AC97_PCI_SUBCLASS 0x1u
-#define AC97_OUTPUT_BUFFER_PAGES 4
 #define AC97_NUM_BUFFER_DESCRIPTORS 32
 
 class AC97Device: public CharacterDevice, public IRQHandler {
@@ -100,6 +101,7 @@ public:
 	//File
 	ssize_t read(FileDescriptor& fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) override;
 	ssize_t write(FileDescriptor& fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) override;
+	int ioctl(unsigned request, SafePointer<void*> argp) override;
 
 	//IRQHandler
 	void handle_irq(IRQRegisters* regs) override;
@@ -113,16 +115,19 @@ private:
 
 	void reset_output();
 	void set_sample_rate(uint32_t sample_rate);
+	Result wait_for_period();
+	void queue_period(uint32_t period, size_t num_bytes);
 
 	PCI::Address m_address;
 	uint16_t m_mixer_address, m_bus_address, m_output_channel;
 	kstd::Arc<VMRegion> m_output_buffer_region;
 	kstd::Arc<VMRegion> m_output_buffer_descriptor_region;
 	BufferDescriptor* m_output_buffer_descriptors;
-	uint32_t m_current_output_buffer_page = 0;
+	uint32_t m_next_period = 0;
 	uint32_t m_current_buffer_descriptor = 0;
 	bool m_output_dma_enabled = false;
 	BooleanBlocker m_blocker;
+	Mutex m_lock {"AC97Device"};
 	uint32_t m_sample_rate;
 };
 
@@ -23,6 +23,7 @@
 #include <kernel/tasking/TaskManager.h>
 #include <kernel/interrupt/IRQHandler.h>
 #include <kernel/interrupt/interrupt.h>
+#include <kernel/Trace.h>
 
 namespace Interrupt {
 	IRQHandler* handlers[16] = {nullptr};
@@ -91,6 +92,7 @@ namespace Interrupt {
 		regs->irq_num -= 0x20;
 		if (regs->irq_num >= (sizeof(handlers) / sizeof(handlers[0])))
 			PANIC("INVALID_IRQ", "Attempted to handle invalid IRQ %d", regs->irq_num);
+		TRACE(TRACE_IRQ, regs->irq_num, 0);
 		auto handler = handlers[regs->irq_num];
 		if(handler) {
 			//Mark that we're in an interrupt so that yield will be async if it occurs
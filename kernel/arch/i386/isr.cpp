@@ -29,6 +29,7 @@
 #include <kernel/tasking/Process.h>
 #include <kernel/KernelMapper.h>
 #include <kernel/arch/registers.h>
+#include <kernel/Trace.h>
 
 namespace Interrupt {
 	TSS fault_tss;
@@ -123,6 +124,7 @@ namespace Interrupt {
 				{
 					size_t err_pos;
 					asm volatile ("mov %%cr2, %0" : "=r" (err_pos));
+					TRACE(TRACE_PAGE_FAULT, err_pos, regs->err_code);
 					PageFault::Type type;
 					switch (regs->err_code) {
 						case FAULT_USER_READ:
@@ -24,6 +24,8 @@
 #include "RandomDevice.h"
 #include "NullDevice.h"
 #include "KernelLogDevice.h"
+#include "ProfileDevice.h"
+#include "TraceDevice.h"
 #include <kernel/kstd/unix_types.h>
 #include <kernel/kstd/KLog.h>
 
@@ -37,6 +39,8 @@ void Device::init() {
 	new NullDevice();
 	new PTYMuxDevice();
 	new KernelLogDevice();
+	new ProfileDevice();
+	new TraceDevice();
 }
 
 Device::Device(unsigned major, unsigned minor): _major(major), _minor(minor) {
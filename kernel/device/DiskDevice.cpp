@@ -21,6 +21,7 @@
 #include <kernel/memory/MemoryManager.h>
 #include "DiskDevice.h"
 #include "kernel/kstd/KLog.h"
+#include <kernel/Trace.h>
 
 size_t DiskDevice::s_used_cache_memory = 0;
 kstd::vector<DiskDevice*> DiskDevice::s_disk_devices;
@@ -114,8 +115,11 @@ size_t DiskDevice::free_pages(size_t num_pages) {
 			break;
 
 		// Flush it if necessary
-		if(lru_region->dirty)
+		if(lru_region->dirty) {
+			TRACE(TRACE_BLOCK_SUBMIT, lru_region->start_block, lru_region->num_blocks() | TRACE_BLOCK_WRITE);
 			lru_device->write_uncached_blocks(lru_region->start_block, lru_region->num_blocks(), (uint8_t*) lru_region->region->start());
+			TRACE(TRACE_BLOCK_COMPLETE, lru_region->start_block, lru_region->num_blocks() | TRACE_BLOCK_WRITE);
+		}
 
 		// Free it
 		num_freed += lru_region->region->size() / PAGE_SIZE;
@@ -147,7 +151,9 @@ kstd::Arc<DiskDevice::BlockCacheRegion> DiskDevice::get_cache_region(size_t bloc
 	_cache_regions.insert(block_cache_region_start(block), reg);
 
 	//Read the blocks into it
+	TRACE(TRACE_BLOCK_SUBMIT, reg->start_block, blocks_per_cache_region());
 	read_uncached_blocks(reg->start_block, blocks_per_cache_region(), (uint8_t*) reg->region->start());
+	TRACE(TRACE_BLOCK_COMPLETE, reg->start_block, blocks_per_cache_region());
 
 	//TODO: Figure out how to read the block after releasing the cache lock so that other blocks can be used in the meantime
 	//(We cannot do this currently as that would result in acquiring / releasing locks in the wrong order)
@@ -186,7 +192,9 @@ void DiskDevice::cache_writeback_task_entry() {
 					region = region_opt.value();
 				}
 				LOCK(region->lock);
+				TRACE(TRACE_BLOCK_SUBMIT, region->start_block, region->num_blocks() | TRACE_BLOCK_WRITE);
 				device->write_uncached_blocks(region->start_block, region->num_blocks(), (uint8_t*) region->region->start());
+				TRACE(TRACE_BLOCK_COMPLETE, region->start_block, region->num_blocks() | TRACE_BLOCK_WRITE);
 				region->dirty = false;
 			}
 		}
@@ -0,0 +1,128 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2024 Byteduck */
+
+#include "ProfileDevice.h"
+#include <kernel/tasking/TaskManager.h>
+#include <kernel/tasking/Thread.h>
+#include <kernel/tasking/Process.h>
+#include <kernel/time/TimeManager.h>
+#include <kernel/StackWalker.h>
+#include <kernel/kstd/KLog.h>
+
+ProfileDevice* ProfileDevice::_inst = nullptr;
+
+ProfileDevice* ProfileDevice::inst() {
+	return _inst;
+}
+
+ProfileDevice::ProfileDevice(): CharacterDevice(1, 17) {
+	if(_inst)
+		KLog::warn("ProfileDevice", "Duplicate profile device created!");
+	else
+		_inst = this;
+}
+
+ssize_t ProfileDevice::read(FileDescriptor& fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) {
+	// Samples include other processes' stack addresses, and reading them consumes them
+	if(TaskManager::current_process()->user().euid != 0)
+		return -EACCES;
+
+	size_t ret = 0;
+	while(count - ret >= sizeof(profile_sample)) {
+		TaskManager::ScopedCritical critical;
+		if(!_samples || _samples->empty())
+			break;
+		auto sample = _samples->pop_front();
+		critical.exit();
+		buffer.write((uint8_t*) &sample, ret, sizeof(profile_sample));
+		ret += sizeof(profile_sample);
+	}
+	return ret;
+}
+
+bool ProfileDevice::can_read(const FileDescriptor& fd) {
+	return _samples && !_samples->empty();
+}
+
+int ProfileDevice::ioctl(unsigned request, SafePointer<void*> argp) {
+	if(TaskManager::current_process()->user().euid != 0)
+		return -EACCES;
+
+	LOCK(_lock);
+	switch(request) {
+		case IO_PROFILE_START: {
+			auto config = SafePointer<profile_config>(argp).get();
+			if(config.interval <= 0)
+				return -EINVAL;
+			if(config.pid != PROFILE_ALL_PROCESSES && TaskManager::process_for_pid(config.pid).is_error())
+				return -ESRCH;
+			if(_running)
+				return -EBUSY;
+			if(!_samples)
+				_samples = new kstd::circular_queue<profile_sample>(PROFILE_BUFFER_SAMPLES);
+
+			TaskManager::ScopedCritical critical;
+			while(!_samples->empty())
+				_samples->pop_front();
+			_pid = config.pid;
+			_interval_us = config.interval;
+			_next_sample_us = 0;
+			_running = true;
+			return SUCCESS;
+		}
+
+		case IO_PROFILE_STOP: {
+			TaskManager::ScopedCritical critical;
+			_running = false;
+			return SUCCESS;
+		}
+
+		default:
+			return -EINVAL;
+	}
+}
+
+void ProfileDevice::tick() {
+	if(!_inst || !_inst->_running)
+		return;
+
+	auto now_us = TimeManager::cycles_to_us(TimeManager::cycles());
+	if(now_us < _inst->_next_sample_us)
+		return;
+	_inst->_next_sample_us = now_us + _inst->_interval_us;
+
+	auto thread = TaskManager::current_thread();
+	if(!thread)
+		return;
+	if(_inst->_pid != PROFILE_ALL_PROCESSES && thread->process()->pid() != _inst->_pid)
+		return;
+	_inst->take_sample(thread);
+}
+
+void ProfileDevice::take_sample(const kstd::Arc<Thread>& thread) {
+#if defined(__i386__)
+	// The innermost trap frame is the timer interrupt, which has the registers of whatever was running
+	auto trap_frame = thread->cur_trap_frame();
+	if(!trap_frame || trap_frame->type != TrapFrame::IRQ)
+		return;
+	auto* regs = trap_frame->irq_regs;
+
+	profile_sample sample;
+	sample.pid = thread->process()->pid();
+	sample.tid = thread->tid();
+	sample.frames[0] = regs->interrupt_frame.eip;
+	sample.num_frames = 1 + StackWalker::walk_stack_safe(thread, &sample.frames[1], PROFILE_MAX_FRAMES - 1,
+														 (StackWalker::Frame*) regs->registers.ebp);
+
+	// If we interrupted the kernel, the frames start in the kernel and continue out to userspace (if at all)
+	sample.num_kernel_frames = 0;
+	if(!(regs->interrupt_frame.cs & 0x3)) {
+		while(sample.num_kernel_frames < sample.num_frames && sample.frames[sample.num_kernel_frames] >= HIGHER_HALF)
+			sample.num_kernel_frames++;
+	}
+
+	if(_samples->size() == _samples->capacity())
+		_samples->pop_front();
+	_samples->push_back(sample);
+#endif
+}
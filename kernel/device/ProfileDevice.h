@@ -0,0 +1,44 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2024 Byteduck */
+
+#pragma once
+
+#include "CharacterDevice.h"
+#include <kernel/api/profile.h>
+#include <kernel/kstd/circular_queue.hpp>
+#include <kernel/tasking/Mutex.h>
+
+class Thread;
+
+/**
+ * A sampling profiler. While it's running, the timer interrupt records the stack of whichever thread it interrupted,
+ * kernel frames included, into a ring buffer of profile_samples that can be read from the device.
+ */
+class ProfileDevice: public CharacterDevice {
+public:
+	static ProfileDevice* inst();
+
+	ProfileDevice();
+
+	//File
+	ssize_t read(FileDescriptor& fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) override;
+	bool can_read(const FileDescriptor& fd) override;
+	int ioctl(unsigned request, SafePointer<void*> argp) override;
+
+	//ProfileDevice
+	/**
+	 * Samples the interrupted thread if the profiler is running and it's time to. Called from the timer interrupt.
+	 */
+	static void tick();
+
+private:
+	void take_sample(const kstd::Arc<Thread>& thread);
+
+	static ProfileDevice* _inst;
+	Mutex _lock {"ProfileDevice"};
+	kstd::circular_queue<profile_sample>* _samples = nullptr; ///Allocated the first time the profiler is started.
+	bool _running = false;
+	pid_t _pid = PROFILE_ALL_PROCESSES;
+	uint64_t _interval_us = 0;
+	uint64_t _next_sample_us = 0;
+};
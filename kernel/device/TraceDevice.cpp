@@ -0,0 +1,38 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2024 Byteduck */
+
+#include "TraceDevice.h"
+#include <kernel/Trace.h>
+#include <kernel/tasking/TaskManager.h>
+#include <kernel/tasking/Process.h>
+
+TraceDevice::TraceDevice(): CharacterDevice(1, 18) {}
+
+ssize_t TraceDevice::read(FileDescriptor& fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) {
+	// Traces include other processes' syscall arguments, and reading them consumes them
+	if(TaskManager::current_process()->user().euid != 0)
+		return -EACCES;
+	return Trace::read(buffer, count);
+}
+
+bool TraceDevice::can_read(const FileDescriptor& fd) {
+	return Trace::has_events();
+}
+
+int TraceDevice::ioctl(unsigned request, SafePointer<void*> argp) {
+	if(TaskManager::current_process()->user().euid != 0)
+		return -EACCES;
+
+	switch(request) {
+		case IO_TRACE_START:
+			return -Trace::start(SafePointer<uint32_t>(argp).get()).code();
+		case IO_TRACE_STOP:
+			Trace::stop();
+			return SUCCESS;
+		case IO_TRACE_LOST:
+			SafePointer<uint32_t>(argp).set(Trace::lost_events());
+			return SUCCESS;
+		default:
+			return -EINVAL;
+	}
+}
@@ -0,0 +1,19 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2024 Byteduck */
+
+#pragma once
+
+#include "CharacterDevice.h"
+
+/**
+ * Lets userspace control tracing and read the events recorded at the kernel's tracepoints (see Trace.h).
+ */
+class TraceDevice: public CharacterDevice {
+public:
+	TraceDevice();
+
+	//File
+	ssize_t read(FileDescriptor& fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) override;
+	bool can_read(const FileDescriptor& fd) override;
+	int ioctl(unsigned request, SafePointer<void*> argp) override;
+};
@@ -21,6 +21,8 @@
 #include <kernel/tasking/TaskManager.h>
 #include <kernel/tasking/Thread.h>
 #include <kernel/tasking/Process.h>
+#include <kernel/tasking/SleepBlocker.h>
+#include <kernel/time/TimeManager.h>
 
 VGADevice* VGADevice::_inst = nullptr;
 
@@ -41,7 +43,43 @@ int VGADevice::ioctl(unsigned request, SafePointer<void*> argp) {
 		case IO_VIDEO_MAP:
 			argp.set(map_framebuffer(proc));
 			return 0;
+		case IO_VIDEO_REFRESH:
+			SafePointer<int>(argp).set(VIDEO_REFRESH_RATE);
+			return 0;
 		default:
 			return -EINVAL;
 	}
-}
\ No newline at end of file
+}
+
+ssize_t VGADevice::read(FileDescriptor& fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) {
+	if(count < sizeof(video_frame))
+		return -EINVAL;
+
+	auto frame = current_frame();
+	while(frame.frame == _last_read_frame) {
+		// Sleep until the next frame starts
+		SleepBlocker blocker(Time(0, 1000000 / VIDEO_REFRESH_RATE - frame.usec + 1));
+		TaskManager::current_thread()->block(blocker);
+		if(blocker.was_interrupted())
+			return -EINTR;
+		frame = current_frame();
+	}
+
+	_last_read_frame = frame.frame;
+	buffer.write((uint8_t*) &frame, sizeof(video_frame));
+	return sizeof(video_frame);
+}
+
+bool VGADevice::can_read(const FileDescriptor& fd) {
+	return current_frame().frame != _last_read_frame;
+}
+
+video_frame VGADevice::current_frame() {
+	// Avoid 64-bit division by splitting the uptime into whole seconds and frames within the second
+	auto uptime = TimeManager::uptime();
+	uint32_t frame_in_second = (uint32_t) uptime.tv_usec * VIDEO_REFRESH_RATE / 1000000;
+	return {
+		(uint32_t) uptime.tv_sec * VIDEO_REFRESH_RATE + frame_in_second,
+		(uint32_t) uptime.tv_usec - frame_in_second * 1000000 / VIDEO_REFRESH_RATE
+	};
+}
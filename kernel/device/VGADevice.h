@@ -24,6 +24,20 @@
 #define IO_VIDEO_HEIGHT	0x8003
 #define IO_VIDEO_PITCH	0x8004
 #define IO_VIDEO_OFFSET	0x8005
+#define IO_VIDEO_REFRESH	0x8006
+
+#define VIDEO_REFRESH_RATE 60
+
+#include "../api/stdint.h"
+
+/**
+ * Reading from a video device waits for the next frame to start and returns one of these. The device polls as
+ * readable once a frame has started that hasn't been read yet, so a compositor can wait for frames alongside input.
+ */
+struct video_frame {
+	uint32_t frame; ///< The number of the frame, counting from boot.
+	uint32_t usec; ///< How long ago the frame started, in microseconds.
+};
 
 #ifdef DUCKOS_KERNEL
 
@@ -43,8 +57,19 @@ public:
 
 	//File
 	virtual int ioctl(unsigned request, SafePointer<void*> argp) override;
+	ssize_t read(FileDescriptor& fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) override;
+	bool can_read(const FileDescriptor& fd) override;
+
+protected:
+	/**
+	 * Gets the current frame of the display's frame clock. None of our display devices can tell us about vertical
+	 * blanking, so by default this ticks at VIDEO_REFRESH_RATE from the system timer.
+	 */
+	virtual video_frame current_frame();
+
 private:
 	static VGADevice* _inst;
+	uint32_t _last_read_frame = 0; ///< The last frame returned by read(). Only pond reads frames, so this isn't per-fd.
 };
 
 #endif
@@ -139,7 +139,7 @@ ResultRet<kstd::Arc<FileDescriptor>> VFS::open(const kstd::string& path, int opt
 	//Resolve the file
 	int resolve_options = options & O_NOFOLLOW ? O_NOFOLLOW : 0;
 	kstd::Arc<LinkedInode> parent(nullptr);
-	auto resolv = resolve_path(path, base, user, &parent);
+	auto resolv = resolve_path(path, base, user, &parent, resolve_options);
 
 	//If we are using O_CREAT and the file doesn't exist (resolv == -ENOENT), make it
 	if(options & O_CREAT) {
@@ -68,6 +68,7 @@ void ProcFS::proc_add(Process* proc) {
 	entries.push_back(ProcFSEntry(ProcStatus, pid));
 	entries.push_back(ProcFSEntry(ProcStacks, pid));
 	entries.push_back(ProcFSEntry(ProcVMSpace, pid));
+	entries.push_back(ProcFSEntry(ProcThreads, pid));
 }
 
 void ProcFS::proc_remove(Process* proc) {
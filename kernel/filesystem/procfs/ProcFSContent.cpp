@@ -132,6 +132,21 @@ ResultRet<kstd::string> ProcFSContent::status(pid_t pid) {
 			str += ",";
 	}
 
+	char bignumbuf[24];
+	auto cpu_time = proc->cpu_time();
+	str += "\nutime = ";
+	lltoa(cpu_time.user_us, bignumbuf, 10);
+	str += bignumbuf;
+
+	str += "\nstime = ";
+	lltoa(cpu_time.kernel_us, bignumbuf, 10);
+	str += bignumbuf;
+
+	auto start_time = proc->start_time();
+	str += "\nstart = ";
+	lltoa((long long) start_time.tv_sec * 1000000 + start_time.tv_usec, bignumbuf, 10);
+	str += bignumbuf;
+
 	str += "\n";
 
 	return str;
@@ -225,25 +240,61 @@ ResultRet<kstd::string> ProcFSContent::vmspace(pid_t pid) {
 	return string;
 }
 
-#ifdef DEBUG
-extern kstd::map<Lock*, int> g_lock_registry;
-#endif
+ResultRet<kstd::string> ProcFSContent::threads(pid_t pid) {
+	auto proc = TRY(TaskManager::process_for_pid(pid));
+	kstd::string str;
+	char numbuf[24];
+	for (auto& tid : proc->threads()) {
+		auto thread = proc->get_thread(tid);
+		if (!thread)
+			continue;
+		auto cpu_time = thread->cpu_time();
+
+		itoa(tid, numbuf, 10);
+		str += numbuf;
+
+		str += "\t";
+		str += thread->state_name();
+
+		str += "\t";
+		lltoa(cpu_time.user_us, numbuf, 10);
+		str += numbuf;
+
+		str += "\t";
+		lltoa(cpu_time.kernel_us, numbuf, 10);
+		str += numbuf;
+		str += "\n";
+	}
+	return str;
+}
 
 ResultRet<kstd::string> ProcFSContent::lock_info() {
-#ifdef DEBUG
 	kstd::string string;
 	char numbuf[32];
-	for (auto pair : g_lock_registry) {
-		if (pair.first->contest_count() == 0)
+	for (size_t i = 0; i < LockClass::count(); i++) {
+		// Copy the class in a critical section so that its counters are consistent with each other
+		LockClass lock_class;
+		{
+			TaskManager::ScopedCritical crit;
+			lock_class = LockClass::at(i);
+		}
+		if (!lock_class.acquisitions && !lock_class.contentions)
 			continue;
-		string += pair.first->name();
-		string += "\t";
-		lltoa(pair.first->contest_count(), numbuf, 10);
-		string += numbuf;
+
+		uint64_t values[] = {
+			lock_class.acquisitions,
+			lock_class.contentions,
+			TimeManager::cycles_to_us(lock_class.total_wait),
+			TimeManager::cycles_to_us(lock_class.max_wait),
+			TimeManager::cycles_to_us(lock_class.max_hold)
+		};
+		string += lock_class.name;
+		for (auto value : values) {
+			string += "\t";
+			lltoa(value, numbuf, 10);
+			string += numbuf;
+		}
 		string += "\n";
 	}
 	return string;
-#else
-	return kstd::string("");
-#endif
 }
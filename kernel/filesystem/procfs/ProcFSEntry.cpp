@@ -116,6 +116,12 @@ ProcFSEntry::ProcFSEntry(ProcFSInodeType type, pid_t pid): type(type), pid(pid)
 			dirent_type = TYPE_FILE;
 			parent = ProcFS::id_for_entry(pid, RootProcEntry);
 			break;
+
+		case ProcThreads:
+			name = "threads";
+			dirent_type = TYPE_FILE;
+			parent = ProcFS::id_for_entry(pid, RootProcEntry);
+			break;
 	}
 
 	dir_entry = DirectoryEntry(ProcFS::id_for_entry(pid, type), dirent_type, name);
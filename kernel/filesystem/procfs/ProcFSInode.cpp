@@ -83,6 +83,8 @@ ResultRet<kstd::string> ProcFSInode::get_string_contents() {
 			return ProcFSContent::stacks(pid);
 		case ProcVMSpace:
 			return ProcFSContent::vmspace(pid);
+		case ProcThreads:
+			return ProcFSContent::threads(pid);
 		default:
 			return Result(-EINVAL);
 	}
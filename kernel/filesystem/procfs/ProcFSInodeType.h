@@ -38,6 +38,7 @@ enum ProcFSInodeType {
 	ProcCwd,
 	ProcStatus,
 	ProcStacks,
-	ProcVMSpace
+	ProcVMSpace,
+	ProcThreads
 };
 
@@ -44,8 +44,141 @@ bool strcmp(const char* str1, const char* str2){
 	return flag == 0 && str1[i] == '\0' && str2[i] == '\0';
 }
 
+#if defined(__i386__)
+
+// Copies and fills at least this big use SSE2. The kernel doesn't own the XMM registers (they hold the state of
+// whichever user thread is running), so they have to be saved and restored around every use, which small copies
+// wouldn't make up for.
+#define SSE2_MIN_SIZE 256
+
+static bool s_use_sse2 = false;
+
+void cstring_set_sse2(bool enabled) {
+	s_use_sse2 = enabled;
+}
+
+static void memcpy_sse2(uint8_t* dest, const uint8_t* src, size_t n) {
+	// Copy bytes until the destination is aligned, so that the stores in the main loop can be aligned.
+	size_t head = (-(uintptr_t) dest) & 15;
+	n -= head;
+	asm volatile("rep movsb" : "+D"(dest), "+S"(src), "+c"(head) :: "memory");
+
+	uint8_t saved[64];
+	size_t blocks = n / 64;
+	n %= 64;
+	asm volatile(
+		"movdqu %%xmm0, (%[saved])\n"
+		"movdqu %%xmm1, 16(%[saved])\n"
+		"movdqu %%xmm2, 32(%[saved])\n"
+		"movdqu %%xmm3, 48(%[saved])\n"
+		"1:\n"
+		"movdqu (%[src]), %%xmm0\n"
+		"movdqu 16(%[src]), %%xmm1\n"
+		"movdqu 32(%[src]), %%xmm2\n"
+		"movdqu 48(%[src]), %%xmm3\n"
+		"movdqa %%xmm0, (%[dest])\n"
+		"movdqa %%xmm1, 16(%[dest])\n"
+		"movdqa %%xmm2, 32(%[dest])\n"
+		"movdqa %%xmm3, 48(%[dest])\n"
+		"add $64, %[src]\n"
+		"add $64, %[dest]\n"
+		"dec %[blocks]\n"
+		"jnz 1b\n"
+		"movdqu (%[saved]), %%xmm0\n"
+		"movdqu 16(%[saved]), %%xmm1\n"
+		"movdqu 32(%[saved]), %%xmm2\n"
+		"movdqu 48(%[saved]), %%xmm3\n"
+		: [dest]"+r"(dest), [src]"+r"(src), [blocks]"+r"(blocks)
+		: [saved]"r"(saved)
+		: "memory");
+
+	asm volatile("rep movsb" : "+D"(dest), "+S"(src), "+c"(n) :: "memory");
+}
+
+static void memmove_backwards_sse2(uint8_t* dest, const uint8_t* src, size_t n) {
+	// Copy bytes from the end until the end of the destination is aligned.
+	uint8_t* dest_end = dest + n;
+	const uint8_t* src_end = src + n;
+	size_t tail = (uintptr_t) dest_end & 15;
+	n -= tail;
+	while(tail--)
+		*--dest_end = *--src_end;
+
+	// Each block is loaded completely before it's stored, so overlap within a block doesn't matter.
+	uint8_t saved[64];
+	size_t blocks = n / 64;
+	n %= 64;
+	asm volatile(
+		"movdqu %%xmm0, (%[saved])\n"
+		"movdqu %%xmm1, 16(%[saved])\n"
+		"movdqu %%xmm2, 32(%[saved])\n"
+		"movdqu %%xmm3, 48(%[saved])\n"
+		"1:\n"
+		"sub $64, %[src]\n"
+		"sub $64, %[dest]\n"
+		"movdqu 48(%[src]), %%xmm0\n"
+		"movdqu 32(%[src]), %%xmm1\n"
+		"movdqu 16(%[src]), %%xmm2\n"
+		"movdqu (%[src]), %%xmm3\n"
+		"movdqa %%xmm0, 48(%[dest])\n"
+		"movdqa %%xmm1, 32(%[dest])\n"
+		"movdqa %%xmm2, 16(%[dest])\n"
+		"movdqa %%xmm3, (%[dest])\n"
+		"dec %[blocks]\n"
+		"jnz 1b\n"
+		"movdqu (%[saved]), %%xmm0\n"
+		"movdqu 16(%[saved]), %%xmm1\n"
+		"movdqu 32(%[saved]), %%xmm2\n"
+		"movdqu 48(%[saved]), %%xmm3\n"
+		: [dest]"+r"(dest_end), [src]"+r"(src_end), [blocks]"+r"(blocks)
+		: [saved]"r"(saved)
+		: "memory");
+
+	while(n--)
+		*--dest_end = *--src_end;
+}
+
+static void memset_sse2(uint8_t* dest, uint8_t c, size_t n) {
+	size_t head = (-(uintptr_t) dest) & 15;
+	n -= head;
+	asm volatile("rep stosb" : "+D"(dest), "+c"(head) : "a"(c) : "memory");
+
+	uint8_t saved[16];
+	size_t blocks = n / 64;
+	n %= 64;
+	asm volatile(
+		"movdqu %%xmm0, (%[saved])\n"
+		"movd %[pattern], %%xmm0\n"
+		"pshufd $0, %%xmm0, %%xmm0\n"
+		"1:\n"
+		"movdqa %%xmm0, (%[dest])\n"
+		"movdqa %%xmm0, 16(%[dest])\n"
+		"movdqa %%xmm0, 32(%[dest])\n"
+		"movdqa %%xmm0, 48(%[dest])\n"
+		"add $64, %[dest]\n"
+		"dec %[blocks]\n"
+		"jnz 1b\n"
+		"movdqu (%[saved]), %%xmm0\n"
+		: [dest]"+r"(dest), [blocks]"+r"(blocks)
+		: [pattern]"r"(c * 0x01010101u), [saved]"r"(saved)
+		: "memory");
+
+	asm volatile("rep stosb" : "+D"(dest), "+c"(n) : "a"(c) : "memory");
+}
+
+#else
+
+void cstring_set_sse2(bool enabled) {}
+
+#endif
+
 extern "C" void* memset(void* dest, int c, size_t n) {
 #if defined(__i386__)
+	if(n >= SSE2_MIN_SIZE && s_use_sse2) {
+		memset_sse2((uint8_t*) dest, (uint8_t) c, n);
+		return dest;
+	}
+
 	void* odest = dest;
 	asm volatile( "rep stosb" : "=D"(dest), "=c"(n) : "0"(dest), "1"(n), "a"(c) : "memory");
 	return odest;
@@ -61,6 +194,11 @@ extern "C" void* memset(void* dest, int c, size_t n) {
 
 extern "C" void *memcpy(void *dest, const void *src, size_t count){
 #if defined(__i386__)
+	if(count >= SSE2_MIN_SIZE && s_use_sse2) {
+		memcpy_sse2((uint8_t*) dest, (const uint8_t*) src, count);
+		return dest;
+	}
+
 	void* odest = dest;
 	asm volatile( "rep movsb" : "+D"(dest), "+S"(src), "+c"(count)::"memory");
 	return odest;
@@ -77,9 +215,17 @@ extern "C" void *memcpy(void *dest, const void *src, size_t count){
 }
 
 extern "C" void* memmove(void* dest, const void* src, size_t n) {
-	if (dest < src) 
+	// A forward copy is safe if the destination is before the source or they don't overlap.
+	if (dest <= src || (const uint8_t*) src + n <= (uint8_t*) dest)
 		return memcpy(dest, src, n);
 
+#if defined(__i386__)
+	if(n >= SSE2_MIN_SIZE && s_use_sse2) {
+		memmove_backwards_sse2((uint8_t*) dest, (const uint8_t*) src, n);
+		return dest;
+	}
+#endif
+
 	uint8_t* dest8 = (uint8_t*) dest;
 	const uint8_t* src8 = (const uint8_t*) src;
 	for (dest8 += n, src8 += n; n--;)
@@ -99,9 +245,22 @@ void* memcpy_uint32(uint32_t* d, uint32_t* s, size_t n) {
 }
 
 int strlen(const char *str){
-	const char *s;
+	// Check a byte at a time until we're aligned, and then a word at a time. Aligned words never cross a page boundary,
+	// so reading past the terminator can't fault.
+	const char* s = str;
+	for (; (uintptr_t) s % sizeof(size_t); ++s) {
+		if (!*s)
+			return (s - str);
+	}
+
+	typedef size_t __attribute__((may_alias)) word_t;
+	constexpr size_t ones = (size_t) -1 / 0xFF;
+	constexpr size_t highs = ones * 0x80;
+	auto* word = (const word_t*) s;
+	while (!((*word - ones) & ~*word & highs))
+		word++;
 
-	for (s = str; *s; ++s)
+	for (s = (const char*) word; *s; ++s)
 		;
 	return (s - str);
 }
@@ -7,6 +7,7 @@
 #include "E1000Adapter.h"
 #include "NetworkManager.h"
 #include "Router.h"
+#include <kernel/Trace.h>
 
 kstd::vector<kstd::Arc<NetworkAdapter>> NetworkAdapter::s_interfaces;
 
@@ -52,6 +53,7 @@ const kstd::vector<kstd::Arc<NetworkAdapter>>& NetworkAdapter::interfaces() {
 
 void NetworkAdapter::receive_bytes(const ReadableBytes& bytes, size_t count) {
 	ASSERT(count <= max_packet_buffer_size);
+	TRACE(TRACE_PACKET_RX, count, 0);
 
 	auto pkt_res = alloc_packet(count);
 	if (pkt_res.is_error()) {
@@ -89,6 +91,7 @@ void NetworkAdapter::send_arp_packet(MACAddress dest, const ARPPacket& packet) {
 }
 
 void NetworkAdapter::send_raw_packet(const ReadableBytes& bytes, size_t count) {
+	TRACE(TRACE_PACKET_TX, count, 0);
 	send_bytes(bytes, count);
 }
 
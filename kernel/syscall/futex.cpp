@@ -7,9 +7,9 @@
 #include "../filesystem/FileDescriptor.h"
 #include "../tasking/Futex.h"
 
-int Process::sys_futex(UserspacePointer<futex_t> futex, int op) {
+int Process::sys_futex(UserspacePointer<futex_t> futex, int op, int arg) {
 	auto addr = (uintptr_t) futex.raw();
-	if (addr > HIGHER_HALF)
+	if (addr > HIGHER_HALF || addr % sizeof(futex_t))
 		return -EFAULT;
 	auto reg_res = _vm_space->get_region_containing(addr);
 	if (reg_res.is_error())
@@ -32,6 +32,22 @@ int Process::sys_futex(UserspacePointer<futex_t> futex, int op) {
 		TaskManager::current_thread()->block(k_futex);
 		return SUCCESS;
 	}
+	case FUTEX_WAIT_VALUE:
+		return FutexWaiter::wait(reg->object().get(), addr - reg->start(), futex, arg);
+	case FUTEX_WAKE:
+		return FutexWaiter::wake(reg->object().get(), addr - reg->start(), arg);
+	case FUTEX_REQUEUE: {
+		auto target_addr = (uintptr_t) arg;
+		if (target_addr > HIGHER_HALF || target_addr % sizeof(futex_t))
+			return -EFAULT;
+		auto target_res = _vm_space->get_region_containing(target_addr);
+		if (target_res.is_error())
+			return -EFAULT;
+		auto target = target_res.value();
+		if (!target->prot().read || !target->prot().write)
+			return -EPERM;
+		return FutexWaiter::requeue(reg->object().get(), addr - reg->start(), target->object().get(), target_addr - target->start());
+	}
 	default:
 		return -EINVAL;
 	}
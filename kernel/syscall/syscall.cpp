@@ -22,13 +22,17 @@
 #include <kernel/kstd/kstdio.h>
 #include <kernel/tasking/TaskManager.h>
 #include "kernel/memory/SafePointer.h"
+#include <kernel/Trace.h>
 
 void syscall_handler(ThreadRegisters& regs){
 #if defined(__i386__)
 	TrapFrame frame { nullptr, TrapFrame::Syscall, &regs };
 	TaskManager::current_thread()->enter_trap_frame(&frame);
 	TaskManager::current_thread()->enter_syscall();
-	regs.gp.eax = handle_syscall(regs, regs.gp.eax, regs.gp.ebx, regs.gp.ecx, regs.gp.edx);
+	auto call = regs.gp.eax;
+	TRACE(TRACE_SYSCALL_ENTER, call, regs.gp.ebx);
+	regs.gp.eax = handle_syscall(regs, call, regs.gp.ebx, regs.gp.ecx, regs.gp.edx);
+	TRACE(TRACE_SYSCALL_EXIT, call, regs.gp.eax);
 	TaskManager::current_thread()->leave_syscall();
 	TaskManager::current_thread()->exit_trap_frame();
 #endif // TODO: aarch64
@@ -212,14 +216,14 @@ int handle_syscall(ThreadRegisters& regs, size_t call, size_t arg1, size_t arg2,
 		case SYS_ACCEPT:
 			return cur_proc->sys_accept(arg1, (struct sockaddr*) arg2, (uint32_t*) arg3);
 		case SYS_FUTEX:
-			return cur_proc->sys_futex((int*) arg1, arg2);
+			return cur_proc->sys_futex((int*) arg1, arg2, arg3);
 		case SYS_YIELD:
 			TaskManager::yield();
 			return 0;
-
-		//TODO: Implement these syscalls
 		case SYS_TIMES:
-			return -1;
+			return cur_proc->sys_times((struct tms*) arg1, (clock_t*) arg2);
+		case SYS_GETRUSAGE:
+			return cur_proc->sys_getrusage(arg1, (struct rusage*) arg2);
 
 		default:
 #ifdef DEBUG
@@ -92,6 +92,7 @@
 #define SYS_ACCEPT 89
 #define SYS_FUTEX 90
 #define SYS_YIELD 91
+#define SYS_GETRUSAGE 92
 
 #ifndef DUCKOS_KERNEL
 #include <sys/types.h>
@@ -0,0 +1,61 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2024 Byteduck */
+
+#include "../tasking/Process.h"
+#include "../tasking/Thread.h"
+#include "../tasking/TaskManager.h"
+#include "../memory/SafePointer.h"
+#include "../time/TimeManager.h"
+#include "../api/times.h"
+#include "../api/resource.h"
+
+namespace {
+	clock_t us_to_clock(uint64_t us) {
+		return (clock_t) (us / (1000000 / CLOCKS_PER_SEC));
+	}
+
+	timeval us_to_timeval(uint64_t us) {
+		return {(time_t) (us / 1000000), (suseconds_t) (us % 1000000)};
+	}
+}
+
+int Process::sys_times(UserspacePointer<struct tms> buf, UserspacePointer<clock_t> ticks) {
+	auto self = cpu_time();
+	auto children = children_cpu_time();
+	struct tms ret = {
+		us_to_clock(self.user_us),
+		us_to_clock(self.kernel_us),
+		us_to_clock(children.user_us),
+		us_to_clock(children.kernel_us)
+	};
+	if(buf)
+		buf.set(ret);
+
+	// The tick count goes through a pointer since it would look like an error once it overflowed an int
+	auto uptime = TimeManager::uptime();
+	ticks.set((clock_t) (uptime.tv_sec * CLOCKS_PER_SEC + uptime.tv_usec / (1000000 / CLOCKS_PER_SEC)));
+	return SUCCESS;
+}
+
+int Process::sys_getrusage(int who, UserspacePointer<struct rusage> usage) {
+	CPUTime time;
+	switch(who) {
+	case RUSAGE_SELF:
+		time = cpu_time();
+		break;
+	case RUSAGE_CHILDREN:
+		time = children_cpu_time();
+		break;
+	case RUSAGE_THREAD:
+		time = TaskManager::current_thread()->cpu_time();
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	struct rusage ret = {};
+	ret.ru_utime = us_to_timeval(time.user_us);
+	ret.ru_stime = us_to_timeval(time.kernel_us);
+	usage.set(ret);
+	return SUCCESS;
+}
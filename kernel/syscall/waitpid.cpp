@@ -18,7 +18,11 @@ int Process::sys_waitpid(pid_t pid, UserspacePointer<int> status, int flags) {
 		status.set(blocker->status());
 	ASSERT(blocker->waited_process());
 	pid_t ret = blocker->waited_process()->pid();
-	if(WIFEXITED(blocker->status()) || WIFSIGNALED(blocker->status()))
-		blocker->waited_process()->reap();
+	if(WIFEXITED(blocker->status()) || WIFSIGNALED(blocker->status())) {
+		auto child = blocker->waited_process();
+		_children_cpu_time += child->cpu_time();
+		_children_cpu_time += child->children_cpu_time();
+		child->reap();
+	}
 	return ret;
 }
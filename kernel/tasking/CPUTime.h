@@ -0,0 +1,20 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2024 Byteduck */
+
+#pragma once
+
+#include <kernel/kstd/types.h>
+
+/**
+ * An amount of CPU time, split by whether it was spent running userspace code or in the kernel.
+ */
+struct CPUTime {
+	uint64_t user_us = 0;
+	uint64_t kernel_us = 0;
+
+	CPUTime& operator+=(const CPUTime& other) {
+		user_us += other.user_us;
+		kernel_us += other.kernel_us;
+		return *this;
+	}
+};
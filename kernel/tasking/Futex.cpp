@@ -3,6 +3,11 @@
 
 #include "Futex.h"
 #include "../memory/MemoryManager.h"
+#include "../memory/SafePointer.h"
+#include "TaskManager.h"
+
+kstd::vector<FutexWaiter*> FutexWaiter::s_waiters;
+Mutex FutexWaiter::s_lock {"FutexWaiter"};
 
 Futex::Futex(kstd::Arc<VMObject> object, size_t offset_in_object):
 	m_object(kstd::move(object)),
@@ -19,3 +24,73 @@ bool Futex::is_ready() {
 bool Futex::can_read(const FileDescriptor& fd) {
 	return is_ready();
 }
+
+int FutexWaiter::wait(VMObject* object, size_t offset, UserspacePointer<int> futex, int expected) {
+	FutexWaiter waiter {object, offset};
+
+	// Check the value and enqueue ourselves atomically with respect to wakers, or we could miss a wakeup.
+	{
+		LOCK(s_lock);
+		if(futex.get() != expected)
+			return -EAGAIN;
+		s_waiters.push_back(&waiter);
+	}
+
+	TaskManager::current_thread()->block(waiter);
+
+	// If we were interrupted, we're still in the queue.
+	LOCK(s_lock);
+	if(waiter.m_woken.load(MemoryOrder::Acquire))
+		return SUCCESS;
+	for(size_t i = 0; i < s_waiters.size(); i++) {
+		if(s_waiters[i] == &waiter) {
+			s_waiters.erase(i);
+			break;
+		}
+	}
+	return -EINTR;
+}
+
+int FutexWaiter::wake(VMObject* object, size_t offset, int count) {
+	LOCK(s_lock);
+	int woken = 0;
+	for(size_t i = 0; i < s_waiters.size() && woken < count;) {
+		auto* waiter = s_waiters[i];
+		if(waiter->m_object != object || waiter->m_offset != offset) {
+			i++;
+			continue;
+		}
+		s_waiters.erase(i);
+		waiter->m_woken.store(true, MemoryOrder::Release);
+		woken++;
+	}
+	return woken;
+}
+
+int FutexWaiter::requeue(VMObject* object, size_t offset, VMObject* target_object, size_t target_offset) {
+	LOCK(s_lock);
+	bool woke_one = false;
+	int requeued = 0;
+	for(size_t i = 0; i < s_waiters.size();) {
+		auto* waiter = s_waiters[i];
+		if(waiter->m_object != object || waiter->m_offset != offset) {
+			i++;
+			continue;
+		}
+		if(!woke_one) {
+			s_waiters.erase(i);
+			waiter->m_woken.store(true, MemoryOrder::Release);
+			woke_one = true;
+			continue;
+		}
+		waiter->m_object = target_object;
+		waiter->m_offset = target_offset;
+		requeued++;
+		i++;
+	}
+	return requeued;
+}
+
+bool FutexWaiter::is_ready() {
+	return m_woken.load(MemoryOrder::Acquire);
+}
@@ -6,6 +6,11 @@
 #include "Blocker.h"
 #include "../memory/VMRegion.h"
 #include "../filesystem/File.h"
+#include "../kstd/vector.hpp"
+#include "Mutex.h"
+
+template<typename T>
+class UserspacePointer;
 
 class Futex: public Blocker, public File {
 public:
@@ -22,3 +27,35 @@ private:
 	kstd::Arc<VMRegion> m_k_region;
 	Atomic<int>* m_var;
 };
+
+/**
+ * A thread blocked in FUTEX_WAIT_VALUE until another thread explicitly wakes it. Waiters are keyed by the VMObject and
+ * offset of the futex word, so they work across processes sharing memory.
+ */
+class FutexWaiter: public Blocker {
+public:
+	/**
+	 * Blocks the current thread on a futex word, unless it no longer holds the expected value.
+	 * @return SUCCESS if woken, -EAGAIN if the value didn't match, or -EINTR if interrupted.
+	 */
+	static int wait(VMObject* object, size_t offset, UserspacePointer<int> futex, int expected);
+
+	/// Wakes up to count threads waiting on the futex word, returning the number woken.
+	static int wake(VMObject* object, size_t offset, int count);
+
+	/// Wakes one thread waiting on a futex word and moves the rest to wait on the target word, returning the number moved.
+	static int requeue(VMObject* object, size_t offset, VMObject* target_object, size_t target_offset);
+
+	// Blocker
+	bool is_ready() override;
+
+private:
+	FutexWaiter(VMObject* object, size_t offset): m_object(object), m_offset(offset) {}
+
+	static kstd::vector<FutexWaiter*> s_waiters;
+	static Mutex s_lock;
+
+	VMObject* m_object;
+	size_t m_offset;
+	Atomic<bool> m_woken = false;
+};
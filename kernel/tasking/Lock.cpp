@@ -20,35 +20,71 @@
 #include "Lock.h"
 #include "Mutex.h"
 #include "TaskManager.h"
-#include <kernel/kstd/map.hpp>
-
-#ifdef DEBUG
-// Hmm, I need a simple set type, don't I.
-Mutex g_lock_registry_lock {"LockRegistry"};
-kstd::map<Lock*, int> g_lock_registry;
-#endif
-
-Lock::Lock(const kstd::string& name): m_name(name) {
-#ifdef DEBUG
-	if (__builtin_expect(this != &g_lock_registry_lock, true)) {
-		if (__builtin_expect(TaskManager::enabled(), true)) {
-			LOCK(g_lock_registry_lock);
-			g_lock_registry[this] = 1;
-		} else {
-			g_lock_registry[this] = 1;
+#include <kernel/kstd/cstring.h>
+#include <kernel/kstd/kstdlib.h>
+
+// These are zero-initialized rather than constructed, since global locks in other files may be constructed first.
+LockClass g_lock_classes[MAX_LOCK_CLASSES];
+size_t g_num_lock_classes;
+
+Lock::Lock(const kstd::string& name): m_name(name), m_class(LockClass::get(name)) {}
+
+Lock::~Lock() = default;
+
+LockClass* LockClass::get(const kstd::string& name) {
+	char class_name[LOCK_CLASS_NAME_LENGTH];
+	auto length = min(name.length(), (size_t) LOCK_CLASS_NAME_LENGTH - 1);
+	memcpy(class_name, name.c_str(), length);
+	class_name[length] = '\0';
+
+	// Classes are only added in critical sections, and are never removed.
+	// Before tasking is enabled, nothing else can be adding one at the same time.
+	bool critical = TaskManager::enabled();
+	if(critical)
+		TaskManager::enter_critical();
+
+	LockClass* ret = nullptr;
+	auto num_classes = g_num_lock_classes;
+	for(size_t i = 0; i < num_classes; i++) {
+		if(strcmp(g_lock_classes[i].name, class_name)) {
+			ret = &g_lock_classes[i];
+			break;
 		}
 	}
-#endif
+
+	if(!ret && num_classes < MAX_LOCK_CLASSES) {
+		ret = &g_lock_classes[num_classes];
+		strcpy(ret->name, class_name);
+		g_num_lock_classes = num_classes + 1;
+	}
+
+	if(critical)
+		TaskManager::leave_critical();
+	return ret;
 }
 
-#ifdef DEBUG
-Lock::~Lock() {
-	LOCK(g_lock_registry_lock);
-	g_lock_registry.erase(this);
+size_t LockClass::count() {
+	return g_num_lock_classes;
+}
+
+LockClass& LockClass::at(size_t index) {
+	return g_lock_classes[index];
+}
+
+// These are called in critical sections, and we only have one CPU, so the counters don't need to be atomic.
+
+void LockClass::contended(uint64_t wait) {
+	contentions++;
+	total_wait += wait;
+	if(wait > max_wait)
+		max_wait = wait;
+}
+
+void LockClass::released(uint64_t hold) {
+	acquisitions++;
+	if(hold > max_hold)
+		max_hold = hold;
 }
-#else
-Lock::~Lock() = default;
-#endif
 
 ScopedLocker::ScopedLocker(Lock& lock): _lock(lock) {
 	_lock.acquire();
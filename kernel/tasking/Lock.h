@@ -24,8 +24,42 @@
 #define LOCK(lock) const ScopedLocker __locker((lock))
 #define LOCK_N(lock, name) const ScopedLocker name((lock))
 
+#define LOCK_CLASS_NAME_LENGTH 32
+#define MAX_LOCK_CLASSES 128
+
 class Lock;
 
+/**
+ * Contention statistics shared by every lock with the same name (for instance, every VMSpace's lock). Times are in
+ * TSC cycles. Classes are never freed, so the statistics cover the whole uptime of the system.
+ */
+struct LockClass {
+	char name[LOCK_CLASS_NAME_LENGTH];
+	uint64_t acquisitions; ///The number of times a lock of this class was acquired (not counting recursive acquisitions).
+	uint64_t contentions; ///The number of times a thread had to wait for (or failed to try-acquire) a lock of this class.
+	uint64_t total_wait; ///The total time threads spent waiting for locks of this class.
+	uint64_t max_wait; ///The longest time a thread spent waiting for a lock of this class.
+	uint64_t max_hold; ///The longest time a lock of this class was held.
+
+	/**
+	 * Gets the class for locks with the given name, creating it if needed.
+	 * @return The class, or nullptr if there are already MAX_LOCK_CLASSES classes.
+	 */
+	static LockClass* get(const kstd::string& name);
+
+	/** Returns the number of lock classes. **/
+	static size_t count();
+
+	/** Returns the lock class at the given index. Classes are never removed, so indices are stable. **/
+	static LockClass& at(size_t index);
+
+	/** Records a contention and, if the lock was eventually acquired, how long it was waited for. **/
+	void contended(uint64_t wait);
+
+	/** Records an acquisition that was just released after being held for the given time. **/
+	void released(uint64_t hold);
+};
+
 class ScopedLocker {
 public:
 	explicit ScopedLocker(Lock& lock);
@@ -44,9 +78,7 @@ public:
 	virtual void release() = 0;
 	virtual const kstd::string& name() { return m_name; }
 
-#ifdef DEBUG
-	virtual unsigned long contest_count() { return m_contest_count.load(MemoryOrder::Relaxed); }
-#endif
+	[[nodiscard]] LockClass* lock_class() const { return m_class; }
 
 	template<typename R, typename F>
 	R synced(F&& lambda) {
@@ -56,6 +88,6 @@ public:
 
 protected:
 	kstd::string m_name;
-	Atomic<unsigned long> m_contest_count = 0;
+	LockClass* m_class;
 };
 
@@ -19,6 +19,8 @@
 
 #include "Mutex.h"
 #include "TaskManager.h"
+#include <kernel/Trace.h>
+#include <kernel/time/TimeManager.h>
 
 extern bool g_panicking;
 
@@ -38,6 +40,9 @@ void Mutex::release() {
 
 	// Decrease counter. If the counter is zero, release the lock
 	if(m_times_locked.sub(1, MemoryOrder::Release) == 1) {
+		if(m_class && m_acquired_at)
+			m_class->released(TimeManager::cycles() - m_acquired_at);
+		m_acquired_at = 0;
 		TaskManager::current_thread()->released_lock(this);
 		m_holding_thread.store(-1, MemoryOrder::SeqCst);
 	}
@@ -62,6 +67,8 @@ inline bool Mutex::acquire_with_mode() {
 	if(!TaskManager::enabled() || !cur_thread || g_panicking)
 		return true; //Tasking isn't initialized yet
 	auto cur_tid = cur_thread->tid();
+	bool contended = false;
+	uint64_t wait_start = 0;
 
 	//Loop while the lock is held
 	while(true) {
@@ -72,6 +79,11 @@ inline bool Mutex::acquire_with_mode() {
 		tid_t expected = -1;
 		if(m_holding_thread.compare_exchange_strong(expected, cur_tid, MemoryOrder::Acquire)) {
 			TaskManager::current_thread()->acquired_lock(this);
+			m_acquired_at = TimeManager::cycles();
+			if(contended && m_class) {
+				TaskManager::ScopedCritical crit;
+				m_class->contended(m_acquired_at - wait_start);
+			}
 			break;
 		}
 
@@ -79,14 +91,20 @@ inline bool Mutex::acquire_with_mode() {
 		if(expected == cur_tid)
 			break;
 
-#ifdef DEBUG
-		m_contest_count.add(1, MemoryOrder::Relaxed);
-#endif
-
 		if constexpr(mode == AcquireMode::Try) {
+			if(m_class) {
+				TaskManager::ScopedCritical crit;
+				m_class->contended(0);
+			}
 			return false;
 		}
 
+		if(!contended) {
+			TRACE(TRACE_LOCK_CONTENDED, this, expected);
+			contended = true;
+			wait_start = TimeManager::cycles();
+		}
+
 		if constexpr(mode == AcquireMode::EnterCritical) {
 			TaskManager::leave_critical();
 			ASSERT(!TaskManager::in_critical());
@@ -53,6 +53,7 @@ private:
 
 	Atomic<tid_t, MemoryOrder::SeqCst> m_holding_thread = -1;
 	Atomic<int, MemoryOrder::SeqCst> m_times_locked = 0;
+	uint64_t m_acquired_at = 0; ///The TSC cycle count when the holding thread acquired the lock, for the lock's class's statistics.
 };
 
 class ScopedCriticalLocker {
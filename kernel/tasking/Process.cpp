@@ -30,6 +30,7 @@
 #include "../filesystem/procfs/ProcFS.h"
 #include "WaitBlocker.h"
 #include "kernel/KernelMapper.h"
+#include "../time/TimeManager.h"
 
 Process* Process::create_kernel(const kstd::string& name, void (*func)()){
 	ProcessArgs args = ProcessArgs(kstd::Arc<LinkedInode>(nullptr));
@@ -171,6 +172,23 @@ kstd::Arc<Thread> Process::get_thread(tid_t tid) {
 	return {};
 }
 
+CPUTime Process::cpu_time() {
+	auto ret = _dead_threads_cpu_time;
+	for_each_thread([&] (const kstd::Arc<Thread>& thread) -> bool {
+		ret += thread->cpu_time();
+		return true;
+	});
+	return ret;
+}
+
+CPUTime Process::children_cpu_time() {
+	return _children_cpu_time;
+}
+
+timeval Process::start_time() {
+	return _start_time;
+}
+
 Process::Process(const kstd::string& name, size_t entry_point, bool kernel, ProcessArgs* args, pid_t pid, pid_t ppid):
 		_user(User::root()),
 		_name(name),
@@ -178,7 +196,8 @@ Process::Process(const kstd::string& name, size_t entry_point, bool kernel, Proc
 		_kernel_mode(kernel),
 		_ppid(_pid > 1 ? ppid : 0),
 		_state(ALIVE),
-		_self_ptr(this)
+		_self_ptr(this),
+		_start_time(TimeManager::uptime())
 {
 	if(!kernel) {
 		auto ttydesc = kstd::make_shared<FileDescriptor>(VirtualTTY::current_tty());
@@ -199,7 +218,7 @@ Process::Process(const kstd::string& name, size_t entry_point, bool kernel, Proc
 	insert_thread(kstd::Arc<Thread>(main_thread));
 }
 
-Process::Process(Process *to_fork, ThreadRegisters& regs): _user(to_fork->_user), _self_ptr(this) {
+Process::Process(Process *to_fork, ThreadRegisters& regs): _user(to_fork->_user), _self_ptr(this), _start_time(TimeManager::uptime()) {
 	if(to_fork->_kernel_mode)
 		PANIC("KRNL_PROCESS_FORK", "Kernel processes cannot be forked.");
 
@@ -376,6 +395,7 @@ void Process::insert_thread(const kstd::Arc<Thread>& thread) {
 
 void Process::remove_thread(const kstd::Arc<Thread>& thread) {
 	LOCK(_thread_lock);
+	_dead_threads_cpu_time += thread->cpu_time();
 	_thread_return_values[thread->_tid] = thread->_return_value;
 	_threads.erase(thread->_tid);
 	for(size_t i = 0; i < _tids.size(); i++) {
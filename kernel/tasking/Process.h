@@ -29,6 +29,7 @@
 #include "../api/poll.h"
 #include "../api/mmap.h"
 #include "Tracer.h"
+#include "CPUTime.h"
 #include "../kstd/KLog.h"
 
 class FileDescriptor;
@@ -82,6 +83,11 @@ public:
 	const kstd::vector<tid_t>& threads();
 	kstd::Arc<Thread> get_thread(tid_t tid);
 
+	//CPU time
+	CPUTime cpu_time(); ///< The CPU time used by all of the process's threads, living or dead.
+	CPUTime children_cpu_time(); ///< The CPU time used by the process's children that have been waited on.
+	timeval start_time(); ///< The uptime at which the process was started.
+
 	//Signals and death
 	void kill(int signal);
 	void die();
@@ -185,7 +191,9 @@ public:
 	int sys_listen(int sockfd, int backlog);
 	int sys_shutdown(int sockfd, int how);
 	int sys_accept(int sockfd, UserspacePointer<struct sockaddr> addr, UserspacePointer<uint32_t> addrlen);
-	int sys_futex(UserspacePointer<int> futex, int operation);
+	int sys_futex(UserspacePointer<int> futex, int operation, int arg);
+	int sys_times(UserspacePointer<struct tms> buf, UserspacePointer<clock_t> ticks);
+	int sys_getrusage(int who, UserspacePointer<struct rusage> usage);
 
 private:
 	friend class Thread;
@@ -255,6 +263,11 @@ private:
 	tid_t _last_active_thread = 1;
 	Mutex _thread_lock {"Process::Thread"};
 
+	//CPU time
+	CPUTime _dead_threads_cpu_time;
+	CPUTime _children_cpu_time;
+	timeval _start_time = {0, 0};
+
 	//Tracing
 	Mutex _tracing_lock {"Process::Tracing"};
 	kstd::vector<kstd::Arc<Tracer>> _tracers;
@@ -29,6 +29,7 @@
 #include <kernel/kstd/KLog.h>
 #include <kernel/net/NetworkManager.h>
 #include "../device/DiskDevice.h"
+#include <kernel/Trace.h>
 
 TSS TaskManager::tss;
 Mutex TaskManager::g_tasking_lock {"Tasking"};
@@ -405,6 +406,9 @@ void TaskManager::preempt(){
 		if(old_thread->tid() != kernel_process->pid() && old_thread->can_be_run())
 			queue_thread(old_thread);
 
+		TRACE(TRACE_CONTEXT_SWITCH, next_thread->tid(), old_thread->state());
+		old_thread->charge_cpu_time();
+		next_thread->start_cpu_clock();
 		cur_thread = next_thread;
 		next_thread.reset();
 
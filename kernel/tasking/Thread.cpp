@@ -30,6 +30,7 @@
 #include "Reaper.h"
 #include "WaitBlocker.h"
 #include <kernel/arch/Processor.h>
+#include <kernel/time/TimeManager.h>
 
 Thread::Thread(Process* process, tid_t tid, size_t entry_point, ProcessArgs* args):
 	_tid(tid),
@@ -204,15 +205,48 @@ bool Thread::can_be_run() {
 }
 
 void Thread::enter_trap_frame(TrapFrame* frame) {
+	// Coming into the kernel from userspace, so what we ran since the clock was last charged was user time
+	if(!_cur_trap_frame)
+		charge_cpu_time();
 	frame->prev = _cur_trap_frame;
 	_cur_trap_frame = frame;
 }
 
 void Thread::exit_trap_frame() {
 	ASSERT(_cur_trap_frame);
+	// Going back out to userspace, so what we ran since the clock was last charged was kernel time
+	if(!_cur_trap_frame->prev)
+		charge_cpu_time();
 	_cur_trap_frame = _cur_trap_frame->prev;
 }
 
+CPUTime Thread::cpu_time() {
+	uint64_t user = m_user_cycles;
+	uint64_t kernel = m_kernel_cycles;
+
+	// If we're the one asking, count what we've run since the clock was last charged too (which must be kernel time)
+	if(TaskManager::current_thread().get() == this && m_cpu_clock_start)
+		kernel += TimeManager::cycles() - m_cpu_clock_start;
+
+	return {TimeManager::cycles_to_us(user), TimeManager::cycles_to_us(kernel)};
+}
+
+void Thread::start_cpu_clock() {
+	m_cpu_clock_start = TimeManager::cycles();
+}
+
+void Thread::charge_cpu_time() {
+	auto now = TimeManager::cycles();
+	if(m_cpu_clock_start) {
+		// We're in userspace if we aren't in a trap, unless we're a kernel thread
+		if(!_cur_trap_frame && !is_kernel_mode())
+			m_user_cycles += now - m_cpu_clock_start;
+		else
+			m_kernel_cycles += now - m_cpu_clock_start;
+	}
+	m_cpu_clock_start = now;
+}
+
 PageDirectory* Thread::page_directory() const {
 	return m_page_directory ? m_page_directory.get() : &MM.kernel_page_directory;
 }
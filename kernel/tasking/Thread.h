@@ -31,6 +31,7 @@
 #include "kernel/kstd/circular_queue.hpp"
 #include "../kstd/KLog.h"
 #include "Tracer.h"
+#include "CPUTime.h"
 #include <kernel/arch/registers.h>
 
 #define THREAD_STACK_SIZE 1048576 //1024KiB
@@ -40,6 +41,7 @@ class Process;
 class Blocker;
 class ProcessArgs;
 template<typename T> class UserspacePointer;
+
 class Thread: public kstd::ArcSelf<Thread> {
 public:
 	enum State {
@@ -110,6 +112,11 @@ public:
 	Result trace_attach(kstd::Arc<Tracer> tracer);
 	void trace_detach();
 
+	//CPU time
+	CPUTime cpu_time();
+	void start_cpu_clock();
+	void charge_cpu_time();
+
 	uint8_t fpu_state[512] __attribute__((aligned(16)));
 	ThreadRegisters registers = {};
 	ThreadRegisters signal_registers = {};
@@ -169,6 +176,11 @@ private:
 	// Tracing
 	Mutex m_tracing_lock {"Thread::Tracing"};
 	kstd::Arc<Tracer> m_tracer;
+
+	// CPU time (in cycles, converted when read)
+	uint64_t m_user_cycles = 0;
+	uint64_t m_kernel_cycles = 0;
+	uint64_t m_cpu_clock_start = 0; ///< When the running thread's time was last charged, or 0 if it hasn't run yet.
 };
 
 void print_arg(Thread* thread, KLog::FormatRules rules);
\ No newline at end of file
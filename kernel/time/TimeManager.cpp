@@ -20,6 +20,7 @@
 #include <kernel/tasking/TaskManager.h>
 #include "TimeManager.h"
 #include <kernel/kstd/KLog.h>
+#include <kernel/device/ProfileDevice.h>
 
 #if defined(__i386__)
 #include "kernel/arch/i386/time/PIT.h"
@@ -89,6 +90,7 @@ void TimeManager::tick() {
 	if(idle_ticks.size() == 100)
 		idle_ticks.pop_front();
 	idle_ticks.push_back(TaskManager::is_idle());
+	ProfileDevice::tick();
 	TaskManager::tick();
 
 #if defined(__i386__)
@@ -102,6 +104,20 @@ void TimeManager::tick() {
 	_epoch.tv_usec = _uptime.tv_usec;
 }
 
+uint64_t TimeManager::cycles() {
+#if defined(__i386__)
+	return read_tsc();
+#else
+	return 0; // TODO: aarch64
+#endif
+}
+
+uint64_t TimeManager::cycles_to_us(uint64_t cycles) {
+	if(!_inst || !_inst->_tsc_speed)
+		return 0;
+	return cycles / _inst->_tsc_speed;
+}
+
 double TimeManager::percent_idle() {
 	bool* ticks_storage = _inst->idle_ticks.storage();
 	int num_idle = 0;
@@ -32,6 +32,16 @@ public:
 	static timeval now();
 	static double percent_idle();
 
+	/**
+	 * Reads a fast cycle counter, for timing short intervals like how long a thread ran for.
+	 */
+	static uint64_t cycles();
+
+	/**
+	 * Converts a number of cycles from cycles() into microseconds.
+	 */
+	static uint64_t cycles_to_us(uint64_t cycles);
+
 protected:
 	friend class TimeKeeper;
 	void tick();
@@ -4,6 +4,7 @@
 #pragma once
 
 #include <libgraphics/Geometry.h>
+#include <cstring>
 
 namespace Lib3D {
 	template<typename T>
@@ -15,12 +16,12 @@ namespace Lib3D {
 
 		Buffer2D(const Buffer2D& other):
 			m_width(other.m_width), m_height(other.m_height),
-			m_data(new T[other.width, other.height])
+			m_data(new T[other.m_width * other.m_height])
 		{
 			memcpy(m_data, other.m_data, m_width * m_height * sizeof(T));
 		}
 
-		Buffer2D(Buffer2D&& other):
+		Buffer2D(Buffer2D&& other) noexcept:
 			m_width(other.m_width), m_height(other.m_height),
 			m_data(other.m_data)
 		{
@@ -28,7 +29,7 @@ namespace Lib3D {
 		}
 
 		Buffer2D& operator=(const Buffer2D& other) {
-			delete m_data;
+			delete[] m_data;
 			m_width = other.m_width;
 			m_height = other.m_height;
 			m_data = new T[m_width * m_height];
@@ -37,7 +38,7 @@ namespace Lib3D {
 		}
 
 		Buffer2D& operator=(Buffer2D&& other) noexcept {
-			delete m_data;
+			delete[] m_data;
 			m_width = other.m_width;
 			m_height = other.m_height;
 			m_data = other.m_data;
@@ -46,7 +47,7 @@ namespace Lib3D {
 		}
 
 		~Buffer2D() {
-			delete m_data;
+			delete[] m_data;
 		}
 
 		inline T& at(size_t x, size_t y) {
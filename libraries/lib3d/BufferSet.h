@@ -15,7 +15,7 @@ namespace Lib3D {
 			depth(dimensions.width, dimensions.height)
 		{}
 
-		Buffer2D<Vec4f> color;
+		Buffer2D<Gfx::Color> color;
 		Buffer2D<float> depth;
 	};
 }
@@ -2,27 +2,79 @@
 /* Copyright © 2016-2023 Byteduck */
 
 #include "RenderContext.h"
+#include <libduck/CPU.h>
+#include <libgraphics/Blit.h>
+#include <algorithm>
+#include <cmath>
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <emmintrin.h>
+#define LIB3D_SSE2
+#endif
+
+// Vertices are snapped to 28.4 fixed point
+#define SUBPIXEL_BITS 4
+#define SUBPIXEL_ONE (1 << SUBPIXEL_BITS)
+// We don't clip triangles, so vertices further out than this are rejected to keep the edge functions from overflowing
+#define MAX_COORDINATE 8192
 
 using namespace Lib3D;
 
+#ifdef LIB3D_SSE2
+static bool use_sse2() {
+	static bool sse2 = Duck::CPU::has_sse2();
+	return sse2;
+}
+#endif
+
+static inline uint8_t to_channel(float val) {
+	return (uint8_t) std::min(std::max(val * 255.0f, 0.0f), 255.0f);
+}
+
 RenderContext::RenderContext(Gfx::Dimensions dimensions):
 	m_viewport({0, 0, dimensions}),
 	m_buffers(dimensions)
-{}
+{
+	resize_bins();
+}
+
+RenderContext::~RenderContext() {
+	stop_threads();
+}
 
 void RenderContext::set_viewport(Gfx::Rect rect) {
 	m_viewport = rect;
 	m_buffers = BufferSet(rect.dimensions());
+	m_tris.clear();
+	resize_bins();
+}
+
+void RenderContext::set_num_threads(int num_threads) {
+	stop_threads();
+	m_stopping = false;
+	for(int i = 1; i < num_threads; i++) {
+		pthread_t thread;
+		if(pthread_create(&thread, nullptr, worker_main, this) != 0)
+			break;
+		m_threads.push_back(thread);
+	}
 }
 
 void RenderContext::clear(Vec4f color) {
-	m_buffers.depth.fill(-INFINITY);
-	m_buffers.color.fill(color);
+	// Anything drawn before this would just get cleared, so throw it away and clear each tile when it's rendered
+	m_tris.clear();
+	for(auto& bin : m_bins)
+		bin.clear();
+	m_clear_pending = true;
+	m_clear_color = vec_to_color(color);
 }
 
 #define f2i(f) ((int) ((f)))
 
 void RenderContext::line(Vertex a, Vertex b) {
+	// Lines are drawn straight into the buffers, so everything before them has to be drawn first
+	flush();
+
 	bool steep = false;
 	if(abs(a.pos.x() - b.pos.x()) < abs(a.pos.y() - b.pos.y())) {
 		a.pos = {a.pos.y(), a.pos.x(), a.pos.z()};
@@ -41,7 +93,7 @@ void RenderContext::line(Vertex a, Vertex b) {
 		const int xint = f2i(x);
 		const int yint = f2i(y);
 		const float lerp = (x - a.pos.x()) / diff.x();
-		const Vec4f color = a.color * (1.0f - lerp) + b.color * lerp;
+		const Gfx::Color color = vec_to_color(a.color * (1.0f - lerp) + b.color * lerp);
 		if(steep) {
 			if (m_buffers.depth.get(yint, xint) < -z) {
 				m_buffers.color.set(yint, xint, color);
@@ -63,10 +115,39 @@ void RenderContext::line(Vertex a, Vertex b) {
 }
 
 void RenderContext::tri(std::array<Vertex, 3> verts) {
-	tri_barycentric(verts);
+	setup_tri(verts);
+}
+
+void RenderContext::flush() {
+	if(m_tris.empty() && !m_clear_pending)
+		return;
+
+	// Hand out one ticket to each worker, and then render tiles alongside them until they're all taken
+	m_next_tile = 0;
+	if(!m_threads.empty()) {
+		pthread_mutex_lock(&m_work_lock);
+		m_work_tickets = (int) m_threads.size();
+		m_workers_done = 0;
+		pthread_cond_broadcast(&m_work_cond);
+		pthread_mutex_unlock(&m_work_lock);
+	}
+
+	render_tiles();
+
+	if(!m_threads.empty()) {
+		pthread_mutex_lock(&m_work_lock);
+		while(m_workers_done < (int) m_threads.size())
+			pthread_cond_wait(&m_done_cond, &m_work_lock);
+		pthread_mutex_unlock(&m_work_lock);
+	}
+
+	m_tris.clear();
+	for(auto& bin : m_bins)
+		bin.clear();
+	m_clear_pending = false;
 }
 
-void RenderContext::tri_barycentric(std::array<Vertex, 3> verts) {
+void RenderContext::setup_tri(std::array<Vertex, 3> verts) {
 	// Transform into world coords
 	std::array<Vec3f, 3> tri;
 	for(int i = 0; i < 3; i++) {
@@ -82,131 +163,102 @@ void RenderContext::tri_barycentric(std::array<Vertex, 3> verts) {
 			norm * Vec3f(0, 0, 1) :
 			Vec3f(std::abs(norm.x()), std::abs(norm.y()), std::abs(norm.z())) * Vec3f(0, 0, 1);
 
-	// Then, transform into screenspace coordinates and calculate bounding box
+	// Then, transform into screenspace coordinates and snap them to fixed point
 	std::array<Vec3f, 3> sstri;
-	Vec2i bbox_max = {0, 0};
-	Vec2i bbox_min = {m_viewport.width - 1, m_viewport.height - 1};
+	int32_t fx[3], fy[3];
 	for(int i = 0; i < 3; i++) {
 		sstri[i] = screenspace(tri[i]);
-		bbox_min.x() = std::min(bbox_min.x(), f2i(sstri[i].x() + 0.5f));
-		bbox_min.y() = std::min(bbox_min.y(), f2i(sstri[i].y() + 0.5f));
-		bbox_max.x() = std::max(bbox_max.x(), f2i(sstri[i].x() + 0.5f));
-		bbox_max.y() = std::max(bbox_max.y(), f2i(sstri[i].y() + 0.5f));
-	}
-	bbox_min.x() = std::max(bbox_min.x(), 0);
-	bbox_min.y() = std::max(bbox_min.y(), 0);
-	bbox_max.x() = std::min(bbox_max.x(), m_viewport.width - 1);
-	bbox_max.y() = std::min(bbox_max.y(), m_viewport.height - 1);
-
-	// Whether the tri takes up just one pixel
-	const bool pixel = bbox_max.x() == bbox_min.x() && bbox_max.y() == bbox_min.y();
-
-	// Calculate the barycentric coordinates of the top-left of our bounding box
-	const Vec3f a {sstri[2].x() - sstri[0].x(), sstri[1].x() - sstri[0].x(), sstri[0].x() - (float) bbox_min.x()};
-	const Vec3f b {sstri[2].y() - sstri[0].y(), sstri[1].y() - sstri[0].y(), sstri[0].y() - (float) bbox_min.y()};
-	const Vec3f u = a^b;
-	Vec3f bary = {
-		1.0f - (u.x() + u.y()) / u.z(),
-		u.y() / u.z(),
-		u.x() / u.z()
-	};
+		if(!(std::abs(sstri[i].x()) < MAX_COORDINATE && std::abs(sstri[i].y()) < MAX_COORDINATE))
+			return;
+		fx[i] = (int32_t) lroundf(sstri[i].x() * SUBPIXEL_ONE);
+		fy[i] = (int32_t) lroundf(sstri[i].y() * SUBPIXEL_ONE);
+	}
 
-	// Calculate x and y steps for barycentric coordinates
-	const Vec3f barystep_x = {
-		-(b.y() + -b.x()) / u.z(),
-		-b.x() / u.z(),
-		b.y() / u.z()
-	};
-	const Vec3f barystep_y = {
-			-(a.x() - a.y()) / u.z(),
-			a.x() / u.z(),
-			-a.y() / u.z()
-	};
+	// Front faces have a positive area in screenspace. If we're drawing back faces too, flip them around.
+	int64_t area = (int64_t) (fx[1] - fx[0]) * (fy[2] - fy[0]) - (int64_t) (fy[1] - fy[0]) * (fx[2] - fx[0]);
+	if(area == 0)
+		return;
+	if(area < 0) {
+		if(m_backface_culling)
+			return;
+		std::swap(verts[1], verts[2]);
+		std::swap(sstri[1], sstri[2]);
+		std::swap(fx[1], fx[2]);
+		std::swap(fy[1], fy[2]);
+		area = -area;
+	}
 
-	// Calculate x and y step for tex coords, color, and depth
-	Vec2f tex;
-	Vec2f texstep_x;
-	Vec2f texstep_y;
-
-	Vec4f color;
-	Vec4f colorstep_x;
-	Vec4f colorstep_y;
-
-	float z = 0;
-	float zstep_x = 0;
-	float zstep_y = 0;
-
-	for (int i = 0; i < 3; i++) {
-		tex += verts[i].tex * bary[i];
-		texstep_x += verts[i].tex * barystep_x[i];
-		texstep_y += verts[i].tex * barystep_y[i];
-
-		color += {
-				verts[i].color[0] * bary[i] * light,
-				verts[i].color[1] * bary[i] * light,
-				verts[i].color[2] * bary[i] * light,
-				verts[i].color[3] * bary[i]
-		};
-		colorstep_x += verts[i].color * light * barystep_x[i];
-		colorstep_y += verts[i].color * light * barystep_y[i];
-
-		z += sstri[i].z() * bary[i];
-		zstep_x += sstri[i].z() * barystep_x[i];
-		zstep_y += sstri[i].z() * barystep_y[i];
-	}
-
-	for(int y = bbox_min.y(); y <= bbox_max.y(); y++) {
-		// Save our barycentric coords, texcoords, and color at the start of the line
-		const auto obary = bary;
-		const auto otex = tex;
-		const auto ocolor = color;
-		const auto oz = z;
-		bool was_inside = false;
-
-		for(int x = bbox_min.x(); x <= bbox_max.x(); x++) {
-			if (!pixel && (bary.x() < 0 || bary.y() < 0 || bary.z() < 0)) {
-				// If we were previously inside the triangle on this line, we're done and can skip to the next line
-				if (was_inside)
-					break;
-				goto done;
-			}
-			was_inside = true;
-
-			if (m_depth_testing && m_buffers.depth.at(x, y) >= z)
-				goto done;
-
-			if (m_bound_texture) {
-				const Vec4f texcol = m_bound_texture->buffer().get(tex.x() * m_bound_texture->buffer().width(), tex.y() * m_bound_texture->buffer().height());
-				const Vec4f sampled_color = {
-						color[0] * texcol[0],
-						color[1] * texcol[1],
-						color[2] * texcol[2],
-						color[3] * texcol[3]
-				};
-				if (m_alpha_testing && sampled_color.w() <= 0)
-					goto done;
-				m_buffers.color.at(x, y) = sampled_color;
-			} else {
-				if (m_alpha_testing && color.w() <= 0)
-					goto done;
-				m_buffers.color.at(x, y) = color;
-			}
+	// Calculate the bounding box, clipped to the viewport
+	Gfx::Rect bbox;
+	{
+		int min_x = std::min({fx[0], fx[1], fx[2]}) >> SUBPIXEL_BITS;
+		int min_y = std::min({fy[0], fy[1], fy[2]}) >> SUBPIXEL_BITS;
+		int max_x = (std::max({fx[0], fx[1], fx[2]}) + SUBPIXEL_ONE - 1) >> SUBPIXEL_BITS;
+		int max_y = (std::max({fy[0], fy[1], fy[2]}) + SUBPIXEL_ONE - 1) >> SUBPIXEL_BITS;
+		min_x = std::max(min_x, 0);
+		min_y = std::max(min_y, 0);
+		max_x = std::min(max_x, m_viewport.width - 1);
+		max_y = std::min(max_y, m_viewport.height - 1);
+		if(max_x < min_x || max_y < min_y)
+			return;
+		bbox = {min_x, min_y, max_x - min_x + 1, max_y - min_y + 1};
+	}
 
-			m_buffers.depth.at(x, y) = z;
+	TriSetup setup;
+	setup.bbox = bbox;
 
-			done:
-			tex += texstep_x;
-			bary += barystep_x;
-			color += colorstep_x;
-			z += zstep_x;
-		}
+	// Edge i runs from vertex i to vertex i + 1. Pixel centers exactly on an edge only belong to the triangle if the
+	// edge is a top or left edge, so that triangles sharing an edge don't both draw it.
+	for(int i = 0; i < 3; i++) {
+		int j = (i + 1) % 3;
+		int32_t a = fy[i] - fy[j];
+		int32_t b = fx[j] - fx[i];
+		bool top_left = a > 0 || (a == 0 && b > 0);
+		setup.edge_a[i] = a;
+		setup.edge_b[i] = b;
+		setup.edge_c[i] = -((int64_t) a * fx[i] + (int64_t) b * fy[i]) - (top_left ? 0 : 1);
+	}
+
+	// Set up the planes for each attribute
+	const float inv_area = (float) (SUBPIXEL_ONE * SUBPIXEL_ONE) / (float) area;
+	const float x0 = (float) fx[0] / SUBPIXEL_ONE, y0 = (float) fy[0] / SUBPIXEL_ONE;
+	const float x10 = (float) (fx[1] - fx[0]) / SUBPIXEL_ONE, y10 = (float) (fy[1] - fy[0]) / SUBPIXEL_ONE;
+	const float x20 = (float) (fx[2] - fx[0]) / SUBPIXEL_ONE, y20 = (float) (fy[2] - fy[0]) / SUBPIXEL_ONE;
+	auto set_plane = [&](int attribute, float v0, float v1, float v2) {
+		const float dx = ((v1 - v0) * y20 - (v2 - v0) * y10) * inv_area;
+		const float dy = ((v2 - v0) * x10 - (v1 - v0) * x20) * inv_area;
+		setup.dx[attribute] = dx;
+		setup.dy[attribute] = dy;
+		setup.base[attribute] = v0 - dx * x0 - dy * y0;
+	};
+	set_plane(TriSetup::Z, sstri[0].z(), sstri[1].z(), sstri[2].z());
+	set_plane(TriSetup::R, verts[0].color[0] * light, verts[1].color[0] * light, verts[2].color[0] * light);
+	set_plane(TriSetup::G, verts[0].color[1] * light, verts[1].color[1] * light, verts[2].color[1] * light);
+	set_plane(TriSetup::B, verts[0].color[2] * light, verts[1].color[2] * light, verts[2].color[2] * light);
+	set_plane(TriSetup::A, verts[0].color[3], verts[1].color[3], verts[2].color[3]);
+	set_plane(TriSetup::U, verts[0].tex.x(), verts[1].tex.x(), verts[2].tex.x());
+	set_plane(TriSetup::V, verts[0].tex.y(), verts[1].tex.y(), verts[2].tex.y());
 
-		// Step bary, tex, color by y step
-		bary = obary + barystep_y;
-		tex = otex + texstep_y;
-		color = ocolor + colorstep_y;
-		z = oz + zstep_y;
+	// Pick a mipmap level based on how many texels each pixel steps over
+	setup.texture = m_bound_texture;
+	setup.texture_level = 0;
+	if(m_bound_texture) {
+		const float width = m_bound_texture->buffer().width(), height = m_bound_texture->buffer().height();
+		const float step_x = std::hypot(setup.dx[TriSetup::U] * width, setup.dx[TriSetup::V] * height);
+		const float step_y = std::hypot(setup.dy[TriSetup::U] * width, setup.dy[TriSetup::V] * height);
+		setup.texture_level = m_bound_texture->level_for(std::max(step_x, step_y));
 	}
+	setup.depth_testing = m_depth_testing;
+	setup.alpha_testing = m_alpha_testing;
+
+	// Finally, add it to the bin of every tile it touches
+	const auto index = (uint32_t) m_tris.size();
+	m_tris.push_back(setup);
+	const int tile_x0 = bbox.x / LIB3D_TILE_SIZE, tile_x1 = (bbox.x + bbox.width - 1) / LIB3D_TILE_SIZE;
+	const int tile_y0 = bbox.y / LIB3D_TILE_SIZE, tile_y1 = (bbox.y + bbox.height - 1) / LIB3D_TILE_SIZE;
+	for(int tile_y = tile_y0; tile_y <= tile_y1; tile_y++)
+		for(int tile_x = tile_x0; tile_x <= tile_x1; tile_x++)
+			m_bins[tile_x + tile_y * m_tiles_x].push_back(index);
 }
 
 void RenderContext::tri_wireframe(std::array<Vertex, 3> verts) {
@@ -220,3 +272,264 @@ void RenderContext::tri_wireframe(std::array<Vertex, 3> verts) {
 	line(verts[1], verts[2]);
 	line(verts[2], verts[0]);
 }
+
+void RenderContext::resize_bins() {
+	m_tiles_x = (m_viewport.width + LIB3D_TILE_SIZE - 1) / LIB3D_TILE_SIZE;
+	m_tiles_y = (m_viewport.height + LIB3D_TILE_SIZE - 1) / LIB3D_TILE_SIZE;
+	m_bins.clear();
+	m_bins.resize(std::max(m_tiles_x * m_tiles_y, 0));
+}
+
+void RenderContext::render_tiles() {
+	const int num_tiles = (int) m_bins.size();
+	int tile;
+	while((tile = m_next_tile++) < num_tiles)
+		render_tile(tile);
+}
+
+void RenderContext::render_tile(int tile) {
+	const int tile_x = (tile % m_tiles_x) * LIB3D_TILE_SIZE;
+	const int tile_y = (tile / m_tiles_x) * LIB3D_TILE_SIZE;
+	const Gfx::Rect tile_rect = {
+		tile_x,
+		tile_y,
+		std::min(LIB3D_TILE_SIZE, m_viewport.width - tile_x),
+		std::min(LIB3D_TILE_SIZE, m_viewport.height - tile_y)
+	};
+
+	if(m_clear_pending) {
+		for(int y = tile_rect.y; y < tile_rect.y + tile_rect.height; y++) {
+			Gfx::Blit::fill_row(&m_buffers.color.at(tile_rect.x, y), m_clear_color, tile_rect.width);
+			std::fill_n(&m_buffers.depth.at(tile_rect.x, y), tile_rect.width, -INFINITY);
+		}
+	}
+
+	for(auto index : m_bins[tile])
+		raster_tri(m_tris[index], tile_rect);
+}
+
+void RenderContext::raster_tri(const TriSetup& tri, Gfx::Rect tile_rect) {
+	const Gfx::Rect rect = tri.bbox.overlapping_area(tile_rect);
+	if(rect.width <= 0 || rect.height <= 0)
+		return;
+
+	// Check the edges against the corners of the area we're drawing. If all the corners are outside of an edge, the
+	// triangle doesn't touch it at all. If they're all inside, we don't need to check that edge for each pixel.
+	int32_t edges[3], steps_x[3], steps_y[3];
+	int num_edges = 0;
+	const int64_t left = ((int64_t) rect.x << SUBPIXEL_BITS) + SUBPIXEL_ONE / 2;
+	const int64_t top = ((int64_t) rect.y << SUBPIXEL_BITS) + SUBPIXEL_ONE / 2;
+	const int64_t right = left + ((int64_t) (rect.width - 1) << SUBPIXEL_BITS);
+	const int64_t bottom = top + ((int64_t) (rect.height - 1) << SUBPIXEL_BITS);
+	for(int i = 0; i < 3; i++) {
+		const int64_t a = tri.edge_a[i], b = tri.edge_b[i], c = tri.edge_c[i];
+		const int64_t corners[4] = {a * left + b * top + c, a * right + b * top + c, a * left + b * bottom + c, a * right + b * bottom + c};
+		const int64_t min = std::min({corners[0], corners[1], corners[2], corners[3]});
+		const int64_t max = std::max({corners[0], corners[1], corners[2], corners[3]});
+		if(max < 0)
+			return;
+		if(min >= 0)
+			continue;
+		edges[num_edges] = (int32_t) corners[0];
+		steps_x[num_edges] = tri.edge_a[i] * SUBPIXEL_ONE;
+		steps_y[num_edges] = tri.edge_b[i] * SUBPIXEL_ONE;
+		num_edges++;
+	}
+
+	// The attributes at the first pixel of the row
+	float row[TriSetup::NUM_ATTRIBUTES];
+	for(int i = 0; i < TriSetup::NUM_ATTRIBUTES; i++)
+		row[i] = tri.base[i] + tri.dx[i] * (rect.x + 0.5f) + tri.dy[i] * (rect.y + 0.5f);
+
+#ifdef LIB3D_SSE2
+	const bool sse2 = use_sse2();
+#endif
+
+	for(int y = rect.y; y < rect.y + rect.height; y++) {
+		Gfx::Color* color = &m_buffers.color.at(rect.x, y);
+		float* depth = &m_buffers.depth.at(rect.x, y);
+#ifdef LIB3D_SSE2
+		if(sse2 && rect.width >= 4)
+			raster_row_sse2(tri, row, rect.width, edges, steps_x, num_edges, color, depth);
+		else
+#endif
+			raster_row(tri, row, 0, rect.width, edges, steps_x, num_edges, color, depth);
+
+		for(int i = 0; i < num_edges; i++)
+			edges[i] += steps_y[i];
+		for(int i = 0; i < TriSetup::NUM_ATTRIBUTES; i++)
+			row[i] += tri.dy[i];
+	}
+}
+
+void RenderContext::raster_row(const TriSetup& tri, const float* row, int x, int width, const int32_t* edges,
+							   const int32_t* steps, int num_edges, Gfx::Color* color, float* depth)
+{
+	int32_t row_edges[3];
+	for(int i = 0; i < num_edges; i++)
+		row_edges[i] = edges[i] + steps[i] * x;
+	const float* dx = tri.dx;
+
+	for(; x < width; x++) {
+		int32_t outside = 0;
+		for(int i = 0; i < num_edges; i++) {
+			outside |= row_edges[i];
+			row_edges[i] += steps[i];
+		}
+		if(outside < 0)
+			continue;
+
+		const float z = row[TriSetup::Z] + dx[TriSetup::Z] * x;
+		if(tri.depth_testing && depth[x] >= z)
+			continue;
+
+		float r = row[TriSetup::R] + dx[TriSetup::R] * x;
+		float g = row[TriSetup::G] + dx[TriSetup::G] * x;
+		float b = row[TriSetup::B] + dx[TriSetup::B] * x;
+		float a = row[TriSetup::A] + dx[TriSetup::A] * x;
+		if(tri.texture) {
+			const Gfx::Color texel = tri.texture->sample(tri.texture_level, row[TriSetup::U] + dx[TriSetup::U] * x, row[TriSetup::V] + dx[TriSetup::V] * x);
+			r *= texel.r * (1.0f / 255.0f);
+			g *= texel.g * (1.0f / 255.0f);
+			b *= texel.b * (1.0f / 255.0f);
+			a *= texel.a * (1.0f / 255.0f);
+		}
+		if(tri.alpha_testing && a <= 0)
+			continue;
+
+		color[x] = {to_channel(r), to_channel(g), to_channel(b), to_channel(a)};
+		depth[x] = z;
+	}
+}
+
+#ifdef LIB3D_SSE2
+__attribute__((target("sse2")))
+static inline __m128 interpolate_sse2(const float* row, const float* dx, int attribute, __m128 pixel_x) {
+	return _mm_add_ps(_mm_set1_ps(row[attribute]), _mm_mul_ps(_mm_set1_ps(dx[attribute]), pixel_x));
+}
+
+__attribute__((target("sse2")))
+static inline __m128i to_channels_sse2(__m128 val) {
+	return _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(val, _mm_setzero_ps()), _mm_set1_ps(255.0f)));
+}
+
+__attribute__((target("sse2")))
+void RenderContext::raster_row_sse2(const TriSetup& tri, const float* row, int width, const int32_t* edges,
+									const int32_t* steps, int num_edges, Gfx::Color* color, float* depth)
+{
+	__m128i edge[3], edge_step[3];
+	for(int i = 0; i < num_edges; i++) {
+		edge[i] = _mm_add_epi32(_mm_set1_epi32(edges[i]), _mm_setr_epi32(0, steps[i], steps[i] * 2, steps[i] * 3));
+		edge_step[i] = _mm_set1_epi32(steps[i] * 4);
+	}
+
+	const Buffer2D<Gfx::Color>* texels = tri.texture ? &tri.texture->level(tri.texture_level) : nullptr;
+	const __m128 offsets = _mm_setr_ps(0, 1, 2, 3);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 max_channel = _mm_set1_ps(255.0f);
+	const __m128i channel_mask = _mm_set1_epi32(0xFF);
+
+	int x = 0;
+	for(; x + 4 <= width; x += 4) {
+		// A pixel's covered if none of its edge values are negative
+		__m128i outside = _mm_setzero_si128();
+		for(int i = 0; i < num_edges; i++) {
+			outside = _mm_or_si128(outside, edge[i]);
+			edge[i] = _mm_add_epi32(edge[i], edge_step[i]);
+		}
+		__m128 mask = _mm_castsi128_ps(_mm_cmpgt_epi32(outside, _mm_set1_epi32(-1)));
+		if(!_mm_movemask_ps(mask))
+			continue;
+
+		// Attributes are only interpolated for groups of pixels that have something to draw
+		const __m128 pixel_x = _mm_add_ps(_mm_set1_ps((float) x), offsets);
+		const __m128 z = interpolate_sse2(row, tri.dx, TriSetup::Z, pixel_x);
+		const __m128 old_depth = _mm_loadu_ps(depth + x);
+		if(tri.depth_testing) {
+			mask = _mm_and_ps(mask, _mm_cmpgt_ps(z, old_depth));
+			if(!_mm_movemask_ps(mask))
+				continue;
+		}
+
+		__m128 r = interpolate_sse2(row, tri.dx, TriSetup::R, pixel_x);
+		__m128 g = interpolate_sse2(row, tri.dx, TriSetup::G, pixel_x);
+		__m128 b = interpolate_sse2(row, tri.dx, TriSetup::B, pixel_x);
+		__m128 a = interpolate_sse2(row, tri.dx, TriSetup::A, pixel_x);
+		if(texels) {
+			// Fetch the texels one at a time, and then split them back up into channels
+			const int tex_width = (int) texels->width(), tex_height = (int) texels->height();
+			const __m128 u = _mm_mul_ps(interpolate_sse2(row, tri.dx, TriSetup::U, pixel_x), _mm_set1_ps((float) tex_width));
+			const __m128 v = _mm_mul_ps(interpolate_sse2(row, tri.dx, TriSetup::V, pixel_x), _mm_set1_ps((float) tex_height));
+			alignas(16) int32_t tex_x[4], tex_y[4];
+			_mm_store_si128((__m128i*) tex_x, _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(u, zero), _mm_set1_ps((float) (tex_width - 1)))));
+			_mm_store_si128((__m128i*) tex_y, _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(v, zero), _mm_set1_ps((float) (tex_height - 1)))));
+			const Gfx::Color* data = texels->data();
+			const __m128i texel = _mm_setr_epi32(
+				(int) data[tex_x[0] + tex_y[0] * tex_width].value,
+				(int) data[tex_x[1] + tex_y[1] * tex_width].value,
+				(int) data[tex_x[2] + tex_y[2] * tex_width].value,
+				(int) data[tex_x[3] + tex_y[3] * tex_width].value);
+			b = _mm_mul_ps(b, _mm_cvtepi32_ps(_mm_and_si128(texel, channel_mask)));
+			g = _mm_mul_ps(g, _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(texel, 8), channel_mask)));
+			r = _mm_mul_ps(r, _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(texel, 16), channel_mask)));
+			a = _mm_mul_ps(a, _mm_cvtepi32_ps(_mm_srli_epi32(texel, 24)));
+		} else {
+			r = _mm_mul_ps(r, max_channel);
+			g = _mm_mul_ps(g, max_channel);
+			b = _mm_mul_ps(b, max_channel);
+			a = _mm_mul_ps(a, max_channel);
+		}
+		if(tri.alpha_testing) {
+			mask = _mm_and_ps(mask, _mm_cmpgt_ps(a, zero));
+			if(!_mm_movemask_ps(mask))
+				continue;
+		}
+
+		// Pack the channels into colors, and write the pixels that passed
+		const __m128i colors = _mm_or_si128(
+			_mm_or_si128(to_channels_sse2(b), _mm_slli_epi32(to_channels_sse2(g), 8)),
+			_mm_or_si128(_mm_slli_epi32(to_channels_sse2(r), 16), _mm_slli_epi32(to_channels_sse2(a), 24)));
+		const __m128i color_mask = _mm_castps_si128(mask);
+		const __m128i old_colors = _mm_loadu_si128((const __m128i*) (color + x));
+		_mm_storeu_si128((__m128i*) (color + x), _mm_or_si128(_mm_and_si128(color_mask, colors), _mm_andnot_si128(color_mask, old_colors)));
+		_mm_storeu_ps(depth + x, _mm_or_ps(_mm_and_ps(mask, z), _mm_andnot_ps(mask, old_depth)));
+	}
+
+	// Don't read past the end of the row for the last few pixels
+	if(x < width)
+		raster_row(tri, row, x, width, edges, steps, num_edges, color, depth);
+}
+#endif
+
+void RenderContext::stop_threads() {
+	if(m_threads.empty())
+		return;
+	pthread_mutex_lock(&m_work_lock);
+	m_stopping = true;
+	pthread_cond_broadcast(&m_work_cond);
+	pthread_mutex_unlock(&m_work_lock);
+	for(auto thread : m_threads)
+		pthread_join(thread, nullptr);
+	m_threads.clear();
+}
+
+void* RenderContext::worker_main(void* arg) {
+	auto* ctx = (RenderContext*) arg;
+	pthread_mutex_lock(&ctx->m_work_lock);
+	while(true) {
+		while(!ctx->m_work_tickets && !ctx->m_stopping)
+			pthread_cond_wait(&ctx->m_work_cond, &ctx->m_work_lock);
+		if(ctx->m_stopping)
+			break;
+		ctx->m_work_tickets--;
+		pthread_mutex_unlock(&ctx->m_work_lock);
+
+		ctx->render_tiles();
+
+		pthread_mutex_lock(&ctx->m_work_lock);
+		ctx->m_workers_done++;
+		pthread_cond_signal(&ctx->m_done_cond);
+	}
+	pthread_mutex_unlock(&ctx->m_work_lock);
+	return nullptr;
+}
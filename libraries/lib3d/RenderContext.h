@@ -10,13 +10,26 @@
 #include "Vertex.h"
 #include "Texture.h"
 #include <array>
+#include <atomic>
 #include <utility>
+#include <vector>
+#include <pthread.h>
+
+// The size of the tiles the viewport is split into for rasterization
+#define LIB3D_TILE_SIZE 64
 
 namespace Lib3D {
+	/**
+	 * Renders triangles into a color and depth buffer. Triangles are set up when they're submitted and sorted into
+	 * bins for each tile of the viewport they touch; nothing is actually drawn until flush(), which rasterizes each
+	 * tile's triangles in order. Tiles are shared out between the calling thread and any worker threads.
+	 */
 	class RenderContext: public Duck::Object {
 	public:
 		DUCK_OBJECT_DEF(RenderContext);
 
+		~RenderContext() override;
+
 		/// Getters and setters
 		BufferSet& buffers() { return m_buffers; }
 		const Gfx::Rect viewport() const { return m_viewport; }
@@ -48,21 +61,57 @@ namespace Lib3D {
 		void set_backface_culling(bool backface_culling) { m_backface_culling = backface_culling; }
 		void set_alpha_testing(bool alpha_testing) { m_alpha_testing = alpha_testing; }
 
+		/// Sets how many threads rasterize tiles during flush(), including the calling thread.
+		void set_num_threads(int num_threads);
+
 		/// Various Stuff
 		void clear(Vec4f color);
 
 		/// Drawing
 		void line(Vertex a, Vertex b);
 		void tri(std::array<Vertex, 3> verts);
+		/// Finishes drawing everything submitted so far into the buffers.
+		void flush();
 
-		/// Textures
+		/// Textures. A texture must stay alive until the triangles drawn with it are flushed.
 		void bind_texture(Texture* texture) { m_bound_texture = texture; }
 
 	private:
 		explicit RenderContext(Gfx::Dimensions dimensions);
 
-		void tri_barycentric(std::array<Vertex, 3> verts);
+		/// A triangle that's ready to be rasterized.
+		struct TriSetup {
+			// Edge functions in 28.4 fixed point. For a pixel center (x, y), also in 28.4, edge i is
+			// edge_a[i] * x + edge_b[i] * y + edge_c[i], and the pixel is inside if it's positive for all three.
+			int32_t edge_a[3];
+			int32_t edge_b[3];
+			int64_t edge_c[3];
+			Gfx::Rect bbox;
+
+			// Planes for interpolating attributes across screen space: value = base + dx * x + dy * y
+			enum Attribute { Z, R, G, B, A, U, V, NUM_ATTRIBUTES };
+			float base[NUM_ATTRIBUTES];
+			float dx[NUM_ATTRIBUTES];
+			float dy[NUM_ATTRIBUTES];
+
+			const Texture* texture;
+			int texture_level;
+			bool depth_testing;
+			bool alpha_testing;
+		};
+
+		void setup_tri(std::array<Vertex, 3> verts);
 		void tri_wireframe(std::array<Vertex, 3> verts);
+		void resize_bins();
+		void render_tiles();
+		void render_tile(int tile);
+		void raster_tri(const TriSetup& tri, Gfx::Rect tile_rect);
+		static void raster_row(const TriSetup& tri, const float* row, int x, int width, const int32_t* edges,
+							   const int32_t* steps, int num_edges, Gfx::Color* color, float* depth);
+		static void raster_row_sse2(const TriSetup& tri, const float* row, int width, const int32_t* edges,
+									const int32_t* steps, int num_edges, Gfx::Color* color, float* depth);
+		void stop_threads();
+		static void* worker_main(void* arg);
 
 		Matrix4f m_modelmat = identity<float, 4>();
 		Matrix4f m_projmat  = ortho(-1.0, 1.0, -1.0, 1.0, -1.0, 1.0);
@@ -73,5 +122,22 @@ namespace Lib3D {
 		bool m_depth_testing = true;
 		bool m_backface_culling = true;
 		bool m_alpha_testing = false;
+
+		// Binning
+		int m_tiles_x = 0, m_tiles_y = 0;
+		std::vector<TriSetup> m_tris;
+		std::vector<std::vector<uint32_t>> m_bins; ///< Indices into m_tris for each tile
+		bool m_clear_pending = false;
+		Gfx::Color m_clear_color;
+
+		// Workers
+		std::vector<pthread_t> m_threads;
+		pthread_mutex_t m_work_lock = PTHREAD_MUTEX_INITIALIZER;
+		pthread_cond_t m_work_cond = PTHREAD_COND_INITIALIZER;
+		pthread_cond_t m_done_cond = PTHREAD_COND_INITIALIZER;
+		int m_work_tickets = 0;
+		int m_workers_done = 0;
+		bool m_stopping = false;
+		std::atomic<int> m_next_tile = 0;
 	};
 }
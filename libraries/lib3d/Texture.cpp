@@ -5,10 +5,40 @@
 
 using namespace Lib3D;
 
-Texture::Texture(const Gfx::Framebuffer& framebuf):
-	m_buffer(framebuf.width, framebuf.height)
-{
-	for(int y = 0; y < framebuf.height; y++)
-		for(int x = 0; x < framebuf.width; x++)
-			m_buffer.at(x, y) = color_to_vec(framebuf.ref_at({x, y}));
+Texture::Texture(const Gfx::Framebuffer& framebuf) {
+	m_levels.emplace_back(framebuf.width, framebuf.height);
+	memcpy(m_levels[0].data(), framebuf.data, sizeof(Gfx::Color) * framebuf.width * framebuf.height);
+
+	// Build each mipmap level by averaging 2x2 blocks of the one before it
+	while(m_levels.back().width() > 1 || m_levels.back().height() > 1) {
+		auto& prev = m_levels.back();
+		size_t width = std::max(prev.width() / 2, (size_t) 1);
+		size_t height = std::max(prev.height() / 2, (size_t) 1);
+		Buffer2D<Gfx::Color> level(width, height);
+		for(size_t y = 0; y < height; y++) {
+			size_t y0 = std::min(y * 2, prev.height() - 1);
+			size_t y1 = std::min(y * 2 + 1, prev.height() - 1);
+			for(size_t x = 0; x < width; x++) {
+				size_t x0 = std::min(x * 2, prev.width() - 1);
+				size_t x1 = std::min(x * 2 + 1, prev.width() - 1);
+				Gfx::Color a = prev.at(x0, y0), b = prev.at(x1, y0), c = prev.at(x0, y1), d = prev.at(x1, y1);
+				level.at(x, y) = {
+					(uint8_t) ((a.r + b.r + c.r + d.r + 2) / 4),
+					(uint8_t) ((a.g + b.g + c.g + d.g + 2) / 4),
+					(uint8_t) ((a.b + b.b + c.b + d.b + 2) / 4),
+					(uint8_t) ((a.a + b.a + c.a + d.a + 2) / 4)
+				};
+			}
+		}
+		m_levels.push_back(std::move(level));
+	}
+}
+
+int Texture::level_for(float texels_per_pixel) const {
+	int level = 0;
+	while(texels_per_pixel >= 2.0f && level < num_levels() - 1) {
+		texels_per_pixel *= 0.5f;
+		level++;
+	}
+	return level;
 }
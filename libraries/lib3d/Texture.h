@@ -7,15 +7,32 @@
 #include <libgraphics/Framebuffer.h>
 #include <libgraphics/Image.h>
 #include "MatrixUtil.h"
+#include <vector>
 
 namespace Lib3D {
 	class Texture {
 	public:
 		explicit Texture(const Gfx::Framebuffer& framebuf);
 
-		[[nodiscard]] const Buffer2D<Vec4f>& buffer() const { return m_buffer; };
+		[[nodiscard]] const Buffer2D<Gfx::Color>& buffer() const { return m_levels[0]; };
+
+		/// Mipmap levels, each half the size of the one before it. Level 0 is the full-size texture.
+		[[nodiscard]] const Buffer2D<Gfx::Color>& level(int level) const { return m_levels[level]; }
+		[[nodiscard]] int num_levels() const { return (int) m_levels.size(); }
+
+		/// Picks the mipmap level to use when each pixel covers texels_per_pixel texels of the full-size texture.
+		[[nodiscard]] int level_for(float texels_per_pixel) const;
+
+		/// Samples a mipmap level at the given texture coordinates, clamping them to the edges of the texture.
+		[[nodiscard]] inline Gfx::Color sample(int level, float u, float v) const {
+			auto& buf = m_levels[level];
+			const int width = (int) buf.width(), height = (int) buf.height();
+			const int x = std::min(std::max((int) (u * (float) width), 0), width - 1);
+			const int y = std::min(std::max((int) (v * (float) height), 0), height - 1);
+			return buf.data()[x + y * width];
+		}
 
 	private:
-		Buffer2D<Vec4f> m_buffer;
+		std::vector<Buffer2D<Gfx::Color>> m_levels;
 	};
-}
\ No newline at end of file
+}
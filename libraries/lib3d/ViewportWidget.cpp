@@ -10,21 +10,14 @@ ViewportWidget::ViewportWidget(Duck::Ptr<RenderContext> ctx):
 {}
 
 void ViewportWidget::do_repaint(const UI::DrawContext& ctx) {
+	m_ctx->flush();
 	auto& color_buf = m_ctx->buffers().color;
-	const Gfx::Framebuffer* buf;
 	if (color_buf.width() == ctx.width() && color_buf.height() == ctx.height()) {
-		buf = &ctx.framebuffer();
+		memcpy(ctx.framebuffer().data, color_buf.data(), sizeof(Gfx::Color) * color_buf.width() * color_buf.height());
 	} else {
-		buf = &m_scale_buffer;
-		if (m_scale_buffer.width != color_buf.width() || m_scale_buffer.height != color_buf.height())
-			m_scale_buffer = Gfx::Framebuffer(color_buf.width(), color_buf.height());
-	}
-	for(size_t i = 0; i < buf->width * buf->height; i++) {
-		buf->data[i] = vec_to_color(color_buf.data()[i]);
-	}
-	if (buf != &ctx.framebuffer()) {
+		const Gfx::Framebuffer buf(color_buf.data(), (int) color_buf.width(), (int) color_buf.height());
 		memset(ctx.framebuffer().data, 0, sizeof(*ctx.framebuffer().data) * ctx.width() * ctx.height());
-		ctx.framebuffer().draw_image_scaled(*buf, {0, 0, ctx.width(), ctx.height()});
+		ctx.framebuffer().draw_image_scaled(buf, {0, 0, ctx.width(), ctx.height()});
 	}
 }
 
@@ -21,6 +21,5 @@ namespace Lib3D {
 		ViewportWidget(Duck::Ptr<RenderContext> ctx);
 
 		Duck::Ptr<RenderContext> m_ctx;
-		Gfx::Framebuffer m_scale_buffer;
 	};
 }
@@ -0,0 +1,46 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2024 Byteduck */
+
+#pragma once
+
+#include <sys/cdefs.h>
+#include <stddef.h>
+
+__DECL_BEGIN
+
+struct mallinfo {
+	int arena;    // Bytes mapped for small allocations
+	int ordblks;  // Number of free small chunks
+	int smblks;   // Unused
+	int hblks;    // Number of large (directly mapped) allocations
+	int hblkhd;   // Bytes mapped for large allocations
+	int usmblks;  // Unused
+	int fsmblks;  // Unused
+	int uordblks; // Bytes in use by small allocations
+	int fordblks; // Bytes free in small allocation spans
+	int keepcost; // Bytes in completely free spans that malloc_trim() could release
+};
+
+/**
+ * Gets statistics about the heap, summed across all arenas.
+ */
+struct mallinfo mallinfo(void);
+
+/**
+ * Returns completely free heap spans to the system.
+ * @param pad Ignored; only whole free spans are ever released.
+ * @return 1 if any memory was released, 0 otherwise.
+ */
+int malloc_trim(size_t pad);
+
+/**
+ * Gets the number of bytes that can actually be used in an allocation, which may be more than was requested.
+ */
+size_t malloc_usable_size(void* ptr);
+
+/**
+ * Prints per-arena heap statistics to stderr.
+ */
+void malloc_stats(void);
+
+__DECL_END
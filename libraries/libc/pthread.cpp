@@ -3,10 +3,67 @@
 
 #include "pthread.h"
 #include <sys/thread.h>
+#include <sys/futex.h>
 #include <cerrno>
 #include <cstdio>
+#include <climits>
+#include <unistd.h>
 
 static_assert(sizeof(tid_t) == sizeof(pthread_t));
+static_assert(sizeof(futex_t) == sizeof(uint32_t));
+
+// How many times to spin on a contended lock before blocking in the kernel.
+#define MUTEX_SPINS 40
+#define SPINLOCK_SPINS 100
+
+#define MUTEX_UNLOCKED 0
+#define MUTEX_LOCKED 1
+#define MUTEX_CONTENDED 2
+
+#define RWLOCK_WRITER 0xFFFFFFFFu
+
+// How often a timed condition wait re-checks the clock, since the kernel can't time out futex waits.
+#define COND_TIMEDWAIT_POLL_US 1000
+
+static inline futex_t* as_futex(uint32_t* val) {
+	return (futex_t*) val;
+}
+
+static inline void cpu_relax() {
+#if defined(__i386__) || defined(__x86_64__)
+	asm volatile("pause");
+#endif
+}
+
+static inline bool mutex_try_acquire(pthread_mutex_t* mutex) {
+	uint32_t expected = MUTEX_UNLOCKED;
+	return __atomic_compare_exchange_n(&mutex->val, &expected, MUTEX_LOCKED, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+static void mutex_acquire_contended(pthread_mutex_t* mutex) {
+	// Mark the mutex as contended so the holder knows to wake us when it unlocks.
+	while (__atomic_exchange_n(&mutex->val, MUTEX_CONTENDED, __ATOMIC_ACQUIRE) != MUTEX_UNLOCKED)
+		futex_wait_value(as_futex(&mutex->val), MUTEX_CONTENDED);
+}
+
+static void mutex_acquire(pthread_mutex_t* mutex) {
+	if (mutex_try_acquire(mutex))
+		return;
+
+	// Spin briefly in case the holder is about to release on another CPU, then let the kernel block us.
+	for (int i = 0; i < MUTEX_SPINS; i++) {
+		cpu_relax();
+		if (__atomic_load_n(&mutex->val, __ATOMIC_RELAXED) == MUTEX_UNLOCKED && mutex_try_acquire(mutex))
+			return;
+	}
+
+	mutex_acquire_contended(mutex);
+}
+
+static void mutex_release(pthread_mutex_t* mutex) {
+	if (__atomic_exchange_n(&mutex->val, MUTEX_UNLOCKED, __ATOMIC_RELEASE) == MUTEX_CONTENDED)
+		futex_wake(as_futex(&mutex->val), 1);
+}
 
 // pthread management
 int pthread_create(pthread_t* thread, const pthread_attr_t* attr, void* (*entry)(void*), void* arg) {
@@ -58,8 +115,9 @@ int pthread_attr_setstacksize(pthread_attr_t*, size_t) { return 0; }
 
 // mutex
 int pthread_mutex_init(pthread_mutex_t* mutex, const pthread_mutexattr_t* attr) {
-	mutex->val = 0;
+	mutex->val = MUTEX_UNLOCKED;
 	mutex->holder = 0;
+	mutex->count = 0;
 	mutex->type = attr ? attr->type : PTHREAD_MUTEX_DEFAULT;
 	if (mutex->type != PTHREAD_MUTEX_NORMAL && mutex->type != PTHREAD_MUTEX_RECURSIVE)
 		return EINVAL;
@@ -67,18 +125,55 @@ int pthread_mutex_init(pthread_mutex_t* mutex, const pthread_mutexattr_t* attr)
 }
 
 int pthread_mutex_destroy(pthread_mutex_t* mutex) {
+	if (__atomic_load_n(&mutex->val, __ATOMIC_RELAXED) != MUTEX_UNLOCKED)
+		return EBUSY;
 	return 0;
 }
 
 int pthread_mutex_lock(pthread_mutex_t* mutex) {
+	if (mutex->type == PTHREAD_MUTEX_RECURSIVE) {
+		auto self = pthread_self();
+		if (__atomic_load_n(&mutex->holder, __ATOMIC_RELAXED) == self) {
+			mutex->count++;
+			return 0;
+		}
+		mutex_acquire(mutex);
+		__atomic_store_n(&mutex->holder, self, __ATOMIC_RELAXED);
+		mutex->count = 1;
+		return 0;
+	}
+
+	mutex_acquire(mutex);
 	return 0;
 }
 
 int pthread_mutex_trylock(pthread_mutex_t* mutex) {
-	return 0;
+	if (mutex->type == PTHREAD_MUTEX_RECURSIVE) {
+		auto self = pthread_self();
+		if (__atomic_load_n(&mutex->holder, __ATOMIC_RELAXED) == self) {
+			mutex->count++;
+			return 0;
+		}
+		if (!mutex_try_acquire(mutex))
+			return EBUSY;
+		__atomic_store_n(&mutex->holder, self, __ATOMIC_RELAXED);
+		mutex->count = 1;
+		return 0;
+	}
+
+	return mutex_try_acquire(mutex) ? 0 : EBUSY;
 }
 
 int pthread_mutex_unlock(pthread_mutex_t* mutex) {
+	if (mutex->type == PTHREAD_MUTEX_RECURSIVE) {
+		if (__atomic_load_n(&mutex->holder, __ATOMIC_RELAXED) != pthread_self())
+			return EPERM;
+		if (--mutex->count)
+			return 0;
+		__atomic_store_n(&mutex->holder, 0, __ATOMIC_RELAXED);
+	}
+
+	mutex_release(mutex);
 	return 0;
 }
 
@@ -103,30 +198,173 @@ int pthread_mutexattr_destroy(pthread_mutexattr_t* attr) {
 	return 0;
 }
 
+// rwlock
+static inline bool rwlock_try_read(pthread_rwlock_t* lock) {
+	// Writers take priority over new readers so that they can't be starved.
+	uint32_t state = __atomic_load_n(&lock->state, __ATOMIC_RELAXED);
+	while (state != RWLOCK_WRITER && state < RWLOCK_WRITER - 1 && !__atomic_load_n(&lock->writers_waiting, __ATOMIC_RELAXED)) {
+		if (__atomic_compare_exchange_n(&lock->state, &state, state + 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+			return true;
+	}
+	return false;
+}
+
+static inline bool rwlock_try_write(pthread_rwlock_t* lock) {
+	uint32_t expected = 0;
+	return __atomic_compare_exchange_n(&lock->state, &expected, RWLOCK_WRITER, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+static void rwlock_wait(pthread_rwlock_t* lock, bool (*try_acquire)(pthread_rwlock_t*)) {
+	for (int i = 0; i < MUTEX_SPINS; i++) {
+		if (try_acquire(lock))
+			return;
+		cpu_relax();
+	}
+
+	__atomic_fetch_add(&lock->waiters, 1, __ATOMIC_SEQ_CST);
+	while (true) {
+		uint32_t seq = __atomic_load_n(&lock->seq, __ATOMIC_SEQ_CST);
+		if (try_acquire(lock))
+			break;
+		futex_wait_value(as_futex(&lock->seq), seq);
+	}
+	__atomic_fetch_sub(&lock->waiters, 1, __ATOMIC_RELAXED);
+}
+
+int pthread_rwlock_init(pthread_rwlock_t* lock, const pthread_rwlockattr_t* attr) {
+	lock->state = 0;
+	lock->seq = 0;
+	lock->waiters = 0;
+	lock->writers_waiting = 0;
+	return 0;
+}
+
+int pthread_rwlock_destroy(pthread_rwlock_t* lock) {
+	if (__atomic_load_n(&lock->state, __ATOMIC_RELAXED))
+		return EBUSY;
+	return 0;
+}
+
+int pthread_rwlock_rdlock(pthread_rwlock_t* lock) {
+	if (!rwlock_try_read(lock))
+		rwlock_wait(lock, rwlock_try_read);
+	return 0;
+}
+
+int pthread_rwlock_tryrdlock(pthread_rwlock_t* lock) {
+	return rwlock_try_read(lock) ? 0 : EBUSY;
+}
+
+int pthread_rwlock_wrlock(pthread_rwlock_t* lock) {
+	if (rwlock_try_write(lock))
+		return 0;
+	__atomic_fetch_add(&lock->writers_waiting, 1, __ATOMIC_SEQ_CST);
+	rwlock_wait(lock, rwlock_try_write);
+	__atomic_fetch_sub(&lock->writers_waiting, 1, __ATOMIC_SEQ_CST);
+	return 0;
+}
+
+int pthread_rwlock_trywrlock(pthread_rwlock_t* lock) {
+	return rwlock_try_write(lock) ? 0 : EBUSY;
+}
+
+int pthread_rwlock_unlock(pthread_rwlock_t* lock) {
+	uint32_t state = __atomic_load_n(&lock->state, __ATOMIC_RELAXED);
+	if (!state)
+		return EPERM;
+	if (state == RWLOCK_WRITER)
+		__atomic_store_n(&lock->state, 0, __ATOMIC_SEQ_CST);
+	else if (__atomic_sub_fetch(&lock->state, 1, __ATOMIC_SEQ_CST))
+		return 0;
+
+	// Readers and writers wait on the same word, so wake everyone and let them race for the lock.
+	if (__atomic_load_n(&lock->waiters, __ATOMIC_SEQ_CST)) {
+		__atomic_fetch_add(&lock->seq, 1, __ATOMIC_SEQ_CST);
+		futex_wake(as_futex(&lock->seq), INT_MAX);
+	}
+	return 0;
+}
+
+int pthread_rwlockattr_init(pthread_rwlockattr_t* attr) {
+	return 0;
+}
+
+int pthread_rwlockattr_destroy(pthread_rwlockattr_t* attr) {
+	return 0;
+}
+
+// barrier
+int pthread_barrier_init(pthread_barrier_t* barrier, const pthread_barrierattr_t* attr, unsigned count) {
+	if (!count)
+		return EINVAL;
+	barrier->count = count;
+	barrier->waiting = 0;
+	barrier->seq = 0;
+	return 0;
+}
+
+int pthread_barrier_destroy(pthread_barrier_t* barrier) {
+	if (__atomic_load_n(&barrier->waiting, __ATOMIC_RELAXED))
+		return EBUSY;
+	return 0;
+}
+
+int pthread_barrier_wait(pthread_barrier_t* barrier) {
+	uint32_t seq = __atomic_load_n(&barrier->seq, __ATOMIC_ACQUIRE);
+	if (__atomic_add_fetch(&barrier->waiting, 1, __ATOMIC_ACQ_REL) == barrier->count) {
+		// We're the last one here, so start the next cycle and release everyone else.
+		__atomic_store_n(&barrier->waiting, 0, __ATOMIC_RELAXED);
+		__atomic_fetch_add(&barrier->seq, 1, __ATOMIC_RELEASE);
+		futex_wake(as_futex(&barrier->seq), INT_MAX);
+		return PTHREAD_BARRIER_SERIAL_THREAD;
+	}
+
+	while (__atomic_load_n(&barrier->seq, __ATOMIC_ACQUIRE) == seq)
+		futex_wait_value(as_futex(&barrier->seq), seq);
+	return 0;
+}
+
+int pthread_barrierattr_init(pthread_barrierattr_t* attr) {
+	return 0;
+}
+
+int pthread_barrierattr_destroy(pthread_barrierattr_t* attr) {
+	return 0;
+}
+
 // spinlock
 int pthread_spin_init(pthread_spinlock_t* lock, int val) {
-	// TODO
-	return -1;
+	lock->lock = 0;
+	return 0;
 }
 
 int pthread_spin_destroy(pthread_spinlock_t* lock) {
-	// TODO
-	return -1;
+	return 0;
 }
 
 int pthread_spin_lock(pthread_spinlock_t* lock) {
-	// TODO
-	return -1;
+	int spins = 0;
+	while (__atomic_exchange_n(&lock->lock, 1, __ATOMIC_ACQUIRE)) {
+		// Give the holder a chance to run if it's been a while, since it may be on the same CPU as us.
+		while (__atomic_load_n(&lock->lock, __ATOMIC_RELAXED)) {
+			if (++spins >= SPINLOCK_SPINS) {
+				sched_yield();
+				spins = 0;
+			} else {
+				cpu_relax();
+			}
+		}
+	}
+	return 0;
 }
 
 int pthread_spin_trylock(pthread_spinlock_t* lock) {
-	// TODO
-	return -1;
+	return __atomic_exchange_n(&lock->lock, 1, __ATOMIC_ACQUIRE) ? EBUSY : 0;
 }
 
 int pthread_spin_unlock(pthread_spinlock_t* lock) {
-	// TODO
-	return -1;
+	__atomic_store_n(&lock->lock, 0, __ATOMIC_RELEASE);
+	return 0;
 }
 
 // misc
@@ -147,8 +385,50 @@ int pthread_key_create(pthread_key_t* key, void (*destructor)(void*)) { return -
 int pthread_key_delete(pthread_key_t key) { return -1; }
 
 // cond
-int pthread_cond_broadcast(pthread_cond_t*) {
-	return -1;
+static int cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex, const struct timespec* abstime) {
+	uint32_t seq = __atomic_load_n(&cond->val, __ATOMIC_RELAXED);
+	__atomic_store_n(&cond->mutex, mutex, __ATOMIC_RELAXED);
+
+	// Fully release the mutex, even if it's recursive, and restore its state when we get it back.
+	int count = mutex->count;
+	pthread_t holder = mutex->holder;
+	mutex->count = 0;
+	__atomic_store_n(&mutex->holder, 0, __ATOMIC_RELAXED);
+	mutex_release(mutex);
+
+	int ret = 0;
+	if (abstime) {
+		// The kernel can't time out a futex wait, so poll until we're signalled or the deadline passes.
+		while (__atomic_load_n(&cond->val, __ATOMIC_ACQUIRE) == seq) {
+			timespec now;
+			clock_gettime(cond->clock, &now);
+			if (now.tv_sec > abstime->tv_sec || (now.tv_sec == abstime->tv_sec && now.tv_nsec >= abstime->tv_nsec)) {
+				ret = ETIMEDOUT;
+				break;
+			}
+			usleep(COND_TIMEDWAIT_POLL_US);
+		}
+	} else {
+		futex_wait_value(as_futex(&cond->val), seq);
+	}
+
+	// We may have been requeued onto the mutex, so other waiters may be queued behind us.
+	mutex_acquire_contended(mutex);
+	mutex->count = count;
+	__atomic_store_n(&mutex->holder, holder, __ATOMIC_RELAXED);
+	return ret;
+}
+
+int pthread_cond_broadcast(pthread_cond_t* cond) {
+	__atomic_fetch_add(&cond->val, 1, __ATOMIC_RELEASE);
+	auto* mutex = __atomic_load_n(&cond->mutex, __ATOMIC_RELAXED);
+
+	// Rather than waking every waiter just to have them fight over the mutex, wake one and move the rest onto the mutex.
+	if (mutex)
+		futex_requeue(as_futex(&cond->val), as_futex(&mutex->val));
+	else
+		futex_wake(as_futex(&cond->val), INT_MAX);
+	return 0;
 }
 
 int pthread_cond_init(pthread_cond_t* cond, pthread_condattr_t const* attr) {
@@ -163,10 +443,14 @@ int pthread_cond_destroy(pthread_cond_t*) {
 }
 
 int pthread_cond_signal(pthread_cond_t* cond) {
-	return -1;
+	__atomic_fetch_add(&cond->val, 1, __ATOMIC_RELEASE);
+	futex_wake(as_futex(&cond->val), 1);
+	return 0;
 }
 
-int pthread_cond_wait(pthread_cond_t*, pthread_mutex_t*) { return -1; }
+int pthread_cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex) {
+	return cond_wait(cond, mutex, nullptr);
+}
 
 int pthread_condattr_init(pthread_condattr_t* attr) {
 	attr->clockid = CLOCK_MONOTONIC_COARSE;
@@ -196,7 +480,9 @@ int pthread_condattr_destroy(pthread_condattr_t*) {
 	return 0;
 }
 
-int pthread_cond_timedwait(pthread_cond_t*, pthread_mutex_t*, const struct timespec*) { return -1; }
+int pthread_cond_timedwait(pthread_cond_t* cond, pthread_mutex_t* mutex, const struct timespec* abstime) {
+	return cond_wait(cond, mutex, abstime);
+}
 
 // cancel
 int pthread_cancel(pthread_t) { return -1; }
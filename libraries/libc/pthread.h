@@ -16,8 +16,12 @@
 #define PTHREAD_MUTEX_NORMAL 1
 #define PTHREAD_MUTEX_RECURSIVE 2
 #define PTHREAD_MUTEX_DEFAULT PTHREAD_MUTEX_NORMAL
-#define PTHREAD_MUTEX_INITIALIZER {}
-#define PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP {}
+#define PTHREAD_MUTEX_INITIALIZER {0, 0, PTHREAD_MUTEX_NORMAL, 0}
+#define PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP {0, 0, PTHREAD_MUTEX_RECURSIVE, 0}
+#define PTHREAD_COND_INITIALIZER {0, 0, CLOCK_REALTIME_COARSE}
+#define PTHREAD_RWLOCK_INITIALIZER {}
+
+#define PTHREAD_BARRIER_SERIAL_THREAD -1
 
 #define PTHREAD_PROCESS_PRIVATE 1
 #define PTHREAD_PROCESS_SHARED 2
@@ -33,22 +37,36 @@ typedef int pthread_t;
 typedef int pthread_key_t;
 typedef uint32_t pthread_once_t;
 typedef void* pthread_attr_t;
-typedef uint64_t pthread_rwlock_t;
 typedef void* pthread_rwlockattr_t;
+typedef void* pthread_barrierattr_t;
 
 typedef struct {
-	uint32_t val;
-	pthread_t holder;
+	uint32_t val; // 0 if unlocked, 1 if locked, 2 if locked and there may be waiters
+	pthread_t holder; // Only tracked for recursive mutexes
 	int type;
+	int count;
 } pthread_mutex_t;
 
+typedef struct {
+	uint32_t state; // The number of readers holding the lock, or RWLOCK_WRITER if held by a writer
+	uint32_t seq; // Incremented whenever waiters should re-check the state
+	uint32_t waiters;
+	uint32_t writers_waiting;
+} pthread_rwlock_t;
+
+typedef struct {
+	uint32_t count;
+	uint32_t waiting;
+	uint32_t seq;
+} pthread_barrier_t;
+
 typedef struct {
 	int type;
 } pthread_mutexattr_t;
 
 typedef struct {
 	pthread_mutex_t* mutex;
-	uint32_t val;
+	uint32_t val; // Incremented on every signal or broadcast
 	clockid_t clock;
 } pthread_cond_t;
 
@@ -96,6 +114,24 @@ int pthread_mutexattr_settype(pthread_mutexattr_t*, int);
 int pthread_mutexattr_gettype(pthread_mutexattr_t*, int*);
 int pthread_mutexattr_destroy(pthread_mutexattr_t*);
 
+// rwlock
+int pthread_rwlock_init(pthread_rwlock_t* lock, const pthread_rwlockattr_t* attr);
+int pthread_rwlock_destroy(pthread_rwlock_t* lock);
+int pthread_rwlock_rdlock(pthread_rwlock_t* lock);
+int pthread_rwlock_tryrdlock(pthread_rwlock_t* lock);
+int pthread_rwlock_wrlock(pthread_rwlock_t* lock);
+int pthread_rwlock_trywrlock(pthread_rwlock_t* lock);
+int pthread_rwlock_unlock(pthread_rwlock_t* lock);
+int pthread_rwlockattr_init(pthread_rwlockattr_t* attr);
+int pthread_rwlockattr_destroy(pthread_rwlockattr_t* attr);
+
+// barrier
+int pthread_barrier_init(pthread_barrier_t* barrier, const pthread_barrierattr_t* attr, unsigned count);
+int pthread_barrier_destroy(pthread_barrier_t* barrier);
+int pthread_barrier_wait(pthread_barrier_t* barrier);
+int pthread_barrierattr_init(pthread_barrierattr_t* attr);
+int pthread_barrierattr_destroy(pthread_barrierattr_t* attr);
+
 // spinlock
 int pthread_spin_init(pthread_spinlock_t* lock, int val);
 int pthread_spin_destroy(pthread_spinlock_t* lock);
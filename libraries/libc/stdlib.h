@@ -22,6 +22,7 @@
 
 #include <sys/cdefs.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <limits.h>
 
 __DECL_BEGIN
@@ -49,7 +50,10 @@ int rand();
 void srand(unsigned int seed);
 
 //Memory
-#include <sys/liballoc.h>
+void* malloc(size_t size);
+void* realloc(void* ptr, size_t size);
+void* calloc(size_t nobj, size_t size);
+void free(void* ptr);
 
 //Environment & System
 char* getenv(const char* name);
@@ -22,16 +22,186 @@
 
 //Memory manipulation
 
+// Copies and fills at least this big use SSE2, since smaller ones don't make up for the setup cost.
+#define SSE2_MIN_SIZE 128
+// Copies at least this big bypass the cache with non-temporal stores, since they'd just evict everything else anyway.
+#define SSE2_NONTEMPORAL_MIN_SIZE (512 * 1024)
+
+static int s_has_sse2 = -1;
+
+static int has_sse2() {
+	if(__builtin_expect(s_has_sse2 < 0, 0)) {
+		uint32_t eax = 1, ebx, ecx, edx;
+		asm volatile("cpuid" : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+		s_has_sse2 = (edx >> 26) & 1;
+	}
+	return s_has_sse2;
+}
+
+__attribute__((target("sse2")))
+static void memcpy_sse2(uint8_t* dest, const uint8_t* src, size_t n) {
+	// Copy bytes until the destination is aligned, so that the stores in the main loop can be aligned.
+	size_t head = (-(uintptr_t) dest) & 15;
+	n -= head;
+	asm volatile("rep movsb" : "+D"(dest), "+S"(src), "+c"(head) :: "memory");
+
+	size_t blocks = n / 64;
+	n %= 64;
+	if(blocks >= SSE2_NONTEMPORAL_MIN_SIZE / 64) {
+		asm volatile(
+			"1:\n"
+			"movdqu (%[src]), %%xmm0\n"
+			"movdqu 16(%[src]), %%xmm1\n"
+			"movdqu 32(%[src]), %%xmm2\n"
+			"movdqu 48(%[src]), %%xmm3\n"
+			"movntdq %%xmm0, (%[dest])\n"
+			"movntdq %%xmm1, 16(%[dest])\n"
+			"movntdq %%xmm2, 32(%[dest])\n"
+			"movntdq %%xmm3, 48(%[dest])\n"
+			"add $64, %[src]\n"
+			"add $64, %[dest]\n"
+			"dec %[blocks]\n"
+			"jnz 1b\n"
+			"sfence\n"
+			: [dest]"+r"(dest), [src]"+r"(src), [blocks]"+r"(blocks)
+			:: "memory", "xmm0", "xmm1", "xmm2", "xmm3");
+	} else if(blocks) {
+		asm volatile(
+			"1:\n"
+			"movdqu (%[src]), %%xmm0\n"
+			"movdqu 16(%[src]), %%xmm1\n"
+			"movdqu 32(%[src]), %%xmm2\n"
+			"movdqu 48(%[src]), %%xmm3\n"
+			"movdqa %%xmm0, (%[dest])\n"
+			"movdqa %%xmm1, 16(%[dest])\n"
+			"movdqa %%xmm2, 32(%[dest])\n"
+			"movdqa %%xmm3, 48(%[dest])\n"
+			"add $64, %[src]\n"
+			"add $64, %[dest]\n"
+			"dec %[blocks]\n"
+			"jnz 1b\n"
+			: [dest]"+r"(dest), [src]"+r"(src), [blocks]"+r"(blocks)
+			:: "memory", "xmm0", "xmm1", "xmm2", "xmm3");
+	}
+
+	asm volatile("rep movsb" : "+D"(dest), "+S"(src), "+c"(n) :: "memory");
+}
+
+__attribute__((target("sse2")))
+static void memmove_backwards_sse2(uint8_t* dest, const uint8_t* src, size_t n) {
+	// Copy bytes from the end until the end of the destination is aligned.
+	uint8_t* dest_end = dest + n;
+	const uint8_t* src_end = src + n;
+	size_t tail = (uintptr_t) dest_end & 15;
+	n -= tail;
+	while(tail--)
+		*--dest_end = *--src_end;
+
+	// Each block is loaded completely before it's stored, so overlap within a block doesn't matter.
+	size_t blocks = n / 64;
+	n %= 64;
+	if(blocks) {
+		asm volatile(
+			"1:\n"
+			"sub $64, %[src]\n"
+			"sub $64, %[dest]\n"
+			"movdqu 48(%[src]), %%xmm0\n"
+			"movdqu 32(%[src]), %%xmm1\n"
+			"movdqu 16(%[src]), %%xmm2\n"
+			"movdqu (%[src]), %%xmm3\n"
+			"movdqa %%xmm0, 48(%[dest])\n"
+			"movdqa %%xmm1, 32(%[dest])\n"
+			"movdqa %%xmm2, 16(%[dest])\n"
+			"movdqa %%xmm3, (%[dest])\n"
+			"dec %[blocks]\n"
+			"jnz 1b\n"
+			: [dest]"+r"(dest_end), [src]"+r"(src_end), [blocks]"+r"(blocks)
+			:: "memory", "xmm0", "xmm1", "xmm2", "xmm3");
+	}
+
+	while(n--)
+		*--dest_end = *--src_end;
+}
+
+__attribute__((target("sse2")))
+static void memset_sse2(uint8_t* dest, uint8_t c, size_t n) {
+	size_t head = (-(uintptr_t) dest) & 15;
+	n -= head;
+	asm volatile("rep stosb" : "+D"(dest), "+c"(head) : "a"(c) : "memory");
+
+	size_t blocks = n / 64;
+	n %= 64;
+	if(blocks) {
+		asm volatile(
+			"movd %[pattern], %%xmm0\n"
+			"pshufd $0, %%xmm0, %%xmm0\n"
+			"1:\n"
+			"movdqa %%xmm0, (%[dest])\n"
+			"movdqa %%xmm0, 16(%[dest])\n"
+			"movdqa %%xmm0, 32(%[dest])\n"
+			"movdqa %%xmm0, 48(%[dest])\n"
+			"add $64, %[dest]\n"
+			"dec %[blocks]\n"
+			"jnz 1b\n"
+			: [dest]"+r"(dest), [blocks]"+r"(blocks)
+			: [pattern]"r"(c * 0x01010101u)
+			: "memory", "xmm0");
+	}
+
+	asm volatile("rep stosb" : "+D"(dest), "+c"(n) : "a"(c) : "memory");
+}
+
+__attribute__((target("sse2")))
+static size_t strlen_sse2(const char* str) {
+	// Aligned 16-byte loads never cross a page boundary, so reading past the terminator can't fault.
+	const char* block = (const char*) ((uintptr_t) str & ~15);
+	uint32_t mask;
+	asm volatile(
+		"pxor %%xmm0, %%xmm0\n"
+		"movdqa (%[block]), %%xmm1\n"
+		"pcmpeqb %%xmm0, %%xmm1\n"
+		"pmovmskb %%xmm1, %[mask]\n"
+		: [mask]"=r"(mask) : [block]"r"(block) : "memory", "xmm0", "xmm1");
+
+	// Ignore any bytes before the start of the string in the first block.
+	mask >>= str - block;
+	if(mask)
+		return __builtin_ctz(mask);
+
+	while(1) {
+		block += 16;
+		asm volatile(
+			"pxor %%xmm0, %%xmm0\n"
+			"movdqa (%[block]), %%xmm1\n"
+			"pcmpeqb %%xmm0, %%xmm1\n"
+			"pmovmskb %%xmm1, %[mask]\n"
+			: [mask]"=r"(mask) : [block]"r"(block) : "memory", "xmm0", "xmm1");
+		if(mask)
+			return block - str + __builtin_ctz(mask);
+	}
+}
+
 void* memcpy(void* dest, const void* src, size_t n) {
+	if(n >= SSE2_MIN_SIZE && has_sse2()) {
+		memcpy_sse2((uint8_t*) dest, (const uint8_t*) src, n);
+		return dest;
+	}
+
 	void* odest = dest;
 	asm volatile( "rep movsb" : "+D"(dest), "+S"(src), "+c"(n)::"memory");
 	return odest;
 }
 
 void* memmove(void* dest, const void* src, size_t n) {
-	if (dest < src)
+	// A forward copy is safe if the destination is before the source or they don't overlap.
+	if (dest <= src || (const uint8_t*) src + n <= (uint8_t*) dest)
 		return memcpy(dest, src, n);
 
+	if(n >= SSE2_MIN_SIZE && has_sse2()) {
+		memmove_backwards_sse2((uint8_t*) dest, (const uint8_t*) src, n);
+		return dest;
+	}
+
 	uint8_t* dest8 = (uint8_t*) dest;
 	const uint8_t* src8 = (const uint8_t*) src;
 	for (dest8 += n, src8 += n; n--;)
@@ -41,6 +211,11 @@ void* memmove(void* dest, const void* src, size_t n) {
 }
 
 void* memset(void* dest, int c, size_t n) {
+	if(n >= SSE2_MIN_SIZE && has_sse2()) {
+		memset_sse2((uint8_t*) dest, (uint8_t) c, n);
+		return dest;
+	}
+
 	void* odest = dest;
 	asm volatile( "rep stosb" : "=D"(dest), "=c"(n) : "0"(dest), "1"(n), "a"(c) : "memory");
 	return odest;
@@ -49,9 +224,7 @@ void* memset(void* dest, int c, size_t n) {
 //String manipulation
 
 char* strcpy(char* dest, const char* src) {
-	char* odest = dest;
-	while ((*dest++ = *src++) != '\0');
-	return odest;
+	return memcpy(dest, src, strlen(src) + 1);
 }
 
 char* strncpy(char* dest, const char* src, size_t n) {
@@ -64,11 +237,7 @@ char* strncpy(char* dest, const char* src, size_t n) {
 }
 
 char* strcat(char* dest, const char* src) {
-	size_t destlen = strlen(dest);
-	size_t i = 0;
-	for (; src[i] != '\0'; i++)
-		dest[i+ destlen] = src[i];
-	dest[i + destlen] = '\0';
+	strcpy(dest + strlen(dest), src);
 	return dest;
 }
 
@@ -300,6 +469,9 @@ char* strtok_r(char* s1, const char* s2, char** saved) {
 #include <kernel/api/strerror.c>
 
 size_t strlen(const char* str) {
+	if(has_sse2())
+		return strlen_sse2(str);
+
 	const char *s;
 	for (s = str; *s; s++);
 	return (s - str);
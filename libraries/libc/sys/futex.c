@@ -36,4 +36,16 @@ int futex_trywait(futex_t* futex) {
 
 void futex_signal(futex_t* futex) {
 	__atomic_fetch_add(futex, 1, __ATOMIC_ACQUIRE);
+}
+
+int futex_wait_value(futex_t* futex, int expected) {
+	return syscall4_noerr(SYS_FUTEX, (int) futex, FUTEX_WAIT_VALUE, expected);
+}
+
+int futex_wake(futex_t* futex, int count) {
+	return syscall4_noerr(SYS_FUTEX, (int) futex, FUTEX_WAKE, count);
+}
+
+int futex_requeue(futex_t* futex, futex_t* target) {
+	return syscall4_noerr(SYS_FUTEX, (int) futex, FUTEX_REQUEUE, (int) target);
 }
\ No newline at end of file
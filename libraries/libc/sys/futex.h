@@ -32,4 +32,29 @@ int futex_trywait(futex_t* futex);
  */
 void futex_signal(futex_t* futex);
 
+/**
+ * Blocks until woken by futex_wake() or futex_requeue(), unless the futex no longer holds the expected value.
+ * Unlike futex_wait(), this does not modify the futex, so it can be used to build other synchronization primitives.
+ * @param futex Pointer to the futex to wait on.
+ * @param expected The value the futex must hold for the calling thread to block.
+ * @return 0 if woken, -EAGAIN if the futex didn't hold the expected value, or -EINTR if interrupted.
+ */
+int futex_wait_value(futex_t* futex, int expected);
+
+/**
+ * Wakes up threads blocked in futex_wait_value() on a futex.
+ * @param futex Pointer to the futex to wake waiters of.
+ * @param count The maximum number of threads to wake.
+ * @return The number of threads woken.
+ */
+int futex_wake(futex_t* futex, int count);
+
+/**
+ * Wakes one thread blocked in futex_wait_value() on a futex and moves the rest to wait on another futex.
+ * @param futex Pointer to the futex to wake waiters of.
+ * @param target Pointer to the futex the remaining waiters should wait on instead.
+ * @return The number of threads moved to the target futex.
+ */
+int futex_requeue(futex_t* futex, futex_t* target);
+
 __DECL_END
\ No newline at end of file
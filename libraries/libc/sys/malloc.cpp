@@ -0,0 +1,483 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2024 Byteduck */
+
+#include <stdlib.h>
+#include <malloc.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <kernel/api/page_size.h>
+#include "mman.h"
+#include "futex.h"
+
+/*
+ * The heap is split into a few arenas, each with its own lock and its own size-classed free lists. A thread picks its
+ * arena based on which stack it's running on, so threads mostly end up with an arena to themselves and don't contend
+ * with each other. Freeing always returns a chunk to the arena it came from.
+ *
+ * Small allocations come from spans, which are runs of pages carved up into chunks of a single size class. Large
+ * allocations are mapped directly and unmapped as soon as they're freed.
+ */
+
+#define HEAP_NUM_ARENAS 8
+#define HEAP_NUM_CLASSES 39
+#define HEAP_MAX_CHUNK 32768
+#define HEAP_SPAN_SIZE 65536
+#define HEAP_MIN_CHUNKS_PER_SPAN 8
+#define HEAP_STACK_SHIFT 20 // Thread stacks are 1MiB, so this is roughly unique per thread
+#define HEAP_LOCK_SPINS 64
+#define HEAP_ALIGNMENT 16
+
+#define HEAP_CHUNK_MAGIC 0xc001c0de
+#define HEAP_CHUNK_DEAD 0xdeaddead
+#define HEAP_SPAN_MAGIC 0x5a4e5350
+
+struct Span;
+
+struct alignas(HEAP_ALIGNMENT) Chunk {
+	Span* span; // nullptr for large allocations
+	union {
+		size_t size; // The requested size, while allocated
+		Chunk* next_free;
+	};
+	uint32_t magic;
+	size_t mapped_size; // The size of the mapping for large allocations, which can be shrunk in place by realloc
+};
+
+struct Arena;
+
+struct Span {
+	uint32_t magic;
+	uint32_t size_class;
+	uint32_t num_chunks;
+	uint32_t num_free;
+	size_t mapped_size;
+	Arena* arena;
+	Chunk* free_list;
+	uint8_t* uncarved; // Chunks from here to the end of the span haven't been handed out yet
+	uint8_t* end;
+	Span* prev;
+	Span* next;
+};
+
+#define HEAP_SPAN_HEADER_SIZE ((sizeof(Span) + HEAP_ALIGNMENT - 1) & ~(HEAP_ALIGNMENT - 1))
+
+#define HEAP_LOCK_UNLOCKED 0
+#define HEAP_LOCK_LOCKED 1
+#define HEAP_LOCK_CONTENDED 2
+
+// Zero is unlocked, so the arenas are usable straight out of .bss: libc calls malloc before any constructors run.
+struct HeapLock {
+	futex_t futex;
+
+	bool try_acquire() {
+		int expected = HEAP_LOCK_UNLOCKED;
+		return __atomic_compare_exchange_n(&futex, &expected, HEAP_LOCK_LOCKED, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+	}
+
+	void acquire() {
+		// Spin briefly in case the holder is about to release, then let the kernel block us.
+		for(int i = 0; i < HEAP_LOCK_SPINS; i++) {
+			if(__atomic_load_n(&futex, __ATOMIC_RELAXED) == HEAP_LOCK_UNLOCKED && try_acquire())
+				return;
+#if defined(__i386__) || defined(__x86_64__)
+			asm volatile("pause");
+#endif
+		}
+
+		// Mark the lock as contended so the holder knows to wake us when it releases.
+		while(__atomic_exchange_n(&futex, HEAP_LOCK_CONTENDED, __ATOMIC_ACQUIRE) != HEAP_LOCK_UNLOCKED)
+			futex_wait_value(&futex, HEAP_LOCK_CONTENDED);
+	}
+
+	void release() {
+		if(__atomic_exchange_n(&futex, HEAP_LOCK_UNLOCKED, __ATOMIC_RELEASE) == HEAP_LOCK_CONTENDED)
+			futex_wake(&futex, 1);
+	}
+};
+
+struct ArenaStats {
+	size_t mapped_bytes;
+	size_t used_bytes;
+	size_t free_chunks;
+	size_t empty_spans;
+	size_t empty_bytes;
+	size_t num_spans;
+	size_t num_allocs;
+	size_t num_frees;
+	size_t contended;
+};
+
+struct Arena {
+	HeapLock lock;
+	Span* partial[HEAP_NUM_CLASSES]; // Spans with at least one free chunk
+	uint32_t num_empty[HEAP_NUM_CLASSES];
+	ArenaStats stats;
+};
+
+static constexpr size_t s_class_sizes[HEAP_NUM_CLASSES] = {
+	32, 48, 64, 80, 96, 112, 128,
+	160, 192, 224, 256,
+	320, 384, 448, 512,
+	640, 768, 896, 1024,
+	1280, 1536, 1792, 2048,
+	2560, 3072, 3584, 4096,
+	5120, 6144, 7168, 8192,
+	10240, 12288, 14336, 16384,
+	20480, 24576, 28672, 32768
+};
+
+static Arena s_arenas[HEAP_NUM_ARENAS];
+static size_t s_large_allocs = 0;
+static size_t s_large_bytes = 0;
+
+static inline size_t round_to_pages(size_t size) {
+	return (size + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+}
+
+/**
+ * Finds the smallest size class that fits a chunk of the given size (including its header).
+ * Classes go up in steps of 16 to 128 bytes, then in four steps per power of two.
+ */
+static inline uint32_t size_class_for(size_t chunk_size) {
+	if(chunk_size <= 128)
+		return chunk_size <= 32 ? 0 : (chunk_size + 15) / 16 - 2;
+	uint32_t log = 31 - __builtin_clz(chunk_size - 1);
+	size_t step = 1u << (log - 2);
+	return 7 + (log - 7) * 4 + (chunk_size - (1u << log) + step - 1) / step - 1;
+}
+
+static Arena* acquire_arena() {
+	auto stack_addr = (uintptr_t) __builtin_frame_address(0);
+	size_t index = (stack_addr >> HEAP_STACK_SHIFT) % HEAP_NUM_ARENAS;
+
+	// If our arena is busy, borrow whichever one is free rather than waiting.
+	for(size_t i = 0; i < HEAP_NUM_ARENAS; i++) {
+		auto* arena = &s_arenas[(index + i) % HEAP_NUM_ARENAS];
+		if(arena->lock.try_acquire())
+			return arena;
+	}
+
+	auto* arena = &s_arenas[index];
+	arena->lock.acquire();
+	arena->stats.contended++;
+	return arena;
+}
+
+static void unlink_span(Span* span) {
+	auto* arena = span->arena;
+	if(span->prev)
+		span->prev->next = span->next;
+	else
+		arena->partial[span->size_class] = span->next;
+	if(span->next)
+		span->next->prev = span->prev;
+	span->prev = nullptr;
+	span->next = nullptr;
+}
+
+static void link_span(Span* span) {
+	auto* arena = span->arena;
+	span->prev = nullptr;
+	span->next = arena->partial[span->size_class];
+	if(span->next)
+		span->next->prev = span;
+	arena->partial[span->size_class] = span;
+}
+
+static void release_span(Span* span) {
+	auto* arena = span->arena;
+	unlink_span(span);
+	arena->stats.mapped_bytes -= span->mapped_size;
+	arena->stats.num_spans--;
+	span->magic = 0;
+	munmap(span, span->mapped_size);
+}
+
+static Span* alloc_span(Arena* arena, uint32_t size_class) {
+	size_t chunk_size = s_class_sizes[size_class];
+	size_t span_size = chunk_size * HEAP_MIN_CHUNKS_PER_SPAN + HEAP_SPAN_HEADER_SIZE;
+	if(span_size < HEAP_SPAN_SIZE)
+		span_size = HEAP_SPAN_SIZE;
+	span_size = round_to_pages(span_size);
+
+	auto* span = (Span*) mmap_named(nullptr, span_size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS, 0, 0, "heap");
+	if(span == MAP_FAILED)
+		return nullptr;
+
+	span->magic = HEAP_SPAN_MAGIC;
+	span->size_class = size_class;
+	span->num_chunks = (span_size - HEAP_SPAN_HEADER_SIZE) / chunk_size;
+	span->num_free = span->num_chunks;
+	span->mapped_size = span_size;
+	span->arena = arena;
+	span->free_list = nullptr;
+	span->uncarved = (uint8_t*) span + HEAP_SPAN_HEADER_SIZE;
+	span->end = span->uncarved + span->num_chunks * chunk_size;
+	link_span(span);
+
+	arena->stats.mapped_bytes += span_size;
+	arena->stats.num_spans++;
+	arena->num_empty[size_class]++;
+	return span;
+}
+
+static void* alloc_small(size_t size) {
+	uint32_t size_class = size_class_for(size + sizeof(Chunk));
+	auto* arena = acquire_arena();
+
+	auto* span = arena->partial[size_class];
+	if(!span) {
+		span = alloc_span(arena, size_class);
+		if(!span) {
+			arena->lock.release();
+			errno = ENOMEM;
+			return nullptr;
+		}
+	}
+
+	if(span->num_free == span->num_chunks)
+		arena->num_empty[size_class]--;
+
+	Chunk* chunk;
+	if(span->free_list) {
+		chunk = span->free_list;
+		span->free_list = chunk->next_free;
+	} else {
+		chunk = (Chunk*) span->uncarved;
+		span->uncarved += s_class_sizes[size_class];
+	}
+
+	if(--span->num_free == 0)
+		unlink_span(span);
+
+	arena->stats.used_bytes += s_class_sizes[size_class];
+	arena->stats.num_allocs++;
+	arena->lock.release();
+
+	chunk->span = span;
+	chunk->size = size;
+	chunk->magic = HEAP_CHUNK_MAGIC;
+	return chunk + 1;
+}
+
+static void free_small(Chunk* chunk) {
+	auto* span = chunk->span;
+	auto* arena = span->arena;
+	uint32_t size_class = span->size_class;
+	arena->lock.acquire();
+
+	chunk->magic = HEAP_CHUNK_DEAD;
+	chunk->next_free = span->free_list;
+	span->free_list = chunk;
+	if(span->num_free++ == 0)
+		link_span(span);
+
+	arena->stats.used_bytes -= s_class_sizes[size_class];
+	arena->stats.num_frees++;
+
+	// Keep one empty span around per size class so we don't thrash mmap, and give any others back.
+	if(span->num_free == span->num_chunks) {
+		if(arena->num_empty[size_class])
+			release_span(span);
+		else
+			arena->num_empty[size_class]++;
+	}
+
+	arena->lock.release();
+}
+
+static void* alloc_large(size_t size) {
+	if(size > (size_t) -1 - PAGE_SIZE - sizeof(Chunk)) {
+		errno = ENOMEM;
+		return nullptr;
+	}
+
+	size_t mapped_size = round_to_pages(size + sizeof(Chunk));
+	auto* chunk = (Chunk*) mmap_named(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS, 0, 0, "heap");
+	if(chunk == MAP_FAILED) {
+		errno = ENOMEM;
+		return nullptr;
+	}
+
+	__atomic_add_fetch(&s_large_allocs, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&s_large_bytes, mapped_size, __ATOMIC_RELAXED);
+
+	chunk->span = nullptr;
+	chunk->size = size;
+	chunk->magic = HEAP_CHUNK_MAGIC;
+	chunk->mapped_size = mapped_size;
+	return chunk + 1;
+}
+
+static void free_large(Chunk* chunk) {
+	size_t mapped_size = chunk->mapped_size;
+	__atomic_sub_fetch(&s_large_allocs, 1, __ATOMIC_RELAXED);
+	__atomic_sub_fetch(&s_large_bytes, mapped_size, __ATOMIC_RELAXED);
+	chunk->magic = HEAP_CHUNK_DEAD;
+	if(munmap(chunk, mapped_size) < 0)
+		fprintf(stderr, "WARNING: FAILED TO MEMRELEASE A MALLOC'D REGION");
+}
+
+static inline Chunk* chunk_for(void* ptr) {
+	auto* chunk = (Chunk*) ptr - 1;
+	if(chunk->magic != HEAP_CHUNK_MAGIC) {
+		if(chunk->magic == HEAP_CHUNK_DEAD)
+			fprintf(stderr, "malloc: Double free of %p\n", ptr);
+		else
+			fprintf(stderr, "malloc: Bad free of %p\n", ptr);
+		return nullptr;
+	}
+	return chunk;
+}
+
+static inline size_t usable_size(Chunk* chunk) {
+	if(chunk->span)
+		return s_class_sizes[chunk->span->size_class] - sizeof(Chunk);
+	return chunk->mapped_size - sizeof(Chunk);
+}
+
+void* malloc(size_t size) {
+	if(!size)
+		size = 1;
+	if(size <= HEAP_MAX_CHUNK - sizeof(Chunk))
+		return alloc_small(size);
+	return alloc_large(size);
+}
+
+void free(void* ptr) {
+	if(!ptr)
+		return;
+	auto* chunk = chunk_for(ptr);
+	if(!chunk)
+		return;
+	if(chunk->span)
+		free_small(chunk);
+	else
+		free_large(chunk);
+}
+
+void* calloc(size_t nobj, size_t size) {
+	size_t total;
+	if(__builtin_mul_overflow(nobj, size, &total)) {
+		errno = ENOMEM;
+		return nullptr;
+	}
+
+	void* ptr = malloc(total);
+	if(!ptr)
+		return nullptr;
+
+	// Freshly mapped large allocations are already zeroed
+	auto* chunk = (Chunk*) ptr - 1;
+	if(chunk->span)
+		memset(ptr, 0, total);
+	return ptr;
+}
+
+void* realloc(void* ptr, size_t size) {
+	if(!size) {
+		free(ptr);
+		return nullptr;
+	}
+
+	if(!ptr)
+		return malloc(size);
+
+	auto* chunk = chunk_for(ptr);
+	if(!chunk)
+		return nullptr;
+
+	// If it still fits (and isn't wasting a large mapping), keep the allocation where it is
+	size_t available = usable_size(chunk);
+	if(size <= available && (chunk->span || size > HEAP_MAX_CHUNK - sizeof(Chunk))) {
+		chunk->size = size;
+		return ptr;
+	}
+
+	void* new_ptr = malloc(size);
+	if(!new_ptr)
+		return nullptr;
+	memcpy(new_ptr, ptr, chunk->size < size ? chunk->size : size);
+	free(ptr);
+	return new_ptr;
+}
+
+size_t malloc_usable_size(void* ptr) {
+	if(!ptr)
+		return 0;
+	auto* chunk = chunk_for(ptr);
+	return chunk ? usable_size(chunk) : 0;
+}
+
+int malloc_trim(size_t pad) {
+	int released = 0;
+	for(auto& arena : s_arenas) {
+		arena.lock.acquire();
+		for(uint32_t size_class = 0; size_class < HEAP_NUM_CLASSES; size_class++) {
+			auto* span = arena.partial[size_class];
+			while(span) {
+				auto* next = span->next;
+				if(span->num_free == span->num_chunks) {
+					release_span(span);
+					arena.num_empty[size_class]--;
+					released = 1;
+				}
+				span = next;
+			}
+		}
+		arena.lock.release();
+	}
+	return released;
+}
+
+static ArenaStats arena_stats(Arena& arena) {
+	arena.lock.acquire();
+	ArenaStats stats = arena.stats;
+	stats.free_chunks = 0;
+	stats.empty_spans = 0;
+	stats.empty_bytes = 0;
+	for(auto* span : arena.partial) {
+		for(; span; span = span->next) {
+			stats.free_chunks += span->num_free;
+			if(span->num_free == span->num_chunks) {
+				stats.empty_spans++;
+				stats.empty_bytes += span->mapped_size;
+			}
+		}
+	}
+	arena.lock.release();
+	return stats;
+}
+
+struct mallinfo mallinfo(void) {
+	struct mallinfo info = {};
+	size_t mapped = 0, used = 0, free_chunks = 0, empty_bytes = 0;
+	for(auto& arena : s_arenas) {
+		auto stats = arena_stats(arena);
+		mapped += stats.mapped_bytes;
+		used += stats.used_bytes;
+		free_chunks += stats.free_chunks;
+		empty_bytes += stats.empty_bytes;
+	}
+	info.arena = (int) mapped;
+	info.ordblks = (int) free_chunks;
+	info.hblks = (int) __atomic_load_n(&s_large_allocs, __ATOMIC_RELAXED);
+	info.hblkhd = (int) __atomic_load_n(&s_large_bytes, __ATOMIC_RELAXED);
+	info.uordblks = (int) used;
+	info.fordblks = (int) (mapped - used);
+	info.keepcost = (int) empty_bytes;
+	return info;
+}
+
+void malloc_stats(void) {
+	for(size_t i = 0; i < HEAP_NUM_ARENAS; i++) {
+		auto stats = arena_stats(s_arenas[i]);
+		if(!stats.num_spans && !stats.num_allocs)
+			continue;
+		fprintf(stderr, "Arena %zu: %zu spans, %zu bytes mapped, %zu in use, %zu allocs, %zu frees, %zu contended\n",
+				i, stats.num_spans, stats.mapped_bytes, stats.used_bytes, stats.num_allocs, stats.num_frees, stats.contended);
+	}
+	fprintf(stderr, "Large: %zu allocations, %zu bytes mapped\n",
+			__atomic_load_n(&s_large_allocs, __ATOMIC_RELAXED), __atomic_load_n(&s_large_bytes, __ATOMIC_RELAXED));
+}
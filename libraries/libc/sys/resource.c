@@ -2,12 +2,10 @@
 /* Copyright © 2016-2024 Byteduck */
 
 #include "resource.h"
-#include "../string.h"
+#include "syscall.h"
 
 int getrusage(int who, struct rusage* usage) {
-	// TODO
-	memset(usage, 0, sizeof(struct rusage));
-	return 0;
+	return syscall3(SYS_GETRUSAGE, who, (int) usage);
 }
 
 int getrlimit(int name, struct rlimit* limit) {
@@ -0,0 +1,12 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2024 Byteduck */
+
+#include "times.h"
+#include "syscall.h"
+
+clock_t times(struct tms* buf) {
+	clock_t ticks;
+	if(syscall3(SYS_TIMES, (int) buf, (int) &ticks) < 0)
+		return (clock_t) -1;
+	return ticks;
+}
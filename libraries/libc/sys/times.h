@@ -0,0 +1,12 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2024 Byteduck */
+
+#pragma once
+
+#include <kernel/api/times.h>
+
+__DECL_BEGIN
+
+clock_t times(struct tms* buf);
+
+__DECL_END
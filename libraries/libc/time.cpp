@@ -20,6 +20,7 @@
 #include <time.h>
 #include <sys/time.h>
 #include <sys/syscall.h>
+#include <sys/resource.h>
 
 constexpr time_t SECOND = 1;
 constexpr time_t MINUTE = SECOND * 60;
@@ -95,7 +96,12 @@ void epoch_to_tm(time_t epoch, struct tm& time) {
 };
 
 clock_t clock() {
-	return -1;
+	struct rusage usage;
+	if(getrusage(RUSAGE_SELF, &usage) < 0)
+		return -1;
+	long long usec = (long long) (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000
+			+ usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+	return (clock_t) (usec / (1000000 / CLOCKS_PER_SEC));
 }
 
 double difftime(time_t time_end, time_t time_beg) {
@@ -9,6 +9,8 @@ namespace Debug {
 	class LiveDebugger: public Debugger {
 	public:
 		Duck::Result attach(pid_t pid, tid_t tid);
+		/// Loads the memory map of a process without attaching to it, so that its addresses can be symbolicated.
+		Duck::Result inspect(pid_t pid);
 
 		// Debugger
 		Duck::ResultRet<uintptr_t> peek(size_t addr) override;
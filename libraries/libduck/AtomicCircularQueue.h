@@ -5,6 +5,11 @@
 
 #include <atomic>
 #include <cassert>
+#include <cstring>
+#include <optional>
+#include <algorithm>
+#include <type_traits>
+#include <sys/futex.h>
 #include "SharedBuffer.h"
 
 namespace Duck {
@@ -12,9 +17,15 @@ namespace Duck {
 	 * This class is meant to be used in multithreaded or IPC applications where a circular queue is needed.
 	 * The queue can be pushed to and popped from atomically without worry of synchronization.
 	 * One thread can push to the queue, and one thread can pop.
+	 *
+	 * Values can be pushed and popped in bulk, and the waiting variants block on a futex (instead of spinning) until
+	 * the other side makes data or space available.
 	 */
-	template<typename T, int Size>
+	template<typename T, size_t Size>
 	class AtomicCircularQueue {
+		static_assert(Size && !(Size & (Size - 1)), "Size must be a power of two");
+		static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable, since the queue may be shared between processes");
+
 	public:
 		AtomicCircularQueue(): m_buffer(nullptr), m_queue(nullptr) {}
 
@@ -28,46 +39,100 @@ namespace Duck {
 			return AtomicCircularQueue(buffer);
 		}
 
+		/** The number of values currently in the queue. **/
+		size_t size() {
+			return m_queue->back.load(std::memory_order_acquire) - m_queue->front.load(std::memory_order_acquire);
+		}
+
 		bool full() {
-			return ((m_queue->front.load() - 1) % Size) == (m_queue->back.load() % Size);
+			return size() == Size;
 		}
 
 		bool empty() {
-			return m_queue->front.load() == m_queue->back.load();
+			return size() == 0;
 		}
 
 		/** Tries to push a value to the queue. Returns true if successful, or false if no space was available. **/
 		bool push(const T& value) {
-			if(full())
-				return false;
-			auto back = m_queue->back.load() % Size;
-			new (&m_queue->storage[back]) T(value);
-			m_queue->back.fetch_add(1);
-			return true;
+			return push(&value, 1);
+		}
+
+		/** Pushes as many of the given values to the queue as there's space for, returning the number pushed. **/
+		size_t push(const T* values, size_t count) {
+			size_t back = m_queue->back.load(std::memory_order_relaxed);
+			size_t front = m_queue->front.load(std::memory_order_acquire);
+			count = std::min(count, Size - (back - front));
+			if(!count)
+				return 0;
+
+			// Copy in up to two runs, since the free space may wrap around the end of the storage.
+			size_t index = back & (Size - 1);
+			size_t first_run = std::min(count, Size - index);
+			memcpy(&m_queue->storage[index], values, first_run * sizeof(T));
+			memcpy(&m_queue->storage[0], values + first_run, (count - first_run) * sizeof(T));
+
+			m_queue->back.store(back + count, std::memory_order_release);
+			notify(m_queue->data_seq, m_queue->consumer_waiting);
+			return count;
 		}
 
 		/** Pushes a value to the queue, waiting until space is available. **/
 		void push_wait(const T& value) {
-			while(!push(value))
-				usleep(1);
+			push_wait(&value, 1);
+		}
+
+		/** Pushes all of the given values to the queue, waiting for space as needed. **/
+		void push_wait(const T* values, size_t count) {
+			while(count) {
+				size_t pushed = push(values, count);
+				values += pushed;
+				count -= pushed;
+				if(count)
+					wait(m_queue->space_seq, m_queue->producer_waiting, [&] { return !full(); });
+			}
 		}
 
 		/** Pops a value from the queue, if available. **/
 		std::optional<T> pop() {
-			if(empty())
+			T value;
+			if(!pop(&value, 1))
 				return std::nullopt;
-			auto front = m_queue->front.load() % Size;
-			auto ret = std::move(m_queue->storage[front]);
-			m_queue->front.fetch_add(1);
-			return ret;
+			return value;
+		}
+
+		/** Pops up to count values from the queue into values, returning the number popped. **/
+		size_t pop(T* values, size_t count) {
+			size_t front = m_queue->front.load(std::memory_order_relaxed);
+			size_t back = m_queue->back.load(std::memory_order_acquire);
+			count = std::min(count, back - front);
+			if(!count)
+				return 0;
+
+			size_t index = front & (Size - 1);
+			size_t first_run = std::min(count, Size - index);
+			memcpy(values, &m_queue->storage[index], first_run * sizeof(T));
+			memcpy(values + first_run, &m_queue->storage[0], (count - first_run) * sizeof(T));
+
+			m_queue->front.store(front + count, std::memory_order_release);
+			notify(m_queue->space_seq, m_queue->producer_waiting);
+			return count;
 		}
 
 		/** Pops a value from the queue, waiting until one is available. **/
 		T pop_wait() {
-			while(true) {
-				auto res = pop();
-				if(res.has_value())
-					return res.value();
+			T value;
+			pop_wait(&value, 1);
+			return value;
+		}
+
+		/** Pops exactly count values from the queue into values, waiting for more to be pushed as needed. **/
+		void pop_wait(T* values, size_t count) {
+			while(count) {
+				size_t popped = pop(values, count);
+				values += popped;
+				count -= popped;
+				if(count)
+					wait(m_queue->data_seq, m_queue->consumer_waiting, [&] { return !empty(); });
 			}
 		}
 
@@ -83,23 +148,51 @@ namespace Duck {
 			assert(buffer->size() >= sizeof(AtomicCircularQueueStruct));
 		}
 
+		template<typename ReadyFunc>
+		static void wait(std::atomic<futex_t>& seq, std::atomic<int>& waiting, ReadyFunc ready) {
+			// Announce that we're waiting before checking again, so the other side either sees us waiting or we see
+			// what it did. Otherwise, we could go to sleep right after it checked for waiters and never wake up.
+			futex_t cur_seq = seq.load(std::memory_order_acquire);
+			waiting.store(1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if(!ready())
+				futex_wait_value((futex_t*) &seq, cur_seq);
+			waiting.store(0, std::memory_order_relaxed);
+		}
+
+		static void notify(std::atomic<futex_t>& seq, std::atomic<int>& waiting) {
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if(!waiting.load(std::memory_order_relaxed))
+				return;
+			seq.fetch_add(1, std::memory_order_release);
+			futex_wake((futex_t*) &seq, 1);
+		}
+
 		struct AtomicCircularQueueStruct {
 		public:
 
 			/*
 			 * Instead of being wrapped around automatically like a regular queue, front and back can only be increased.
 			 * This means that in order to get the "real" position of the front and back, we have to mod them by Size.
+			 * Since Size is a power of two, this still works when they overflow.
 			 *
-			 * This way, we know that the queue is empty if front == back and full if (front - 1) % Size == back,
+			 * This way, we know that the queue is empty if front == back and full if back - front == Size,
 			 * instead of having to keep track of size separately, which would complicate things.
 			 */
 
 			std::atomic<size_t> front = 0; /* Points to the next element to be popped off the queue. */
 			std::atomic<size_t> back = 0; /* Points to where the next element will be pushed onto the queue. */
 
+			std::atomic<futex_t> data_seq = 0; /* Bumped to wake the consumer when data is pushed. */
+			std::atomic<futex_t> space_seq = 0; /* Bumped to wake the producer when data is popped. */
+			std::atomic<int> consumer_waiting = 0;
+			std::atomic<int> producer_waiting = 0;
+
 			T storage[Size];
 		};
 
+		static_assert(sizeof(std::atomic<futex_t>) == sizeof(futex_t));
+
 		Ptr<SharedBuffer> m_buffer;
 		AtomicCircularQueueStruct* m_queue;
 	};
@@ -0,0 +1,34 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2024 Byteduck */
+
+#include "CPU.h"
+#include <cstdint>
+
+using namespace Duck;
+
+bool CPU::has_sse2() {
+	return features().sse2;
+}
+
+bool CPU::has_ssse3() {
+	return features().ssse3;
+}
+
+bool CPU::has_sse41() {
+	return features().sse41;
+}
+
+const CPU::Features& CPU::features() {
+	static Features features = [] {
+		Features ret;
+#if defined(__i386__) || defined(__x86_64__)
+		uint32_t eax = 1, ebx, ecx, edx;
+		asm volatile("cpuid" : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+		ret.sse2 = edx & (1u << 26);
+		ret.ssse3 = ecx & (1u << 9);
+		ret.sse41 = ecx & (1u << 19);
+#endif
+		return ret;
+	}();
+	return features;
+}
@@ -0,0 +1,27 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2024 Byteduck */
+
+#pragma once
+
+namespace Duck {
+	/**
+	 * Reports which optional instruction set extensions the CPU supports, so that optimized code paths can be chosen
+	 * at runtime. The CPU is only queried once.
+	 */
+	class CPU {
+	public:
+		static bool has_sse2();
+		static bool has_ssse3();
+		static bool has_sse41();
+
+	private:
+		struct Features {
+			bool sse2 = false;
+			bool ssse3 = false;
+			bool sse41 = false;
+		};
+
+		static const Features& features();
+	};
+}
+
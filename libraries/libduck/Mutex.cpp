@@ -0,0 +1,22 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2024 Byteduck */
+
+#include "Mutex.h"
+
+using namespace Duck;
+
+Mutex::~Mutex() {
+	pthread_mutex_destroy(&m_mutex);
+}
+
+void Mutex::acquire() {
+	pthread_mutex_lock(&m_mutex);
+}
+
+bool Mutex::try_acquire() {
+	return !pthread_mutex_trylock(&m_mutex);
+}
+
+void Mutex::release() {
+	pthread_mutex_unlock(&m_mutex);
+}
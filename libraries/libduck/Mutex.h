@@ -0,0 +1,29 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2024 Byteduck */
+
+#pragma once
+
+#include <pthread.h>
+#include "SpinLock.h"
+
+namespace Duck {
+	/**
+	 * A lock that spins briefly when contended and then blocks in the kernel until the holder releases it.
+	 * Can be used with LOCK() just like a SpinLock.
+	 */
+	class Mutex {
+	public:
+		Mutex() = default;
+		Mutex(const Mutex& other) = delete;
+		Mutex& operator=(const Mutex& other) = delete;
+		~Mutex();
+
+		void acquire();
+		bool try_acquire();
+		void release();
+
+	private:
+		pthread_mutex_t m_mutex = PTHREAD_MUTEX_INITIALIZER;
+	};
+}
+
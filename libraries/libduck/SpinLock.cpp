@@ -19,19 +19,27 @@
 
 #include "SpinLock.h"
 #include <sys/thread.h>
+#include <sched.h>
 
-void Duck::SpinLock::acquire() {
-	while(times_locked.exchange(1, std::memory_order_acquire));
-}
+// How many times to check the lock before yielding to other threads.
+#define SPINLOCK_SPINS 100
 
-void Duck::SpinLock::release() {
-	times_locked.store(0, std::memory_order_release);
+void Duck::SpinLock::acquire() {
+	int spins = 0;
+	while(times_locked.exchange(1, std::memory_order_acquire)) {
+		while(times_locked.load(std::memory_order_relaxed)) {
+			if(++spins < SPINLOCK_SPINS)
+				continue;
+			sched_yield();
+			spins = 0;
+		}
+	}
 }
 
-Duck::ScopedLock::ScopedLock(Duck::SpinLock& lock): lock(lock) {
-	lock.acquire();
+bool Duck::SpinLock::try_acquire() {
+	return !times_locked.exchange(1, std::memory_order_acquire);
 }
 
-Duck::ScopedLock::~ScopedLock() {
-	lock.release();
+void Duck::SpinLock::release() {
+	times_locked.store(0, std::memory_order_release);
 }
@@ -25,22 +25,37 @@
 #define LOCK(l) Duck::ScopedLock __lock(l);
 
 namespace Duck {
+	/**
+	 * A lock that busy-waits until it's available, yielding the CPU every so often so that a holder on the same CPU
+	 * can run. Only use this for very short critical sections; Duck::Mutex is a better choice for almost everything.
+	 */
 	class SpinLock {
 	public:
 		SpinLock() = default;
 		void acquire();
+		bool try_acquire();
 		void release();
 
 	private:
 		std::atomic<int> times_locked = {0};
 	};
 
+	/**
+	 * Holds a lock (anything with acquire() and release()) for as long as it's in scope.
+	 */
+	template<typename LockType>
 	class ScopedLock {
 	public:
-		explicit ScopedLock(SpinLock& lock);
-		~ScopedLock();
+		explicit ScopedLock(LockType& lock): lock(lock) {
+			lock.acquire();
+		}
+
+		~ScopedLock() {
+			lock.release();
+		}
+
 	private:
-		SpinLock& lock;
+		LockType& lock;
 	};
 }
 
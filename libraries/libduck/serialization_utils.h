@@ -36,6 +36,7 @@
 
 namespace Duck {
 	class Serializable;
+	class SharedBuffer;
 }
 
 namespace Duck::Serialization {
@@ -61,10 +62,23 @@ namespace Duck::Serialization {
 				is_vector<T>() ||
 				std::is_same<T, std::string>() ||
 				std::is_same<T, Duck::Ptr<Duck::ByteBuffer>>() ||
+				std::is_same<T, Duck::Ptr<Duck::SharedBuffer>>() ||
 				std::is_base_of<Duck::Serializable, T>() ||
 				is_serializable_struct<T>()
 			> {};
 
+	/**
+	 * Whether every value of a type serializes to the same number of bytes, given by buffer_size().
+	 */
+	template<typename T>
+	struct is_fixed_size_type : std::integral_constant<bool,
+				is_serializable_type<T>() &&
+				!is_vector<T>() &&
+				!std::is_same<T, std::string>() &&
+				!std::is_same<T, Duck::Ptr<Duck::ByteBuffer>>() &&
+				!std::is_base_of<Duck::Serializable, T>()
+			> {};
+
 	template<typename T>
 	struct is_serializable_return_type : std::integral_constant<bool, is_serializable_type<T>() || std::is_void<T>()> {};
 
@@ -83,6 +97,8 @@ namespace Duck::Serialization {
 			return first.size() + 1 + buffer_size(rest...);
 		else if constexpr(std::is_same<ParamT, Duck::Ptr<Duck::ByteBuffer>>())
 			return sizeof(size_t) + first.size() + buffer_size(rest...);
+		else if constexpr(std::is_same<ParamT, Duck::Ptr<Duck::SharedBuffer>>())
+			return sizeof(int) + buffer_size(rest...);
 		else if constexpr(std::is_base_of<Duck::Serializable, ParamT>())
 			return first.serialized_size() + buffer_size(rest...);
 		else
@@ -115,6 +131,10 @@ namespace Duck::Serialization {
 			buf += sizeof(size_t);
 			memcpy((char*) buf, first.template data<void>(), first.size());
 			buf += first.size();
+		} else if constexpr(std::is_same<ParamT, Duck::Ptr<Duck::SharedBuffer>>()) {
+			//Shared buffers are passed by reference, so the receiver needs to have been allowed to map them
+			*((int*) buf) = first ? first->id() : -1;
+			buf += sizeof(int);
 		} else if constexpr(std::is_base_of<Duck::Serializable, ParamT>()) {
 			first.serialize(buf);
 		} else {
@@ -149,6 +169,11 @@ namespace Duck::Serialization {
 			size_t size = *((size_t*) buf); //TODO Sanity check?
 			buf += sizeof(size_t);
 			first = Duck::ByteBuffer::copy(buf, size);
+		} else if constexpr(std::is_same<ParamT, Duck::Ptr<Duck::SharedBuffer>>()) {
+			int id = *((int*) buf);
+			buf += sizeof(int);
+			auto adopt_res = ParamT::element_type::adopt(id);
+			first = adopt_res.is_error() ? nullptr : adopt_res.value();
 		} else if constexpr(std::is_base_of<Duck::Serializable, ParamT>()) {
 			first.deserialize(buf);
 		} else {
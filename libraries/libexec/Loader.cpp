@@ -21,6 +21,9 @@ Loader::Loader(std::string main_executable):
 	m_global_symbols["__dlopen"] = (uintptr_t) __dlopen;
 	m_global_symbols["__dlclose"] = (uintptr_t) __dlclose;
 	m_global_symbols["__dlsym"] = (uintptr_t) __dlsym;
+	m_lazy_binding = !getenv("LD_BIND_NOW");
+	// Never let a setuid or setgid executable's symbol bindings come from (or go to) the cache
+	m_use_cache = !getenv("LD_NO_CACHE") && getuid() == geteuid() && getgid() == getegid();
 }
 
 Loader* Loader::main() {
@@ -44,6 +47,9 @@ Duck::Result Loader::load() {
 	// Map the executable
 	struct stat statbuf;
 	fstat(m_executable->fd, &statbuf);
+	m_executable->path = m_main_executable;
+	m_executable->inode = statbuf.st_ino;
+	m_executable->mtime = statbuf.st_mtime;
 	m_executable->mapped_size = ((statbuf.st_size + PAGE_SIZE - 1) / PAGE_SIZE) * PAGE_SIZE;
 	auto* mapped_file = mmap(nullptr, m_executable->mapped_size, PROT_READ, MAP_SHARED, m_executable->fd, 0);
 	if(mapped_file == MAP_FAILED) {
@@ -51,20 +57,28 @@ Duck::Result Loader::load() {
 	}
 	m_executable->mapped_file = (uint8_t*) mapped_file;
 
+	// See if we've loaded this exact executable before
+	if(m_use_cache && m_cache.read(m_main_executable).is_success()) {
+		auto& cached_exec = m_cache.object(0);
+		m_cache_valid = cached_exec.inode == (uint32_t) statbuf.st_ino && cached_exec.mtime == statbuf.st_mtime;
+	}
+
 	//Load the executable and its dependencies
 	if(m_executable->load(*this, m_main_executable.c_str()) < 0)
 		return errno;
 
-	//Read the symbols from the libraries and executable
-	auto rev_it = m_objects.rbegin();
-	while(rev_it != m_objects.rend()) {
-		auto* object = rev_it->second;
-		object->read_symbols(*this);
-		rev_it++;
+	//If everything is where it was last time, we can reuse the symbol locations we found then
+	if(m_cache_valid)
+		m_cache_valid = cache_matches_objects();
+	if(m_cache_valid) {
+		for(size_t i = 0; i < m_cache.num_symbols(); i++) {
+			auto& symbol = m_cache.symbol(i);
+			m_symbols[m_cache.string(symbol.name)] = symbol.loc;
+		}
 	}
 
-	//Relocate the libraries and executable
-	rev_it = m_objects.rbegin();
+	//Relocate the libraries and executable. Symbols are looked up on demand through each object's hash table.
+	auto rev_it = m_objects.rbegin();
 	while(rev_it != m_objects.rend()) {
 		auto* object = rev_it->second;
 		object->relocate(*this);
@@ -72,10 +86,13 @@ Duck::Result Loader::load() {
 		rev_it++;
 	}
 
+	if(m_use_cache && !m_cache_valid)
+		write_cache();
+
 	// Call __init_stdio for libc.so before any other initializer
-	if(m_symbols["__init_stdio"] != 0) {
-		((void(*)()) m_symbols["__init_stdio"])();
-	}
+	auto init_stdio = get_symbol("__init_stdio");
+	if(init_stdio)
+		((void(*)()) init_stdio)();
 
 	//Call the initializer methods for the libraries and executable
 	rev_it = m_objects.rbegin();
@@ -128,17 +145,36 @@ Object* Loader::open_library(const char* library_name) {
 		return m_objects[library_name];
 	}
 
-	//Find the library
-	auto library_loc = find_library(library_name);
-	if(library_loc.empty())
-		return nullptr;
-
-	//Open the library
-	int fd = open(library_loc.c_str(), O_RDONLY);
-	if(fd < 0)
-		return nullptr;
+	//Try the location from the loader cache first, as long as it's still the same file
+	std::string library_loc;
+	int fd = -1;
 	struct stat statbuf;
-	fstat(fd, &statbuf);
+	auto* cached = m_cache_valid ? m_cache.find_object(library_name) : nullptr;
+	if(cached) {
+		fd = open(m_cache.string(cached->path), O_RDONLY);
+		if(fd >= 0 && (fstat(fd, &statbuf) < 0 || statbuf.st_ino != cached->inode || statbuf.st_mtime != cached->mtime)) {
+			close(fd);
+			fd = -1;
+		}
+		if(fd >= 0)
+			library_loc = m_cache.string(cached->path);
+	}
+
+	if(fd < 0) {
+		m_cache_valid = false;
+
+		//Find the library
+		library_loc = find_library(library_name);
+		if(library_loc.empty())
+			return nullptr;
+
+		//Open the library
+		fd = open(library_loc.c_str(), O_RDONLY);
+		if(fd < 0)
+			return nullptr;
+		fstat(fd, &statbuf);
+	}
+
 	size_t mapped_size = ((statbuf.st_size + PAGE_SIZE - 1) / PAGE_SIZE) * PAGE_SIZE;
 	auto* mapped_file = mmap(nullptr, mapped_size, PROT_READ, MAP_SHARED, fd, 0);
 	if(mapped_file == MAP_FAILED) {
@@ -151,6 +187,9 @@ Object* Loader::open_library(const char* library_name) {
 	m_objects[library_name] = object;
 	object->fd = fd;
 	object->name = library_name;
+	object->path = library_loc;
+	object->inode = statbuf.st_ino;
+	object->mtime = statbuf.st_mtime;
 	object->mapped_file = (uint8_t*) mapped_file;
 	object->mapped_size = mapped_size;
 
@@ -162,12 +201,11 @@ Object* Loader::open_library(const char* library_name) {
 std::string Loader::find_library(const char* library_name) {
 	if(strchr(library_name, '/')) return library_name;
 
-	char* ld_library_path = getenv("LD_LIBRARY_PATH");
-	std::string default_ld = "/lib:/usr/lib:/usr/local/lib";
-	if(!ld_library_path)
-		ld_library_path = const_cast<char*>(default_ld.c_str());
+	// strtok modifies the string, so work on a copy instead of the environment itself
+	char* env_library_path = getenv("LD_LIBRARY_PATH");
+	std::string ld_library_path = env_library_path ? env_library_path : "/lib:/usr/lib:/usr/local/lib";
 
-	char* cpath = strtok(ld_library_path, ":");
+	char* cpath = strtok(ld_library_path.data(), ":");
 	struct stat stat_buf {};
 	while(cpath != nullptr) {
 		std::string file = std::string(cpath) + "/" + std::string(library_name);
@@ -192,13 +230,57 @@ uintptr_t Loader::get_global_symbol(const char* name) {
 	return s->second;
 }
 
-void Loader::set_symbol(const char* name, uintptr_t loc) {
-	m_symbols[name] = loc;
+uintptr_t Loader::get_symbol(const char* name, bool copy_name) {
+	auto s = m_symbols.find(name);
+	if (s != m_symbols.end())
+		return s->second;
+
+	// Only cache symbols we found; a library loaded later by dlopen may still provide the missing ones
+	auto loc = find_symbol(name);
+	if(loc) {
+		if(copy_name)
+			m_symbols[m_copied_symbol_names.emplace_back(name)] = loc;
+		else
+			m_symbols[name] = loc;
+	}
+	return loc;
 }
 
-uintptr_t Loader::get_symbol(const char* name) {
-	auto s = m_symbols.find(name);
-	if (s == m_symbols.end())
-		return 0;
-	return s->second;
+bool Loader::cache_matches_objects() {
+	if(m_cache.num_objects() != m_objects.size() || m_cache.object(0).memloc != m_executable->memloc)
+		return false;
+	for(size_t i = 1; i < m_cache.num_objects(); i++) {
+		auto& cached = m_cache.object(i);
+		auto object = m_objects.find(m_cache.string(cached.name));
+		if(object == m_objects.end() || object->second->memloc != cached.memloc)
+			return false;
+	}
+	return true;
+}
+
+void Loader::write_cache() {
+	LoaderCache::Writer writer;
+	writer.add_object(m_executable->name, m_executable->path, m_executable->inode, m_executable->mtime, m_executable->memloc);
+	for(auto& [name, object] : m_objects) {
+		if(object != m_executable)
+			writer.add_object(name, object->path, object->inode, object->mtime, object->memloc);
+	}
+	for(auto& [name, loc] : m_symbols)
+		writer.add_symbol(name, loc);
+
+	auto res = writer.write(m_main_executable);
+	if(res.is_error() && m_debug)
+		Log::dbgf("Couldn't write loader cache for {}: {}", m_main_executable, res.message());
+}
+
+uintptr_t Loader::find_symbol(const char* name) const {
+	uint32_t sysv_hash = Object::sysv_hash(name);
+	uint32_t gnu_hash = Object::gnu_hash(name);
+	for(auto it = m_objects.rbegin(); it != m_objects.rend(); it++) {
+		auto* object = it->second;
+		auto* symbol = object->find_dynamic_symbol(name, sysv_hash, gnu_hash);
+		if(symbol)
+			return symbol->st_value + object->memloc;
+	}
+	return 0;
 }
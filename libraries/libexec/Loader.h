@@ -5,8 +5,11 @@
 
 #include <unordered_map>
 #include "Object.h"
+#include "LoaderCache.h"
 #include <map>
+#include <deque>
 #include <string>
+#include <string_view>
 #include <libduck/Result.h>
 
 namespace Exec {
@@ -25,20 +28,36 @@ namespace Exec {
 
 		void set_global_symbol(const char* name, uintptr_t loc);
 		uintptr_t get_global_symbol(const char* name);
-		void set_symbol(const char* name, uintptr_t loc);
-		uintptr_t get_symbol(const char* name);
+		/**
+		 * Looks up a symbol and caches its location.
+		 * @param name The name of the symbol.
+		 * @param copy_name Whether name needs to be copied before being cached, because it doesn't point into a
+		 *                  loaded object's string table (for instance, if it was passed to dlsym).
+		 */
+		uintptr_t get_symbol(const char* name, bool copy_name = false);
+		uintptr_t find_symbol(const char* name) const;
 
 		bool debug_mode() const { return m_debug; }
+		bool lazy_binding() const { return m_lazy_binding; }
 
 	private:
+		bool cache_matches_objects();
+		void write_cache();
+
 		static Loader* s_main_loader;
 
 		std::string m_main_executable;
-		std::unordered_map<std::string, uintptr_t> m_global_symbols;
-		std::unordered_map<std::string, uintptr_t> m_symbols;
+		// Symbol names point into the loaded objects' string tables, which are never unmapped
+		std::unordered_map<std::string_view, uintptr_t> m_global_symbols;
+		std::unordered_map<std::string_view, uintptr_t> m_symbols;
+		std::deque<std::string> m_copied_symbol_names; ///Owns the names of cached symbols that were looked up with copy_name.
 		std::map<std::string, Object*> m_objects;
 		size_t m_current_brk = 0;
 		bool m_debug = false;
+		bool m_lazy_binding = true;
+		LoaderCache m_cache;
+		bool m_use_cache = true;
+		bool m_cache_valid = false;
 		Object* m_executable;
 	};
 }
@@ -0,0 +1,157 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2024 Byteduck */
+
+#include "LoaderCache.h"
+#include "Object.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using Duck::Result;
+using namespace Exec;
+
+std::string LoaderCache::cache_path(const std::string& executable) {
+	char name[16];
+	snprintf(name, sizeof(name), "%08x", Object::gnu_hash(executable.c_str()));
+	return std::string(LOADER_CACHE_DIR "/") + name;
+}
+
+Result LoaderCache::read(const std::string& executable) {
+	int fd = open(cache_path(executable).c_str(), O_RDONLY | O_NOFOLLOW);
+	if(fd < 0)
+		return errno;
+
+	struct stat statbuf;
+	if(fstat(fd, &statbuf) < 0 || (size_t) statbuf.st_size < sizeof(Header)) {
+		close(fd);
+		return Result("Invalid cache");
+	}
+
+	// The cache decides where symbols are bound, so only trust it if nobody but root (or us) could have written it
+	bool trusted_owner = statbuf.st_uid == 0 || statbuf.st_uid == geteuid();
+	if(!S_ISREG(statbuf.st_mode) || !trusted_owner || (statbuf.st_mode & (S_IWGRP | S_IWOTH))) {
+		close(fd);
+		return Result("Untrusted cache");
+	}
+
+	m_data.resize(statbuf.st_size);
+	ssize_t nread = ::read(fd, m_data.data(), m_data.size());
+	close(fd);
+	if(nread != (ssize_t) m_data.size())
+		return Result("Couldn't read cache");
+
+	// Make sure everything is in bounds before we trust any of it
+	auto* header = (const Header*) m_data.data();
+	size_t expected_size = sizeof(Header)
+			+ header->num_objects * sizeof(ObjectEntry)
+			+ header->num_symbols * sizeof(SymbolEntry)
+			+ header->strings_size;
+	if(header->magic != LOADER_CACHE_MAGIC || header->version != LOADER_CACHE_VERSION || expected_size != m_data.size())
+		return Result("Invalid cache");
+	if(!header->num_objects || !header->strings_size || m_data.back() != '\0')
+		return Result("Invalid cache");
+
+	m_header = header;
+	m_objects = (const ObjectEntry*) (m_data.data() + sizeof(Header));
+	m_symbols = (const SymbolEntry*) (m_objects + header->num_objects);
+	m_strings = (const char*) (m_symbols + header->num_symbols);
+
+	bool strings_valid = header->library_path < header->strings_size;
+	for(size_t i = 0; i < header->num_objects; i++)
+		strings_valid &= m_objects[i].name < header->strings_size && m_objects[i].path < header->strings_size;
+	for(size_t i = 0; i < header->num_symbols; i++)
+		strings_valid &= m_symbols[i].name < header->strings_size;
+	if(!strings_valid) {
+		m_header = nullptr;
+		return Result("Invalid cache");
+	}
+
+	// The cache is only good for the same executable and library search path
+	if(executable != string(m_objects[0].path) || strcmp(library_path(), string(header->library_path))) {
+		m_header = nullptr;
+		return Result("Stale cache");
+	}
+
+	return Result::SUCCESS;
+}
+
+const LoaderCache::ObjectEntry* LoaderCache::find_object(const char* name) const {
+	for(size_t i = 1; i < num_objects(); i++) {
+		if(!strcmp(string(m_objects[i].name), name))
+			return &m_objects[i];
+	}
+	return nullptr;
+}
+
+const char* LoaderCache::library_path() {
+	auto* path = getenv("LD_LIBRARY_PATH");
+	return path ? path : "";
+}
+
+LoaderCache::Writer::Writer() {
+	m_library_path = add_string(library_path());
+}
+
+void LoaderCache::Writer::add_object(const std::string& name, const std::string& path, ino_t inode, time_t mtime, size_t memloc) {
+	m_objects.push_back({
+		.name = add_string(name),
+		.path = add_string(path),
+		.inode = (uint32_t) inode,
+		.memloc = (uint32_t) memloc,
+		.mtime = mtime
+	});
+}
+
+void LoaderCache::Writer::add_symbol(std::string_view name, uintptr_t loc) {
+	m_symbols.push_back({
+		.name = add_string(name),
+		.loc = (uint32_t) loc
+	});
+}
+
+Result LoaderCache::Writer::write(const std::string& executable) {
+	Header header = {
+		.magic = LOADER_CACHE_MAGIC,
+		.version = LOADER_CACHE_VERSION,
+		.num_objects = (uint32_t) m_objects.size(),
+		.num_symbols = (uint32_t) m_symbols.size(),
+		.strings_size = (uint32_t) m_strings.size(),
+		.library_path = m_library_path
+	};
+
+	// Write to a temporary file first so other processes never see a partially-written cache
+	auto path = cache_path(executable);
+	auto temp_path = path + "." + std::to_string(getpid());
+	unlink(temp_path.c_str()); // Left over from a process that had the same pid and crashed while writing
+	int fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW, 0644);
+	if(fd < 0)
+		return errno;
+
+	bool success = ::write(fd, &header, sizeof(header)) == sizeof(header)
+			&& ::write(fd, m_objects.data(), m_objects.size() * sizeof(ObjectEntry)) == (ssize_t) (m_objects.size() * sizeof(ObjectEntry))
+			&& ::write(fd, m_symbols.data(), m_symbols.size() * sizeof(SymbolEntry)) == (ssize_t) (m_symbols.size() * sizeof(SymbolEntry))
+			&& ::write(fd, m_strings.data(), m_strings.size()) == (ssize_t) m_strings.size();
+	close(fd);
+
+	if(success) {
+		unlink(path.c_str());
+		success = rename(temp_path.c_str(), path.c_str()) == 0;
+	}
+
+	if(!success) {
+		unlink(temp_path.c_str());
+		return Result("Couldn't write cache");
+	}
+
+	return Result::SUCCESS;
+}
+
+uint32_t LoaderCache::Writer::add_string(std::string_view string) {
+	auto offset = (uint32_t) m_strings.size();
+	m_strings.insert(m_strings.end(), string.begin(), string.end());
+	m_strings.push_back('\0');
+	return offset;
+}
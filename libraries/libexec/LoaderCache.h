@@ -0,0 +1,86 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2024 Byteduck */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sys/types.h>
+#include <libduck/Result.h>
+
+#define LOADER_CACHE_DIR "/var/cache/ld"
+#define LOADER_CACHE_MAGIC 0x4c444348 // "LDCH"
+#define LOADER_CACHE_VERSION 1
+
+namespace Exec {
+	/**
+	 * A per-executable record of where the dynamic loader found each library, where it put it, and what symbols it
+	 * resolved while relocating. On a warm start, the loader can skip the library search path and symbol lookups as
+	 * long as every object still has the same inode and mtime and ends up at the same address.
+	 */
+	class LoaderCache {
+	public:
+		struct Header {
+			uint32_t magic;
+			uint32_t version;
+			uint32_t num_objects;
+			uint32_t num_symbols;
+			uint32_t strings_size;
+			uint32_t library_path; // Offset of LD_LIBRARY_PATH in the string table
+		};
+
+		struct ObjectEntry {
+			uint32_t name; // Offset in the string table
+			uint32_t path; // Offset in the string table
+			uint32_t inode;
+			uint32_t memloc;
+			int64_t mtime;
+		};
+
+		struct SymbolEntry {
+			uint32_t name; // Offset in the string table
+			uint32_t loc;
+		};
+
+		class Writer {
+		public:
+			Writer();
+			void add_object(const std::string& name, const std::string& path, ino_t inode, time_t mtime, size_t memloc);
+			void add_symbol(std::string_view name, uintptr_t loc);
+			/// Atomically replaces the cache for an executable.
+			Duck::Result write(const std::string& executable);
+
+		private:
+			uint32_t add_string(std::string_view string);
+
+			std::vector<ObjectEntry> m_objects;
+			std::vector<SymbolEntry> m_symbols;
+			std::vector<char> m_strings;
+			uint32_t m_library_path;
+		};
+
+		static std::string cache_path(const std::string& executable);
+
+		/// Reads the cache for an executable. The first object is always the executable itself.
+		Duck::Result read(const std::string& executable);
+
+		const ObjectEntry* find_object(const char* name) const;
+		[[nodiscard]] size_t num_objects() const { return m_header ? m_header->num_objects : 0; }
+		[[nodiscard]] const ObjectEntry& object(size_t index) const { return m_objects[index]; }
+		[[nodiscard]] size_t num_symbols() const { return m_header ? m_header->num_symbols : 0; }
+		[[nodiscard]] const SymbolEntry& symbol(size_t index) const { return m_symbols[index]; }
+		/// Strings returned by this stay valid for the lifetime of the cache.
+		[[nodiscard]] const char* string(uint32_t offset) const { return m_strings + offset; }
+
+	private:
+		static const char* library_path();
+
+		std::vector<uint8_t> m_data;
+		const Header* m_header = nullptr;
+		const ObjectEntry* m_objects = nullptr;
+		const SymbolEntry* m_symbols = nullptr;
+		const char* m_strings = nullptr;
+	};
+}
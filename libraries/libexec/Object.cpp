@@ -2,6 +2,8 @@
 /* Copyright © 2016-2024 Byteduck */
 
 #include "Object.h"
+#include <algorithm>
+#include <cstdlib>
 #include <cstring>
 #include <libduck/Log.h>
 #include <map>
@@ -11,6 +13,12 @@
 using Duck::Log;
 using namespace Exec;
 
+extern "C" void __exec_plt_trampoline();
+
+extern "C" __attribute__((visibility("hidden"))) uintptr_t __exec_bind_plt(Object* object, size_t reloc_offset) {
+	return object->bind_plt_relocation(*Loader::main(), reloc_offset);
+}
+
 // TODO: We just gotta redo most of this. It's pretty gross.
 
 Object::~Object() {
@@ -168,6 +176,22 @@ void Object::read_dynamic_table(std::function<size_t(size_t)> lookup) {
 				dsym_table_size = hash[1];
 				break;
 
+			case DT_GNU_HASH:
+				gnu_hash_table = (uint32_t*) lookup(dynamic.d_val);
+				break;
+
+			case DT_PLTGOT:
+				plt_got = (uintptr_t*) lookup(dynamic.d_val);
+				break;
+
+			case DT_JMPREL:
+				plt_relocs = (elf32_rel*) lookup(dynamic.d_val);
+				break;
+
+			case DT_PLTRELSZ:
+				plt_relocs_size = dynamic.d_val / sizeof(elf32_rel);
+				break;
+
 			case DT_STRTAB:
 				dstring_table = (char*) lookup(dynamic.d_val);
 				break;
@@ -196,6 +220,24 @@ void Object::read_dynamic_table(std::function<size_t(size_t)> lookup) {
 		}
 	}
 
+	//Without DT_HASH, the symbol count has to be found by walking to the end of the longest GNU hash chain
+	if(!hash && gnu_hash_table) {
+		uint32_t num_buckets = gnu_hash_table[0];
+		uint32_t sym_offset = gnu_hash_table[1];
+		uint32_t* buckets = gnu_hash_table + 4 + gnu_hash_table[2];
+		uint32_t* chains = buckets + num_buckets;
+		uint32_t last_sym = 0;
+		for(uint32_t i = 0; i < num_buckets; i++)
+			last_sym = std::max(last_sym, buckets[i]);
+		if(last_sym >= sym_offset) {
+			while(!(chains[last_sym - sym_offset] & 1))
+				last_sym++;
+			dsym_table_size = last_sym + 1;
+		} else {
+			dsym_table_size = sym_offset;
+		}
+	}
+
 	//Now that the string table is loaded, we can iterate again and find the required libraries
 	required_libraries.resize(0);
 	for(auto& dynamic : dynamic_table) {
@@ -298,107 +340,205 @@ int Object::read_copy_relocations(Loader& loader) {
 	return 0;
 }
 
-int Object::read_symbols(Loader& loader) {
-	//Put all the symbols into the symbols map if they aren't there already
-	for(size_t i = 0; i < dsym_table_size; i++) {
-		auto* symbol = &dsym_table[i];
-		char* symbol_name = (char*)((uintptr_t) dstring_table + symbol->st_name);
-		if(symbol->st_shndx && !loader.get_symbol(symbol_name)) {
-			loader.set_symbol(symbol_name, symbol->st_value + memloc);
-		}
-	}
-	return 0;
-}
-
 int Object::relocate(Loader& loader) {
+	bool lazy = loader.lazy_binding() && plt_got && plt_relocs;
+
 	//Relocate the symbols
 	for(auto& shdr : sheaders) {
 		if(shdr.sh_type != SHT_REL)
 			continue;
 		auto* rel_table = (elf32_rel*) (shdr.sh_addr + memloc);
-		for(size_t i = 0; i < shdr.sh_size / sizeof(elf32_rel); i++) {
-			auto& rel = rel_table[i];
-			uint8_t rel_type = ELF32_R_TYPE(rel.r_info);
-			uint32_t rel_symbol = ELF32_R_SYM(rel.r_info);
-
-			if(rel_type == R_386_NONE)
-				continue;
-
-			auto& symbol = dsym_table[rel_symbol];
-			uintptr_t symbol_loc = memloc + symbol.st_value;
-			char* symbol_name = (char *)((uintptr_t) dstring_table + symbol.st_name);
-
-			//If this kind of relocation is a symbol, look it up
-			if(rel_type == R_386_32 || rel_type == R_386_PC32 || rel_type == R_386_COPY || rel_type == R_386_GLOB_DAT || rel_type == R_386_JMP_SLOT) {
-				if(symbol_name) {
-					auto sym = loader.get_symbol(symbol_name);
-					if(!sym) {
-						if(loader.debug_mode())
-							Log::warn("Symbol ", symbol_name, " not found for ", name);
-						symbol_loc = 0x0;
-					} else {
-						symbol_loc = sym;
-					}
-				}
-			}
 
-			//If this is a global symbol or weak, try finding it in the global symbol table
-			if(rel_type == R_386_GLOB_DAT || (ELF32_ST_BIND(symbol.st_info) == STB_WEAK && !symbol_loc)) {
-				if(symbol_name) {
-					auto sym = loader.get_global_symbol(symbol_name);
-					if(sym) {
-						symbol_loc = sym;
-					}
-				}
-			}
+		//If we're binding lazily, PLT relocations are handled below
+		if(lazy && rel_table == plt_relocs)
+			continue;
 
-			//Perform the actual relocation
-			auto* reloc_loc = (void*) (memloc + rel.r_offset);
-			switch(rel_type) {
-				case R_386_32:
-					symbol_loc += *((ssize_t*) reloc_loc);
-					*((uintptr_t*)reloc_loc) = (uintptr_t) symbol_loc;
-					break;
+		for(size_t i = 0; i < shdr.sh_size / sizeof(elf32_rel); i++)
+			apply_relocation(loader, rel_table[i]);
+	}
 
-				case R_386_PC32:
-					symbol_loc += *((ssize_t*) reloc_loc);
-					symbol_loc -= memloc + rel.r_offset;
-					*((uintptr_t*)reloc_loc) = (uintptr_t) symbol_loc;
-					break;
+	if(!lazy)
+		return 0;
 
-				case R_386_COPY:
-					memcpy(reloc_loc, (const void*) symbol_loc, symbol.st_size);
-					break;
+	//GOT[1] and GOT[2] are pushed / jumped to by PLT0, so point them at us and the resolver trampoline
+	plt_got[1] = (uintptr_t) this;
+	plt_got[2] = (uintptr_t) __exec_plt_trampoline;
+
+	//Each PLT slot initially points back at the push instruction of its own PLT entry, which just needs rebasing
+	for(size_t i = 0; i < plt_relocs_size; i++) {
+		auto& rel = plt_relocs[i];
+		if(ELF32_R_TYPE(rel.r_info) == R_386_JMP_SLOT)
+			*((uintptr_t*) (memloc + rel.r_offset)) += memloc;
+		else
+			apply_relocation(loader, rel);
+	}
 
-				case R_386_GLOB_DAT:
-				case R_386_JMP_SLOT:
-					*((uintptr_t*) reloc_loc) = (uintptr_t) symbol_loc;
-					break;
+	return 0;
+}
 
-				case R_386_RELATIVE:
-					symbol_loc = memloc + *((ssize_t*) reloc_loc);
-					*((uintptr_t*) reloc_loc) = (uintptr_t) symbol_loc;
-					break;
+void Object::apply_relocation(Loader& loader, const elf32_rel& rel) {
+	uint8_t rel_type = ELF32_R_TYPE(rel.r_info);
+	uint32_t rel_symbol = ELF32_R_SYM(rel.r_info);
+
+	if(rel_type == R_386_NONE)
+		return;
+
+	auto& symbol = dsym_table[rel_symbol];
+	uintptr_t symbol_loc = memloc + symbol.st_value;
+	char* symbol_name = (char *)((uintptr_t) dstring_table + symbol.st_name);
+
+	//If this kind of relocation is a symbol, look it up
+	if(rel_type == R_386_32 || rel_type == R_386_PC32 || rel_type == R_386_COPY || rel_type == R_386_GLOB_DAT || rel_type == R_386_JMP_SLOT) {
+		if(symbol_name) {
+			auto sym = loader.get_symbol(symbol_name);
+			if(!sym) {
+				if(loader.debug_mode())
+					Log::warn("Symbol ", symbol_name, " not found for ", name);
+				symbol_loc = 0x0;
+			} else {
+				symbol_loc = sym;
+			}
+		}
+	}
 
-				default:
-					if(loader.debug_mode())
-						Log::warn("Unknown relocation type ", (int) rel_type, " for ",  (int) rel_symbol);
-					break;
+	//If this is a global symbol or weak, try finding it in the global symbol table
+	if(rel_type == R_386_GLOB_DAT || (ELF32_ST_BIND(symbol.st_info) == STB_WEAK && !symbol_loc)) {
+		if(symbol_name) {
+			auto sym = loader.get_global_symbol(symbol_name);
+			if(sym) {
+				symbol_loc = sym;
 			}
 		}
 	}
 
-	return 0;
+	//Perform the actual relocation
+	auto* reloc_loc = (void*) (memloc + rel.r_offset);
+	switch(rel_type) {
+		case R_386_32:
+			symbol_loc += *((ssize_t*) reloc_loc);
+			*((uintptr_t*)reloc_loc) = (uintptr_t) symbol_loc;
+			break;
+
+		case R_386_PC32:
+			symbol_loc += *((ssize_t*) reloc_loc);
+			symbol_loc -= memloc + rel.r_offset;
+			*((uintptr_t*)reloc_loc) = (uintptr_t) symbol_loc;
+			break;
+
+		case R_386_COPY:
+			memcpy(reloc_loc, (const void*) symbol_loc, symbol.st_size);
+			break;
+
+		case R_386_GLOB_DAT:
+		case R_386_JMP_SLOT:
+			*((uintptr_t*) reloc_loc) = (uintptr_t) symbol_loc;
+			break;
+
+		case R_386_RELATIVE:
+			symbol_loc = memloc + *((ssize_t*) reloc_loc);
+			*((uintptr_t*) reloc_loc) = (uintptr_t) symbol_loc;
+			break;
+
+		default:
+			if(loader.debug_mode())
+				Log::warn("Unknown relocation type ", (int) rel_type, " for ",  (int) rel_symbol);
+			break;
+	}
+}
+
+uintptr_t Object::bind_plt_relocation(Loader& loader, size_t reloc_offset) {
+	auto& rel = *((elf32_rel*) ((uintptr_t) plt_relocs + reloc_offset));
+	auto& symbol = dsym_table[ELF32_R_SYM(rel.r_info)];
+	char* symbol_name = (char *)((uintptr_t) dstring_table + symbol.st_name);
+
+	//This can be called from any thread, so don't touch the loader's symbol cache
+	auto symbol_loc = loader.find_symbol(symbol_name);
+	if(!symbol_loc && ELF32_ST_BIND(symbol.st_info) == STB_WEAK)
+		symbol_loc = loader.get_global_symbol(symbol_name);
+	if(!symbol_loc) {
+		Log::errf("ld: Could not resolve symbol {} for {}", symbol_name, name);
+		exit(-1);
+	}
+
+	*((uintptr_t*) (memloc + rel.r_offset)) = symbol_loc;
+	return symbol_loc;
 }
 
-uintptr_t Object::get_dynamic_symbol(const char* name) {
+uint32_t Object::sysv_hash(const char* name) {
+	uint32_t hash = 0;
+	while(*name) {
+		hash = (hash << 4) + (uint8_t) *(name++);
+		uint32_t high = hash & 0xf0000000;
+		if(high)
+			hash ^= high >> 24;
+		hash &= ~high;
+	}
+	return hash;
+}
+
+uint32_t Object::gnu_hash(const char* name) {
+	uint32_t hash = 5381;
+	while(*name)
+		hash = (hash << 5) + hash + (uint8_t) *(name++);
+	return hash;
+}
+
+const elf32_sym* Object::find_dynamic_symbol(const char* name, uint32_t sysv_hash, uint32_t gnu_hash) const {
+	auto matches = [&] (const elf32_sym& symbol) {
+		return symbol.st_shndx != SHN_UNDEF && !strcmp(dstring_table + symbol.st_name, name);
+	};
+
+	if(gnu_hash_table) {
+		uint32_t num_buckets = gnu_hash_table[0];
+		uint32_t sym_offset = gnu_hash_table[1];
+		uint32_t bloom_size = gnu_hash_table[2];
+		uint32_t bloom_shift = gnu_hash_table[3];
+		auto* bloom = gnu_hash_table + 4;
+		auto* buckets = bloom + bloom_size;
+		auto* chains = buckets + num_buckets;
+
+		//Check the bloom filter first, which rules out most objects that don't have the symbol
+		uint32_t bloom_word = bloom[(gnu_hash / 32) % bloom_size];
+		uint32_t bloom_mask = (1u << (gnu_hash % 32)) | (1u << ((gnu_hash >> bloom_shift) % 32));
+		if((bloom_word & bloom_mask) != bloom_mask)
+			return nullptr;
+
+		uint32_t index = buckets[gnu_hash % num_buckets];
+		if(index < sym_offset)
+			return nullptr;
+		while(true) {
+			uint32_t chain_hash = chains[index - sym_offset];
+			if((chain_hash | 1) == (gnu_hash | 1) && matches(dsym_table[index]))
+				return &dsym_table[index];
+			if(chain_hash & 1)
+				return nullptr;
+			index++;
+		}
+	}
+
+	if(hash) {
+		uint32_t num_buckets = hash[0];
+		auto* buckets = hash + 2;
+		auto* chains = buckets + num_buckets;
+		for(uint32_t index = buckets[sysv_hash % num_buckets]; index; index = chains[index]) {
+			if(matches(dsym_table[index]))
+				return &dsym_table[index];
+		}
+		return nullptr;
+	}
+
 	for(size_t i = 0; i < dsym_table_size; i++) {
-		auto* symbol = &dsym_table[i];
-		char* symbol_name = (char*)((uintptr_t) dstring_table + symbol->st_name);
-		if (!strcmp(symbol_name, name))
-			return symbol->st_value + memloc;
+		if(matches(dsym_table[i]))
+			return &dsym_table[i];
 	}
-	return 0;
+	return nullptr;
+}
+
+uintptr_t Object::get_dynamic_symbol(const char* name) const {
+	auto* symbol = find_dynamic_symbol(name, sysv_hash(name), gnu_hash(name));
+	if(!symbol)
+		return 0;
+	return symbol->st_value + memloc;
 }
 
 Object::SymbolInfo Object::symbolicate(uintptr_t offset) {
@@ -9,6 +9,7 @@
 #include <string>
 #include <libduck/Result.h>
 #include <functional>
+#include <sys/types.h>
 #include "elf.h"
 
 namespace Exec {
@@ -29,10 +30,14 @@ namespace Exec {
 		int load_sections();
 		void mprotect_sections();
 		int read_copy_relocations(Loader& loader);
-		int read_symbols(Loader& loader);
 		int relocate(Loader& loader);
+		void apply_relocation(Loader& loader, const elf32_rel& rel);
+		uintptr_t bind_plt_relocation(Loader& loader, size_t reloc_offset);
 
-		uintptr_t get_dynamic_symbol(const char* name);
+		static uint32_t sysv_hash(const char* name);
+		static uint32_t gnu_hash(const char* name);
+		const elf32_sym* find_dynamic_symbol(const char* name, uint32_t sysv_hash, uint32_t gnu_hash) const;
+		uintptr_t get_dynamic_symbol(const char* name) const;
 
 		struct SymbolInfo {
 			const char* name;
@@ -41,6 +46,9 @@ namespace Exec {
 		SymbolInfo symbolicate(uintptr_t offset);
 
 		std::string name;
+		std::string path;
+		ino_t inode = 0;
+		time_t mtime = 0;
 		int fd = 0;
 		elf32_ehdr* header = nullptr;
 		size_t memsz = 0;
@@ -53,6 +61,11 @@ namespace Exec {
 		elf32_sym* dsym_table = nullptr;
 		size_t dsym_table_size = 0;
 		uint32_t* hash = nullptr;
+		uint32_t* gnu_hash_table = nullptr;
+
+		uintptr_t* plt_got = nullptr;
+		elf32_rel* plt_relocs = nullptr;
+		size_t plt_relocs_size = 0;
 
 		char* string_table = nullptr;
 		size_t string_table_size = 0;
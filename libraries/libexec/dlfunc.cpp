@@ -31,7 +31,7 @@ ResultRet<uintptr_t> __dlsym(Exec::Object* obj, const char* name) {
 		auto loader = Loader::main();
 		if (!loader)
 			return Result(EINVAL);
-		auto sym = loader->get_symbol(name);
+		auto sym = loader->get_symbol(name, true);
 		if (!sym)
 			sym = loader->get_global_symbol(name);
 		return sym;
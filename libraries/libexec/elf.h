@@ -72,6 +72,7 @@
 #define DT_VALRNGLO		0x6ffffd00
 #define DT_VALRNGHI		0x6ffffdff
 #define DT_ADDRRNGLO	0x6ffffe00
+#define DT_GNU_HASH		0x6ffffef5
 #define DT_ADDRRNGHI	0x6ffffeff
 #define DT_VERSYM		0x6ffffff0
 #define DT_RELACOUNT	0x6ffffff9
@@ -85,6 +86,8 @@
 #define DT_LOPROC		0x70000000
 #define DT_HIPROC		0x7fffffff
 
+#define SHN_UNDEF		0
+
 #define SHT_NULL		0
 #define SHT_PROGBITS	1
 #define SHT_SYMTAB		2
@@ -0,0 +1,228 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2024 Byteduck */
+
+#include "Blit.h"
+#include <libduck/CPU.h>
+#include <cstring>
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <emmintrin.h>
+#define GFX_SSE2
+#endif
+
+using namespace Gfx;
+
+// Bilinear weights are kept to seven bits so that the weighted differences fit in 16 bits
+#define BILINEAR_SHIFT 7
+#define BILINEAR_WEIGHT(fixed) (((fixed) >> (16 - BILINEAR_SHIFT)) & ((1 << BILINEAR_SHIFT) - 1))
+
+static bool use_sse2() {
+	static bool sse2 = Duck::CPU::has_sse2();
+	return sse2;
+}
+
+static inline Color blend_fill_pixel(Color dest, unsigned int premultiplied[4], unsigned int inv_alpha) {
+	return RGBA(
+			(uint8_t) ((premultiplied[0] + inv_alpha * dest.r) >> 8),
+			(uint8_t) ((premultiplied[1] + inv_alpha * dest.g) >> 8),
+			(uint8_t) ((premultiplied[2] + inv_alpha * dest.b) >> 8),
+			(uint8_t) ((premultiplied[3] + inv_alpha * dest.a) >> 8));
+}
+
+static inline Color bilinear_pixel(Color a0, Color a1, Color b0, Color b1, int fx, int fy) {
+	auto lerp = [](int from, int to, int weight) {
+		return from + (((to - from) * weight) >> BILINEAR_SHIFT);
+	};
+	uint32_t ret = 0;
+	for(int shift = 0; shift < 32; shift += 8) {
+		int left = lerp((a0.value >> shift) & 0xFF, (b0.value >> shift) & 0xFF, fy);
+		int right = lerp((a1.value >> shift) & 0xFF, (b1.value >> shift) & 0xFF, fy);
+		ret |= (uint32_t) lerp(left, right, fx) << shift;
+	}
+	return ret;
+}
+
+#ifdef GFX_SSE2
+
+__attribute__((target("sse2")))
+static inline __m128i blend_pixels_sse2(__m128i dest, __m128i src) {
+	// Works on two pixels at once with 16-bit channels. dest * (256 - alpha) + src * (alpha + 1) never exceeds 65535.
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i one = _mm_set1_epi16(1);
+	const __m128i two_fifty_six = _mm_set1_epi16(256);
+
+	__m128i src_lo = _mm_unpacklo_epi8(src, zero);
+	__m128i src_hi = _mm_unpackhi_epi8(src, zero);
+	__m128i dest_lo = _mm_unpacklo_epi8(dest, zero);
+	__m128i dest_hi = _mm_unpackhi_epi8(dest, zero);
+
+	__m128i alpha_lo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(src_lo, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+	__m128i alpha_hi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(src_hi, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+
+	__m128i res_lo = _mm_add_epi16(
+			_mm_mullo_epi16(src_lo, _mm_add_epi16(alpha_lo, one)),
+			_mm_mullo_epi16(dest_lo, _mm_sub_epi16(two_fifty_six, alpha_lo)));
+	__m128i res_hi = _mm_add_epi16(
+			_mm_mullo_epi16(src_hi, _mm_add_epi16(alpha_hi, one)),
+			_mm_mullo_epi16(dest_hi, _mm_sub_epi16(two_fifty_six, alpha_hi)));
+
+	return _mm_packus_epi16(_mm_srli_epi16(res_lo, 8), _mm_srli_epi16(res_hi, 8));
+}
+
+__attribute__((target("sse2")))
+static void fill_row_sse2(Color* dest, Color color, size_t count) {
+	__m128i value = _mm_set1_epi32((int) color.value);
+	size_t i = 0;
+	for(; i + 4 <= count; i += 4)
+		_mm_storeu_si128((__m128i*) (dest + i), value);
+	for(; i < count; i++)
+		dest[i] = color;
+}
+
+__attribute__((target("sse2")))
+static void blend_row_sse2(Color* dest, const Color* src, size_t count) {
+	const __m128i alpha_mask = _mm_set1_epi32((int) 0xFF000000);
+	size_t i = 0;
+	for(; i + 4 <= count; i += 4) {
+		__m128i src_px = _mm_loadu_si128((const __m128i*) (src + i));
+		__m128i alpha = _mm_and_si128(src_px, alpha_mask);
+
+		// Skip the math for runs of fully transparent or fully opaque pixels, which are the most common
+		int transparent = _mm_movemask_epi8(_mm_cmpeq_epi32(alpha, _mm_setzero_si128()));
+		if(transparent == 0xFFFF)
+			continue;
+		int opaque = _mm_movemask_epi8(_mm_cmpeq_epi32(alpha, alpha_mask));
+		if(opaque == 0xFFFF) {
+			_mm_storeu_si128((__m128i*) (dest + i), src_px);
+			continue;
+		}
+
+		__m128i dest_px = _mm_loadu_si128((const __m128i*) (dest + i));
+		_mm_storeu_si128((__m128i*) (dest + i), blend_pixels_sse2(dest_px, src_px));
+	}
+	for(; i < count; i++)
+		dest[i] = dest[i].blended(src[i]);
+}
+
+__attribute__((target("sse2")))
+static void blend_fill_row_sse2(Color* dest, Color color, size_t count) {
+	__m128i src_px = _mm_set1_epi32((int) color.value);
+	size_t i = 0;
+	for(; i + 4 <= count; i += 4) {
+		__m128i dest_px = _mm_loadu_si128((const __m128i*) (dest + i));
+		_mm_storeu_si128((__m128i*) (dest + i), blend_pixels_sse2(dest_px, src_px));
+	}
+
+	unsigned int alpha = color.a + 1;
+	unsigned int inv_alpha = 256 - color.a;
+	unsigned int premultiplied[4] = {alpha * color.r, alpha * color.g, alpha * color.b, alpha * color.a};
+	for(; i < count; i++)
+		dest[i] = blend_fill_pixel(dest[i], premultiplied, inv_alpha);
+}
+
+__attribute__((target("sse2")))
+static void gradient_row_sse2(Color* dest, Color from, Color to, int start, int length, size_t count) {
+	// One pixel per iteration, with the four channels in one register
+	const __m128i zero = _mm_setzero_si128();
+	__m128 from_px = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128((int) from.value), zero), zero));
+	__m128 to_px = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128((int) to.value), zero), zero));
+	for(size_t i = 0; i < count; i++) {
+		float percent = (float) (start + (int) i) / length;
+		__m128 mixed = _mm_add_ps(_mm_mul_ps(from_px, _mm_set1_ps(1.0f - percent)), _mm_mul_ps(to_px, _mm_set1_ps(percent)));
+		__m128i channels = _mm_cvttps_epi32(mixed);
+		channels = _mm_packs_epi32(channels, channels);
+		dest[i].value = (uint32_t) _mm_cvtsi128_si32(_mm_packus_epi16(channels, channels));
+	}
+}
+
+__attribute__((target("sse2")))
+static void scale_row_bilinear_sse2(Color* dest, const Color* row_a, const Color* row_b, size_t src_width, size_t count, uint32_t x, uint32_t step, uint32_t y_frac) {
+	// Each register holds the left and right samples of a pixel in 16-bit channels
+	const __m128i zero = _mm_setzero_si128();
+	__m128i fy = _mm_set1_epi16((short) BILINEAR_WEIGHT(y_frac));
+	for(size_t i = 0; i < count; i++, x += step) {
+		size_t x0 = x >> 16;
+		size_t x1 = x0 + 1 < src_width ? x0 + 1 : x0;
+		__m128i top = _mm_unpacklo_epi8(_mm_unpacklo_epi32(_mm_cvtsi32_si128((int) row_a[x0].value), _mm_cvtsi32_si128((int) row_a[x1].value)), zero);
+		__m128i bottom = _mm_unpacklo_epi8(_mm_unpacklo_epi32(_mm_cvtsi32_si128((int) row_b[x0].value), _mm_cvtsi32_si128((int) row_b[x1].value)), zero);
+		__m128i vertical = _mm_add_epi16(top, _mm_srai_epi16(_mm_mullo_epi16(_mm_sub_epi16(bottom, top), fy), BILINEAR_SHIFT));
+		__m128i left = vertical;
+		__m128i right = _mm_unpackhi_epi64(vertical, vertical);
+		__m128i fx = _mm_set1_epi16((short) BILINEAR_WEIGHT(x));
+		__m128i horizontal = _mm_add_epi16(left, _mm_srai_epi16(_mm_mullo_epi16(_mm_sub_epi16(right, left), fx), BILINEAR_SHIFT));
+		dest[i].value = (uint32_t) _mm_cvtsi128_si32(_mm_packus_epi16(horizontal, horizontal));
+	}
+}
+
+#endif
+
+void Blit::copy_row(Color* dest, const Color* src, size_t count) {
+	// libc's memcpy already uses SSE2 where it helps
+	memcpy(dest, src, count * sizeof(Color));
+}
+
+void Blit::fill_row(Color* dest, Color color, size_t count) {
+#ifdef GFX_SSE2
+	if(use_sse2())
+		return fill_row_sse2(dest, color, count);
+#endif
+	for(size_t i = 0; i < count; i++)
+		dest[i] = color;
+}
+
+void Blit::blend_row(Color* dest, const Color* src, size_t count) {
+#ifdef GFX_SSE2
+	if(use_sse2())
+		return blend_row_sse2(dest, src, count);
+#endif
+	for(size_t i = 0; i < count; i++)
+		dest[i] = dest[i].blended(src[i]);
+}
+
+void Blit::blend_fill_row(Color* dest, Color color, size_t count) {
+#ifdef GFX_SSE2
+	if(use_sse2())
+		return blend_fill_row_sse2(dest, color, count);
+#endif
+	unsigned int alpha = color.a + 1;
+	unsigned int inv_alpha = 256 - color.a;
+	unsigned int premultiplied[4] = {alpha * color.r, alpha * color.g, alpha * color.b, alpha * color.a};
+	for(size_t i = 0; i < count; i++)
+		dest[i] = blend_fill_pixel(dest[i], premultiplied, inv_alpha);
+}
+
+void Blit::gradient_row(Color* dest, Color from, Color to, int start, int length, size_t count) {
+#ifdef GFX_SSE2
+	if(use_sse2())
+		return gradient_row_sse2(dest, from, to, start, length, count);
+#endif
+	for(size_t i = 0; i < count; i++)
+		dest[i] = from.mixed(to, (float) (start + (int) i) / length);
+}
+
+void Blit::scale_row_nearest(Color* dest, const Color* src, size_t count, uint32_t x, uint32_t step) {
+	// This is bound by the gather, so SSE2 doesn't help; unroll instead
+	size_t i = 0;
+	for(; i + 4 <= count; i += 4) {
+		dest[i] = src[x >> 16];
+		dest[i + 1] = src[(x + step) >> 16];
+		dest[i + 2] = src[(x + step * 2) >> 16];
+		dest[i + 3] = src[(x + step * 3) >> 16];
+		x += step * 4;
+	}
+	for(; i < count; i++, x += step)
+		dest[i] = src[x >> 16];
+}
+
+void Blit::scale_row_bilinear(Color* dest, const Color* row_a, const Color* row_b, size_t src_width, size_t count, uint32_t x, uint32_t step, uint32_t y_frac) {
+#ifdef GFX_SSE2
+	if(use_sse2())
+		return scale_row_bilinear_sse2(dest, row_a, row_b, src_width, count, x, step, y_frac);
+#endif
+	int fy = BILINEAR_WEIGHT(y_frac);
+	for(size_t i = 0; i < count; i++, x += step) {
+		size_t x0 = x >> 16;
+		size_t x1 = x0 + 1 < src_width ? x0 + 1 : x0;
+		dest[i] = bilinear_pixel(row_a[x0], row_a[x1], row_b[x0], row_b[x1], BILINEAR_WEIGHT(x), fy);
+	}
+}
@@ -0,0 +1,61 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2024 Byteduck */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "Color.h"
+
+/*
+ * Row kernels used by Framebuffer for its drawing operations. Each one has an SSE2 version that is used when the CPU
+ * supports it, and a scalar version that gives the same results otherwise.
+ */
+
+namespace Gfx::Blit {
+	/**
+	 * Copies pixels from one row to another.
+	 */
+	void copy_row(Color* dest, const Color* src, size_t count);
+
+	/**
+	 * Sets every pixel in a row to a color.
+	 */
+	void fill_row(Color* dest, Color color, size_t count);
+
+	/**
+	 * Blends pixels on top of a row, like Color::blended().
+	 */
+	void blend_row(Color* dest, const Color* src, size_t count);
+
+	/**
+	 * Blends a single color on top of every pixel in a row.
+	 */
+	void blend_fill_row(Color* dest, Color color, size_t count);
+
+	/**
+	 * Fills a row with a horizontal gradient, like Color::mixed().
+	 * @param start The position in the gradient of the first pixel.
+	 * @param length The total length of the gradient.
+	 */
+	void gradient_row(Color* dest, Color from, Color to, int start, int length, size_t count);
+
+	/**
+	 * Scales a row using nearest-neighbor sampling.
+	 * @param x The position in src of the first pixel, in 16.16 fixed point.
+	 * @param step The distance in src between each pixel of dest, in 16.16 fixed point.
+	 */
+	void scale_row_nearest(Color* dest, const Color* src, size_t count, uint32_t x, uint32_t step);
+
+	/**
+	 * Scales a row using bilinear filtering between two rows.
+	 * @param row_a The upper row to sample from.
+	 * @param row_b The lower row to sample from.
+	 * @param src_width The number of pixels in each source row.
+	 * @param x The position in the source rows of the first pixel, in 16.16 fixed point.
+	 * @param step The distance in the source rows between each pixel of dest, in 16.16 fixed point.
+	 * @param y_frac How far between row_a and row_b to sample, in 16.16 fixed point.
+	 */
+	void scale_row_bilinear(Color* dest, const Color* row_a, const Color* row_b, size_t src_width, size_t count, uint32_t x, uint32_t step, uint32_t y_frac);
+}
+
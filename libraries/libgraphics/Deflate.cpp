@@ -19,224 +19,640 @@
 
 #include "Deflate.h"
 #include <stdlib.h>
-
-unsigned int read_bits(DEFLATE* def, size_t num_bits) {
-	unsigned int ret = 0;
-	for(size_t i = 0; i < num_bits; i++) {
-		if(def->bit_pos == 8) { //We've read all 8 bits from the current byte, read a new one
-			def->bit_buf = def->read(def->arg);
-			def->bit_pos = 0;
-		}
-		ret |= (def->bit_buf & 0x1u) << i;
-		def->bit_buf >>= 1;
-		def->bit_pos++;
-	}
-	return ret;
-}
-
-void create_huffman(const uint8_t lengths[], uint32_t size, huffman* huff) {
-	//Zero out code length counts
-	for(size_t i = 0; i < 16; i++)
-		huff->counts[i] = 0;
-
+#include <string.h>
+
+#define INFLATE_RING_MASK (INFLATE_RING_SIZE - 1)
+#define INFLATE_MAX_MATCH 258
+
+#define STATE_ZLIB_HEADER 0
+#define STATE_BLOCK_HEADER 1
+#define STATE_STORED_HEADER 2
+#define STATE_STORED_COPY 3
+#define STATE_DYNAMIC_HEADER 4
+#define STATE_CODELENS 5
+#define STATE_LENGTHS 6
+#define STATE_CODES 7
+#define STATE_ZLIB_TRAILER 8
+#define STATE_DONE 9
+#define STATE_ERROR 10
+
+//Results of inflate_run()
+#define RUN_NEEDS_INPUT 0
+#define RUN_RING_FULL 1
+#define RUN_DONE 2
+#define RUN_ERROR 3
+
+//The lengths corresponding to symbols > 256
+static const uint16_t lengths_base[] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+//The number of extra bits to read and add to the lengths corresponding to symbols > 256
+static const uint8_t lengths_extrabits[] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+//The distances for decoded symbols after the symbols > 256
+static const uint16_t distances_base[] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+//The number of extra bits to read and add to the distances above
+static const uint8_t distances_extrabits[] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+//The code lengths for the dynamic huffman alphabet
+static const uint8_t codelen_alphabet[] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+static huffman fixed_len_huff;
+static huffman fixed_dist_huff;
+static int made_fixed = 0;
+
+/**
+ * Builds the lookup tables for a huffman code.
+ * @return 0 on success, or -1 if the code lengths are over-subscribed.
+ */
+static int create_huffman(const uint8_t lengths[], uint32_t size, huffman* huff) {
 	//Count the number of symbols with each code length
-	for(size_t i = 0; i < size; i++)
+	memset(huff->counts, 0, sizeof(huff->counts));
+	for(uint32_t i = 0; i < size; i++)
 		huff->counts[lengths[i]]++;
-
 	huff->counts[0] = 0;
 
-	//Figure out the starting indexes into the final symbol array for each code length
-	uint32_t count = 0;
+	//Make sure there aren't more codes of each length than there's room for. Incomplete codes are allowed.
+	int left = 1;
+	for(int i = 1; i < 16; i++) {
+		left <<= 1;
+		left -= huff->counts[i];
+		if(left < 0)
+			return -1;
+	}
+
+	//Figure out the starting indexes into the final symbol array and the first code of each length
 	uint16_t indexes[16];
-	for(uint16_t i = 0; i < 16; i++) {
+	uint16_t next_code[16];
+	uint32_t count = 0;
+	uint32_t code = 0;
+	for(int i = 0; i < 16; i++) {
 		indexes[i] = count;
 		count += huff->counts[i];
+		if(i > 0) {
+			code = (code + huff->counts[i - 1]) << 1;
+			next_code[i] = code;
+		}
 	}
 
-	//Create the final symbol array which we can index into using codes
-	for (uint16_t i = 0; i < size; i++) {
-		if (lengths[i])
-			huff->symbols[indexes[lengths[i]]++] = i;
+	//Create the final symbol array, and fill the fast lookup table with every code short enough to fit in it.
+	//Codes are stored most significant bit first, so they are reversed to be indexed by the bit buffer.
+	memset(huff->fast, 0, sizeof(huff->fast));
+	for(uint32_t i = 0; i < size; i++) {
+		uint8_t len = lengths[i];
+		if(!len)
+			continue;
+		huff->symbols[indexes[len]++] = i;
+		uint32_t cur_code = next_code[len]++;
+		if(len > INFLATE_FAST_BITS)
+			continue;
+		uint32_t reversed = 0;
+		for(uint8_t bit = 0; bit < len; bit++)
+			reversed |= ((cur_code >> bit) & 1u) << (len - 1 - bit);
+		for(uint32_t entry = reversed; entry < (1u << INFLATE_FAST_BITS); entry += (1u << len))
+			huff->fast[entry] = (len << 9) | i;
 	}
+
+	return 0;
 }
 
-uint16_t huffman_decode(DEFLATE* def, huffman* huff) {
-	int count = 0;
-	int cur = 0;
-	for(int i = 1; cur >= 0; i++) {
-		cur = read_bits(def, 1) | (cur << 1);
-		count += huff->counts[i];
-		cur -= huff->counts[i];
+static void create_fixed_huffman() {
+	uint8_t len_lengths[288];
+	for(uint16_t i = 0; i < 288; i++) {
+		if(i < 144 || i >= 280)
+			len_lengths[i] = 8;
+		else if(i < 256)
+			len_lengths[i] = 9;
+		else
+			len_lengths[i] = 7;
 	}
-	return huff->symbols[count + cur];
+	create_huffman(len_lengths, 288, &fixed_len_huff);
+
+	uint8_t dist_lengths[30];
+	for(uint8_t i = 0; i < 30; i++)
+		dist_lengths[i] = 5;
+	create_huffman(dist_lengths, 30, &fixed_dist_huff);
+	made_fixed = 1;
 }
 
-void def_write(DEFLATE* def, uint8_t byte) {
-	if(def->frame_pointer == 0x8000)
-		def->frame_pointer = 0;
-	def->reading_frame[def->frame_pointer++] = byte;
-	def->write(byte, def->arg);
+/**
+ * Tops up the bit buffer to at least 56 bits, if there's enough input left.
+ * When eight bytes are available they are loaded at once; the bits above bit_count are then real upcoming input,
+ * so loading the same bytes again later doesn't change anything.
+ */
+static inline void refill(INFLATE* inf) {
+	// The fast path relies on bit_count being below 64, so don't touch a buffer that's already full enough
+	if(inf->bit_count >= 56)
+		return;
+	if(inf->in_end - inf->in >= 8) {
+		uint64_t word;
+		memcpy(&word, inf->in, 8);
+		inf->bit_buf |= word << inf->bit_count;
+		inf->in += (63 - inf->bit_count) >> 3;
+		inf->bit_count |= 56;
+	} else {
+		while(inf->bit_count < 56 && inf->in < inf->in_end) {
+			inf->bit_buf |= (uint64_t) *inf->in++ << inf->bit_count;
+			inf->bit_count += 8;
+		}
+	}
 }
 
-void inflate(DEFLATE* def, huffman* len_huff, huffman* dist_huff) {
-	//The lengths corresponding to symbols > 256
-	static const uint16_t lengths[] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
-	//The number of extra bits to read and add to the lengths corresponding to symbols > 256
-	static const uint16_t lengths_extrabits[] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
-	//The distances for decoded symbols after the symbols > 256
-	static const uint16_t distances[] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
-	//The number of extra bits to read and add to the distances above
-	static const uint16_t distances_extrabits[] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+static inline uint32_t peek_bits(INFLATE* inf, uint32_t num_bits) {
+	return (uint32_t) (inf->bit_buf & ((1ull << num_bits) - 1));
+}
 
-	while(1) {
-		uint16_t sym = huffman_decode(def, len_huff);
-		if(sym < 256) {
-			def_write(def, sym);
-		} else {
-			if(sym == 256)
-				break;
-			uint16_t length = read_bits(def, lengths_extrabits[sym - 257]) + lengths[sym - 257];
-			uint16_t distance_index = huffman_decode(def, dist_huff);
-			uint16_t distance = distances[distance_index] + read_bits(def, distances_extrabits[distance_index]);
-			//If sym > 256, write length bytes to the output from distance bytes behind the current position
-			for(uint16_t i = 0; i < length; i++) {
-				uint8_t byte = def->reading_frame[(def->frame_pointer - distance) % 0x8000];
-				def_write(def, byte);
-			}
+static inline void consume_bits(INFLATE* inf, uint32_t num_bits) {
+	inf->bit_buf >>= num_bits;
+	inf->bit_count -= num_bits;
+}
+
+/**
+ * Decodes a symbol from the bit buffer.
+ * @return The symbol, -1 if there aren't enough bits buffered, or -2 if the code is invalid.
+ */
+static inline int huffman_decode(INFLATE* inf, const huffman* huff) {
+	uint16_t entry = huff->fast[inf->bit_buf & ((1u << INFLATE_FAST_BITS) - 1)];
+	if(entry) {
+		uint32_t len = entry >> 9;
+		if(len > inf->bit_count)
+			return -1;
+		consume_bits(inf, len);
+		return entry & 0x1FF;
+	}
+
+	//The code is longer than the lookup table (or invalid), so walk the canonical code one bit at a time
+	int code = 0;
+	int first = 0;
+	int index = 0;
+	for(uint32_t len = 1; len < 16; len++) {
+		if(len > inf->bit_count)
+			return -1;
+		code |= (int) ((inf->bit_buf >> (len - 1)) & 1u);
+		int count = huff->counts[len];
+		if(code - first < count) {
+			consume_bits(inf, len);
+			return huff->symbols[index + code - first];
 		}
+		index += count;
+		first = (first + count) << 1;
+		code <<= 1;
 	}
+	return -2;
 }
 
-void inflate_dynamic(DEFLATE* def) {
-	//The code lengths for the dynamic huffman alphabet
-	static const uint8_t codelen_alphabet[] = {
-			16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
-	};
-
-	uint16_t hlit = read_bits(def, 5) + 257; //# of Literal/Length codes
-	uint8_t hdist = read_bits(def, 5) + 1; //# of Distance codes
-	uint8_t hclen = read_bits(def, 4) + 4; //# of Code Length codes
-
-	//Get the code lengths for each entry in the code length alphabet
-	uint8_t alphabet_codelens[19] = {0};
-	for(uint32_t i = 0; i < hclen; i++)
-		alphabet_codelens[codelen_alphabet[i]] = read_bits(def, 3);
-
-	//Build the huffman code table for the literal/length alphabet
-	huffman codes_huff;
-	create_huffman(alphabet_codelens, 19, &codes_huff);
-
-	//Get the lengths for the literal/length alphabet
-	uint16_t i = 0;
-	uint8_t lengths[320];
-	while(i < hdist + hlit) {
-		uint16_t sym = huffman_decode(def, &codes_huff);
-		if(sym < 16) { //0-15: Represent code lengths of 0 - 15
-			lengths[i++] = sym;
-		} else {
-			uint8_t num_repeats = 0;
-			uint8_t to_repeat = 0;
-			switch(sym) {
-				case 16: //16: Copy the previous code length 3 - 6 times.
-					to_repeat = lengths[i - 1];
-					num_repeats = read_bits(def, 2) + 3;
-					break;
-				case 17: //17: Repeat a code length of 0 for 3 - 10 times.
-					num_repeats = read_bits(def, 3) + 3;
-					break;
-				case 18: //18: Repeat a code length of 0 for 11 - 138 times
-					num_repeats = read_bits(def, 7) + 11;
-					break;
-				default:
-					//Shouldn't happen...
-					break;
-			}
-			for(uint8_t j = 0; j < num_repeats; j++)
-				lengths[i++] = to_repeat;
+static uint32_t adler32(uint32_t adler, const uint8_t* data, size_t len) {
+	uint32_t a = adler & 0xFFFF;
+	uint32_t b = adler >> 16;
+	while(len) {
+		//5552 is the most bytes that can be summed before b could overflow
+		size_t n = len < 5552 ? len : 5552;
+		len -= n;
+		while(n--) {
+			a += *data++;
+			b += a;
 		}
+		a %= 65521;
+		b %= 65521;
 	}
+	return a | (b << 16);
+}
 
-	//Build the length/dist tables
-	huffman length_huff;
-	create_huffman(lengths, hlit, &length_huff);
-	huffman dist_huff;
-	create_huffman(lengths + hlit, hdist, &dist_huff);
-
-	inflate(def, &length_huff, &dist_huff);
+static inline uint32_t ring_space(INFLATE* inf) {
+	return INFLATE_RING_SIZE - (inf->out_pos - inf->flush_pos);
 }
 
-int inflate_uncompressed(DEFLATE* def) {
-	def->bit_buf = 0;
-	def->bit_pos = 8;
+static inline void copy_match(INFLATE* inf, uint32_t distance, uint32_t length) {
+	uint32_t dest_pos = inf->out_pos & INFLATE_RING_MASK;
+	uint32_t src_pos = (inf->out_pos - distance) & INFLATE_RING_MASK;
+	inf->out_pos += length;
+
+	if(dest_pos + length > INFLATE_RING_SIZE || src_pos + length > INFLATE_RING_SIZE) {
+		//The match wraps around the ring, so copy it byte by byte
+		while(length--) {
+			inf->ring[dest_pos] = inf->ring[src_pos];
+			dest_pos = (dest_pos + 1) & INFLATE_RING_MASK;
+			src_pos = (src_pos + 1) & INFLATE_RING_MASK;
+		}
+		return;
+	}
 
-	uint16_t len_a = def->read(def->arg);
-	uint16_t len_b = def->read(def->arg);
-	uint16_t len = len_a | (len_b << 8);
+	uint8_t* dest = inf->ring + dest_pos;
+	const uint8_t* src = inf->ring + src_pos;
+	if(distance >= length) {
+		memcpy(dest, src, length);
+	} else if(distance == 1) {
+		memset(dest, *src, length);
+	} else {
+		//The match overlaps itself, so it repeats the last distance bytes. Each copy doubles the repeated run.
+		while(length) {
+			uint32_t chunk = (uint32_t) (dest - src);
+			if(chunk > length)
+				chunk = length;
+			memcpy(dest, src, chunk);
+			dest += chunk;
+			length -= chunk;
+		}
+	}
+}
 
-	uint16_t lencomp_a = def->read(def->arg);
-	uint16_t lencomp_b = def->read(def->arg);
-	uint16_t lencomp = lencomp_a | (lencomp_b << 8);
+static inline void end_block(INFLATE* inf) {
+	if(!inf->final_block)
+		inf->state = STATE_BLOCK_HEADER;
+	else
+		inf->state = inf->zlib ? STATE_ZLIB_TRAILER : STATE_DONE;
+}
 
-	//Make sure lencomp is actually the ones complement of length
-	if((lencomp & 0xFFFF) != (~len & 0xFFFF))
-		return -1;
+/**
+ * Decodes literals and matches into the ring until the block ends, the ring fills up, or input runs out.
+ */
+static int inflate_codes(INFLATE* inf) {
+	const huffman* len_huff = inf->cur_len_huff;
+	const huffman* dist_huff = inf->cur_dist_huff;
 
-	for(uint16_t i = 0; i < len; i++)
-		def_write(def, def->read(def->arg));
+	while(1) {
+		if(ring_space(inf) < INFLATE_MAX_MATCH)
+			return RUN_RING_FULL;
 
-	return 0;
-}
+		refill(inf);
+		const uint8_t* saved_in = inf->in;
+		uint64_t saved_buf = inf->bit_buf;
+		uint32_t saved_count = inf->bit_count;
 
-huffman fixed_len_huff;
-huffman fixed_dist_huff;
-int made_fixed = 0;
+		int sym = huffman_decode(inf, len_huff);
+		if(sym < 0)
+			goto fail;
 
-int decompress(DEFLATE* def) {
-	def->bit_pos = 8;
-	def->frame_pointer = 0;
-	def->bit_buf = 0;
+		if(sym < 256) {
+			inf->ring[inf->out_pos++ & INFLATE_RING_MASK] = sym;
+			continue;
+		}
 
-	uint8_t bfinal = 0;
+		if(sym == 256) {
+			end_block(inf);
+			return RUN_DONE;
+		}
 
-	//Make the huffman code tables for fixed code inflation if they don't exist already
-	if(!made_fixed) {
-		made_fixed = 1;
-		uint8_t len_lengths[288];
-		for(uint16_t i = 0; i < 288; i++) {
-			if(i < 144 || i >= 280)
-				len_lengths[i] = 8;
-			else if(i < 256)
-				len_lengths[i] = 9;
-			else if(i < 280)
-				len_lengths[i] = 7;
+		{
+			sym -= 257;
+			if(sym >= 29)
+				return RUN_ERROR;
+			uint32_t extra = lengths_extrabits[sym];
+			if(extra > inf->bit_count)
+				goto fail;
+			uint32_t length = lengths_base[sym] + peek_bits(inf, extra);
+			consume_bits(inf, extra);
+
+			int dist_sym = huffman_decode(inf, dist_huff);
+			if(dist_sym < 0) {
+				sym = dist_sym;
+				goto fail;
+			}
+			if(dist_sym >= 30)
+				return RUN_ERROR;
+			extra = distances_extrabits[dist_sym];
+			if(extra > inf->bit_count)
+				goto fail;
+			uint32_t distance = distances_base[dist_sym] + peek_bits(inf, extra);
+			consume_bits(inf, extra);
+
+			if(distance > inf->out_pos && !inf->history_full)
+				return RUN_ERROR;
+			copy_match(inf, distance, length);
+			continue;
 		}
-		create_huffman(len_lengths, 288, &fixed_len_huff);
 
-		uint8_t dist_lengths[30];
-		for(uint8_t i = 0; i < 30; i++)
-			dist_lengths[i] = 5;
-		create_huffman(dist_lengths, 30, &fixed_dist_huff);
+	fail:
+		//Go back to the start of the symbol so we can try again once there's more input
+		if(sym == -2)
+			return RUN_ERROR;
+		inf->in = saved_in;
+		inf->bit_buf = saved_buf;
+		inf->bit_count = saved_count;
+		return RUN_NEEDS_INPUT;
 	}
+}
+
+/**
+ * Runs the decoder until it needs more input, the ring fills up, the stream ends, or an error occurs.
+ * Every state only consumes input once it has everything it needs, or saves its progress as it goes, so decoding
+ * can always pick back up where it left off once there's more input.
+ */
+static int inflate_run(INFLATE* inf) {
+#define NEED_BITS(n) \
+	if(inf->bit_count < (n)) \
+		return RUN_NEEDS_INPUT
+
+	while(1) {
+		refill(inf);
+		switch(inf->state) {
+			case STATE_ZLIB_HEADER: {
+				NEED_BITS(16);
+				uint32_t cmf = peek_bits(inf, 8);
+				uint32_t flg = peek_bits(inf, 16) >> 8;
+				consume_bits(inf, 16);
+				if((cmf & 0xFu) != 8 || (cmf >> 4) > 7 || ((cmf << 8) | flg) % 31) {
+					fprintf(stderr, "deflate: Invalid zlib header\n");
+					return RUN_ERROR;
+				}
+				if(flg & 0x20u) {
+					fprintf(stderr, "deflate: zlib presets are not supported\n");
+					return RUN_ERROR;
+				}
+				inf->state = STATE_BLOCK_HEADER;
+				break;
+			}
 
-	while(!bfinal) {
-		bfinal = read_bits(def, 1);
-		uint8_t btype = read_bits(def, 2);
-		switch(btype) {
-			case 0b00:
-				if(inflate_uncompressed(def) < 0)
-					return -1;
+			case STATE_BLOCK_HEADER: {
+				NEED_BITS(3);
+				inf->final_block = peek_bits(inf, 1);
+				uint32_t btype = peek_bits(inf, 3) >> 1;
+				consume_bits(inf, 3);
+				switch(btype) {
+					case 0b00:
+						inf->state = STATE_STORED_HEADER;
+						break;
+					case 0b01:
+						inf->cur_len_huff = &fixed_len_huff;
+						inf->cur_dist_huff = &fixed_dist_huff;
+						inf->state = STATE_CODES;
+						break;
+					case 0b10:
+						inf->state = STATE_DYNAMIC_HEADER;
+						break;
+					default:
+						fprintf(stderr, "deflate: Invalid btype 0b11\n");
+						return RUN_ERROR;
+				}
 				break;
-			case 0b01:
-				inflate(def, &fixed_len_huff, &fixed_dist_huff);
+			}
+
+			case STATE_STORED_HEADER: {
+				NEED_BITS((inf->bit_count & 7u) + 32);
+				consume_bits(inf, inf->bit_count & 7u);
+				uint32_t len = peek_bits(inf, 16);
+				uint32_t lencomp = peek_bits(inf, 32) >> 16;
+				consume_bits(inf, 32);
+				//Make sure lencomp is actually the ones complement of length
+				if((lencomp & 0xFFFF) != (~len & 0xFFFF))
+					return RUN_ERROR;
+				inf->copy_length = len;
+				inf->state = STATE_STORED_COPY;
 				break;
-			case 0b10:
-				inflate_dynamic(def);
+			}
+
+			case STATE_STORED_COPY: {
+				while(inf->copy_length) {
+					uint32_t space = ring_space(inf);
+					if(!space)
+						return RUN_RING_FULL;
+
+					//Anything already in the bit buffer has to be used up first
+					if(inf->bit_count) {
+						inf->ring[inf->out_pos++ & INFLATE_RING_MASK] = peek_bits(inf, 8);
+						consume_bits(inf, 8);
+						inf->copy_length--;
+						continue;
+					}
+
+					if(inf->in == inf->in_end)
+						return RUN_NEEDS_INPUT;
+					uint32_t ring_pos = inf->out_pos & INFLATE_RING_MASK;
+					size_t count = inf->copy_length;
+					if(count > space)
+						count = space;
+					if(count > (size_t) (inf->in_end - inf->in))
+						count = inf->in_end - inf->in;
+					if(count > INFLATE_RING_SIZE - ring_pos)
+						count = INFLATE_RING_SIZE - ring_pos;
+					memcpy(inf->ring + ring_pos, inf->in, count);
+					inf->in += count;
+					inf->out_pos += count;
+					inf->copy_length -= count;
+					//We skipped past input that may have been loaded into the top of the bit buffer
+					inf->bit_buf = 0;
+				}
+				end_block(inf);
 				break;
+			}
+
+			case STATE_DYNAMIC_HEADER: {
+				NEED_BITS(14);
+				inf->hlit = peek_bits(inf, 5) + 257; //# of Literal/Length codes
+				inf->hdist = (peek_bits(inf, 10) >> 5) + 1; //# of Distance codes
+				inf->hclen = (peek_bits(inf, 14) >> 10) + 4; //# of Code Length codes
+				consume_bits(inf, 14);
+				if(inf->hlit > 286 || inf->hdist > 30)
+					return RUN_ERROR;
+				inf->num_lengths = 0;
+				memset(inf->lengths, 0, 19);
+				inf->state = STATE_CODELENS;
+				break;
+			}
+
+			case STATE_CODELENS: {
+				//Get the code lengths for each entry in the code length alphabet
+				while(inf->num_lengths < inf->hclen) {
+					NEED_BITS(3);
+					inf->lengths[codelen_alphabet[inf->num_lengths++]] = peek_bits(inf, 3);
+					consume_bits(inf, 3);
+				}
+
+				//Build the huffman code table for the code length alphabet
+				if(create_huffman(inf->lengths, 19, &inf->codes_huff) < 0)
+					return RUN_ERROR;
+				inf->num_lengths = 0;
+				inf->state = STATE_LENGTHS;
+				break;
+			}
+
+			case STATE_LENGTHS: {
+				//Get the lengths for the literal/length and distance alphabets
+				uint32_t total = inf->hlit + inf->hdist;
+				while(inf->num_lengths < total) {
+					refill(inf);
+					const uint8_t* saved_in = inf->in;
+					uint64_t saved_buf = inf->bit_buf;
+					uint32_t saved_count = inf->bit_count;
+
+					int sym = huffman_decode(inf, &inf->codes_huff);
+					if(sym == -2)
+						return RUN_ERROR;
+					if(sym < 0)
+						return RUN_NEEDS_INPUT;
+
+					if(sym < 16) { //0-15: Represent code lengths of 0 - 15
+						inf->lengths[inf->num_lengths++] = sym;
+						continue;
+					}
+
+					uint32_t num_repeats;
+					uint8_t to_repeat = 0;
+					uint32_t extra = sym == 16 ? 2 : (sym == 17 ? 3 : 7);
+					if(inf->bit_count < extra) {
+						inf->in = saved_in;
+						inf->bit_buf = saved_buf;
+						inf->bit_count = saved_count;
+						return RUN_NEEDS_INPUT;
+					}
+					switch(sym) {
+						case 16: //16: Copy the previous code length 3 - 6 times.
+							if(!inf->num_lengths)
+								return RUN_ERROR;
+							to_repeat = inf->lengths[inf->num_lengths - 1];
+							num_repeats = peek_bits(inf, 2) + 3;
+							break;
+						case 17: //17: Repeat a code length of 0 for 3 - 10 times.
+							num_repeats = peek_bits(inf, 3) + 3;
+							break;
+						default: //18: Repeat a code length of 0 for 11 - 138 times
+							num_repeats = peek_bits(inf, 7) + 11;
+							break;
+					}
+					consume_bits(inf, extra);
+					if(inf->num_lengths + num_repeats > total)
+						return RUN_ERROR;
+					memset(inf->lengths + inf->num_lengths, to_repeat, num_repeats);
+					inf->num_lengths += num_repeats;
+				}
+
+				//Build the length/dist tables. There must be a code for the end of block symbol.
+				if(!inf->lengths[256])
+					return RUN_ERROR;
+				if(create_huffman(inf->lengths, inf->hlit, &inf->len_huff) < 0)
+					return RUN_ERROR;
+				if(create_huffman(inf->lengths + inf->hlit, inf->hdist, &inf->dist_huff) < 0)
+					return RUN_ERROR;
+				inf->cur_len_huff = &inf->len_huff;
+				inf->cur_dist_huff = &inf->dist_huff;
+				inf->state = STATE_CODES;
+				break;
+			}
+
+			case STATE_CODES: {
+				int ret = inflate_codes(inf);
+				if(ret != RUN_DONE)
+					return ret;
+				break;
+			}
+
+			case STATE_ZLIB_TRAILER: {
+				NEED_BITS((inf->bit_count & 7u) + 32);
+				consume_bits(inf, inf->bit_count & 7u);
+				uint32_t adler = 0;
+				for(int i = 0; i < 4; i++) {
+					adler = (adler << 8) | peek_bits(inf, 8);
+					consume_bits(inf, 8);
+				}
+				inf->expected_adler = adler;
+				inf->state = STATE_DONE;
+				break;
+			}
+
+			case STATE_DONE: {
+				//Give back any whole bytes we read past the end of the stream
+				size_t extra_bytes = inf->bit_count >> 3;
+				if(extra_bytes > (size_t) (inf->in - inf->in_start))
+					extra_bytes = inf->in - inf->in_start;
+				inf->in -= extra_bytes;
+				inf->bit_buf = 0;
+				inf->bit_count = 0;
+				return RUN_DONE;
+			}
+
 			default:
-				fprintf(stderr, "deflate: Invalid btype 0b11\n");
-				return -1;
+				return RUN_ERROR;
 		}
 	}
+#undef NEED_BITS
+}
 
-	return 0;
-}
\ No newline at end of file
+/**
+ * Copies as much pending output from the ring as will fit into out.
+ */
+static size_t inflate_flush(INFLATE* inf, uint8_t* out, size_t out_len) {
+	size_t count = inf->out_pos - inf->flush_pos;
+	if(count > out_len)
+		count = out_len;
+
+	size_t done = 0;
+	while(done < count) {
+		uint32_t ring_pos = inf->flush_pos & INFLATE_RING_MASK;
+		size_t chunk = count - done;
+		if(chunk > INFLATE_RING_SIZE - ring_pos)
+			chunk = INFLATE_RING_SIZE - ring_pos;
+		memcpy(out + done, inf->ring + ring_pos, chunk);
+		if(inf->zlib)
+			inf->adler = adler32(inf->adler, inf->ring + ring_pos, chunk);
+		inf->flush_pos += chunk;
+		done += chunk;
+	}
+
+	if(inf->out_pos >= INFLATE_MAX_DISTANCE)
+		inf->history_full = 1;
+	return count;
+}
+
+void inflate_init(INFLATE* inf, int zlib) {
+	//Make the huffman code tables for fixed code inflation if they don't exist already
+	if(!made_fixed)
+		create_fixed_huffman();
+
+	inf->state = zlib ? STATE_ZLIB_HEADER : STATE_BLOCK_HEADER;
+	inf->zlib = zlib;
+	inf->final_block = 0;
+	inf->history_full = 0;
+	inf->bit_buf = 0;
+	inf->bit_count = 0;
+	inf->copy_length = 0;
+	inf->adler = 1;
+	inf->expected_adler = 1;
+	inf->out_pos = 0;
+	inf->flush_pos = 0;
+}
+
+int inflate_stream(INFLATE* inf, const uint8_t* in, size_t in_len, size_t* in_used, uint8_t* out, size_t out_len, size_t* out_written) {
+	inf->in = in;
+	inf->in_start = in;
+	inf->in_end = in + in_len;
+
+	size_t written = 0;
+	int ret;
+	while(1) {
+		written += inflate_flush(inf, out + written, out_len - written);
+		int pending = inf->out_pos != inf->flush_pos;
+
+		if(inf->state == STATE_ERROR) {
+			ret = INFLATE_ERROR;
+			break;
+		}
+
+		if(inf->state == STATE_DONE) {
+			if(pending) {
+				ret = INFLATE_NEEDS_OUTPUT;
+			} else if(inf->zlib && inf->adler != inf->expected_adler) {
+				fprintf(stderr, "deflate: Checksum mismatch\n");
+				inf->state = STATE_ERROR;
+				ret = INFLATE_ERROR;
+			} else {
+				ret = INFLATE_DONE;
+			}
+			break;
+		}
+
+		//Don't bother decoding more if there's nowhere for it to go
+		if(pending && written == out_len) {
+			ret = INFLATE_NEEDS_OUTPUT;
+			break;
+		}
+
+		int run = inflate_run(inf);
+		if(run == RUN_ERROR) {
+			inf->state = STATE_ERROR;
+		} else if(run == RUN_NEEDS_INPUT) {
+			written += inflate_flush(inf, out + written, out_len - written);
+			ret = inf->out_pos != inf->flush_pos ? INFLATE_NEEDS_OUTPUT : INFLATE_NEEDS_INPUT;
+			break;
+		}
+	}
+
+	*in_used = inf->in - in;
+	*out_written = written;
+	return ret;
+}
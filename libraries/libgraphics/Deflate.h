@@ -24,23 +24,81 @@
 
 __DECL_BEGIN
 
-typedef struct DEFLATE {
-	uint8_t bit_pos;
-	uint8_t bit_buf;
-	size_t frame_pointer;
-	uint8_t reading_frame[0x8000];
+//The number of bits looked up at once when decoding huffman codes. Longer codes fall back to a slower search.
+#define INFLATE_FAST_BITS 9
+//The size of the output ring. Must be a power of two, and at least twice the maximum distance of a back-reference.
+#define INFLATE_RING_SIZE 0x10000
+#define INFLATE_MAX_DISTANCE 0x8000
 
-	void (*write)(uint8_t, void*);
-	uint8_t (*read)(void*);
-	void* arg;
-} DEFLATE;
+//Return values of inflate_stream()
+#define INFLATE_DONE 0
+#define INFLATE_NEEDS_INPUT 1
+#define INFLATE_NEEDS_OUTPUT 2
+#define INFLATE_ERROR (-1)
 
 typedef struct huffman {
+	uint16_t fast[1 << INFLATE_FAST_BITS]; //Indexed by the next INFLATE_FAST_BITS bits: (code length << 9) | symbol, or 0 if the code is longer
 	uint16_t counts[16];
 	uint16_t symbols[288];
 } huffman;
 
-int decompress(DEFLATE* def);
+typedef struct INFLATE {
+	int state;
+	int zlib;
+	int final_block;
+	int history_full;
+
+	//Input
+	uint64_t bit_buf;
+	uint32_t bit_count;
+	const uint8_t* in;
+	const uint8_t* in_start;
+	const uint8_t* in_end;
+
+	//Dynamic block headers
+	uint16_t hlit;
+	uint16_t hdist;
+	uint16_t hclen;
+	uint16_t num_lengths;
+	uint8_t lengths[320];
+	huffman codes_huff;
+	huffman len_huff;
+	huffman dist_huff;
+	const huffman* cur_len_huff;
+	const huffman* cur_dist_huff;
+
+	//Stored blocks
+	uint32_t copy_length;
+
+	//Output
+	uint32_t adler;
+	uint32_t expected_adler;
+	uint32_t out_pos;
+	uint32_t flush_pos;
+	uint8_t ring[INFLATE_RING_SIZE];
+} INFLATE;
+
+/**
+ * Prepares an INFLATE to decompress a new stream.
+ * @param inf The INFLATE to initialize.
+ * @param zlib Whether the stream has a zlib header and checksum, or is raw DEFLATE data.
+ */
+void inflate_init(INFLATE* inf, int zlib);
+
+/**
+ * Decompresses as much of a stream as possible. Can be called repeatedly with successive pieces of input and
+ * output buffers; any input that was consumed will not be needed again.
+ * @param inf The INFLATE to use.
+ * @param in The next piece of compressed input.
+ * @param in_len The number of bytes available in in.
+ * @param in_used Will be set to the number of input bytes consumed.
+ * @param out The buffer to decompress into.
+ * @param out_len The size of out.
+ * @param out_written Will be set to the number of bytes written to out.
+ * @return INFLATE_DONE if the stream is finished, INFLATE_NEEDS_INPUT if all input was consumed, INFLATE_NEEDS_OUTPUT
+ *         if out was filled with more output remaining, or INFLATE_ERROR if the stream is invalid.
+ */
+int inflate_stream(INFLATE* inf, const uint8_t* in, size_t in_len, size_t* in_used, uint8_t* out, size_t out_len, size_t* out_written);
 
 __DECL_END
 
@@ -207,24 +207,37 @@ Font* Font::load_from_shm(shm fontshm) {
 Font::Font(shm fontshm): fontshm(fontshm), uses_shm(true) {
 	data = (FontData*) fontshm.ptr;
 
-	//Read glyphs into map
+	//Find the unknown character glyph
+	unknown_glyph = nullptr;
 	FontGlyph* gptr = data->glyphs;
 	for(size_t i = 0; i < data->num_glyphs; i++) {
-		glyphs[gptr->codepoint] = gptr;
+		if(gptr->codepoint == 0xFFFD) //REPLACEMENT CHARACTER
+			unknown_glyph = gptr;
 		size_t glyph_size = sizeof(FontGlyph) + (gptr->width * gptr->height * sizeof(uint32_t));
 		gptr = (FontGlyph*) ((size_t) gptr + glyph_size);
 	}
-
-	//Create the unknown character glyph
-	if(glyphs[0xFFFD]) { //REPLACEMENT CHARACTER
-		size_t glyph_size = sizeof(FontGlyph) + (glyphs[0xFFFD]->width * glyphs[0xFFFD]->height * sizeof(uint32_t));
-		unknown_glyph = (FontGlyph*) malloc(glyph_size);
-		memcpy(unknown_glyph, glyphs[0xFFFD], glyph_size);
-	} else {
+	if(!unknown_glyph) {
 		//Don't have REPLACEMENT CHARACTER, just make a blank glyph
 		unknown_glyph = new FontGlyph;
 	}
+	add_glyph(unknown_glyph);
 
+	//Prepare the glyphs and put them in the lookup table
+	gptr = data->glyphs;
+	for(size_t i = 0; i < data->num_glyphs; i++) {
+		auto index = (uint32_t) glyph_infos.size();
+		add_glyph(gptr);
+		if(gptr->codepoint < 0x10000) {
+			auto& page = glyph_pages[gptr->codepoint >> 8];
+			if(!page)
+				page = std::unique_ptr<uint32_t[]>(new uint32_t[0x100]());
+			page[gptr->codepoint & 0xFF] = index;
+		} else {
+			other_glyphs[gptr->codepoint] = index;
+		}
+		size_t glyph_size = sizeof(FontGlyph) + (gptr->width * gptr->height * sizeof(uint32_t));
+		gptr = (FontGlyph*) ((size_t) gptr + glyph_size);
+	}
 }
 
 Font::~Font() {
@@ -235,7 +248,44 @@ Font::~Font() {
 		delete data;
 	}
 
-	delete unknown_glyph;
+	if(unknown_glyph->codepoint != 0xFFFD)
+		delete unknown_glyph;
+}
+
+void Font::add_glyph(FontGlyph* glyph) {
+	GlyphInfo info = {
+		.glyph = glyph,
+		.offset = {
+			glyph->base_x - data->bounding_box.base_x,
+			(data->bounding_box.base_y - glyph->base_y) + (data->size - glyph->height)
+		},
+		.first_span = (uint32_t) glyph_spans.size(),
+		.num_spans = 0
+	};
+
+	//Turn each row of the bitmap into runs of set pixels, so they can be drawn as fills
+	for(int y = 0; y < glyph->height; y++) {
+		auto* row = &glyph->bitmap[y * glyph->width];
+		int x = 0;
+		while(x < glyph->width) {
+			if(!row[x]) {
+				x++;
+				continue;
+			}
+			int start = x;
+			while(x < glyph->width && row[x])
+				x++;
+			glyph_spans.push_back({(int16_t) start, (int16_t) y, (int16_t) (x - start)});
+			info.num_spans++;
+		}
+	}
+
+	glyph_infos.push_back(info);
+}
+
+const GlyphInfo& Font::glyph_info_slow(uint32_t codepoint) const {
+	auto it = other_glyphs.find(codepoint);
+	return glyph_infos[it != other_glyphs.end() ? it->second : 0];
 }
 
 FontData::BoundingBox Font::bounding_box() {
@@ -250,22 +300,14 @@ int Font::shm_id() {
 	return uses_shm ? fontshm.id : -1;
 }
 
-FontGlyph* Font::glyph(uint32_t codepoint) {
-	auto* glyph = glyphs[codepoint];
-	return glyph ? glyph : unknown_glyph;
-}
-
 Dimensions Font::size_of(std::string_view string) {
 	Rect bounding_box = {0, 0, 0, this->bounding_box().height};
 	Point cpos = {0, 0};
 	for (auto ch : string) {
-		auto glph = glyph(ch);
-		Point offset = {
-			glph->base_x - data->bounding_box.base_x,
-			(data->bounding_box.base_y - glph->base_y) + (data->size - glph->height)
-		};
+		auto& info = glyph_info(ch);
+		auto glph = info.glyph;
 		Rect glyph_box = {
-			cpos + offset,
+			cpos + info.offset,
 			glph->width, glph->height
 		};
 		bounding_box = bounding_box.combine(glyph_box);
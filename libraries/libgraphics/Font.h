@@ -23,6 +23,8 @@
 #include <cstdint>
 #include <sys/shm.h>
 #include <map>
+#include <memory>
+#include <vector>
 #include "Graphics.h"
 #include "Geometry.h"
 
@@ -58,6 +60,21 @@ namespace Gfx {
 		FontGlyph glyphs[];
 	};
 
+	/// A horizontal run of opaque pixels in one row of a glyph.
+	struct GlyphSpan {
+		int16_t x;
+		int16_t y;
+		int16_t length;
+	};
+
+	/// A glyph prepared for drawing: where it goes relative to the pen position, and its bitmap as spans.
+	struct GlyphInfo {
+		FontGlyph* glyph;
+		Point offset; ///< The offset of the glyph's bitmap from the pen position
+		uint32_t first_span;
+		uint32_t num_spans;
+	};
+
 	class Font {
 	public:
 		static Font* load_bdf_shm(const char* path);
@@ -70,7 +87,17 @@ namespace Gfx {
 
 		FontData::BoundingBox bounding_box();
 
-		FontGlyph* glyph(uint32_t codepoint);
+		const GlyphInfo& glyph_info(uint32_t codepoint) const {
+			if(codepoint < 0x10000) {
+				auto& page = glyph_pages[codepoint >> 8];
+				return glyph_infos[page ? page[codepoint & 0xFF] : 0];
+			}
+			return glyph_info_slow(codepoint);
+		}
+
+		FontGlyph* glyph(uint32_t codepoint) const { return glyph_info(codepoint).glyph; }
+
+		const GlyphSpan* spans(const GlyphInfo& info) const { return glyph_spans.data() + info.first_span; }
 
 		Dimensions size_of(std::string_view string);
 
@@ -79,11 +106,23 @@ namespace Gfx {
 
 		~Font();
 
+		void add_glyph(FontGlyph* glyph);
+		const GlyphInfo& glyph_info_slow(uint32_t codepoint) const;
+
 		bool uses_shm = false;
 		shm fontshm = {nullptr, 0, 0};
 		FontData* data;
-		std::map<uint32_t, FontGlyph*> glyphs;
 		FontGlyph* unknown_glyph;
+
+		/*
+		 * Glyphs in the Basic Multilingual Plane are looked up in a table of 256-codepoint pages, which are only
+		 * allocated if the font has a glyph in them. Each entry is an index into glyph_infos, where 0 is the unknown
+		 * glyph. Anything outside of the BMP goes in the map.
+		 */
+		std::unique_ptr<uint32_t[]> glyph_pages[0x100];
+		std::map<uint32_t, uint32_t> other_glyphs;
+		std::vector<GlyphInfo> glyph_infos;
+		std::vector<GlyphSpan> glyph_spans;
 	};
 }
 
@@ -22,6 +22,9 @@
 #include "Font.h"
 #include "Memory.h"
 #include "Geometry.h"
+#include "Blit.h"
+#include <vector>
+#include <cstring>
 
 using namespace Gfx;
 
@@ -79,8 +82,29 @@ void Framebuffer::copy(const Framebuffer& other, Rect other_area, const Point& p
 	other_area.width = self_area.width;
 	other_area.height = self_area.height;
 
-	for(int y = 0; y < self_area.height; y++) {
-		memcpy_uint32((uint32_t*) &data[self_area.x + (self_area.y + y) * width], (uint32_t*) &other.data[other_area.x + (other_area.y + y) * other.width], self_area.width);
+	for(int y = 0; y < self_area.height; y++)
+		Blit::copy_row(&data[self_area.x + (self_area.y + y) * width], &other.data[other_area.x + (other_area.y + y) * other.width], self_area.width);
+}
+
+void Framebuffer::copy_within(Rect area, const Point& pos) const {
+	//Make sure both areas are in bounds of the framebuffer
+	Point offset = pos - area.position();
+	area = area.overlapping_area({0, 0, width, height});
+	Rect self_area = area.transform(offset).overlapping_area({0, 0, width, height});
+	if(self_area.empty())
+		return;
+	area = self_area.transform(offset * -1);
+
+	//Go bottom to top when moving down so that we don't copy rows we've already overwritten
+	auto copy_row = [&](int y) {
+		memmove(&data[self_area.x + (self_area.y + y) * width], &data[area.x + (area.y + y) * width], self_area.width * sizeof(Color));
+	};
+	if(self_area.y > area.y) {
+		for(int y = self_area.height - 1; y >= 0; y--)
+			copy_row(y);
+	} else {
+		for(int y = 0; y < self_area.height; y++)
+			copy_row(y);
 	}
 }
 
@@ -117,13 +141,8 @@ void Framebuffer::copy_blitting(const Framebuffer& other, Rect other_area, const
 	other_area.width = self_area.width;
 	other_area.height = self_area.height;
 
-	for(int y = 0; y < self_area.height; y++) {
-		for(int x = 0; x < self_area.width; x++) {
-			auto& this_val = data[(self_area.x + x) + (self_area.y + y) * width];
-			auto& other_val = other.data[(other_area.x + x) + (other_area.y + y) * other.width];
-			this_val = this_val.blended(other_val);
-		}
-	}
+	for(int y = 0; y < self_area.height; y++)
+		Blit::blend_row(&data[self_area.x + (self_area.y + y) * width], &other.data[other_area.x + (other_area.y + y) * other.width], self_area.width);
 }
 
 void Framebuffer::copy_blitting_flipped(const Framebuffer& other, Rect other_area, const Point& pos, bool flip_h, bool flip_v) const {
@@ -184,27 +203,22 @@ void Framebuffer::draw_image(const Framebuffer& other, Rect other_area, const Po
 	other_area.width = self_area.width;
 	other_area.height = self_area.height;
 
-	for(int y = 0; y < self_area.height; y++) {
-		for(int x = 0; x < self_area.width; x++) {
-			auto& this_val = data[(self_area.x + x) + (self_area.y + y) * width];
-			auto& other_val = other.data[(other_area.x + x) + (other_area.y + y) * other.width];
-			this_val = this_val.blended(other_val);
-		}
-	}
+	for(int y = 0; y < self_area.height; y++)
+		Blit::blend_row(&data[self_area.x + (self_area.y + y) * width], &other.data[other_area.x + (other_area.y + y) * other.width], self_area.width);
 }
 
 void Framebuffer::draw_image(const Framebuffer& other, const Point& pos) const {
 	draw_image(other, {0, 0, other.width, other.height}, pos);
 }
 
-void Framebuffer::draw_image_scaled(const Framebuffer& other, const Rect& rect) const {
+void Framebuffer::draw_image_scaled(const Framebuffer& other, const Rect& rect, ScaleMode mode) const {
 	if(rect.width == other.width && rect.height == other.height) {
 		draw_image(other, rect.position());
 		return;
 	}
 
-	double scale_x = (double) rect.width / (double) other.width;
-	double scale_y = (double) rect.height / (double) other.height;
+	if(rect.width <= 0 || rect.height <= 0 || !other.width || !other.height)
+		return;
 
 	//Make sure self_area is in bounds of the framebuffer
 	Rect self_area = rect;
@@ -212,19 +226,35 @@ void Framebuffer::draw_image_scaled(const Framebuffer& other, const Rect& rect)
 	if(self_area.empty())
 		return;
 
-	//Update other area with the changes made to self_area
-	DoubleRect other_area = {0, 0, (float) other.width, (float) other.height};
-	other_area.x += (self_area.x - rect.x) / scale_x;
-	other_area.y += (self_area.y - rect.y) / scale_y;
-	other_area.width = self_area.width / scale_x;
-	other_area.height = self_area.height / scale_y;
+	//The distance between each pixel of the image, in 16.16 fixed point
+	uint32_t step_x = ((uint64_t) other.width << 16) / rect.width;
+	uint32_t step_y = ((uint64_t) other.height << 16) / rect.height;
 
-	for(int y = 0; y < self_area.height; y++) {
-		for(int x = 0; x < self_area.width; x++) {
-			auto& this_val = data[(self_area.x + x) + (self_area.y + y) * width];
-			auto& other_val = other.data[(int) (other_area.x + x / scale_x) + (int) (other_area.y + y / scale_y) * other.width];
-			this_val = this_val.blended(other_val);
+	//Sample each row into a buffer, then blend it onto the framebuffer
+	std::vector<Color> row(self_area.width);
+
+	if(mode == ScaleMode::Nearest) {
+		uint32_t start_x = (self_area.x - rect.x) * step_x;
+		for(int y = 0; y < self_area.height; y++) {
+			uint32_t src_y = ((uint64_t) (self_area.y - rect.y + y) * step_y) >> 16;
+			Blit::scale_row_nearest(row.data(), &other.data[src_y * other.width], self_area.width, start_x, step_x);
+			Blit::blend_row(&data[self_area.x + (self_area.y + y) * width], row.data(), self_area.width);
 		}
+		return;
+	}
+
+	//For bilinear filtering, sample from the centers of pixels
+	auto sample_start = [](int offset, uint32_t step) {
+		int64_t pos = (int64_t) offset * step + step / 2 - (1 << 15);
+		return (uint32_t) (pos < 0 ? 0 : pos);
+	};
+	uint32_t start_x = sample_start(self_area.x - rect.x, step_x);
+	for(int y = 0; y < self_area.height; y++) {
+		uint32_t src_y = sample_start(self_area.y - rect.y + y, step_y);
+		int row_a = std::min((int) (src_y >> 16), other.height - 1);
+		int row_b = std::min(row_a + 1, other.height - 1);
+		Blit::scale_row_bilinear(row.data(), &other.data[row_a * other.width], &other.data[row_b * other.width], other.width, self_area.width, start_x, step_x, src_y);
+		Blit::blend_row(&data[self_area.x + (self_area.y + y) * width], row.data(), self_area.width);
 	}
 }
 
@@ -234,11 +264,8 @@ void Framebuffer::fill(Rect area, Color color) const {
 	if(area.empty())
 		return;
 
-	for(int y = 0; y < area.height; y++) {
-		for(int x = 0; x < area.width; x++) {
-			data[x + area.x + (area.y + y) * width] = color;
-		}
-	}
+	for(int y = 0; y < area.height; y++)
+		Blit::fill_row(&data[area.x + (area.y + y) * width], color, area.width);
 }
 
 void Framebuffer::fill_blitting(Rect area, Color color) const {
@@ -247,37 +274,39 @@ void Framebuffer::fill_blitting(Rect area, Color color) const {
 	if(area.empty())
 		return;
 
-	unsigned int alpha = COLOR_A(color) + 1;
-	unsigned int inv_alpha = 256 - COLOR_A(color);
-	unsigned int premultiplied_r = alpha * COLOR_R(color);
-	unsigned int premultiplied_g = alpha * COLOR_G(color);
-	unsigned int premultiplied_b = alpha * COLOR_B(color);
-	unsigned int premultiplied_a = alpha * COLOR_A(color);
-
-	for(int y = 0; y < area.height; y++) {
-		for(int x = 0; x < area.width; x++) {
-			auto this_val = data[(area.x + x) + (area.y + y) * width];
-			data[(area.x + x) + (area.y + y) * width] = RGBA(
-					(uint8_t)((premultiplied_r + inv_alpha * COLOR_R(this_val)) >> 8),
-					(uint8_t)((premultiplied_g + inv_alpha * COLOR_G(this_val)) >> 8),
-					(uint8_t)((premultiplied_b + inv_alpha * COLOR_B(this_val)) >> 8),
-					(uint8_t)((premultiplied_a + inv_alpha * COLOR_A(this_val)) >> 8));
-		}
-	}
+	for(int y = 0; y < area.height; y++)
+		Blit::blend_fill_row(&data[area.x + (area.y + y) * width], color, area.width);
 }
 
 void Framebuffer::fill_gradient_h(Rect area, Color color_a, Color color_b) const {
 	if(color_a == color_b)
-		fill(area, color_a);
-	for(int x = 0; x < area.width; x++)
-		fill({area.x + x, area.y, 1, area.height}, color_a.mixed(color_b, (float) x / area.width));
+		return fill(area, color_a);
+
+	//Make sure area is in the bounds of the framebuffer
+	Rect clipped_area = area.overlapping_area({0, 0, width, height});
+	if(clipped_area.empty())
+		return;
+
+	//Every row is the same, so draw the first one and copy it to the rest
+	auto* first_row = &data[clipped_area.x + clipped_area.y * width];
+	Blit::gradient_row(first_row, color_a, color_b, clipped_area.x - area.x, area.width, clipped_area.width);
+	for(int y = 1; y < clipped_area.height; y++)
+		Blit::copy_row(&data[clipped_area.x + (clipped_area.y + y) * width], first_row, clipped_area.width);
 }
 
 void Framebuffer::fill_gradient_v(Rect area, Color color_a, Color color_b) const {
 	if(color_a == color_b)
-		fill(area, color_a);
-	for(int y = 0; y < area.height; y++)
-		fill({area.x, area.y + y, area.width, 1}, color_a.mixed(color_b, (float) y / area.height));
+		return fill(area, color_a);
+
+	//Make sure area is in the bounds of the framebuffer
+	Rect clipped_area = area.overlapping_area({0, 0, width, height});
+	if(clipped_area.empty())
+		return;
+
+	for(int y = 0; y < clipped_area.height; y++) {
+		Color color = color_a.mixed(color_b, (float) (clipped_area.y - area.y + y) / area.height);
+		Blit::fill_row(&data[clipped_area.x + (clipped_area.y + y) * width], color, clipped_area.width);
+	}
 }
 
 void Framebuffer::invert(Gfx::Rect area) const {
@@ -357,34 +386,37 @@ Point Framebuffer::draw_text(const char* str, size_t len, const Point& pos, Font
 }
 
 Point Framebuffer::draw_glyph(Font* font, uint32_t codepoint, const Point& glyph_pos, Color color) const {
-	auto* glyph = font->glyph(codepoint);
-	int y_offset = (font->bounding_box().base_y - glyph->base_y) + (font->size() - glyph->height);
-	int x_offset = glyph->base_x - font->bounding_box().base_x;
-	Point pos = {glyph_pos.x + x_offset, glyph_pos.y + y_offset};
-	Rect glyph_area = {0, 0, glyph->width, glyph->height};
-
-	//Make sure self_area is in bounds of the framebuffer
-	Rect self_area = {pos.x, pos.y, glyph_area.width, glyph_area.height};
-	self_area = self_area.overlapping_area({0, 0, width, height});
-	if(self_area.empty())
-		return glyph_pos + Point {glyph->next_offset.x, glyph->next_offset.y};
-
-	//Update glyph_area with the changes made to self_area
-	glyph_area.x += self_area.x - pos.x;
-	glyph_area.y += self_area.y - pos.y;
-	glyph_area.width = self_area.width;
-	glyph_area.height = self_area.height;
-
-	for(int y = 0; y < self_area.height; y++) {
-		for(int x = 0; x < self_area.width; x++) {
-			auto& this_val = data[(self_area.x + x) + (self_area.y + y) * width];
-			auto& other_val = glyph->bitmap[(glyph_area.x + x) + (glyph_area.y + y) * glyph->width];
-			if (other_val)
-				this_val = this_val.blended(color);
+	auto& info = font->glyph_info(codepoint);
+	auto* glyph = info.glyph;
+	Point next_pos = glyph_pos + Point {glyph->next_offset.x, glyph->next_offset.y};
+	Point pos = glyph_pos + info.offset;
+
+	//Skip glyphs that are invisible or completely out of bounds
+	if(!color.a || pos.x >= width || pos.y >= height || pos.x + glyph->width <= 0 || pos.y + glyph->height <= 0)
+		return next_pos;
+
+	//Fill each run of set pixels in the glyph, clipped to the framebuffer
+	bool opaque = color.a == 255;
+	auto* span = font->spans(info);
+	auto* spans_end = span + info.num_spans;
+	for(; span < spans_end; span++) {
+		int y = pos.y + span->y;
+		if(y < 0 || y >= height)
+			continue;
+		int x = std::max(pos.x + span->x, 0);
+		int end = std::min(pos.x + span->x + span->length, width);
+		if(x >= end)
+			continue;
+		auto* row = &data[x + y * width];
+		if(opaque) {
+			for(int i = 0; i < end - x; i++)
+				row[i] = color;
+		} else {
+			Blit::blend_fill_row(row, color, end - x);
 		}
 	}
 
-	return glyph_pos + Point {glyph->next_offset.x, glyph->next_offset.y};
+	return next_pos;
 }
 
 void Framebuffer::multiply(Color color) {
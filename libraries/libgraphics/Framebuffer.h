@@ -30,6 +30,12 @@
 
 namespace Gfx {
 	class Font;
+
+	enum class ScaleMode {
+		Nearest,
+		Bilinear
+	};
+
 	class Framebuffer: public Duck::Serializable {
 	public:
 		Framebuffer();
@@ -60,6 +66,14 @@ namespace Gfx {
 		 */
 		void copy(const Framebuffer& other, Rect other_area, const Point& pos) const;
 
+		/**
+		 * Copies a part of this Image to somewhere else in it. Unlike copying the Image to itself with ::copy(), this
+		 * works when the two areas overlap.
+		 * @param area The area of this Image to copy.
+		 * @param pos The position of this Image to copy to.
+		 */
+		void copy_within(Rect area, const Point& pos) const;
+
 		/**
 		 * Copies a part of another Image to this one, ignoring alpha.
 		 * @param other The other Image to copy from.
@@ -111,8 +125,9 @@ namespace Gfx {
 		 * fit inside of the specified rect.
 		 * @param other The Image to draw.
 		 * @param size The rect on this Image to scale the image to and draw on.
+		 * @param mode How to sample the Image when scaling it.
 		 */
-		void draw_image_scaled(const Framebuffer& other, const Rect& rect) const;
+		void draw_image_scaled(const Framebuffer& other, const Rect& rect, ScaleMode mode = ScaleMode::Nearest) const;
 
 		/**
 		 * Fills an area of the Image with a color.
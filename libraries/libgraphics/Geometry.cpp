@@ -17,4 +17,146 @@
 	Copyright (c) Byteduck 2016-2021. All rights reserved.
 */
 
-#include "Geometry.h"
\ No newline at end of file
+#include "Geometry.h"
+using namespace Gfx;
+
+static inline bool rect_is_empty(const Rect& rect) {
+	return rect.width <= 0 || rect.height <= 0;
+}
+
+Region::Region(const Rect& rect) {
+	if(!rect_is_empty(rect))
+		m_rects.push_back(rect);
+}
+
+void Region::add(const Rect& rect) {
+	if(rect_is_empty(rect))
+		return;
+
+	// Cut away the parts of the new rect we already have, and add whatever is left
+	std::vector<Rect> pieces = {rect};
+	for(auto& existing : m_rects) {
+		if(existing.collides(rect))
+			subtract_from(pieces, existing);
+		if(pieces.empty())
+			return;
+	}
+	m_rects.insert(m_rects.end(), pieces.begin(), pieces.end());
+	coalesce();
+}
+
+void Region::add(const Region& region) {
+	for(auto& rect : region.m_rects)
+		add(rect);
+}
+
+void Region::subtract(const Rect& rect) {
+	if(rect_is_empty(rect) || !intersects(rect))
+		return;
+	subtract_from(m_rects, rect);
+	coalesce();
+}
+
+void Region::subtract(const Region& region) {
+	for(auto& rect : region.m_rects)
+		subtract(rect);
+}
+
+void Region::intersect(const Rect& rect) {
+	if(rect_is_empty(rect))
+		return clear();
+	size_t num_kept = 0;
+	for(auto& existing : m_rects) {
+		if(existing.collides(rect))
+			m_rects[num_kept++] = existing.overlapping_area(rect);
+	}
+	m_rects.resize(num_kept);
+	coalesce();
+}
+
+Region Region::intersection(const Rect& rect) const {
+	Region ret;
+	if(rect_is_empty(rect))
+		return ret;
+	for(auto& existing : m_rects) {
+		if(existing.collides(rect))
+			ret.m_rects.push_back(existing.overlapping_area(rect));
+	}
+	ret.coalesce();
+	return ret;
+}
+
+bool Region::intersects(const Rect& rect) const {
+	if(rect_is_empty(rect))
+		return false;
+	for(auto& existing : m_rects) {
+		if(existing.collides(rect))
+			return true;
+	}
+	return false;
+}
+
+Rect Region::bounds() const {
+	if(m_rects.empty())
+		return {0, 0, 0, 0};
+	Rect ret = m_rects[0];
+	for(auto& rect : m_rects)
+		ret = ret.combine(rect);
+	return ret;
+}
+
+int Region::area() const {
+	int ret = 0;
+	for(auto& rect : m_rects)
+		ret += rect.area();
+	return ret;
+}
+
+void Region::subtract_from(std::vector<Rect>& rects, const Rect& cut) {
+	// Each rect that collides with the cut is split into up to four pieces around it: above, below, left and right.
+	std::vector<Rect> ret;
+	ret.reserve(rects.size() + 3);
+	for(auto& rect : rects) {
+		if(!rect.collides(cut)) {
+			ret.push_back(rect);
+			continue;
+		}
+
+		int top = std::max(rect.y, cut.y);
+		int bottom = std::min(rect.y + rect.height, cut.y + cut.height);
+		if(cut.y > rect.y)
+			ret.push_back({rect.x, rect.y, rect.width, cut.y - rect.y});
+		if(cut.y + cut.height < rect.y + rect.height)
+			ret.push_back({rect.x, bottom, rect.width, rect.y + rect.height - bottom});
+		if(cut.x > rect.x)
+			ret.push_back({rect.x, top, cut.x - rect.x, bottom - top});
+		if(cut.x + cut.width < rect.x + rect.width)
+			ret.push_back({cut.x + cut.width, top, rect.x + rect.width - (cut.x + cut.width), bottom - top});
+	}
+	rects = std::move(ret);
+}
+
+void Region::coalesce() {
+	// Merge rects that share a whole edge, first vertically and then horizontally, leaving them in reading order.
+	// Since the rects don't overlap, any two that can be merged will be next to each other once sorted.
+	auto merge = [&](auto order, auto can_merge, auto do_merge) {
+		std::sort(m_rects.begin(), m_rects.end(), order);
+		size_t num_merged = 0;
+		for(size_t i = 0; i < m_rects.size(); i++) {
+			if(num_merged && can_merge(m_rects[num_merged - 1], m_rects[i]))
+				do_merge(m_rects[num_merged - 1], m_rects[i]);
+			else
+				m_rects[num_merged++] = m_rects[i];
+		}
+		m_rects.resize(num_merged);
+	};
+
+	merge(
+		[](const Rect& a, const Rect& b) { return a.x != b.x ? a.x < b.x : a.y < b.y; },
+		[](const Rect& a, const Rect& b) { return a.x == b.x && a.width == b.width && a.y + a.height == b.y; },
+		[](Rect& a, const Rect& b) { a.height += b.height; });
+	merge(
+		[](const Rect& a, const Rect& b) { return a.y != b.y ? a.y < b.y : a.x < b.x; },
+		[](const Rect& a, const Rect& b) { return a.y == b.y && a.height == b.height && a.x + a.width == b.x; },
+		[](Rect& a, const Rect& b) { a.width += b.width; });
+}
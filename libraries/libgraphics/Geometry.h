@@ -20,6 +20,7 @@
 #pragma once
 
 #include <algorithm>
+#include <vector>
 #include <math.h>
 #include <libduck/Stream.h>
 
@@ -426,4 +427,68 @@ namespace Gfx {
 	using IntRect = GenericRect<int>;
 	using FloatRect = GenericRect<float>;
 	using DoubleRect = GenericRect<double>;
+
+	/**
+	 * An arbitrary area made up of rects. The rects never overlap, and are kept sorted top to bottom, left to right.
+	 */
+	class Region {
+	public:
+		Region() = default;
+		Region(const Rect& rect);
+
+		/**
+		 * Adds a rect to the region.
+		 */
+		void add(const Rect& rect);
+
+		/**
+		 * Adds all of the area of another region to this region.
+		 */
+		void add(const Region& region);
+
+		/**
+		 * Removes a rect from the region.
+		 */
+		void subtract(const Rect& rect);
+
+		/**
+		 * Removes all of the area of another region from this region.
+		 */
+		void subtract(const Region& region);
+
+		/**
+		 * Removes everything outside of a rect from the region.
+		 */
+		void intersect(const Rect& rect);
+
+		/**
+		 * Returns the part of the region inside of a rect.
+		 */
+		[[nodiscard]] Region intersection(const Rect& rect) const;
+
+		/**
+		 * Returns true if any part of the region is inside of a rect.
+		 */
+		[[nodiscard]] bool intersects(const Rect& rect) const;
+
+		/**
+		 * Returns the smallest rect containing the whole region.
+		 */
+		[[nodiscard]] Rect bounds() const;
+
+		/**
+		 * Returns the number of points in the region.
+		 */
+		[[nodiscard]] int area() const;
+
+		[[nodiscard]] bool empty() const { return m_rects.empty(); }
+		[[nodiscard]] const std::vector<Rect>& rects() const { return m_rects; }
+		void clear() { m_rects.clear(); }
+
+	private:
+		static void subtract_from(std::vector<Rect>& rects, const Rect& rect);
+		void coalesce();
+
+		std::vector<Rect> m_rects;
+	};
 }
@@ -18,9 +18,11 @@
 */
 
 #include <cfloat>
+#include <cstring>
 #include <valarray>
 #include "Image.h"
 #include "PNG.h"
+#include "ImageCache.h"
 
 using namespace Gfx;
 using namespace Duck;
@@ -37,11 +39,14 @@ Duck::ResultRet<Duck::Ptr<Image>> Image::load(Duck::Path path) {
 		for(auto& entry : entries) {
 			int width, height;
 			if(sscanf(entry.path().basename().c_str(), "%dx%d", &width, &height) == 2) {
-				auto* png = load_png(entry.path());
-				if(png && png->width == width && png->height == height) {
+				auto png_res = ImageCache::load_png(entry.path());
+				if(png_res.is_error())
+					continue;
+				auto png = png_res.value();
+				if(png->width == width && png->height == height) {
 					if(largest_size.width * largest_size.height < width * height)
 						largest_size = {width, height};
-					buffers[{width, height}] = Ptr<Framebuffer>(png);
+					buffers[{width, height}] = png;
 				}
 			}
 		}
@@ -49,10 +54,8 @@ Duck::ResultRet<Duck::Ptr<Image>> Image::load(Duck::Path path) {
 			return Result("No valid images in icon");
 		return Image::make(buffers, largest_size);
 	} else if(path.extension() == "png") {
-		auto* png = load_png(path);
-		if(!png)
-			return Result("Invalid PNG file");
-		std::map<std::pair<int, int>, Ptr<Framebuffer>> map = {{{png->width, png->height}, Ptr<Framebuffer>(png)}};
+		auto png = TRY(ImageCache::load_png(path));
+		std::map<std::pair<int, int>, Ptr<Framebuffer>> map = {{{png->width, png->height}, png}};
 		return Image::make(map, Dimensions {png->width, png->height});
 	}
 	return Result("Invalid image file");
@@ -88,8 +91,13 @@ void Image::draw(const Framebuffer& buffer, Point point) const {
 }
 
 void Image::multiply(Color color) {
+	// Our framebuffers may be shared with clones of this image or the image cache, so multiply private copies
 	for(auto& framebuffer : m_framebuffers) {
-		framebuffer.second->multiply(color);
+		auto& original = *framebuffer.second;
+		auto copy = std::make_shared<Framebuffer>(original.width, original.height);
+		memcpy(copy->data, original.data, IMGSIZE(original.width, original.height));
+		copy->multiply(color);
+		framebuffer.second = copy;
 	}
 }
 
@@ -47,7 +47,7 @@ namespace Gfx {
 		Image(std::map<std::pair<int, int>, Duck::Ptr<Framebuffer>> framebuffers, Dimensions size);
 		void initialize() override {};
 
-		const std::map<std::pair<int, int>, Duck::Ptr<Framebuffer>> m_framebuffers;
+		std::map<std::pair<int, int>, Duck::Ptr<Framebuffer>> m_framebuffers;
 		Dimensions m_size;
 	};
 }
@@ -0,0 +1,160 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2024 Byteduck */
+
+#include "ImageCache.h"
+#include "PNG.h"
+#include <libduck/Mutex.h>
+#include <map>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace Gfx;
+using Duck::Result, Duck::ResultRet, Duck::Ptr;
+
+namespace {
+	struct LoadedImage {
+		std::weak_ptr<Framebuffer> framebuffer;
+		time_t mtime;
+		off_t size;
+	};
+
+	// Images this process already has, so that loading the same icon twice doesn't map it twice
+	Duck::Mutex loaded_lock;
+	std::map<std::string, LoadedImage> loaded;
+
+	uint32_t hash_path(const std::string& path) {
+		uint32_t hash = 2166136261u;
+		for(char c : path)
+			hash = (hash ^ (uint8_t) c) * 16777619u;
+		return hash;
+	}
+}
+
+std::string ImageCache::cache_path(const std::string& path) {
+	char name[16];
+	snprintf(name, sizeof(name), "%08x", hash_path(path));
+	return std::string(IMAGE_CACHE_DIR "/") + name;
+}
+
+ResultRet<Ptr<Framebuffer>> ImageCache::load_png(const Duck::Path& path) {
+	auto& path_string = path.string();
+	struct stat source;
+	if(stat(path_string.c_str(), &source) < 0)
+		return Result(errno);
+
+	LOCK(loaded_lock);
+	auto loaded_it = loaded.find(path_string);
+	if(loaded_it != loaded.end()) {
+		auto framebuffer = loaded_it->second.framebuffer.lock();
+		if(framebuffer && loaded_it->second.mtime == source.st_mtime && loaded_it->second.size == source.st_size)
+			return framebuffer;
+	}
+
+	auto framebuffer = map(path_string, source);
+	if(!framebuffer) {
+		auto* png = Gfx::load_png(path_string);
+		if(!png)
+			return Result("Invalid PNG file");
+		framebuffer = Ptr<Framebuffer>(png);
+
+		// Share it with everyone else if it's small enough, and use the shared copy ourselves so that we don't keep two
+		if((size_t) png->width * png->height <= IMAGE_CACHE_MAX_PIXELS && !write(path_string, source, *png).is_error()) {
+			if(auto mapped = map(path_string, source))
+				framebuffer = mapped;
+		}
+	}
+
+	loaded[path_string] = {framebuffer, source.st_mtime, source.st_size};
+	return framebuffer;
+}
+
+Ptr<Framebuffer> ImageCache::map(const std::string& path, const struct stat& source) {
+	int fd = open(cache_path(path).c_str(), O_RDONLY | O_NOFOLLOW);
+	if(fd < 0)
+		return nullptr;
+
+	struct stat statbuf;
+	if(fstat(fd, &statbuf) < 0 || (size_t) statbuf.st_size < sizeof(Header)) {
+		close(fd);
+		return nullptr;
+	}
+
+	// Anyone can write to the cache directory, so only use images that root or we decoded
+	bool trusted_owner = statbuf.st_uid == 0 || statbuf.st_uid == geteuid();
+	if(!S_ISREG(statbuf.st_mode) || !trusted_owner || (statbuf.st_mode & (S_IWGRP | S_IWOTH))) {
+		close(fd);
+		return nullptr;
+	}
+
+	// Mapping the file shared means every process that loads this image uses the same physical pages
+	size_t size = statbuf.st_size;
+	void* mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if(mapping == MAP_FAILED)
+		return nullptr;
+
+	// Make sure everything is in bounds and that the cache is for the same version of the same file
+	auto* header = (const Header*) mapping;
+	size_t header_size = sizeof(Header) + (size_t) header->path_length;
+	bool valid = header->magic == IMAGE_CACHE_MAGIC && header->version == IMAGE_CACHE_VERSION
+			&& header->mtime == source.st_mtime && header->source_size == (uint32_t) source.st_size
+			&& header->width && header->height && (size_t) header->width * header->height <= IMAGE_CACHE_MAX_PIXELS
+			&& header->path_length == path.size() && header_size <= header->data_offset && header->data_offset % 4 == 0
+			&& header->data_offset + IMGSIZE((size_t) header->width, header->height) == size
+			&& !memcmp((const char*) mapping + sizeof(Header), path.c_str(), path.size());
+	if(!valid) {
+		munmap(mapping, size);
+		return nullptr;
+	}
+
+	auto* pixels = (Color*) ((uint8_t*) mapping + header->data_offset);
+	return Ptr<Framebuffer>(new Framebuffer(pixels, (int) header->width, (int) header->height), [mapping, size](Framebuffer* framebuffer) {
+		delete framebuffer;
+		munmap(mapping, size);
+	});
+}
+
+Result ImageCache::write(const std::string& path, const struct stat& source, const Framebuffer& image) {
+	Header header = {
+		.magic = IMAGE_CACHE_MAGIC,
+		.version = IMAGE_CACHE_VERSION,
+		.mtime = source.st_mtime,
+		.source_size = (uint32_t) source.st_size,
+		.width = (uint32_t) image.width,
+		.height = (uint32_t) image.height,
+		.path_length = (uint32_t) path.size(),
+		.data_offset = (uint32_t) ((sizeof(Header) + path.size() + 15) & ~15)
+	};
+
+	// Write to a temporary file first so other processes never see a partially-written image
+	auto cache_file = cache_path(path);
+	auto temp_path = cache_file + "." + std::to_string(getpid());
+	unlink(temp_path.c_str()); // Left over from a process that had the same pid and crashed while writing
+	int fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW, 0644);
+	if(fd < 0)
+		return errno;
+
+	static const char padding[16] = {0};
+	size_t padding_size = header.data_offset - sizeof(Header) - path.size();
+	size_t data_size = IMGSIZE(image.width, image.height);
+	bool success = ::write(fd, &header, sizeof(header)) == sizeof(header)
+			&& ::write(fd, path.c_str(), path.size()) == (ssize_t) path.size()
+			&& ::write(fd, padding, padding_size) == (ssize_t) padding_size
+			&& ::write(fd, image.data, data_size) == (ssize_t) data_size;
+	close(fd);
+
+	if(success) {
+		unlink(cache_file.c_str());
+		success = rename(temp_path.c_str(), cache_file.c_str()) == 0;
+	}
+
+	if(!success) {
+		unlink(temp_path.c_str());
+		return Result("Couldn't write image cache");
+	}
+
+	return Result::SUCCESS;
+}
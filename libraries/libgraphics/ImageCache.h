@@ -0,0 +1,50 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2024 Byteduck */
+
+#pragma once
+
+#include "Framebuffer.h"
+#include <libduck/Path.h>
+#include <libduck/Object.h>
+#include <libduck/Result.h>
+#include <sys/stat.h>
+
+#define IMAGE_CACHE_DIR "/var/cache/images"
+#define IMAGE_CACHE_MAGIC 0x494d4743 // "IMGC"
+#define IMAGE_CACHE_VERSION 1
+// Larger images (wallpapers and the like) are usually only loaded by one process, so they aren't worth caching
+#define IMAGE_CACHE_MAX_PIXELS (512 * 512)
+
+namespace Gfx {
+	/**
+	 * A cache of decoded images shared between processes. Each decoded image is written to a file in IMAGE_CACHE_DIR
+	 * which is mapped read-only and shared by every process that loads the same image, so icons used by many programs
+	 * are only decoded and stored once. Entries are keyed by path, and are only used while the source file's mtime and
+	 * size are unchanged.
+	 */
+	class ImageCache {
+	public:
+		struct Header {
+			uint32_t magic;
+			uint32_t version;
+			int64_t mtime;
+			uint32_t source_size;
+			uint32_t width;
+			uint32_t height;
+			uint32_t path_length; // The source path follows the header
+			uint32_t data_offset; // Offset of the pixels from the start of the file
+		};
+
+		/**
+		 * Loads a PNG, using a cached copy of it if there is one. The returned framebuffer may be shared with other
+		 * users of the cache and must not be modified.
+		 */
+		static Duck::ResultRet<Duck::Ptr<Framebuffer>> load_png(const Duck::Path& path);
+
+		static std::string cache_path(const std::string& path);
+
+	private:
+		static Duck::Ptr<Framebuffer> map(const std::string& path, const struct stat& source);
+		static Duck::Result write(const std::string& path, const struct stat& source, const Framebuffer& image);
+	};
+}
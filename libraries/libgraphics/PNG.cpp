@@ -19,29 +19,27 @@
 
 #include "PNG.h"
 #include <memory.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <libduck/CPU.h>
 #include "Deflate.h"
 #include "Framebuffer.h"
 
-#define abs(a) ((a) < 0 ? -(a) : (a))
-
-uint32_t fget32(FILE* file) {
-	uint32_t d = fgetc(file);
-	uint32_t c = fgetc(file);
-	uint32_t b = fgetc(file);
-	uint32_t a = fgetc(file);
-	return a | (b << 8) | (c << 16) | (d << 24);
-}
+#if defined(__i386__) || defined(__x86_64__)
+#include <emmintrin.h>
+#define PNG_SSE2
+#endif
 
 const uint8_t PNG_HEADER[] = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
 
 #define CHUNK_IHDR 0x49484452
+#define CHUNK_PLTE 0x504c5445
+#define CHUNK_TRNS 0x74524e53
 #define CHUNK_IDAT 0x49444154
 #define CHUNK_IEND 0x49454e44
 
-#define STATE_SCANLINE_BEGIN 1
-#define STATE_READPIXEL 2
-#define STATE_DONE 3
-
 #define PNG_FILTERTYPE_NONE 0
 #define PNG_FILTERTYPE_SUB 1
 #define PNG_FILTERTYPE_UP 2
@@ -54,6 +52,10 @@ const uint8_t PNG_HEADER[] = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
 #define PNG_COLORTYPE_AGRAYSCALE 4
 #define PNG_COLORTYPE_ATRUECOLOR 6
 
+//Images bigger than this are almost certainly corrupt, and would overflow our size calculations
+#define PNG_MAX_DIMENSION 16384
+#define PNG_MAX_PIXELS (64 * 1024 * 1024)
+
 using namespace Gfx;
 
 typedef struct PNG {
@@ -66,317 +68,592 @@ typedef struct PNG {
 		uint8_t filter_method;
 		uint8_t interlace_method;
 	} ihdr;
-	Gfx::Framebuffer* image;
-	FILE* file;
-	uint32_t chunk_size;
-	uint32_t chunk_type;
-
-	uint8_t state;
-	uint8_t pixel_buffer[4];
-	uint8_t pixel_buffer_pos;
-	int pixel_x;
-	int pixel_y;
-	uint8_t scanline_filtertype;
+	uint8_t channels;
+	uint8_t bytes_per_pixel; //Rounded up to one byte, which is what filters work with
+	Color palette[256];
+	bool has_transparent_color;
+	uint16_t transparent_color[3]; //The tRNS color key for grayscale or truecolor images
 } PNG;
 
+//The position and spacing of the pixels in each Adam7 pass
+static const uint8_t adam7_start_x[] = {0, 4, 0, 2, 0, 1, 0};
+static const uint8_t adam7_start_y[] = {0, 0, 4, 0, 2, 0, 1};
+static const uint8_t adam7_step_x[] = {8, 8, 4, 4, 2, 2, 1};
+static const uint8_t adam7_step_y[] = {8, 8, 8, 4, 4, 2, 2};
+
+static inline uint32_t get32(const uint8_t* data) {
+	return ((uint32_t) data[0] << 24) | ((uint32_t) data[1] << 16) | ((uint32_t) data[2] << 8) | data[3];
+}
+
+static inline uint16_t get16(const uint8_t* data) {
+	return (data[0] << 8) | data[1];
+}
+
+static bool use_sse2() {
+	static bool sse2 = Duck::CPU::has_sse2();
+	return sse2;
+}
+
+static inline size_t row_bytes(const PNG& png, uint32_t width) {
+	return ((size_t) width * png.channels * png.ihdr.bit_depth + 7) / 8;
+}
+
+static inline uint32_t pass_width(const PNG& png, int pass) {
+	if(png.ihdr.interlace_method == 0)
+		return png.ihdr.width;
+	return (png.ihdr.width + adam7_step_x[pass] - 1 - adam7_start_x[pass]) / adam7_step_x[pass];
+}
+
+static inline uint32_t pass_height(const PNG& png, int pass) {
+	if(png.ihdr.interlace_method == 0)
+		return png.ihdr.height;
+	return (png.ihdr.height + adam7_step_y[pass] - 1 - adam7_start_y[pass]) / adam7_step_y[pass];
+}
+
 //A, B, or C, whichever is closest to p = A + B − C
-int paeth(int a, int b, int c) {
-	int p = (int) a + (int) b - (int) c;
-	if (abs(p - a) <= abs(p - b) && abs(p - a) <= abs(p - c)) return a;
-	else if (abs(p - b) <= abs(p - c)) return b;
+static inline int paeth(int a, int b, int c) {
+	int pa = b - c;
+	int pb = a - c;
+	int pc = pa + pb;
+	pa = pa < 0 ? -pa : pa;
+	pb = pb < 0 ? -pb : pb;
+	pc = pc < 0 ? -pc : pc;
+	if(pa <= pb && pa <= pc)
+		return a;
+	if(pb <= pc)
+		return b;
 	return c;
 }
 
-void put_pixel(PNG* png, uint32_t color) {
-	IMGPTRPIXEL(png->image, png->pixel_x, png->pixel_y) = color;
-	png->pixel_buffer_pos = 0;
-	png->pixel_x++;
-	if(png->pixel_x == png->ihdr.width) {
-		if(png->pixel_y == png->ihdr.height - 1) {
-			png->state = STATE_DONE;
-		} else {
-			png->state = STATE_SCANLINE_BEGIN;
-			png->pixel_x = 0;
-			png->pixel_y++;
-		}
-	}
+/*
+ * Scanline unfiltering. Sub, Avg and Paeth depend on the previous pixel of the same row, so the vectorized versions
+ * work on one whole pixel at a time (for the common 3 and 4 byte formats), while Up has no such dependency and is done
+ * sixteen bytes at a time. Rows are followed by at least four bytes of readable padding.
+ */
+
+static void unfilter_sub(uint8_t* row, size_t length, size_t bpp) {
+	for(size_t i = bpp; i < length; i++)
+		row[i] += row[i - bpp];
 }
 
-void grayscale_pixel(PNG* png) {
-	uint8_t c = png->pixel_buffer[0];
-
-	if(png->scanline_filtertype == PNG_FILTERTYPE_SUB && png->pixel_x > 0) {
-		Color left_color = IMGPTRPIXEL(png->image, png->pixel_x - 1, png->pixel_y);
-		c += COLOR_R(left_color);
-	} else if(png->scanline_filtertype == PNG_FILTERTYPE_UP && png->pixel_y > 0) {
-		Color up_color = IMGPTRPIXEL(png->image, png->pixel_x, png->pixel_y - 1);
-		c += COLOR_R(up_color);
-	} else if(png->scanline_filtertype == PNG_FILTERTYPE_AVG) {
-		Color left_color = (png->pixel_x > 0) ? IMGPTRPIXEL(png->image, png->pixel_x - 1, png->pixel_y) : Color();
-		Color up_color = (png->pixel_y > 0) ? IMGPTRPIXEL(png->image, png->pixel_x, png->pixel_y - 1) : Color();
-		c += (COLOR_R(up_color) + COLOR_R(left_color)) / 2;
-	} else if(png->scanline_filtertype == PNG_FILTERTYPE_PAETH) {
-		Color left_color = (png->pixel_x > 0) ? IMGPTRPIXEL(png->image, png->pixel_x - 1, png->pixel_y) : Color();
-		Color up_color = (png->pixel_y > 0) ? IMGPTRPIXEL(png->image, png->pixel_x, png->pixel_y - 1) : Color();
-		Color corner_color = (png->pixel_x > 0 && png->pixel_y > 0) ? IMGPTRPIXEL(png->image, png->pixel_x - 1, png->pixel_y - 1) : Color();
-
-		c = ((int) c + paeth(COLOR_R(left_color), COLOR_R(up_color), COLOR_R(corner_color))) % 256;
-	}
+static void unfilter_up(uint8_t* row, const uint8_t* prev, size_t length) {
+	for(size_t i = 0; i < length; i++)
+		row[i] += prev[i];
+}
+
+static void unfilter_avg(uint8_t* row, const uint8_t* prev, size_t length, size_t bpp) {
+	for(size_t i = 0; i < bpp && i < length; i++)
+		row[i] += prev[i] >> 1;
+	for(size_t i = bpp; i < length; i++)
+		row[i] += (row[i - bpp] + prev[i]) >> 1;
+}
+
+static void unfilter_paeth(uint8_t* row, const uint8_t* prev, size_t length, size_t bpp) {
+	for(size_t i = 0; i < bpp && i < length; i++)
+		row[i] += prev[i];
+	for(size_t i = bpp; i < length; i++)
+		row[i] += paeth(row[i - bpp], prev[i], prev[i - bpp]);
+}
+
+#ifdef PNG_SSE2
+
+__attribute__((target("sse2")))
+static inline __m128i load_pixel(const uint8_t* pixel) {
+	int value;
+	memcpy(&value, pixel, 4);
+	return _mm_cvtsi32_si128(value);
+}
 
-	put_pixel(png, RGB(c,c,c));
+__attribute__((target("sse2")))
+static inline void store_pixel(uint8_t* pixel, __m128i value, size_t bpp) {
+	int result = _mm_cvtsi128_si32(value);
+	memcpy(pixel, &result, bpp);
 }
 
-void truecolor_pixel(PNG* png) {
-	uint8_t r = png->pixel_buffer[0];
-	uint8_t g = png->pixel_buffer[1];
-	uint8_t b = png->pixel_buffer[2];
-
-	if(png->scanline_filtertype == PNG_FILTERTYPE_SUB && png->pixel_x > 0) {
-		Color left_color = IMGPTRPIXEL(png->image, png->pixel_x - 1, png->pixel_y);
-		r += COLOR_R(left_color);
-		g += COLOR_G(left_color);
-		b += COLOR_B(left_color);
-	} else if(png->scanline_filtertype == PNG_FILTERTYPE_UP && png->pixel_y > 0) {
-		Color up_color = IMGPTRPIXEL(png->image, png->pixel_x, png->pixel_y - 1);
-		r += COLOR_R(up_color);
-		g += COLOR_G(up_color);
-		b += COLOR_B(up_color);
-	} else if(png->scanline_filtertype == PNG_FILTERTYPE_AVG) {
-		Color left_color = (png->pixel_x > 0) ? IMGPTRPIXEL(png->image, png->pixel_x - 1, png->pixel_y) : Color();
-		Color up_color = (png->pixel_y > 0) ? IMGPTRPIXEL(png->image, png->pixel_x, png->pixel_y - 1) : Color();
-		r += (COLOR_R(up_color) + COLOR_R(left_color)) / 2;
-		g += (COLOR_G(up_color) + COLOR_G(left_color)) / 2;
-		b += (COLOR_B(up_color) + COLOR_B(left_color)) / 2;
-	} else if(png->scanline_filtertype == PNG_FILTERTYPE_PAETH) {
-		Color left_color = (png->pixel_x > 0) ? IMGPTRPIXEL(png->image, png->pixel_x - 1, png->pixel_y) : Color();
-		Color up_color = (png->pixel_y > 0) ? IMGPTRPIXEL(png->image, png->pixel_x, png->pixel_y - 1) : Color();
-		Color corner_color = (png->pixel_x > 0 && png->pixel_y > 0) ? IMGPTRPIXEL(png->image, png->pixel_x - 1, png->pixel_y - 1) : Color();
-
-		r = ((int) r + paeth(COLOR_R(left_color), COLOR_R(up_color), COLOR_R(corner_color))) % 256;
-		g = ((int) g + paeth(COLOR_G(left_color), COLOR_G(up_color), COLOR_G(corner_color))) % 256;
-		b = ((int) b + paeth(COLOR_B(left_color), COLOR_B(up_color), COLOR_B(corner_color))) % 256;
+__attribute__((target("sse2")))
+static void unfilter_up_sse2(uint8_t* row, const uint8_t* prev, size_t length) {
+	size_t i = 0;
+	for(; i + 16 <= length; i += 16) {
+		__m128i cur = _mm_loadu_si128((const __m128i*) (row + i));
+		__m128i up = _mm_loadu_si128((const __m128i*) (prev + i));
+		_mm_storeu_si128((__m128i*) (row + i), _mm_add_epi8(cur, up));
 	}
+	for(; i < length; i++)
+		row[i] += prev[i];
+}
 
-	put_pixel(png, RGB(r,g,b));
+__attribute__((target("sse2")))
+static void unfilter_sub_sse2(uint8_t* row, size_t length, size_t bpp) {
+	__m128i left = _mm_setzero_si128();
+	for(size_t i = 0; i < length; i += bpp) {
+		left = _mm_add_epi8(load_pixel(row + i), left);
+		store_pixel(row + i, left, bpp);
+	}
 }
 
-void alpha_truecolor_pixel(PNG* png) {
-	uint8_t r = png->pixel_buffer[0];
-	uint8_t g = png->pixel_buffer[1];
-	uint8_t b = png->pixel_buffer[2];
-	uint8_t a = png->pixel_buffer[3];
-
-	if(png->scanline_filtertype == PNG_FILTERTYPE_SUB && png->pixel_x > 0) {
-		Color left_color = IMGPTRPIXEL(png->image, png->pixel_x - 1, png->pixel_y);
-		r += COLOR_R(left_color);
-		g += COLOR_G(left_color);
-		b += COLOR_B(left_color);
-		a += COLOR_A(left_color);
-	} else if(png->scanline_filtertype == PNG_FILTERTYPE_UP && png->pixel_y > 0) {
-		Color up_color = IMGPTRPIXEL(png->image, png->pixel_x, png->pixel_y - 1);
-		r += COLOR_R(up_color);
-		g += COLOR_G(up_color);
-		b += COLOR_B(up_color);
-		a += COLOR_A(up_color);
-	} else if(png->scanline_filtertype == PNG_FILTERTYPE_AVG) {
-		Color left_color = (png->pixel_x > 0) ? IMGPTRPIXEL(png->image, png->pixel_x - 1, png->pixel_y) : Color();
-		Color up_color = (png->pixel_y > 0) ? IMGPTRPIXEL(png->image, png->pixel_x, png->pixel_y - 1) : Color();
-		r += (COLOR_R(up_color) + COLOR_R(left_color)) / 2;
-		g += (COLOR_G(up_color) + COLOR_G(left_color)) / 2;
-		b += (COLOR_B(up_color) + COLOR_B(left_color)) / 2;
-		a += (COLOR_A(up_color) + COLOR_A(left_color)) / 2;
-	} else if(png->scanline_filtertype == PNG_FILTERTYPE_PAETH) {
-		Color left_color = (png->pixel_x > 0) ? IMGPTRPIXEL(png->image, png->pixel_x - 1, png->pixel_y) : Color();
-		Color up_color = (png->pixel_y > 0) ? IMGPTRPIXEL(png->image, png->pixel_x, png->pixel_y - 1) : Color();
-		Color corner_color = (png->pixel_x > 0 && png->pixel_y > 0) ? IMGPTRPIXEL(png->image, png->pixel_x - 1, png->pixel_y - 1) : Color();
-
-		r = ((int) r + paeth(COLOR_R(left_color), COLOR_R(up_color), COLOR_R(corner_color))) % 256;
-		g = ((int) g + paeth(COLOR_G(left_color), COLOR_G(up_color), COLOR_G(corner_color))) % 256;
-		b = ((int) b + paeth(COLOR_B(left_color), COLOR_B(up_color), COLOR_B(corner_color))) % 256;
-		a = ((int) a + paeth(COLOR_A(left_color), COLOR_A(up_color), COLOR_A(corner_color))) % 256;
+__attribute__((target("sse2")))
+static void unfilter_avg_sse2(uint8_t* row, const uint8_t* prev, size_t length, size_t bpp) {
+	// _mm_avg_epu8 rounds up, so subtract the low bit that caused the rounding
+	const __m128i one = _mm_set1_epi8(1);
+	__m128i left = _mm_setzero_si128();
+	for(size_t i = 0; i < length; i += bpp) {
+		__m128i up = load_pixel(prev + i);
+		__m128i avg = _mm_sub_epi8(_mm_avg_epu8(left, up), _mm_and_si128(_mm_xor_si128(left, up), one));
+		left = _mm_add_epi8(load_pixel(row + i), avg);
+		store_pixel(row + i, left, bpp);
 	}
+}
+
+__attribute__((target("sse2")))
+static inline __m128i abs_epi16(__m128i value) {
+	return _mm_max_epi16(value, _mm_sub_epi16(_mm_setzero_si128(), value));
+}
 
-	put_pixel(png, RGBA(r,g,b,a));
+__attribute__((target("sse2")))
+static inline __m128i select_epi16(__m128i mask, __m128i a, __m128i b) {
+	return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
 }
 
-void alpha_grayscale_pixel(PNG* png) {
-	uint8_t c = png->pixel_buffer[0];
-	uint8_t a = png->pixel_buffer[1];
-
-	if(png->scanline_filtertype == PNG_FILTERTYPE_SUB && png->pixel_x > 0) {
-		Color left_color = IMGPTRPIXEL(png->image, png->pixel_x - 1, png->pixel_y);
-		c += COLOR_R(left_color);
-		a += COLOR_A(left_color);
-	} else if(png->scanline_filtertype == PNG_FILTERTYPE_UP && png->pixel_y > 0) {
-		Color up_color = IMGPTRPIXEL(png->image, png->pixel_x, png->pixel_y - 1);
-		c += COLOR_R(up_color);
-		a += COLOR_A(up_color);
-	} else if(png->scanline_filtertype == PNG_FILTERTYPE_AVG) {
-		Color left_color = (png->pixel_x > 0) ? IMGPTRPIXEL(png->image, png->pixel_x - 1, png->pixel_y) : Color();
-		Color up_color = (png->pixel_y > 0) ? IMGPTRPIXEL(png->image, png->pixel_x, png->pixel_y - 1) : Color();
-		c += (COLOR_R(up_color) + COLOR_R(left_color)) / 2;
-		a += (COLOR_A(up_color) + COLOR_A(left_color)) / 2;
-	} else if(png->scanline_filtertype == PNG_FILTERTYPE_PAETH) {
-		Color left_color = (png->pixel_x > 0) ? IMGPTRPIXEL(png->image, png->pixel_x - 1, png->pixel_y) : Color();
-		Color up_color = (png->pixel_y > 0) ? IMGPTRPIXEL(png->image, png->pixel_x, png->pixel_y - 1) : Color();
-		Color corner_color = (png->pixel_x > 0 && png->pixel_y > 0) ? IMGPTRPIXEL(png->image, png->pixel_x - 1, png->pixel_y - 1) : Color();
-
-		c = ((int) c + paeth(COLOR_R(left_color), COLOR_R(up_color), COLOR_R(corner_color))) % 256;
-		a = ((int) a + paeth(COLOR_A(left_color), COLOR_A(up_color), COLOR_A(corner_color))) % 256;
+__attribute__((target("sse2")))
+static void unfilter_paeth_sse2(uint8_t* row, const uint8_t* prev, size_t length, size_t bpp) {
+	// Works with 16-bit channels so that the predictor distances can't overflow
+	const __m128i zero = _mm_setzero_si128();
+	__m128i a = zero;
+	__m128i c = zero;
+	for(size_t i = 0; i < length; i += bpp) {
+		__m128i b = _mm_unpacklo_epi8(load_pixel(prev + i), zero);
+		__m128i pa = _mm_sub_epi16(b, c);
+		__m128i pb = _mm_sub_epi16(a, c);
+		__m128i pc = abs_epi16(_mm_add_epi16(pa, pb));
+		pa = abs_epi16(pa);
+		pb = abs_epi16(pb);
+		__m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+		__m128i nearest = select_epi16(_mm_cmpeq_epi16(pa, smallest), a, select_epi16(_mm_cmpeq_epi16(pb, smallest), b, c));
+		__m128i result = _mm_add_epi8(load_pixel(row + i), _mm_packus_epi16(nearest, zero));
+		store_pixel(row + i, result, bpp);
+		a = _mm_unpacklo_epi8(result, zero);
+		c = b;
 	}
+}
 
-	put_pixel(png, RGBA(c,c,c,a));
+#endif
+
+static bool unfilter_row(uint8_t filter, uint8_t* row, const uint8_t* prev, size_t length, size_t bpp) {
+#ifdef PNG_SSE2
+	bool sse2 = use_sse2();
+	bool sse2_pixels = sse2 && (bpp == 3 || bpp == 4);
+#endif
+
+	switch(filter) {
+		case PNG_FILTERTYPE_NONE:
+			return true;
+		case PNG_FILTERTYPE_SUB:
+#ifdef PNG_SSE2
+			if(sse2_pixels)
+				unfilter_sub_sse2(row, length, bpp);
+			else
+#endif
+				unfilter_sub(row, length, bpp);
+			return true;
+		case PNG_FILTERTYPE_UP:
+#ifdef PNG_SSE2
+			if(sse2)
+				unfilter_up_sse2(row, prev, length);
+			else
+#endif
+				unfilter_up(row, prev, length);
+			return true;
+		case PNG_FILTERTYPE_AVG:
+#ifdef PNG_SSE2
+			if(sse2_pixels)
+				unfilter_avg_sse2(row, prev, length, bpp);
+			else
+#endif
+				unfilter_avg(row, prev, length, bpp);
+			return true;
+		case PNG_FILTERTYPE_PAETH:
+#ifdef PNG_SSE2
+			if(sse2_pixels)
+				unfilter_paeth_sse2(row, prev, length, bpp);
+			else
+#endif
+				unfilter_paeth(row, prev, length, bpp);
+			return true;
+		default:
+			return false;
+	}
 }
 
-void png_write(uint8_t byte, void* png_void) {
-	PNG* png = (PNG*) png_void;
-
-	//Start of a scanline, use the byte as the
-	if(png->state == STATE_SCANLINE_BEGIN) {
-		png->scanline_filtertype = byte;
-		png->state = STATE_READPIXEL;
-	} else if(png->state == STATE_READPIXEL) {
-		png->pixel_buffer[png->pixel_buffer_pos++] = byte;
-		if(png->pixel_buffer_pos == 1 && png->ihdr.color_type == PNG_COLORTYPE_GRAYSCALE) {
-			grayscale_pixel(png);
-		} else if(png->pixel_buffer_pos == 3 && png->ihdr.color_type == PNG_COLORTYPE_TRUECOLOR) {
-			truecolor_pixel(png);
-		} else if(png->pixel_buffer_pos == 2 && png->ihdr.color_type == PNG_COLORTYPE_AGRAYSCALE) {
-			alpha_grayscale_pixel(png);
-		} else if(png->pixel_buffer_pos == 4 && png->ihdr.color_type == PNG_COLORTYPE_ATRUECOLOR) {
-			alpha_truecolor_pixel(png);
+/*
+ * Pixel conversion. Each of these turns one unfiltered scanline into Colors.
+ */
+
+//Gets a sample from a row of samples smaller than a byte, which are packed most significant bits first
+static inline uint8_t packed_sample(const uint8_t* row, size_t index, uint8_t depth) {
+	size_t bit = index * depth;
+	return (row[bit / 8] >> (8 - depth - (bit % 8))) & ((1u << depth) - 1);
+}
+
+#ifdef PNG_SSE2
+__attribute__((target("sse2")))
+static size_t convert_rgba8_sse2(const uint8_t* row, Color* out, size_t count) {
+	//Swap the red and blue channels of four pixels at a time
+	const __m128i green_alpha = _mm_set1_epi32((int) 0xFF00FF00);
+	const __m128i low_byte = _mm_set1_epi32(0xFF);
+	size_t i = 0;
+	for(; i + 4 <= count; i += 4) {
+		__m128i pixels = _mm_loadu_si128((const __m128i*) (row + i * 4));
+		__m128i swapped = _mm_or_si128(
+				_mm_and_si128(pixels, green_alpha),
+				_mm_or_si128(
+						_mm_slli_epi32(_mm_and_si128(pixels, low_byte), 16),
+						_mm_and_si128(_mm_srli_epi32(pixels, 16), low_byte)));
+		_mm_storeu_si128((__m128i*) (out + i), swapped);
+	}
+	return i;
+}
+#endif
+
+static void convert_rgba8(const uint8_t* row, Color* out, size_t count) {
+	size_t i = 0;
+#ifdef PNG_SSE2
+	if(use_sse2())
+		i = convert_rgba8_sse2(row, out, count);
+#endif
+	for(; i < count; i++) {
+		const uint8_t* pixel = row + i * 4;
+		out[i] = RGBA(pixel[0], pixel[1], pixel[2], pixel[3]);
+	}
+}
+
+static void convert_row(const PNG& png, const uint8_t* row, Color* out, size_t count) {
+	uint8_t depth = png.ihdr.bit_depth;
+	switch(png.ihdr.color_type) {
+		case PNG_COLORTYPE_ATRUECOLOR:
+			if(depth == 8) {
+				convert_rgba8(row, out, count);
+			} else {
+				for(size_t i = 0; i < count; i++, row += 8)
+					out[i] = RGBA(row[0], row[2], row[4], row[6]);
+			}
+			break;
+
+		case PNG_COLORTYPE_TRUECOLOR: {
+			size_t pixel_size = depth == 8 ? 3 : 6;
+			for(size_t i = 0; i < count; i++, row += pixel_size) {
+				if(depth == 8) {
+					out[i] = RGB(row[0], row[1], row[2]);
+					if(png.has_transparent_color && row[0] == png.transparent_color[0] && row[1] == png.transparent_color[1] && row[2] == png.transparent_color[2])
+						out[i].a = 0;
+				} else {
+					out[i] = RGB(row[0], row[2], row[4]);
+					if(png.has_transparent_color && get16(row) == png.transparent_color[0] && get16(row + 2) == png.transparent_color[1] && get16(row + 4) == png.transparent_color[2])
+						out[i].a = 0;
+				}
+			}
+			break;
+		}
+
+		case PNG_COLORTYPE_GRAYSCALE: {
+			for(size_t i = 0; i < count; i++) {
+				uint16_t sample;
+				uint8_t value;
+				if(depth == 16) {
+					sample = get16(row + i * 2);
+					value = sample >> 8;
+				} else if(depth == 8) {
+					sample = value = row[i];
+				} else {
+					sample = packed_sample(row, i, depth);
+					value = sample * 255 / ((1u << depth) - 1);
+				}
+				out[i] = RGB(value, value, value);
+				if(png.has_transparent_color && sample == png.transparent_color[0])
+					out[i].a = 0;
+			}
+			break;
 		}
+
+		case PNG_COLORTYPE_AGRAYSCALE:
+			for(size_t i = 0; i < count; i++) {
+				if(depth == 8)
+					out[i] = RGBA(row[i * 2], row[i * 2], row[i * 2], row[i * 2 + 1]);
+				else
+					out[i] = RGBA(row[i * 4], row[i * 4], row[i * 4], row[i * 4 + 2]);
+			}
+			break;
+
+		case PNG_COLORTYPE_INDEXED:
+			for(size_t i = 0; i < count; i++)
+				out[i] = png.palette[depth == 8 ? row[i] : packed_sample(row, i, depth)];
+			break;
 	}
 }
 
-uint8_t png_read(void* png_void) {
-	PNG* png = (PNG*) png_void;
-	if(png->chunk_size == 0) {
-		//Reached end of IDAT, read next one
-		fget32(png->file); //Ignore CRC
-		png->chunk_size = fget32(png->file);
-		png->chunk_type = fget32(png->file);
-		if(png->chunk_type != CHUNK_IDAT)
-			fprintf(stderr, "PNG: encountered non-IDAT chunk in middle of file, continuing anyway...\n");
+static bool read_ihdr(PNG& png, const uint8_t* data, uint32_t size) {
+	if(size < 13) {
+		fprintf(stderr, "PNG: Invalid IHDR chunk\n");
+		return false;
 	}
-	png->chunk_size--;
-	return fgetc(png->file);
+
+	png.ihdr.width = get32(data);
+	png.ihdr.height = get32(data + 4);
+	png.ihdr.bit_depth = data[8];
+	png.ihdr.color_type = data[9];
+	png.ihdr.compression_method = data[10];
+	png.ihdr.filter_method = data[11];
+	png.ihdr.interlace_method = data[12];
+
+	//Check IHDR parameters
+	uint8_t depth = png.ihdr.bit_depth;
+	bool valid_depth;
+	switch(png.ihdr.color_type) {
+		case PNG_COLORTYPE_GRAYSCALE:
+			png.channels = 1;
+			valid_depth = depth == 1 || depth == 2 || depth == 4 || depth == 8 || depth == 16;
+			break;
+		case PNG_COLORTYPE_TRUECOLOR:
+			png.channels = 3;
+			valid_depth = depth == 8 || depth == 16;
+			break;
+		case PNG_COLORTYPE_INDEXED:
+			png.channels = 1;
+			valid_depth = depth == 1 || depth == 2 || depth == 4 || depth == 8;
+			break;
+		case PNG_COLORTYPE_AGRAYSCALE:
+			png.channels = 2;
+			valid_depth = depth == 8 || depth == 16;
+			break;
+		case PNG_COLORTYPE_ATRUECOLOR:
+			png.channels = 4;
+			valid_depth = depth == 8 || depth == 16;
+			break;
+		default:
+			fprintf(stderr, "PNG: Invalid color type %d\n", png.ihdr.color_type);
+			return false;
+	}
+	if(!valid_depth) {
+		fprintf(stderr, "PNG: Invalid bit depth %d for color type %d\n", depth, png.ihdr.color_type);
+		return false;
+	}
+	if(png.ihdr.compression_method != 0) {
+		fprintf(stderr, "PNG: Invalid compression method %d\n", png.ihdr.compression_method);
+		return false;
+	}
+	if(png.ihdr.filter_method != 0) {
+		fprintf(stderr, "PNG: Invalid filter method %d\n", png.ihdr.filter_method);
+		return false;
+	}
+	if(png.ihdr.interlace_method != 0 && png.ihdr.interlace_method != 1) {
+		fprintf(stderr, "PNG: Invalid interlace method %d\n", png.ihdr.interlace_method);
+		return false;
+	}
+	if(!png.ihdr.width || !png.ihdr.height || png.ihdr.width > PNG_MAX_DIMENSION || png.ihdr.height > PNG_MAX_DIMENSION
+		|| png.ihdr.width * png.ihdr.height > PNG_MAX_PIXELS) {
+		fprintf(stderr, "PNG: Unsupported dimensions %lux%lu\n", png.ihdr.width, png.ihdr.height);
+		return false;
+	}
+
+	png.bytes_per_pixel = (png.channels * depth + 7) / 8;
+	return true;
 }
 
-Framebuffer* Gfx::load_png_from_file(FILE* file) {
+static void read_trns(PNG& png, const uint8_t* data, uint32_t size) {
+	switch(png.ihdr.color_type) {
+		case PNG_COLORTYPE_INDEXED:
+			for(uint32_t i = 0; i < size && i < 256; i++)
+				png.palette[i].a = data[i];
+			break;
+		case PNG_COLORTYPE_GRAYSCALE:
+			if(size >= 2) {
+				png.has_transparent_color = true;
+				png.transparent_color[0] = get16(data);
+			}
+			break;
+		case PNG_COLORTYPE_TRUECOLOR:
+			if(size >= 6) {
+				png.has_transparent_color = true;
+				for(int i = 0; i < 3; i++)
+					png.transparent_color[i] = get16(data + i * 2);
+			}
+			break;
+		default:
+			break;
+	}
+}
+
+Framebuffer* Gfx::load_png_from_memory(const uint8_t* data, size_t size) {
 	//Read the header
-	fseek(file, 0, SEEK_SET);
-	uint8_t header[8];
-	fread(header, 8, 1, file);
-	if(memcmp(header, PNG_HEADER, 8) != 0) {
+	if(size < 8 || memcmp(data, PNG_HEADER, 8) != 0) {
 		fprintf(stderr, "PNG: Invalid file header!\n");
 		return NULL;
 	}
 
 	PNG png;
-	png.file = file;
-	png.pixel_buffer_pos = 0;
-	png.pixel_x = 0;
-	png.pixel_y = 0;
-	png.state = STATE_SCANLINE_BEGIN;
+	memset(&png, 0, sizeof(PNG));
+	for(auto& color : png.palette)
+		color = RGB(0, 0, 0);
+
+	//The decompressed image data: every scanline of every pass, each with a leading filter type byte
+	uint8_t* raw = NULL;
+	size_t raw_size = 0;
+	size_t raw_written = 0;
+	INFLATE* inflater = NULL;
+	int inflate_status = INFLATE_NEEDS_INPUT;
+	auto fail = [&]() -> Framebuffer* {
+		delete[] raw;
+		delete inflater;
+		return NULL;
+	};
 
 	//Read the chunks
+	size_t offset = 8;
 	size_t chunk = 0;
-	while(1) {
-		png.chunk_size = fget32(file);
-		png.chunk_type = fget32(file);
-		if(feof(file) || png.state == STATE_DONE)
-			break;
+	while(offset + 12 <= size) {
+		uint32_t chunk_size = get32(data + offset);
+		uint32_t chunk_type = get32(data + offset + 4);
+		const uint8_t* chunk_data = data + offset + 8;
+		if(chunk_size > size - offset - 12) {
+			fprintf(stderr, "PNG: Chunk extends past end of file\n");
+			return fail();
+		}
+		offset += chunk_size + 12; //Size, type, data, and CRC
 
-		if(chunk == 0 && png.chunk_type != CHUNK_IHDR) {
-			fprintf(stderr, "PNG: No IHDR chunk 0x%lx\n", png.chunk_type);
-			return NULL;
+		if(chunk == 0 && chunk_type != CHUNK_IHDR) {
+			fprintf(stderr, "PNG: No IHDR chunk 0x%lx\n", chunk_type);
+			return fail();
 		} else if(chunk == 0) {
-			//Read IHDR
-			png.ihdr.width = fget32(file);
-			png.ihdr.height = fget32(file);
-			png.ihdr.bit_depth = fgetc(file);
-			png.ihdr.color_type = fgetc(file);
-			png.ihdr.compression_method = fgetc(file);
-			png.ihdr.filter_method = fgetc(file);
-			png.ihdr.interlace_method = fgetc(file);
-
-			//Check IHDR parameters
-			if(png.ihdr.bit_depth != 1 && png.ihdr.bit_depth != 2 && png.ihdr.bit_depth != 4 && png.ihdr.bit_depth != 8 && png.ihdr.bit_depth != 16) {
-				fprintf(stderr, "PNG: Invalid bit depth %d\n", png.ihdr.bit_depth);
-				return NULL;
+			if(!read_ihdr(png, chunk_data, chunk_size))
+				return fail();
+
+			int num_passes = png.ihdr.interlace_method ? 7 : 1;
+			for(int pass = 0; pass < num_passes; pass++) {
+				uint32_t width = pass_width(png, pass);
+				uint32_t height = pass_height(png, pass);
+				if(width && height)
+					raw_size += (row_bytes(png, width) + 1) * height;
 			}
-			if(png.ihdr.color_type != 0 && png.ihdr.color_type != 2 && png.ihdr.color_type != 4 && png.ihdr.color_type != 6) {
-				if(png.ihdr.color_type == 3)
-					fprintf(stderr, "PNG: Indexed color is not supported!\n");
-				else
-					fprintf(stderr, "PNG: Invalid color type %d\n", png.ihdr.color_type);
-				return NULL;
-			}
-			if(png.ihdr.compression_method != 0) {
-				fprintf(stderr, "PNG: Invalid compression method %d\n", png.ihdr.compression_method);
-				return NULL;
-			}
-			if(png.ihdr.filter_method != 0) {
-				fprintf(stderr, "PNG: Invalid filter method %d\n", png.ihdr.filter_method);
-				return NULL;
-			}
-			if(png.ihdr.interlace_method != 0 && png.ihdr.interlace_method != 1) {
-				fprintf(stderr, "PNG: Invalid interlace method %d\n", png.ihdr.interlace_method);
-				return NULL;
-			}
-			if(png.ihdr.interlace_method == 1) {
-				fprintf(stderr, "PNG: Adam7 interlacing not supported yet!\n");
-				return NULL;
+			//Padding lets the unfiltering read a whole pixel at a time
+			raw = new uint8_t[raw_size + 16];
+			memset(raw + raw_size, 0, 16);
+			inflater = new INFLATE;
+			inflate_init(inflater, 1);
+		} else if(chunk_type == CHUNK_PLTE) {
+			for(uint32_t i = 0; i < chunk_size / 3 && i < 256; i++)
+				png.palette[i] = RGB(chunk_data[i * 3], chunk_data[i * 3 + 1], chunk_data[i * 3 + 2]);
+		} else if(chunk_type == CHUNK_TRNS) {
+			read_trns(png, chunk_data, chunk_size);
+		} else if(chunk_type == CHUNK_IDAT) {
+			//The image data is a single zlib stream split across all of the IDAT chunks, decompressed straight from the file
+			if(inflate_status == INFLATE_DONE)
+				continue;
+			size_t in_used, out_written;
+			inflate_status = inflate_stream(inflater, chunk_data, chunk_size, &in_used, raw + raw_written, raw_size - raw_written, &out_written);
+			raw_written += out_written;
+			if(inflate_status == INFLATE_ERROR) {
+				fprintf(stderr, "PNG: Invalid image data\n");
+				return fail();
 			}
+			//If there's more data than the image needs, ignore it
+			if(inflate_status == INFLATE_NEEDS_OUTPUT)
+				inflate_status = INFLATE_DONE;
+		} else if(chunk_type == CHUNK_IEND) {
+			break;
+		}
 
-			//Allocate framebuffer space
-			png.image = new Framebuffer(png.ihdr.width, png.ihdr.height);
-			//Skip unused bytes
-			for(size_t i = 13; i < png.chunk_size; i++)
-				fgetc(file);
-		} else if(png.chunk_type == CHUNK_IDAT) {
-			uint8_t zlib_method = fgetc(file);
-			if((zlib_method & 0xFu) != 0x8) {
-				fprintf(stderr, "PNG: Unsupported zlib compression type 0x%x\n!", zlib_method & 0xFu);
-				free(png.image->data);
-				return NULL;
-			}
-			uint8_t zlib_flags = fgetc(file);
-			if(zlib_flags & 0x20u) {
-				fprintf(stderr, "PNG: zlib presets are not supported.\n");
-				free(png.image->data);
-				return NULL;
+		chunk++;
+	}
+
+	if(!raw || raw_written != raw_size) {
+		fprintf(stderr, "PNG: Not enough image data\n");
+		return fail();
+	}
+
+	//Unfilter each pass and put its pixels in place
+	auto* image = new Framebuffer(png.ihdr.width, png.ihdr.height);
+	auto* zero_row = new uint8_t[row_bytes(png, png.ihdr.width) + 16]();
+	auto* pixel_row = png.ihdr.interlace_method ? new Color[png.ihdr.width] : NULL;
+	uint8_t* row = raw;
+	bool valid = true;
+	int num_passes = png.ihdr.interlace_method ? 7 : 1;
+	for(int pass = 0; pass < num_passes && valid; pass++) {
+		uint32_t width = pass_width(png, pass);
+		uint32_t height = pass_height(png, pass);
+		if(!width || !height)
+			continue;
+
+		size_t length = row_bytes(png, width);
+		const uint8_t* prev = zero_row;
+		for(uint32_t y = 0; y < height; y++) {
+			uint8_t filter = row[0];
+			uint8_t* scanline = row + 1;
+			if(!unfilter_row(filter, scanline, prev, length, png.bytes_per_pixel)) {
+				fprintf(stderr, "PNG: Invalid filter type %d\n", filter);
+				valid = false;
+				break;
 			}
 
-			png.chunk_size -= 2;
+			if(png.ihdr.interlace_method) {
+				convert_row(png, scanline, pixel_row, width);
+				uint32_t image_y = adam7_start_y[pass] + y * adam7_step_y[pass];
+				for(uint32_t x = 0; x < width; x++)
+					image->data[adam7_start_x[pass] + x * adam7_step_x[pass] + image_y * png.ihdr.width] = pixel_row[x];
+			} else {
+				convert_row(png, scanline, image->data + y * png.ihdr.width, width);
+			}
 
-			auto* def = new DEFLATE;
-			def->arg = &png;
-			def->write = png_write;
-			def->read = png_read;
-			decompress(def);
-			delete def;
-		} else if(png.chunk_type == CHUNK_IEND) {
-			break;
-		} else {
-			//Since fseek() clears the read buffer, this is usually faster
-			for(uint32_t i = 0; i < png.chunk_size; i++)
-				fgetc(file);
+			prev = scanline;
+			row += length + 1;
 		}
+	}
 
-		fget32(file); //Skip CRC
-		chunk++;
+	delete[] pixel_row;
+	delete[] zero_row;
+	delete[] raw;
+	delete inflater;
+	if(!valid) {
+		delete image;
+		return NULL;
+	}
+	return image;
+}
+
+static Framebuffer* load_png_from_fd(int fd) {
+	struct stat statbuf;
+	if(fstat(fd, &statbuf) < 0 || statbuf.st_size <= 0)
+		return NULL;
+	size_t size = statbuf.st_size;
+
+	//Map the file so the image data can be decompressed without copying it first, and read it if that doesn't work
+	void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if(data != MAP_FAILED) {
+		auto* ret = load_png_from_memory((const uint8_t*) data, size);
+		munmap(data, size);
+		return ret;
 	}
 
-	return png.image;
+	auto* buffer = new uint8_t[size];
+	size_t nread = 0;
+	while(nread < size) {
+		ssize_t res = pread(fd, buffer + nread, size - nread, nread);
+		if(res <= 0)
+			break;
+		nread += res;
+	}
+	auto* ret = load_png_from_memory(buffer, nread);
+	delete[] buffer;
+	return ret;
+}
+
+Framebuffer* Gfx::load_png_from_file(FILE* file) {
+	return load_png_from_fd(fileno(file));
 }
 
 Framebuffer* Gfx::load_png(const std::string& filename) {
-	auto* file = fopen(filename.c_str(), "r");
-	if(!file)
+	int fd = open(filename.c_str(), O_RDONLY);
+	if(fd < 0)
 		return nullptr;
-	auto* ret = load_png_from_file(file);
-	fclose(file);
+	auto* ret = load_png_from_fd(fd);
+	close(fd);
 	return ret;
-}
\ No newline at end of file
+}
@@ -29,6 +29,7 @@
 __DECL_BEGIN
 
 namespace Gfx {
+	Gfx::Framebuffer* load_png_from_memory(const uint8_t* data, size_t size);
 	Gfx::Framebuffer* load_png_from_file(FILE* file);
 	Gfx::Framebuffer* load_png(const std::string& filename);
 }
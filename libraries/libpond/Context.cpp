@@ -80,6 +80,7 @@ Context::Context(std::shared_ptr<Endpoint> endpt): endpoint(std::move(endpt)) {
 	GET_FUNC(move_window, void, WindowMovePkt, move_window);
 	GET_FUNC(resize_window, WindowResizedPkt, WindowResizePkt, resize_window);
 	GET_FUNC(invalidate_window, bool, WindowInvalidatePkt, invalidate_window);
+	GET_FUNC(scroll_window, bool, WindowScrollPkt, scroll_window);
 	GET_FUNC(get_font, FontResponsePkt, GetFontPkt, get_font);
 	GET_FUNC(set_title, void, SetTitlePkt, set_title);
 	GET_FUNC(reparent, void, WindowReparentPkt, reparent);
@@ -89,6 +90,7 @@ Context::Context(std::shared_ptr<Endpoint> endpt): endpoint(std::move(endpt)) {
 	GET_FUNC(set_app_info, void, App::Info, set_app_info);
 	GET_FUNC(focus_window, void, WindowFocusPkt, focus_window);
 	GET_FUNC(set_minimum_size, void, WindowMinSizePkt, set_minimum_size);
+	GET_FUNC(get_frame_stats, FrameStatsPkt, GetFrameStatsPkt, get_frame_stats);
 }
 
 void Context::read_events(bool block) {
@@ -336,3 +338,7 @@ Gfx::Dimensions Context::get_display_dimensions() {
 void Context::set_app_info(App::Info& info) {
 	__river_set_app_info(info);
 }
+
+FrameStatsPkt Context::get_frame_stats() {
+	return __river_get_frame_stats({});
+}
@@ -96,6 +96,11 @@ namespace Pond {
 		 */
 		void set_app_info(App::Info& info);
 
+		/**
+		 * Gets timing statistics for the frames pond has painted.
+		 */
+		FrameStatsPkt get_frame_stats();
+
 	private:
 		friend class Window;
 		explicit Context(std::shared_ptr<River::Endpoint> endpoint);
@@ -125,6 +130,7 @@ namespace Pond {
 		PONDFUNC(move_window, void, WindowMovePkt);
 		PONDFUNC(resize_window, WindowResizedPkt, WindowResizePkt);
 		PONDFUNC(invalidate_window, bool, WindowInvalidatePkt);
+		PONDFUNC(scroll_window, bool, WindowScrollPkt);
 		PONDFUNC(get_font, FontResponsePkt, GetFontPkt);
 		PONDFUNC(set_title, void, SetTitlePkt);
 		PONDFUNC(reparent, void, WindowReparentPkt);
@@ -134,6 +140,7 @@ namespace Pond {
 		PONDFUNC(set_app_info, void, App::Info);
 		PONDFUNC(focus_window, void, WindowFocusPkt);
 		PONDFUNC(set_minimum_size, void, WindowMinSizePkt);
+		PONDFUNC(get_frame_stats, FrameStatsPkt, GetFrameStatsPkt);
 	};
 }
 
@@ -40,6 +40,10 @@ void Window::invalidate_area(Gfx::Rect area) {
 	_flipped = _context->__river_invalidate_window({_id, area});
 }
 
+void Window::scroll_area(Gfx::Rect area, Gfx::Point delta, Gfx::Rect damage) {
+	_flipped = _context->__river_scroll_window({_id, area, delta, damage});
+}
+
 void Window::resize(Gfx::Dimensions dims) {
 	auto resp = _context->__river_resize_window({_id, dims});
 	Event evt;
@@ -117,6 +121,10 @@ Framebuffer Window::framebuffer() const {
 	return {(Gfx::Color*) _shm.ptr + (_flipped ? 0 : _rect.width * _rect.height), _rect.width, _rect.height};
 }
 
+Framebuffer Window::front_framebuffer() const {
+	return {(Gfx::Color*) _shm.ptr + (_flipped ? _rect.width * _rect.height : 0), _rect.width, _rect.height};
+}
+
 unsigned int Window::mouse_buttons() const {
 	return _mouse_buttons;
 }
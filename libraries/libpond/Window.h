@@ -62,6 +62,16 @@ namespace Pond {
 		 */
 		void invalidate_area(Gfx::Rect area);
 
+		/**
+		 * Tells the compositor that the contents of an area of the window moved, so that it can move what's already
+		 * on the screen instead of redrawing it. The contents of the framebuffer must already be moved, and whatever
+		 * was scrolled into view drawn.
+		 * @param area The area of the window that was scrolled.
+		 * @param delta How far the contents of the area moved.
+		 * @param damage Anything else in the window that needs to be redrawn, or an empty rect if nothing does.
+		 */
+		void scroll_area(Gfx::Rect area, Gfx::Point delta, Gfx::Rect damage);
+
 		/**
 		 * Resizes a window.
 		 * @param dims The new dimensions of the window.
@@ -171,6 +181,13 @@ namespace Pond {
 		 */
 		Gfx::Framebuffer framebuffer() const;
 
+		/**
+		 * Gets the window's active framebuffer (the one last submitted to the compositor and currently displayed).
+		 * This should only be read from, to bring the inactive framebuffer up to date before a partial redraw.
+		 * @return The front framebuffer of the window.
+		 */
+		Gfx::Framebuffer front_framebuffer() const;
+
 		/**
 		 * Gets the current mouse buttons of the window.
 		 * @return The current mouse buttons of the window.
@@ -62,6 +62,13 @@ namespace Pond {
 		Gfx::Rect area;
 	};
 
+	struct WindowScrollPkt {
+		int window_id;
+		Gfx::Rect area; ///< The area of the window being scrolled.
+		Gfx::Point delta; ///< How far its contents moved.
+		Gfx::Rect damage; ///< Anything else in the window that changed and needs to be redrawn.
+	};
+
 	struct MouseMovePkt {
 		int window_id;
 		Gfx::Point delta;
@@ -136,6 +143,23 @@ namespace Pond {
 		int window_id;
 		Gfx::Dimensions minimum_size;
 	};
+
+	struct GetFrameStatsPkt {
+		int display; ///< Unused
+	};
+
+	struct FrameStatsPkt {
+		uint32_t refresh_rate; ///< How many times a second the display's frame clock ticks.
+		uint32_t frames; ///< The number of frames painted.
+		uint32_t missed_frames; ///< The number of frames that weren't flipped until after the next one started.
+		uint32_t last_paint_usec; ///< How long it took to paint the last frame.
+		uint32_t average_paint_usec; ///< A running average of how long frames take to paint.
+		uint32_t max_paint_usec; ///< The longest any frame has taken to paint.
+		uint32_t average_latency_usec; ///< A running average of the time from a frame starting to it being flipped.
+		uint32_t input_frames; ///< The number of frames that showed the effects of input, like the cursor moving.
+		uint32_t average_input_latency_usec; ///< A running average of the time from input being read to it being shown.
+		uint32_t max_input_latency_usec; ///< The longest it has taken for input to be shown.
+	};
 }
 
 
@@ -83,8 +83,14 @@ ResultRet<std::shared_ptr<Endpoint>> BusConnection::get_endpoint(const std::stri
 		Log::err("[River] Error getting endpoint ", name, ": ", error_str(packet.error));
 		return Result(packet.error);
 	}
-	auto ret = std::make_shared<Endpoint>(shared_from_this(), name, Endpoint::PROXY);
+	pid_t host_pid = 0;
+	if(packet.data.size() == sizeof(pid_t))
+		memcpy(&host_pid, packet.data.data(), sizeof(pid_t));
+	auto ret = std::make_shared<Endpoint>(shared_from_this(), name, Endpoint::PROXY, host_pid);
 	_endpoints[name] = ret;
+
+	//Calls go through the bus server until the host answers with a channel, so we don't have to wait on it here
+	send_packet({OPEN_CHANNEL, name});
 	return ret;
 }
 
@@ -92,18 +98,43 @@ Result BusConnection::send_packet(const RiverPacket& packet) {
 	return River::send_packet(_fd, SOCKETFS_RECIPIENT_HOST, packet);
 }
 
-void BusConnection::read_all_packets(bool block) {
-	if(block) {
-		struct pollfd pfd = {_fd, POLLIN, 0};
-		poll(&pfd, 1, -1);
+Result BusConnection::send_call(const std::string& endpoint, const RiverPacket& packet) {
+	//Remember who the call is waiting on, so that it can be failed if they go away without returning
+	if(packet.sequence)
+		_pending_calls[packet.sequence] = endpoint;
+
+	//Only calls by ID can go over a channel, since the host doesn't get told the names of what's sent over one
+	if(packet.target_id) {
+		//A host that isn't reading its channel might never make room in it, so go through the bus server instead
+		auto channel_it = _channels.find(endpoint);
+		if(channel_it != _channels.end() && channel_it->second->send(packet, false).is_success())
+			return Result::SUCCESS;
+	}
+	return send_packet(packet);
+}
+
+Result BusConnection::send_return(const RiverPacket& packet) {
+	if(packet.target_id) {
+		//Don't wait on a client that isn't reading its returns; the bus server can hold onto it instead
+		auto channel_it = _client_channels.find(packet.recipient);
+		if(channel_it != _client_channels.end() && channel_it->second->send(packet, false).is_success())
+			return Result::SUCCESS;
 	}
+	return send_packet(packet);
+}
+
+void BusConnection::read_all_packets(bool block) {
+	if(block)
+		wait_for_packets();
 	while(read_packet(false) != NO_PACKET);
 }
 
 void BusConnection::read_and_handle_packets(bool block) {
 	read_all_packets(_packet_queue.empty() ? block : false);
 	while(!_packet_queue.empty()) {
-		auto& pkt = _packet_queue.front();
+		//Handling a packet can wait on others and take them out of the queue, so take this one out first
+		auto pkt = std::move(_packet_queue.front());
+		_packet_queue.pop_front();
 
 		switch(pkt.type) {
 			case FUNCTION_CALL:
@@ -122,11 +153,13 @@ void BusConnection::read_and_handle_packets(bool block) {
 				handle_message(pkt);
 				break;
 
+			case OPEN_CHANNEL:
+				handle_open_channel(pkt);
+				break;
+
 			default:
 				Log::err("[River] Unhandled packet type ", pkt.type);
 		}
-
-		_packet_queue.pop_front();
 	}
 }
 
@@ -135,31 +168,131 @@ int BusConnection::file_descriptor() {
 }
 
 PacketReadResult BusConnection::read_packet(bool block) {
-	auto pkt_res = River::receive_packet(_fd, block);
+	if(block)
+		wait_for_packets();
+
+	//Channels are read first, so that everything a client sent over one is read before we hear that it disconnected
+	bool read_channels = read_channel_packets();
+	auto pkt_res = River::receive_packet(_fd, false);
 	if(pkt_res.is_error())
-		return static_cast<PacketReadResult>(pkt_res.code());
-	_packet_queue.push_back(pkt_res.value());
+		return read_channels ? PACKET_READ : static_cast<PacketReadResult>(pkt_res.code());
+	queue_packet(std::move(pkt_res.value()));
 	return PACKET_READ;
 }
 
+void BusConnection::wait_for_packets() {
+	std::vector<struct pollfd> pfds = {{_fd, POLLIN, 0}};
+	for(auto& channel : _channels)
+		pfds.push_back({channel.second->poll_fd(), POLLIN, 0});
+	for(auto& channel : _client_channels)
+		pfds.push_back({channel.second->poll_fd(), POLLIN, 0});
+	poll(pfds.data(), pfds.size(), -1);
+}
+
+bool BusConnection::read_channel_packets() {
+	bool read = false;
+	for(auto& channel : _channels)
+		read |= read_channel(channel.second);
+	for(auto& channel : _client_channels)
+		read |= read_channel(channel.second);
+	return read;
+}
+
+bool BusConnection::read_channel(const Duck::Ptr<Channel>& channel) {
+	bool read = false;
+	while(true) {
+		auto pkt_res = channel->receive();
+		if(pkt_res.code() == NO_PACKET)
+			return read;
+		if(pkt_res.is_error())
+			continue;
+		queue_packet(std::move(pkt_res.value()));
+		read = true;
+	}
+}
+
+void BusConnection::queue_packet(RiverPacket packet) {
+	//Returns are set aside for whoever's waiting on them, instead of going through the queue
+	if(packet.type == FUNCTION_RETURN && packet.sequence) {
+		_pending_calls.erase(packet.sequence);
+		_returns[packet.sequence] = std::move(packet);
+	} else if(packet.type == ENDPOINT_DISCONNECTED) {
+		//Handled right away, since whoever's waiting on a return from the endpoint isn't handling the queue
+		handle_endpoint_disconnected(packet);
+	} else {
+		_packet_queue.push_back(std::move(packet));
+	}
+}
+
 RiverPacket BusConnection::await_packet(PacketType type, const std::string& endpoint, const std::string& path) {
 	while(true) {
-		if(read_packet(true) == PACKET_READ) {
-			auto& packet = _packet_queue.back();
-			if (packet.type == type) {
-				if((endpoint.empty() || endpoint == packet.endpoint) && (path.empty() || path == packet.path)) {
-					auto ret = _packet_queue.back();
-					_packet_queue.pop_back();
-					return ret;
-				}
+		//A read can queue any number of packets (or none, if it was a return), so look through the whole queue
+		for(auto it = _packet_queue.begin(); it != _packet_queue.end(); it++) {
+			auto& packet = *it;
+			if(packet.type == type && (endpoint.empty() || endpoint == packet.endpoint) && (path.empty() || path == packet.path)) {
+				auto ret = std::move(packet);
+				_packet_queue.erase(it);
+				return ret;
 			}
 		}
+		read_packet(true);
+	}
+}
+
+uint32_t BusConnection::next_sequence() {
+	auto sequence = _next_sequence++;
+	if(!_next_sequence)
+		_next_sequence = 1;
+	return sequence;
+}
+
+RiverPacket BusConnection::await_return(uint32_t sequence) {
+	while(true) {
+		auto return_it = _returns.find(sequence);
+		if(return_it != _returns.end()) {
+			auto ret = std::move(return_it->second);
+			_returns.erase(return_it);
+			return ret;
+		}
+		read_packet(true);
 	}
 }
 
+bool BusConnection::has_return(uint32_t sequence) {
+	while(read_packet(false) != NO_PACKET);
+	return _returns.find(sequence) != _returns.end();
+}
+
+void BusConnection::intern_function(uint32_t id, std::shared_ptr<IFunction> function) {
+	if(id)
+		_function_ids[id] = std::move(function);
+}
+
+void BusConnection::intern_message(uint32_t id, std::shared_ptr<IMessage> message) {
+	if(id)
+		_message_ids[id] = std::move(message);
+}
+
+pid_t BusConnection::client_pid(sockid_t client) {
+	auto pid_it = _client_pids.find(client);
+	return pid_it == _client_pids.end() ? 0 : pid_it->second;
+}
+
 void BusConnection::handle_function_call(const RiverPacket& packet) {
+	if(packet.target_id) {
+		auto function_it = _function_ids.find(packet.target_id);
+		if(function_it == _function_ids.end()) {
+			Log::warn("[River] Got call for unknown function ", packet.target_id);
+			send_call_error(packet, FUNCTION_DOES_NOT_EXIST);
+			return;
+		}
+		function_it->second->remote_call(packet);
+		return;
+	}
+
 	if(!_endpoints[packet.endpoint]) {
 		Log::warn("[River] Got function call for unknown endpoint ", packet.endpoint);
+		send_call_error(packet, ENDPOINT_DOES_NOT_EXIST);
 		return;
 	}
 
@@ -167,13 +300,35 @@ void BusConnection::handle_function_call(const RiverPacket& packet) {
 	auto func = endpoint->get_ifunction(packet.path);
 	if(!func) {
 		Log::warn("[River] Got call for unknown function ", packet.endpoint, ":", packet.path);
+		send_call_error(packet, FUNCTION_DOES_NOT_EXIST);
 		return;
 	}
 
 	func->remote_call(packet);
 }
 
+void BusConnection::send_call_error(const RiverPacket& call, ErrorType error) {
+	//Calls without a sequence aren't waiting on a return
+	if(!call.sequence)
+		return;
+	RiverPacket reply = {FUNCTION_RETURN, call.endpoint, call.path, error};
+	reply.recipient = call.sender;
+	reply.target_id = call.target_id;
+	reply.sequence = call.sequence;
+	send_return(reply);
+}
+
 void BusConnection::handle_message(const RiverPacket& packet) {
+	if(packet.target_id) {
+		auto message_it = _message_ids.find(packet.target_id);
+		if(message_it == _message_ids.end()) {
+			Log::warn("[River] Got unknown message ", packet.target_id);
+			return;
+		}
+		message_it->second->handle_message(packet);
+		return;
+	}
+
 	if(!_endpoints[packet.endpoint]) {
 		Log::warn("[River] Got message for unknown endooint ", packet.endpoint);
 		return;
@@ -190,6 +345,8 @@ void BusConnection::handle_message(const RiverPacket& packet) {
 }
 
 void BusConnection::handle_client_connected(const RiverPacket& packet) {
+	_client_pids[packet.connected_id] = packet.connected_pid;
+
 	if(!_endpoints[packet.endpoint]) {
 		Log::warn("[River] Got client connected message for unknown endpoint ", packet.endpoint);
 		return;
@@ -201,6 +358,10 @@ void BusConnection::handle_client_connected(const RiverPacket& packet) {
 }
 
 void BusConnection::handle_client_disconnected(const RiverPacket& packet) {
+	//Anything the client sent over its channel after we last read it is dropped along with it
+	_client_channels.erase(packet.disconnected_id);
+	_client_pids.erase(packet.disconnected_id);
+
 	if(!_endpoints[packet.endpoint]) {
 		Log::warn("[River] Got client disconnected message for unknown endpoint ", packet.endpoint);
 		return;
@@ -209,4 +370,88 @@ void BusConnection::handle_client_disconnected(const RiverPacket& packet) {
 	auto& endpoint = _endpoints[packet.endpoint];
 	if(endpoint->on_client_disconnect)
 		endpoint->on_client_disconnect(packet.disconnected_id, packet.disconnected_pid);
-}
\ No newline at end of file
+}
+void BusConnection::handle_endpoint_disconnected(const RiverPacket& packet) {
+	//Anything the host sent over the channel before it went away is still read
+	auto channel_it = _channels.find(packet.endpoint);
+	if(channel_it != _channels.end()) {
+		auto channel = channel_it->second;
+		_channels.erase(channel_it);
+		read_channel(channel);
+	}
+
+	//Don't attach to a channel the host answered with before it went away
+	for(auto pkt_it = _packet_queue.begin(); pkt_it != _packet_queue.end();) {
+		if(pkt_it->type == OPEN_CHANNEL && pkt_it->endpoint == packet.endpoint)
+			pkt_it = _packet_queue.erase(pkt_it);
+		else
+			pkt_it++;
+	}
+
+	//Calls to the endpoint that haven't returned by now never will
+	for(auto call_it = _pending_calls.begin(); call_it != _pending_calls.end();) {
+		if(call_it->second != packet.endpoint) {
+			call_it++;
+			continue;
+		}
+		RiverPacket ret = {FUNCTION_RETURN, packet.endpoint, "", ENDPOINT_DOES_NOT_EXIST};
+		ret.sequence = call_it->first;
+		_returns[call_it->first] = std::move(ret);
+		call_it = _pending_calls.erase(call_it);
+	}
+}
+
+void BusConnection::handle_open_channel(const RiverPacket& packet) {
+	//Hosts we asked for a channel to one of their endpoints answer with the same packet type that we're asked with
+	auto endpoint_it = _endpoints.find(packet.endpoint);
+	if(endpoint_it != _endpoints.end() && endpoint_it->second && endpoint_it->second->type() == Endpoint::PROXY) {
+		attach_channel(packet);
+		return;
+	}
+
+	RiverPacket reply = {OPEN_CHANNEL, packet.endpoint, "", SUCCESS};
+	reply.recipient = packet.connected_id;
+
+	//A client only needs one channel to us, no matter how many of our endpoints it uses
+	auto channel_it = _client_channels.find(packet.connected_id);
+	if(channel_it == _client_channels.end()) {
+		auto channel_res = Channel::create(packet.connected_id, packet.connected_pid);
+		if(channel_res.is_error()) {
+			Log::warn("[River] Couldn't open channel to client ", packet.connected_pid, ": ", channel_res.message());
+			reply.error = UNKNOWN_ERROR;
+			send_packet(reply);
+			return;
+		}
+		channel_it = _client_channels.insert({packet.connected_id, channel_res.value()}).first;
+	}
+
+	reply.data.resize(sizeof(Channel::Info));
+	memcpy(reply.data.data(), &channel_it->second->info(), sizeof(Channel::Info));
+	send_packet(reply);
+}
+
+void BusConnection::attach_channel(const RiverPacket& packet) {
+	auto& endpoint = packet.endpoint;
+	if(packet.error || packet.data.size() != sizeof(Channel::Info)) {
+		Log::warn("[River] Couldn't open channel to ", endpoint, ": ", error_str(packet.error));
+		return;
+	}
+
+	Channel::Info info;
+	memcpy(&info, packet.data.data(), sizeof(Channel::Info));
+
+	//Endpoints with the same host share the channel to it
+	for(auto& channel : _channels) {
+		if(channel.second->info().to_host == info.to_host) {
+			_channels[endpoint] = channel.second;
+			return;
+		}
+	}
+
+	auto channel_res = Channel::attach(packet.sender, info);
+	if(channel_res.is_error()) {
+		Log::warn("[River] Couldn't attach to channel to ", endpoint, ": ", channel_res.message());
+		return;
+	}
+	_channels[endpoint] = channel_res.value();
+}
@@ -26,10 +26,13 @@
 #include <memory>
 #include <utility>
 #include "packet.h"
+#include "Channel.h"
 
 namespace River {
 	class Endpoint;
 	class BusServer;
+	class IFunction;
+	class IMessage;
 
 	class BusConnection: public std::enable_shared_from_this<BusConnection> {
 	public:
@@ -49,6 +52,17 @@ namespace River {
 		Duck::ResultRet<std::shared_ptr<Endpoint>> get_endpoint(const std::string& name);
 
 		Duck::Result send_packet(const RiverPacket& packet);
+
+		/**
+		 * Sends a function call to an endpoint, straight to its host over a channel if we have one.
+		 */
+		Duck::Result send_call(const std::string& endpoint, const RiverPacket& packet);
+
+		/**
+		 * Sends a function's return to the client that called it, over its channel if it has one.
+		 */
+		Duck::Result send_return(const RiverPacket& packet);
+
 		void read_all_packets(bool block);
 		void read_and_handle_packets(bool block);
 		int file_descriptor();
@@ -56,17 +70,80 @@ namespace River {
 		PacketReadResult read_packet(bool block);
 		RiverPacket await_packet(PacketType type, const std::string& endpoint = "", const std::string& path = "");
 
+		/**
+		 * Returns a new sequence number to send a function call with, so that its return can be told apart from others.
+		 */
+		uint32_t next_sequence();
+
+		/**
+		 * Waits for the return of the function call sent with the given sequence number, handling nothing else in the
+		 * meantime. Other returns that arrive first are kept until they're awaited.
+		 */
+		RiverPacket await_return(uint32_t sequence);
+
+		/**
+		 * Reads whatever packets are available without blocking, and returns whether the return of the function call
+		 * sent with the given sequence number has arrived.
+		 */
+		bool has_return(uint32_t sequence);
+
+		/**
+		 * Remembers the ID the server gave a function or message, so that calls and messages sent to it by ID can be
+		 * handled without looking up its name.
+		 */
+		void intern_function(uint32_t id, std::shared_ptr<IFunction> function);
+		void intern_message(uint32_t id, std::shared_ptr<IMessage> message);
+
+		/**
+		 * Returns the pid of a client connected to one of our endpoints, or 0 if we don't know of it.
+		 */
+		pid_t client_pid(sockid_t client);
+
 	private:
 		void handle_function_call(const RiverPacket& packet);
 		void handle_message(const RiverPacket& packet);
 		void handle_client_connected(const RiverPacket& packet);
 		void handle_client_disconnected(const RiverPacket& packet);
+		void handle_endpoint_disconnected(const RiverPacket& packet);
+		void handle_open_channel(const RiverPacket& packet);
+
+		/**
+		 * Replies to a function call that couldn't be made with an error, so that the caller isn't left waiting.
+		 */
+		void send_call_error(const RiverPacket& call, ErrorType error);
+
+		/**
+		 * Attaches to the channel the host of an endpoint answered our request for one with. Until then (or if it
+		 * couldn't open one), calls go through the bus server like everything else.
+		 */
+		void attach_channel(const RiverPacket& packet);
+
+		/**
+		 * Waits until there's something to read from the bus or any of our channels.
+		 */
+		void wait_for_packets();
+
+		/**
+		 * Reads everything waiting in our channels into the packet queue.
+		 * @return Whether anything was read.
+		 */
+		bool read_channel_packets();
+		bool read_channel(const Duck::Ptr<Channel>& channel);
+		void queue_packet(RiverPacket packet);
 
 		int _fd = 0;
 		BusServer* _server = nullptr;
 		BusType _type;
 		std::map<std::string, std::shared_ptr<Endpoint>> _endpoints;
 		std::deque<RiverPacket> _packet_queue;
+		std::map<uint32_t, RiverPacket> _returns; ///< Function returns that arrived but haven't been awaited yet.
+		std::map<uint32_t, std::string> _pending_calls; ///< The endpoints of calls that haven't returned yet, by sequence.
+		std::map<uint32_t, std::shared_ptr<IFunction>> _function_ids;
+		std::map<uint32_t, std::shared_ptr<IMessage>> _message_ids;
+		uint32_t _next_sequence = 1;
+		std::map<std::string, Duck::Ptr<Channel>> _channels; ///< Channels to the hosts of endpoints, by endpoint.
+		std::map<sockid_t, Duck::Ptr<Channel>> _client_channels; ///< Channels to the clients of our endpoints.
+		std::map<sockid_t, pid_t> _client_pids;
 	};
 }
 
@@ -22,6 +22,7 @@
 #include <cstring>
 #include <memory>
 #include <poll.h>
+#include <algorithm>
 #include "packet.h"
 #include "Endpoint.h"
 #include "BusConnection.h"
@@ -66,58 +67,67 @@ void BusServer::read_and_handle_packets(bool block) {
 		if(pkt_res.is_error())
 			continue;
 		auto packet = pkt_res.value();
+		handle_packet(packet);
+		return;
+	}
+}
 
-		switch(packet.type) {
-			case SOCKETFS_CLIENT_CONNECTED:
-				client_connected(packet);
-				return;
-
-			case SOCKETFS_CLIENT_DISCONNECTED:
-				client_disconnected(packet);
-				return;
-
-			case REGISTER_ENDPOINT:
-				register_endpoint(packet);
-				return;
-
-			case GET_ENDPOINT:
-				get_endpoint(packet);
-				return;
-
-			case REGISTER_FUNCTION:
-				register_function(packet);
-				return;
-
-			case GET_FUNCTION:
-				get_function(packet);
-				return;
-
-			case FUNCTION_CALL:
-				call_function(packet);
-				return;
-
-			case FUNCTION_RETURN:
-				function_return(packet);
-				return;
-
-			case REGISTER_MESSAGE:
-				register_message(packet);
-				return;
-
-			case GET_MESSAGE:
-				get_message(packet);
-				return;
-
-			case SEND_MESSAGE:
-				send_message(packet);
-				return;
-
-			default:
-				packet.error = MALFORMED_DATA;
-				packet.data.clear();
-				send_packet(packet.__socketfs_from_id, packet);
-				return;
-		}
+void BusServer::handle_packet(RiverPacket& packet) {
+	LOCK(_lock);
+	switch(packet.type) {
+		case SOCKETFS_CLIENT_CONNECTED:
+			client_connected(packet);
+			return;
+
+		case SOCKETFS_CLIENT_DISCONNECTED:
+			client_disconnected(packet);
+			return;
+
+		case REGISTER_ENDPOINT:
+			register_endpoint(packet);
+			return;
+
+		case GET_ENDPOINT:
+			get_endpoint(packet);
+			return;
+
+		case REGISTER_FUNCTION:
+			register_function(packet);
+			return;
+
+		case GET_FUNCTION:
+			get_function(packet);
+			return;
+
+		case FUNCTION_CALL:
+			call_function(packet);
+			return;
+
+		case FUNCTION_RETURN:
+			function_return(packet);
+			return;
+
+		case REGISTER_MESSAGE:
+			register_message(packet);
+			return;
+
+		case GET_MESSAGE:
+			get_message(packet);
+			return;
+
+		case SEND_MESSAGE:
+			send_message(packet);
+			return;
+
+		case OPEN_CHANNEL:
+			open_channel(packet);
+			return;
+
+		default:
+			packet.error = MALFORMED_DATA;
+			packet.data.clear();
+			send_packet(packet.__socketfs_from_id, packet);
+			return;
 	}
 }
 
@@ -134,6 +144,7 @@ tid_t BusServer::spawn_thread() {
 }
 
 void BusServer::set_allow_new_endpoints(bool allow) {
+	LOCK(_lock);
 	_allow_new_endpoints = allow;
 }
 
@@ -186,10 +197,19 @@ void BusServer::client_disconnected(const RiverPacket& packet) {
 		return;
 	}
 
-	//Erase the client's registered endpoints
+	//Erase the client's registered endpoints, letting the clients connected to them know so they stop waiting on it
 	auto& client = client_it->second;
-	for(auto& endpoint : client->registered_endpoints)
-		_endpoints.erase(endpoint);
+	for(auto& endpoint : client->registered_endpoints) {
+		for(auto& other_client : _clients) {
+			auto& connected = other_client.second->connected_endpoints;
+			auto connected_it = std::find(connected.begin(), connected.end(), endpoint);
+			if(other_client.first == client->id || connected_it == connected.end())
+				continue;
+			connected.erase(connected_it);
+			send_packet(other_client.first, {ENDPOINT_DISCONNECTED, endpoint});
+		}
+		erase_endpoint(endpoint);
+	}
 
 	//Send the disconnect message to all of the client's connected endpoints
 	for(auto& endpoint_name : client->connected_endpoints) {
@@ -230,7 +250,7 @@ void BusServer::register_endpoint(const RiverPacket& packet) {
 		return;
 	}
 
-	_endpoints[packet.endpoint] = std::make_unique<ServerEndpoint>(ServerEndpoint{packet.endpoint, packet.__socketfs_from_id});
+	_endpoints[packet.endpoint] = std::make_unique<ServerEndpoint>(ServerEndpoint{packet.endpoint, packet.__socketfs_from_id, packet.__socketfs_from_pid});
 	Log::dbg("[River] Registering endpoint ", packet.endpoint);
 
 	auto& client = _clients[packet.__socketfs_from_id];
@@ -262,12 +282,16 @@ void BusServer::get_endpoint(const RiverPacket& packet) {
 		});
 	}
 
-	send_packet(packet.__socketfs_from_id, {
+	//Tell the client who hosts the endpoint, so that it can share buffers with them
+	RiverPacket reply = {
 			packet.type,
 			packet.endpoint,
 			packet.path,
 			SUCCESS
-	});
+	};
+	reply.data.resize(sizeof(pid_t));
+	memcpy(reply.data.data(), &endpoint->pid, sizeof(pid_t));
+	send_packet(packet.__socketfs_from_id, reply);
 }
 
 void BusServer::register_function(const RiverPacket& packet) {
@@ -293,39 +317,80 @@ void BusServer::register_function(const RiverPacket& packet) {
 		return;
 	}
 
-	endpoint->functions[packet.path] = std::make_unique<ServerFunction>(ServerFunction {packet.path});
+	auto& function = endpoint->functions[packet.path];
+	function = std::make_unique<ServerFunction>(ServerFunction {packet.path, _next_id++, endpoint.get()});
+	_function_ids[function->id] = function.get();
 
-	send_packet(packet.__socketfs_from_id, {
+	RiverPacket reply = {
 			packet.type,
 			packet.endpoint,
 			packet.path,
 			SUCCESS
-	});
+	};
+	reply.target_id = function->id;
+	send_packet(packet.__socketfs_from_id, reply);
 }
 
 void BusServer::get_function(const RiverPacket& packet) {
 	VERIFY_ENDPOINT
 	VERIFY_FUNCTION
 
-	send_packet(packet.__socketfs_from_id, {
+	RiverPacket reply = {
 			packet.type,
 			packet.endpoint,
 			packet.path,
 			SUCCESS
-	});
+	};
+	reply.target_id = endpoint->functions[packet.path]->id;
+	send_packet(packet.__socketfs_from_id, reply);
 }
 
 void BusServer::call_function(const RiverPacket& packet) {
-	VERIFY_ENDPOINT
-	VERIFY_FUNCTION
-
 	RiverPacket func_packet = packet;
 	func_packet.sender = packet.__socketfs_from_id;
 	func_packet.__socketfs_from_id = 0;
+
+	//Calls to functions by ID don't need any names looked up
+	if(packet.target_id) {
+		auto function_it = _function_ids.find(packet.target_id);
+		if(function_it == _function_ids.end()) {
+			//Reply with a return so that the caller waiting on it finds out
+			RiverPacket reply = {
+					FUNCTION_RETURN,
+					"",
+					"",
+					FUNCTION_DOES_NOT_EXIST
+			};
+			reply.target_id = packet.target_id;
+			reply.sequence = packet.sequence;
+			send_packet(packet.__socketfs_from_id, reply);
+			return;
+		}
+		send_packet(function_it->second->endpoint->id, func_packet);
+		return;
+	}
+
+	VERIFY_ENDPOINT
+	VERIFY_FUNCTION
 	send_packet(endpoint->id, func_packet);
 }
 
 void BusServer::function_return(const RiverPacket& packet) {
+	if(packet.target_id) {
+		auto function_it = _function_ids.find(packet.target_id);
+		if(function_it == _function_ids.end() || function_it->second->endpoint->id != packet.__socketfs_from_id || packet.recipient == SOCKETFS_RECIPIENT_HOST || packet.recipient == _self_pid) {
+			send_packet(packet.__socketfs_from_id, {
+					packet.type,
+					packet.endpoint,
+					packet.path,
+					ILLEGAL_REQUEST
+			});
+			return;
+		}
+		send_packet(packet.recipient, packet);
+		return;
+	}
+
 	VERIFY_ENDPOINT
 	VERIFY_FUNCTION
 
@@ -365,34 +430,104 @@ void BusServer::register_message(const RiverPacket& packet) {
 		return;
 	}
 
-	endpoint->messages[packet.path] = std::make_unique<ServerMessage>(ServerMessage {packet.path});
+	auto& message = endpoint->messages[packet.path];
+	message = std::make_unique<ServerMessage>(ServerMessage {packet.path, _next_id++, endpoint.get()});
+	_message_ids[message->id] = message.get();
 
-	send_packet(packet.__socketfs_from_id, {
+	RiverPacket reply = {
 			packet.type,
 			packet.endpoint,
 			packet.path,
 			SUCCESS
-	});
+	};
+	reply.target_id = message->id;
+	send_packet(packet.__socketfs_from_id, reply);
 }
 
 void BusServer::get_message(const RiverPacket& packet) {
 	VERIFY_ENDPOINT
 	VERIFY_MESSAGE
 
-	send_packet(packet.__socketfs_from_id, {
+	RiverPacket reply = {
 			packet.type,
 			packet.endpoint,
 			packet.path,
 			SUCCESS
-	});
+	};
+	reply.target_id = endpoint->messages[packet.path]->id;
+	send_packet(packet.__socketfs_from_id, reply);
 }
 
 void BusServer::send_message(const RiverPacket& packet) {
-	VERIFY_ENDPOINT
-	VERIFY_MESSAGE
+	if(packet.target_id) {
+		auto message_it = _message_ids.find(packet.target_id);
+		if(message_it == _message_ids.end() || message_it->second->endpoint->id != packet.__socketfs_from_id) {
+			send_packet(packet.__socketfs_from_id, {
+					packet.type,
+					packet.endpoint,
+					packet.path,
+					MESSAGE_DOES_NOT_EXIST
+			});
+			return;
+		}
+	} else {
+		VERIFY_ENDPOINT
+		VERIFY_MESSAGE
+	}
 
 	RiverPacket message_packet = packet;
 	message_packet.sender = packet.__socketfs_from_id;
 	message_packet.__socketfs_from_id = 0;
 	send_packet(packet.recipient, message_packet);
 }
+
+void BusServer::open_channel(const RiverPacket& packet) {
+	VERIFY_ENDPOINT
+
+	if(endpoint->id != packet.__socketfs_from_id) {
+		//A client asking for a channel to the endpoint's host. The host is told who's asking by us, so it can trust it
+		send_packet(endpoint->id, {
+			.type = OPEN_CHANNEL,
+			.endpoint = packet.endpoint,
+			.path = "",
+			.connected_pid = packet.__socketfs_from_pid,
+			.connected_id = packet.__socketfs_from_id
+		});
+		return;
+	}
+
+	//The host answering with the buffers for the channel
+	if(packet.recipient == SOCKETFS_RECIPIENT_HOST || packet.recipient == _self_pid) {
+		send_packet(packet.__socketfs_from_id, {
+				packet.type,
+				packet.endpoint,
+				packet.path,
+				ILLEGAL_REQUEST
+		});
+		return;
+	}
+
+	RiverPacket reply = packet;
+	reply.sender = packet.__socketfs_from_id;
+	reply.__socketfs_from_id = 0;
+	send_packet(packet.recipient, reply);
+}
+
+void BusServer::erase_endpoint(const std::string& name) {
+	auto endpoint_it = _endpoints.find(name);
+	if(endpoint_it == _endpoints.end())
+		return;
+
+	//Forget the IDs of everything the endpoint registered, so nobody can call them anymore
+	if(endpoint_it->second) {
+		for(auto& function : endpoint_it->second->functions) {
+			if(function.second)
+				_function_ids.erase(function.second->id);
+		}
+		for(auto& message : endpoint_it->second->messages) {
+			if(message.second)
+				_message_ids.erase(message.second->id);
+		}
+	}
+	_endpoints.erase(endpoint_it);
+}
@@ -21,6 +21,7 @@
 
 #include <string>
 #include <libduck/Result.h>
+#include <libduck/Mutex.h>
 #include <map>
 #include <memory>
 #include <sys/types.h>
@@ -48,17 +49,24 @@ namespace River {
 		void set_allow_new_endpoints(bool allow);
 
 	private:
+		struct ServerEndpoint;
+
 		struct ServerMessage {
 			std::string path;
+			uint32_t id;
+			ServerEndpoint* endpoint;
 		};
 
 		struct ServerFunction {
 			std::string path;
+			uint32_t id;
+			ServerEndpoint* endpoint;
 		};
 
 		struct ServerEndpoint {
 			std::string name;
 			sockid_t id;
+			pid_t pid;
 			std::map<std::string, std::unique_ptr<ServerFunction>> functions;
 			std::map<std::string, std::unique_ptr<ServerMessage>> messages;
 		};
@@ -72,6 +80,7 @@ namespace River {
 		BusServer(int fd, ServerType type): _fd(fd), _type(type), _self_pid(getpid()) {}
 
 		Duck::Result send_packet(int pid, const RiverPacket& packet);
+		void handle_packet(RiverPacket& packet);
 
 		void client_connected(const RiverPacket& packet);
 		void client_disconnected(const RiverPacket& packet);
@@ -84,14 +93,20 @@ namespace River {
 		void register_message(const RiverPacket& packet);
 		void get_message(const RiverPacket& packet);
 		void send_message(const RiverPacket& packet);
+		void open_channel(const RiverPacket& packet);
+		void erase_endpoint(const std::string& name);
 
 		int _fd = 0;
 		ServerType _type;
 		bool _started = false;
 		bool _allow_new_endpoints = true;
 
+		Duck::Mutex _lock; // Guards the client and endpoint state, which may be touched from the server thread.
 		std::map<sockid_t, std::unique_ptr<ServerClient>> _clients;
 		std::map<std::string, std::unique_ptr<ServerEndpoint>> _endpoints;
+		std::map<uint32_t, ServerFunction*> _function_ids; // Functions by the IDs they were given when registered
+		std::map<uint32_t, ServerMessage*> _message_ids; // Messages by the IDs they were given when registered
+		uint32_t _next_id = 1;
 		pid_t _self_pid;
 	};
 }
@@ -0,0 +1,84 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2024 Byteduck */
+
+#include "Channel.h"
+#include <unistd.h>
+#include <cerrno>
+
+using namespace River;
+using Duck::Result, Duck::ResultRet, Duck::Ptr, Duck::SharedBuffer;
+
+ResultRet<Ptr<Channel>> Channel::create(sockid_t peer, pid_t peer_pid) {
+	auto to_client = TRY(IPCBuffer::alloc("River channel"))->buffer();
+	auto to_host = TRY(IPCBuffer::alloc("River channel"))->buffer();
+
+	// Both sides write to both buffers, since the heads and futexes live in them too
+	if(to_client->allow(peer_pid) < 0 || to_host->allow(peer_pid) < 0)
+		return Result(errno);
+
+	auto sender = TRY(IPCBufferSender::attach(to_client));
+	auto receiver = TRY(IPCBufferReceiver::attach(to_host));
+	auto poll_fd = TRY(receiver->open_poll_fd());
+	return Ptr<Channel>(new Channel(peer, {to_client->id(), to_host->id()}, sender, receiver, poll_fd));
+}
+
+ResultRet<Ptr<Channel>> Channel::attach(sockid_t peer, const Info& info) {
+	auto to_client = TRY(SharedBuffer::adopt(info.to_client));
+	auto to_host = TRY(SharedBuffer::adopt(info.to_host));
+	auto sender = TRY(IPCBufferSender::attach(to_host));
+	auto receiver = TRY(IPCBufferReceiver::attach(to_client));
+	auto poll_fd = TRY(receiver->open_poll_fd());
+	return Ptr<Channel>(new Channel(peer, info, sender, receiver, poll_fd));
+}
+
+Channel::Channel(sockid_t peer, Info info, Ptr<IPCBufferSender> sender, Ptr<IPCBufferReceiver> receiver, int poll_fd):
+	m_peer(peer),
+	m_info(info),
+	m_sender(std::move(sender)),
+	m_receiver(std::move(receiver)),
+	m_poll_fd(poll_fd)
+{}
+
+Channel::~Channel() {
+	close(m_poll_fd);
+}
+
+Result Channel::send(const RiverPacket& packet, bool blocking) {
+	return m_sender->send(sizeof(Record) + packet.data.size(), [&packet] (uint8_t* buf) {
+		auto* record = (Record*) buf;
+		record->type = packet.type;
+		record->error = packet.error;
+		record->target_id = packet.target_id;
+		record->sequence = packet.sequence;
+		if(!packet.data.empty())
+			memcpy(record->data, packet.data.data(), packet.data.size());
+	}, blocking);
+}
+
+ResultRet<RiverPacket> Channel::receive() {
+	RiverPacket packet = {};
+	bool valid = false;
+	auto res = m_receiver->recv([&] (const uint8_t* buf, size_t size) {
+		if(size < sizeof(Record) || size - sizeof(Record) > SOCKETFS_MAX_BUFFER_SIZE)
+			return;
+		auto* record = (const Record*) buf;
+		packet.type = record->type;
+		packet.error = record->error;
+		packet.target_id = record->target_id;
+		packet.sequence = record->sequence;
+		packet.data.assign(record->data, buf + size);
+		valid = true;
+	}, false);
+
+	if(res.code() == IPCBuffer::NO_MESSAGE)
+		return Result(NO_PACKET);
+	if(res.is_error() || !valid)
+		return Result(PACKET_ERR);
+
+	// Only calls and returns are sent over channels, and either way, the other side of the channel is who sent it
+	if(packet.type != FUNCTION_CALL && packet.type != FUNCTION_RETURN)
+		return Result(PACKET_ERR);
+	packet.sender = m_peer;
+	packet.__socketfs_from_id = m_peer;
+	return packet;
+}
@@ -0,0 +1,78 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2024 Byteduck */
+
+#pragma once
+
+#include "IPCBuffer.h"
+#include "packet.h"
+
+namespace River {
+	/**
+	 * A direct connection between a client and the host of an endpoint, made of two IPCBuffers in shared memory (one
+	 * for each direction). Function calls and returns sent over a channel skip the bus server entirely, so they're
+	 * only copied once and the server doesn't need to be scheduled to pass them along.
+	 */
+	class Channel {
+	public:
+		/**
+		 * The buffers a host shares with a client to open a channel, sent in the data of an OPEN_CHANNEL reply.
+		 */
+		struct Info {
+			int to_client; ///< The shared buffer ID of the buffer the host sends through.
+			int to_host; ///< The shared buffer ID of the buffer the client sends through.
+		};
+
+		/**
+		 * Creates a channel to a client, as the host of an endpoint.
+		 * @param peer The ID of the client's connection to the bus.
+		 * @param peer_pid The client's pid, which the buffers are shared with.
+		 */
+		static Duck::ResultRet<Duck::Ptr<Channel>> create(sockid_t peer, pid_t peer_pid);
+
+		/**
+		 * Attaches to a channel that the host of an endpoint created for us.
+		 * @param peer The ID of the host's connection to the bus.
+		 * @param info The buffers the host shared with us.
+		 */
+		static Duck::ResultRet<Duck::Ptr<Channel>> attach(sockid_t peer, const Info& info);
+
+		~Channel();
+
+		/**
+		 * Sends a function call or return through the channel. Only its type, error, target ID, sequence and data are
+		 * sent, so packets that still need their endpoint and path to be routed can't be.
+		 * @param blocking Whether to wait for room in the buffer if it's full.
+		 */
+		Duck::Result send(const RiverPacket& packet, bool blocking);
+
+		/**
+		 * Receives the next packet waiting in the channel, without blocking. Its sender is set to our peer.
+		 * @return The packet, or NO_PACKET if there isn't one.
+		 */
+		Duck::ResultRet<RiverPacket> receive();
+
+		/**
+		 * A file descriptor that polls as readable while there are packets waiting to be received.
+		 */
+		int poll_fd() const { return m_poll_fd; }
+		sockid_t peer() const { return m_peer; }
+		const Info& info() const { return m_info; }
+
+	private:
+		struct Record {
+			PacketType type;
+			ErrorType error;
+			uint32_t target_id;
+			uint32_t sequence;
+			uint8_t data[];
+		};
+
+		Channel(sockid_t peer, Info info, Duck::Ptr<IPCBufferSender> sender, Duck::Ptr<IPCBufferReceiver> receiver, int poll_fd);
+
+		sockid_t m_peer;
+		Info m_info;
+		Duck::Ptr<IPCBufferSender> m_sender;
+		Duck::Ptr<IPCBufferReceiver> m_receiver;
+		int m_poll_fd;
+	};
+}
@@ -22,7 +22,7 @@
 
 using namespace River;
 
-Endpoint::Endpoint(std::shared_ptr<BusConnection> bus, const std::string& name, ConnectionType type): _bus(std::move(bus)), _type(type), _name(name) {
+Endpoint::Endpoint(std::shared_ptr<BusConnection> bus, const std::string& name, ConnectionType type, pid_t host_pid): _bus(std::move(bus)), _type(type), _name(name), _host_pid(host_pid) {
 
 }
 
@@ -42,6 +42,10 @@ Endpoint::ConnectionType Endpoint::type() const {
 	return _type;
 }
 
+pid_t Endpoint::host_pid() const {
+	return _host_pid;
+}
+
 const std::shared_ptr<BusConnection>& Endpoint::bus() {
 	return _bus;
 }
@@ -43,7 +43,7 @@ namespace River {
 	public:
 		enum ConnectionType { PROXY, HOST };
 
-		Endpoint(std::shared_ptr<BusConnection> bus, const std::string& name, ConnectionType type);
+		Endpoint(std::shared_ptr<BusConnection> bus, const std::string& name, ConnectionType type, pid_t host_pid = 0);
 
 		template<typename RetT, typename... ParamTs>
 		Duck::ResultRet<Function<RetT, ParamTs...>> register_function(const std::string& path, typename type_identity<std::function<RetT(sockid_t, ParamTs...)>>::type callback) {
@@ -64,8 +64,9 @@ namespace River {
 				return Duck::Result(packet.error);
 			}
 
-			auto ret = std::make_shared<Function<RetT, ParamTs...>>(path, shared_from_this(), callback);
+			auto ret = std::make_shared<Function<RetT, ParamTs...>>(path, shared_from_this(), packet.target_id, callback);
 			_functions[stringname] = ret;
+			_bus->intern_function(packet.target_id, ret);
 			return *ret;
 		}
 
@@ -97,7 +98,7 @@ namespace River {
 				return Duck::Result(packet.error);
 			}
 
-			auto ret = std::make_shared<Function<RetT, ParamTs...>>(path, shared_from_this());
+			auto ret = std::make_shared<Function<RetT, ParamTs...>>(path, shared_from_this(), packet.target_id);
 			_functions[stringname] = ret;
 			return *ret;
 		}
@@ -139,7 +140,7 @@ namespace River {
 				return Duck::Result(packet.error);
 			}
 
-			auto ret = std::make_shared<Message<T>>(path, shared_from_this());
+			auto ret = std::make_shared<Message<T>>(path, shared_from_this(), packet.target_id);
 			_messages[stringname] = ret;
 			return *ret;
 		}
@@ -174,8 +175,9 @@ namespace River {
 				return Duck::Result(packet.error);
 			}
 
-			auto ret = std::make_shared<Message<T>>(path, shared_from_this(), callback);
+			auto ret = std::make_shared<Message<T>>(path, shared_from_this(), packet.target_id, callback);
 			_messages[stringname] = ret;
+			_bus->intern_message(packet.target_id, ret);
 			return Duck::Result(SUCCESS);
 		}
 
@@ -184,6 +186,7 @@ namespace River {
 
 		const std::string& name();
 		ConnectionType type() const;
+		pid_t host_pid() const; ///< The pid of the endpoint's host, if we aren't it.
 		const std::shared_ptr<BusConnection>& bus();
 
 		std::function<void(sockid_t, pid_t)> on_client_connect = nullptr;
@@ -193,6 +196,7 @@ namespace River {
 		std::map<std::string, std::shared_ptr<IMessage>> _messages;
 		std::string _name;
 		ConnectionType _type;
+		pid_t _host_pid;
 		std::shared_ptr<BusConnection> _bus;
 	};
 }
@@ -25,6 +25,8 @@
 #include "packet.h"
 #include <cstring>
 #include "BusConnection.h"
+#include "Future.hpp"
+#include "SharedBuffers.hpp"
 #include <libduck/serialization_utils.h>
 
 #pragma once
@@ -45,10 +47,11 @@ namespace River {
 	public:
 		Function(const std::string& path): _path(path), _endpoint(nullptr), _callback(nullptr) {}
 
-		Function(const std::string& path, std::shared_ptr<Endpoint> endpoint, std::function<RetT(sockid_t, ParamTs...)> callback = nullptr):
+		Function(const std::string& path, std::shared_ptr<Endpoint> endpoint, uint32_t id, std::function<RetT(sockid_t, ParamTs...)> callback = nullptr):
 				_path(stringname_of(path)),
 				_endpoint(std::move(endpoint)),
-				_callback(callback) {}
+				_callback(callback),
+				_id(id) {}
 
 		static std::string stringname_of(const std::string& path) {
 			std::string ret = path + "<" + typeid(RetT).name() + "[";
@@ -67,40 +70,34 @@ namespace River {
 			}
 
 			if(_endpoint->type() == Endpoint::PROXY) {
-				RiverPacket packet = {
-						FUNCTION_CALL,
-						_endpoint->name(),
-						_path
-				};
-
-				//Serialize function call data (tuple {arg1, arg2, arg3...})
-				packet.data.resize(Duck::Serialization::buffer_size(args...));
-				uint8_t* call_data = packet.data.data();
-				Duck::Serialization::serialize(call_data, args...);
-
-				//Send the function call packet and await a reply (if the function has a non-void return type)
-				_endpoint->bus()->send_packet(packet);
-				if constexpr(!std::is_void<RetT>()) {
-					auto pkt = _endpoint->bus()->await_packet(FUNCTION_RETURN, _endpoint->name(), _path);
-					if(pkt.error) {
-						Duck::Log::err("[River] Remote function call ", pkt.endpoint, ":", pkt.path, " failed: ", error_str(pkt.error));
-						if constexpr(!std::is_void<RetT>())
-							return RetT();
-					}
-
-					//Deserialize and return the return value
-					RetT ret;
-					if(pkt.data.size() == sizeof(RetT)) {
-						const uint8_t* resp_data = pkt.data.data();
-						Duck::Serialization::deserialize(resp_data, ret);
-					}
-					return ret;
-				}
+				if constexpr(std::is_void<RetT>())
+					send_call(0, args...);
+				else
+					return call_async(args...).get();
 			} else {
 				return _callback(0, args...);
 			}
 		}
 
+		/**
+		 * Calls the function without waiting for it to return, so that more calls can be made in the meantime.
+		 * @return A future for the function's return value.
+		 */
+		Future<RetT> call_async(ParamTs... args) const {
+			static_assert(!std::is_void<RetT>(), "Functions without a return value don't need to be called asynchronously!");
+			if(!_endpoint) {
+				Duck::Log::err("[River] Tried calling uninitialized function ", _path);
+				return Future<RetT>(RetT());
+			}
+
+			if(_endpoint->type() != Endpoint::PROXY)
+				return Future<RetT>(_callback(0, args...));
+
+			auto sequence = _endpoint->bus()->next_sequence();
+			send_call(sequence, args...);
+			return Future<RetT>(_endpoint->bus(), sequence);
+		}
+
 		const std::string& path() override {
 			return _path;
 		}
@@ -131,20 +128,42 @@ namespace River {
 						packet.path
 				};
 				resp.recipient = packet.sender;
+				resp.target_id = packet.target_id;
+				resp.sequence = packet.sequence;
 				RetT ret = _callback(packet.sender, std::get<ParamTs>(data_tuple)...);
+				share_buffers(_endpoint->bus()->client_pid(packet.sender), ret);
 				resp.data.resize(Duck::Serialization::buffer_size(ret));
 				uint8_t* resp_data = resp.data.data();
 				Duck::Serialization::serialize(resp_data, ret);
-				_endpoint->bus()->send_packet(resp);
+				_endpoint->bus()->send_return(resp);
 			} else {
 				_callback(packet.sender, std::get<ParamTs>(data_tuple)...);
 			}
 		}
 
 	private:
+		void send_call(uint32_t sequence, ParamTs... args) const {
+			//Once we know the function's ID, we don't need to send its name
+			RiverPacket packet = {FUNCTION_CALL};
+			if(!_id) {
+				packet.endpoint = _endpoint->name();
+				packet.path = _path;
+			}
+			packet.target_id = _id;
+			packet.sequence = sequence;
+
+			//Serialize function call data (tuple {arg1, arg2, arg3...})
+			share_buffers(_endpoint->host_pid(), args...);
+			packet.data.resize(Duck::Serialization::buffer_size(args...));
+			uint8_t* call_data = packet.data.data();
+			Duck::Serialization::serialize(call_data, args...);
+			_endpoint->bus()->send_call(_endpoint->name(), packet);
+		}
+
 		std::string _path;
 		std::shared_ptr<Endpoint> _endpoint;
 		std::function<RetT(sockid_t, ParamTs...)> _callback;
+		uint32_t _id = 0;
 	};
 }
 
@@ -0,0 +1,64 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2024 Byteduck */
+
+#pragma once
+
+#include "BusConnection.h"
+#include <libduck/Log.h>
+#include <libduck/serialization_utils.h>
+
+namespace River {
+	/**
+	 * The result of a function call that may not have returned yet. Calls made with Function::call_async don't wait
+	 * for each other, so many can be sent before waiting on any of their results. The result should always be
+	 * waited on with get(), since it's kept by the connection until it is.
+	 */
+	template<typename T>
+	class Future {
+	public:
+		Future() = default;
+		Future(std::shared_ptr<BusConnection> bus, uint32_t sequence): _bus(std::move(bus)), _sequence(sequence) {}
+		explicit Future(T value): _value(std::move(value)), _ready(true) {}
+
+		/**
+		 * Returns whether the call has returned yet, without waiting for it.
+		 */
+		bool ready() {
+			return _ready || (_bus && _bus->has_return(_sequence));
+		}
+
+		/**
+		 * Waits for the call to return (if it hasn't already), and returns its result.
+		 */
+		T& get() {
+			if(_ready || !_bus)
+				return _value;
+			_ready = true;
+
+			auto packet = _bus->await_return(_sequence);
+			if(packet.error) {
+				Duck::Log::err("[River] Remote function call ", packet.target_id, " failed: ", error_str(packet.error));
+				return _value;
+			}
+
+			//Compare against the serialized size, since some types (like shared buffers, sent as just their ID) aren't
+			//serialized as they're laid out in memory. Types that vary in size are at least as big as an empty one.
+			auto expected_size = Duck::Serialization::buffer_size(_value);
+			bool size_ok = Duck::Serialization::is_fixed_size_type<T>() ? packet.data.size() == expected_size : packet.data.size() >= expected_size;
+			if(!size_ok) {
+				Duck::Log::err("[River] Remote function call ", packet.target_id, " returned malformed data");
+				return _value;
+			}
+
+			const uint8_t* data = packet.data.data();
+			Duck::Serialization::deserialize(data, _value);
+			return _value;
+		}
+
+	private:
+		std::shared_ptr<BusConnection> _bus;
+		uint32_t _sequence = 0;
+		T _value = T();
+		bool _ready = false;
+	};
+}
@@ -3,6 +3,7 @@
 
 #include "IPCBuffer.h"
 #include <sys/futex.h>
+#include <cerrno>
 
 using namespace Duck;
 using namespace River;
@@ -84,6 +85,13 @@ Result IPCBufferReceiver::recv(const ReadCallback& callback, bool blocking) {
 	return Result::SUCCESS;
 }
 
+Duck::ResultRet<int> IPCBufferReceiver::open_poll_fd() {
+	int fd = futex_open(&m_header->read_futex);
+	if(fd < 0)
+		return Result(errno);
+	return fd;
+}
+
 Duck::ResultRet<Duck::Ptr<IPCBufferSender>> IPCBufferSender::attach(Ptr<SharedBuffer> buffer) {
 	if (buffer->size() <= sizeof(Header))
 		return Result {"Invalid buffer size"};
@@ -16,7 +16,7 @@ namespace River {
 		};
 
 		enum ResultCode {
-			NO_MESSAGE,
+			NO_MESSAGE = 1, // Nonzero, or it would read as success
 			INVALID_BUFFER_STATE,
 			NO_BUFFER_SPACE,
 			MESSAGE_TOO_LARGE
@@ -52,6 +52,11 @@ namespace River {
 		using ReadCallback = std::function<void(const uint8_t*, size_t)>;
 		Duck::Result recv(const ReadCallback& callback, bool blocking = true);
 
+		/**
+		 * Opens a file descriptor that polls as readable while there are messages waiting to be received.
+		 */
+		Duck::ResultRet<int> open_poll_fd();
+
 	private:
 		IPCBufferReceiver(Duck::Ptr<Duck::SharedBuffer> buffer): IPCBuffer(std::move(buffer)) {};
 	};
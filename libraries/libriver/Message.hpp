@@ -21,6 +21,7 @@
 
 #include "packet.h"
 #include "Endpoint.h"
+#include "SharedBuffers.hpp"
 #include "libduck/serialization_utils.h"
 #include <type_traits>
 
@@ -38,14 +39,16 @@ namespace River {
 	public:
 		Message(const std::string& path): _path(path), _endpoint(nullptr), _callback(nullptr) {}
 
-		Message(const std::string& path, std::shared_ptr<Endpoint> endpoint):
+		Message(const std::string& path, std::shared_ptr<Endpoint> endpoint, uint32_t id):
 				_path(stringname_of(path)),
-				_endpoint(std::move(endpoint)) {}
+				_endpoint(std::move(endpoint)),
+				_id(id) {}
 
-		Message(const std::string& path, std::shared_ptr<Endpoint> endpoint, std::function<void(T)> callback):
+		Message(const std::string& path, std::shared_ptr<Endpoint> endpoint, uint32_t id, std::function<void(T)> callback):
 				_path(stringname_of(path)),
 				_endpoint(std::move(endpoint)),
-				_callback(callback) {}
+				_callback(callback),
+				_id(id) {}
 
 		static std::string stringname_of(const std::string& path) {
 			return path + "<" + typeid(T).name() + "[" + std::to_string(sizeof(T)) + "]>";
@@ -58,14 +61,16 @@ namespace River {
 			}
 
 			if(_endpoint->type() == Endpoint::HOST) {
-				RiverPacket packet = {
-						SEND_MESSAGE,
-						_endpoint->name(),
-						_path
-				};
+				RiverPacket packet = {SEND_MESSAGE};
+				if(!_id) {
+					packet.endpoint = _endpoint->name();
+					packet.path = _path;
+				}
+				packet.target_id = _id;
 				packet.recipient = recipient;
 
 				//Serialize message data
+				share_buffers(_endpoint->bus()->client_pid(recipient), data);
 				packet.data.resize(Duck::Serialization::buffer_size(data));
 				uint8_t* buf = packet.data.data();
 				Duck::Serialization::serialize(buf, data);
@@ -113,6 +118,7 @@ namespace River {
 		std::string _path;
 		std::shared_ptr<Endpoint> _endpoint;
 		std::function<void(T)> _callback = nullptr;
+		uint32_t _id = 0;
 	};
 }
 
@@ -0,0 +1,28 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2024 Byteduck */
+
+#pragma once
+
+#include <libduck/SharedBuffer.h>
+#include <type_traits>
+
+namespace River {
+	/**
+	 * Lets a process map the shared buffers among some values about to be sent to it. Shared buffers are serialized by
+	 * reference, so big arguments (framebuffers, sample blocks, file contents) can be passed without being copied, but
+	 * only buffers passed directly are shared this way; ones inside of other types need to be allowed by hand.
+	 * @param pid The pid to share the buffers with. If it's 0, nothing is shared.
+	 */
+	template<typename... Ts>
+	void share_buffers(pid_t pid, const Ts&... values) {
+		if(!pid)
+			return;
+		auto share = [pid] (const auto& value) {
+			if constexpr(std::is_same<std::decay_t<decltype(value)>, Duck::Ptr<Duck::SharedBuffer>>()) {
+				if(value)
+					value->allow(pid);
+			}
+		};
+		(share(values), ...);
+	}
+}
@@ -112,12 +112,11 @@ Duck::ResultRet<RiverPacket> River::receive_packet(int fd, bool block)  {
 			raw_socketfs_packet->sender,
 			raw_socketfs_packet->sender_pid
 		};
+		packet.target_id = raw_packet->target_id;
+		packet.sequence = raw_packet->sequence;
 
 		//Get the target from the RawPacket
-		auto* target_cstr = new char[raw_packet->path_length];
-		strncpy(target_cstr, (const char*) raw_packet->data, raw_packet->path_length);
-		std::string target = target_cstr;
-		delete[] target_cstr;
+		std::string target((const char*) raw_packet->data, strnlen((const char*) raw_packet->data, raw_packet->path_length - 1));
 
 		//Get the data from the RawPacket
 		if(raw_packet->data_length) {
@@ -130,7 +129,9 @@ Duck::ResultRet<RiverPacket> River::receive_packet(int fd, bool block)  {
 
 		//Parse the target
 		auto colon = target.find(':');
-		if(colon == std::string::npos) {
+		if(target.empty()) {
+			//Packets with a target ID don't need a name
+		} else if(colon == std::string::npos) {
 			packet.endpoint = target;
 		} else {
 			packet.endpoint = target.substr(0, colon);
@@ -144,7 +145,8 @@ Duck::ResultRet<RiverPacket> River::receive_packet(int fd, bool block)  {
 }
 
 Result River::send_packet(int fd, sockid_t recipient, const RiverPacket& packet) {
-	auto full_name = packet.endpoint + ":" + packet.path;
+	//If the packet is going to an interned function or message, the ID is all the server needs
+	auto full_name = (packet.endpoint.empty() && packet.path.empty()) ? std::string() : packet.endpoint + ":" + packet.path;
 	size_t n_bytes = full_name.length() + 1 + packet.data.size();
 
 	auto* raw_packet = (RawPacket*) malloc(sizeof(RawPacket) + n_bytes);
@@ -154,6 +156,8 @@ Result River::send_packet(int fd, sockid_t recipient, const RiverPacket& packet)
 	raw_packet->data_length = packet.data.size();
 	raw_packet->path_length = full_name.length() + 1;
 	raw_packet->id = packet.recipient;
+	raw_packet->target_id = packet.target_id;
+	raw_packet->sequence = packet.sequence;
 
 	memcpy(raw_packet->data, full_name.c_str(), full_name.length() + 1);
 	if(!packet.data.empty())
@@ -36,6 +36,7 @@ namespace River {
 
 		CLIENT_CONNECTED = 1,
 		CLIENT_DISCONNECTED = 2,
+		ENDPOINT_DISCONNECTED = 3, ///< Sent to the clients of an endpoint when its host goes away.
 
 		REGISTER_ENDPOINT = 10,
 		GET_ENDPOINT = 11,
@@ -49,7 +50,9 @@ namespace River {
 		GET_MESSAGE = 26,
 		SEND_MESSAGE = 25,
 
-		DEREGISTER_PATH = 30
+		DEREGISTER_PATH = 30,
+
+		OPEN_CHANNEL = 40
 	};
 
 	enum ErrorType {
@@ -76,6 +79,8 @@ namespace River {
 		size_t data_length;
 		ErrorType error;
 		sockid_t id;
+		uint32_t target_id;
+		uint32_t sequence;
 		uint8_t data[];
 	};
 
@@ -97,6 +102,12 @@ namespace River {
 		sockid_t __socketfs_from_id;
 		pid_t __socketfs_from_pid;
 		std::vector<uint8_t> data;
+		/**
+		 * The ID the server gave the function or message this packet is for, when it was registered or looked up.
+		 * Calls, returns and messages use it instead of the endpoint name and path once they have it.
+		 */
+		uint32_t target_id = 0;
+		uint32_t sequence = 0; ///< Which call a FUNCTION_RETURN is in reply to.
 	};
 
 	enum PacketReadResult {
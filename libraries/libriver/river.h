@@ -21,8 +21,11 @@
 
 #include "BusConnection.h"
 #include "BusServer.h"
+#include "Channel.h"
 #include "Endpoint.h"
 #include "Function.hpp"
+#include "Future.hpp"
 #include "Message.hpp"
+#include "SharedBuffers.hpp"
 #include "packet.h"
 
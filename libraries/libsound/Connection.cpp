@@ -45,21 +45,25 @@ void Connection::queue_samples(Duck::Ptr<SampleBuffer> buffer) {
 		buffer = buffer->resample(m_server_samplerate);
 
 	// Queue the samples
-	for(size_t i = 0; i < buffer->num_samples(); i++)
-		m_buffer.push_wait(buffer->samples()[i]);
+	m_buffer.push_wait(buffer->samples(), buffer->num_samples());
+}
+
+void Connection::set_volume(float volume) {
+	server_set_volume(volume);
 }
 
 Connection::Connection(std::shared_ptr<River::Endpoint> endpoint): m_endpoint(std::move(endpoint)) {
 	m_endpoint->get_function(get_server_sample_rate);
 	m_endpoint->get_function(server_request_buffer);
+	m_endpoint->get_function(server_set_volume);
 
 	m_server_samplerate = get_server_sample_rate();
 
-	auto shared_sample_buffer_res = Duck::SharedBuffer::adopt(server_request_buffer());
-	if(shared_sample_buffer_res.is_error()) {
-		Duck::Log::errf("libsound: Could not request buffer: {}", shared_sample_buffer_res.result());
+	auto shared_sample_buffer = server_request_buffer();
+	if(!shared_sample_buffer) {
+		Duck::Log::err("libsound: Could not request buffer");
 		return;
 	}
 
-	m_buffer = Duck::AtomicCircularQueue<Sample, LIBSOUND_QUEUE_SIZE>::attach(shared_sample_buffer_res.value());
+	m_buffer = Duck::AtomicCircularQueue<Sample, LIBSOUND_QUEUE_SIZE>::attach(shared_sample_buffer);
 }
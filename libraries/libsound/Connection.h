@@ -32,6 +32,7 @@ namespace Sound {
 		static Duck::ResultRet<std::shared_ptr<Connection>> create();
 
 		void queue_samples(Duck::Ptr<SampleBuffer> buffer);
+		void set_volume(float volume);
 		[[nodiscard]] uint32_t server_sample_rate() const { return m_server_samplerate; }
 
 	private:
@@ -42,8 +43,9 @@ namespace Sound {
 		Duck::AtomicCircularQueue<Sample, LIBSOUND_QUEUE_SIZE> m_buffer;
 
 		//RIVER FUNCTIONS
-		River::Function<int> server_request_buffer = {"request_buffer"};
+		River::Function<Duck::Ptr<Duck::SharedBuffer>> server_request_buffer = {"request_buffer"};
 		River::Function<uint32_t> get_server_sample_rate = {"get_sample_rate"};
+		River::Function<void, float> server_set_volume = {"set_volume"};
 	};
 }
 
@@ -0,0 +1,147 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2024 Byteduck */
+
+#include "Mix.h"
+#include <libduck/CPU.h>
+#include <algorithm>
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <emmintrin.h>
+#define SOUND_SSE2
+#endif
+
+using namespace Sound;
+
+static_assert(sizeof(Sample) == sizeof(float) * 2);
+
+static inline uint32_t to_16bit_lpcm(const Sample& sample) {
+	auto left = (int16_t) (std::clamp(sample.left, -1.0f, 1.0f) * 32767.0f);
+	auto right = (int16_t) (std::clamp(sample.right, -1.0f, 1.0f) * 32767.0f);
+	return ((uint32_t) (uint16_t) right << 16) | (uint16_t) left;
+}
+
+static inline Sample interpolate(const Sample* src, size_t src_count, float pos) {
+	auto index = (size_t) pos;
+	Sample sample = src[index];
+	if(index + 1 < src_count) {
+		float frac = pos - (float) index;
+		sample.left += (src[index + 1].left - sample.left) * frac;
+		sample.right += (src[index + 1].right - sample.right) * frac;
+	}
+	return sample;
+}
+
+#ifdef SOUND_SSE2
+
+/* Each SSE register holds two interleaved stereo samples. */
+
+__attribute__((target("sse2")))
+static void mix_samples_sse2(Sample* dest, const Sample* src, size_t count, float volume) {
+	auto* dest_f = (float*) dest;
+	auto* src_f = (const float*) src;
+	__m128 vol = _mm_set1_ps(volume);
+	size_t i = 0;
+	for(; i + 4 <= count; i += 4) {
+		__m128 a = _mm_loadu_ps(src_f + i * 2);
+		__m128 b = _mm_loadu_ps(src_f + i * 2 + 4);
+		_mm_storeu_ps(dest_f + i * 2, _mm_add_ps(_mm_loadu_ps(dest_f + i * 2), _mm_mul_ps(a, vol)));
+		_mm_storeu_ps(dest_f + i * 2 + 4, _mm_add_ps(_mm_loadu_ps(dest_f + i * 2 + 4), _mm_mul_ps(b, vol)));
+	}
+	for(; i < count; i++) {
+		dest[i].left += src[i].left * volume;
+		dest[i].right += src[i].right * volume;
+	}
+}
+
+__attribute__((target("sse2")))
+static size_t resample_mix_sse2(Sample* dest, size_t dest_count, const Sample* src, size_t src_count, float step, float volume) {
+	auto* dest_f = (float*) dest;
+	__m128 vol = _mm_set1_ps(volume);
+	size_t i = 0;
+
+	// Two output samples per iteration, as long as both have a following source sample to interpolate towards.
+	for(; i + 2 <= dest_count; i += 2) {
+		float pos0 = (float) i * step;
+		float pos1 = (float) (i + 1) * step;
+		auto index0 = (size_t) pos0;
+		auto index1 = (size_t) pos1;
+		if(index1 + 1 >= src_count)
+			break;
+		__m128 pair0 = _mm_loadu_ps((const float*) &src[index0]);
+		__m128 pair1 = _mm_loadu_ps((const float*) &src[index1]);
+		__m128 from = _mm_movelh_ps(pair0, pair1);
+		__m128 to = _mm_movehl_ps(pair1, pair0);
+		float frac0 = pos0 - (float) index0;
+		float frac1 = pos1 - (float) index1;
+		__m128 frac = _mm_set_ps(frac1, frac1, frac0, frac0);
+		__m128 sample = _mm_add_ps(from, _mm_mul_ps(_mm_sub_ps(to, from), frac));
+		_mm_storeu_ps(dest_f + i * 2, _mm_add_ps(_mm_loadu_ps(dest_f + i * 2), _mm_mul_ps(sample, vol)));
+	}
+
+	for(; i < dest_count; i++) {
+		float pos = (float) i * step;
+		if((size_t) pos >= src_count)
+			break;
+		Sample sample = interpolate(src, src_count, pos);
+		dest[i].left += sample.left * volume;
+		dest[i].right += sample.right * volume;
+	}
+	return i;
+}
+
+__attribute__((target("sse2")))
+static void convert_to_16bit_lpcm_sse2(uint32_t* dest, const Sample* src, size_t count) {
+	auto* src_f = (const float*) src;
+	__m128 min = _mm_set1_ps(-1.0f);
+	__m128 max = _mm_set1_ps(1.0f);
+	__m128 scale = _mm_set1_ps(32767.0f);
+	size_t i = 0;
+	for(; i + 4 <= count; i += 4) {
+		__m128 a = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src_f + i * 2), min), max), scale);
+		__m128 b = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src_f + i * 2 + 4), min), max), scale);
+		// Packing keeps the interleaving, so each 32-bit lane ends up as one left/right frame.
+		__m128i packed = _mm_packs_epi32(_mm_cvttps_epi32(a), _mm_cvttps_epi32(b));
+		_mm_storeu_si128((__m128i*) (dest + i), packed);
+	}
+	for(; i < count; i++)
+		dest[i] = to_16bit_lpcm(src[i]);
+}
+
+#endif
+
+void Sound::mix_samples(Sample* dest, const Sample* src, size_t count, float volume) {
+#ifdef SOUND_SSE2
+	if(Duck::CPU::has_sse2())
+		return mix_samples_sse2(dest, src, count, volume);
+#endif
+	for(size_t i = 0; i < count; i++) {
+		dest[i].left += src[i].left * volume;
+		dest[i].right += src[i].right * volume;
+	}
+}
+
+size_t Sound::resample_mix(Sample* dest, size_t dest_count, const Sample* src, size_t src_count, float step, float volume) {
+#ifdef SOUND_SSE2
+	if(Duck::CPU::has_sse2())
+		return resample_mix_sse2(dest, dest_count, src, src_count, step, volume);
+#endif
+	size_t i = 0;
+	for(; i < dest_count; i++) {
+		float pos = (float) i * step;
+		if((size_t) pos >= src_count)
+			break;
+		Sample sample = interpolate(src, src_count, pos);
+		dest[i].left += sample.left * volume;
+		dest[i].right += sample.right * volume;
+	}
+	return i;
+}
+
+void Sound::convert_to_16bit_lpcm(uint32_t* dest, const Sample* src, size_t count) {
+#ifdef SOUND_SSE2
+	if(Duck::CPU::has_sse2())
+		return convert_to_16bit_lpcm_sse2(dest, src, count);
+#endif
+	for(size_t i = 0; i < count; i++)
+		dest[i] = to_16bit_lpcm(src[i]);
+}
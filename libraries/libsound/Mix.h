@@ -0,0 +1,46 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2024 Byteduck */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "Sample.h"
+
+/*
+ * Mixing kernels for interleaved stereo samples. Mixing never clamps; samples are allowed to exceed [-1, 1] while being
+ * mixed so that loud streams don't distort each other, and are only clamped once when converted for output.
+ * SSE2 is used when the CPU supports it.
+ */
+
+namespace Sound {
+	/**
+	 * Adds samples into a mix buffer.
+	 * @param dest The buffer to mix into.
+	 * @param src The samples to add.
+	 * @param count The number of samples to mix.
+	 * @param volume The factor to scale src by.
+	 */
+	void mix_samples(Sample* dest, const Sample* src, size_t count, float volume = 1.0f);
+
+	/**
+	 * Resamples samples using linear interpolation and adds them into a mix buffer.
+	 * @param dest The buffer to mix into.
+	 * @param dest_count The maximum number of samples to write to dest.
+	 * @param src The samples to resample.
+	 * @param src_count The number of samples in src.
+	 * @param step The distance in src between each sample in dest (source rate / destination rate).
+	 * @param volume The factor to scale src by.
+	 * @return The number of samples written to dest.
+	 */
+	size_t resample_mix(Sample* dest, size_t dest_count, const Sample* src, size_t src_count, float step, float volume = 1.0f);
+
+	/**
+	 * Clamps samples and converts them to signed 16-bit stereo LPCM.
+	 * @param dest The buffer to write frames to, with the left channel in the low half of each.
+	 * @param src The samples to convert.
+	 * @param count The number of samples to convert.
+	 */
+	void convert_to_16bit_lpcm(uint32_t* dest, const Sample* src, size_t count);
+}
+
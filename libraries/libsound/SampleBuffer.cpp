@@ -18,6 +18,7 @@
 */
 
 #include "SampleBuffer.h"
+#include "Mix.h"
 #include <libduck/Log.h>
 
 using namespace Sound;
@@ -37,24 +38,14 @@ Ptr<SampleBuffer> SampleBuffer::resample(uint32_t sample_rate) const {
 	float ratio = (float) sample_rate / (float) m_sample_rate;
 	size_t new_num_samples = (size_t) (m_num_samples * ratio);
 	auto new_buf = SampleBuffer::make(sample_rate, new_num_samples);
+	memset(new_buf->m_samples, 0, sizeof(Sample) * new_num_samples);
 	resample_mix_into(sample_rate, new_buf, m_num_samples, 1);
 	return new_buf;
 }
 
 void SampleBuffer::resample_mix_into(uint32_t sample_rate, Duck::Ptr<SampleBuffer> buffer, size_t n_samples, float factor) const {
-	float ratio = (float) sample_rate / (float) m_sample_rate;
-	for(size_t i = 0; i < buffer->m_num_samples; i++) {
-		float sample_pos = (float) i / ratio;
-		size_t sample_pos_int = (size_t) sample_pos;
-		if (sample_pos_int >= n_samples)
-			break;
-		float sample_pos_frac = sample_pos - sample_pos_int;
-		Sample sample = m_samples[sample_pos_int];
-		if(sample_pos_int + 1 < m_num_samples) {
-			sample += (m_samples[sample_pos_int + 1] - sample) * sample_pos_frac;
-		}
-		buffer->m_samples[i] += sample * factor;
-	}
+	float step = (float) m_sample_rate / (float) sample_rate;
+	resample_mix(buffer->m_samples, buffer->m_num_samples, m_samples, std::min(n_samples, m_num_samples), step, factor);
 }
 
 Sample* SampleBuffer::samples() const {
@@ -3,14 +3,14 @@
 
 #include "Sound.h"
 #include <sys/thread.h>
-#include <libduck/SpinLock.h>
+#include <libduck/Mutex.h>
 #include "Connection.h"
 #include "WavReader.h"
 #include "SoundSource.h"
 
 using namespace Sound;
 
-Duck::SpinLock sound_lock;
+Duck::Mutex sound_lock;
 Duck::Ptr<Connection> connection;
 std::vector<Duck::WeakPtr<SoundSource>> sources;
 bool exit_on_finish = false;
@@ -55,6 +55,11 @@ Duck::Ptr<SoundSource> Sound::add_source(Duck::Ptr<WavReader> reader) {
 	return source;
 }
 
+void Sound::set_volume(float volume) {
+	if(connection)
+		connection->set_volume(volume);
+}
+
 Duck::Result Sound::init() {
 	if(connection)
 		return Duck::Result(EXIT_SUCCESS);
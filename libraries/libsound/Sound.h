@@ -12,4 +12,5 @@ namespace Sound {
 	Duck::Result init();
 	Duck::Ptr<SoundSource> add_source(Duck::Ptr<WavReader> reader);
 	void wait();
+	void set_volume(float volume);
 }
\ No newline at end of file
@@ -24,7 +24,7 @@
 #include <libduck/File.h>
 #include "SampleBuffer.h"
 #include <libduck/MappedBuffer.h>
-#include <libduck/SpinLock.h>
+#include <libduck/Mutex.h>
 
 #define WAV_RIFF_MAGIC 0x46464952
 #define WAV_WAV_MAGIC 0x45564157
@@ -79,6 +79,6 @@ namespace Sound {
 		Duck::Ptr<Duck::MappedBuffer> m_mapped_file;
 		WavHeader& m_header;
 		size_t m_offset;
-		Duck::SpinLock m_lock;
+		Duck::Mutex m_lock;
 	};
 }
\ No newline at end of file
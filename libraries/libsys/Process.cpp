@@ -22,9 +22,25 @@
 #include <libduck/Config.h>
 #include <unistd.h>
 #include <libduck/File.h>
+#include <sys/times.h>
+#include <algorithm>
 
 using namespace Sys;
-using Duck::Result, Duck::ResultRet, Duck::Path;
+using Duck::Result, Duck::ResultRet, Duck::Path, Duck::Time;
+
+namespace {
+	Time time_from_usec(unsigned long long usec) {
+		return {(int64_t) (usec / 1000000), (long) (usec % 1000000)};
+	}
+
+	double usec(const Time& time) {
+		return (double) time.epoch() * 1000000 + time.interval_usec();
+	}
+
+	Time uptime() {
+		return Time::millis(times(nullptr));
+	}
+}
 
 std::map<pid_t, Process> Process::get_all() {
 	std::map<pid_t, Process> ret;
@@ -114,9 +130,27 @@ Result Process::update() {
 		_threads.push_back(std::stoi(thrd));
 	}
 
+	_sample_time = uptime();
+	_user_time = time_from_usec(std::stoull(proc["utime"]));
+	_kernel_time = time_from_usec(std::stoull(proc["stime"]));
+	_start_time = time_from_usec(std::stoull(proc["start"]));
+
+	double lifetime = usec(_sample_time - _start_time);
+	_cpu_percent = lifetime > 0 ? std::min(usec(cpu_time()) / lifetime * 100.0, 100.0) : 0;
+
 	return Result::SUCCESS;
 }
 
+void Process::measure_since(const Process& previous) {
+	if(previous._pid != _pid || !(previous._start_time == _start_time))
+		return;
+	double elapsed = usec(_sample_time - previous._sample_time);
+	if(elapsed <= 0)
+		return;
+	double used = usec(cpu_time()) - usec(previous.cpu_time());
+	_cpu_percent = std::max(std::min(used / elapsed * 100.0, 100.0), 0.0);
+}
+
 Duck::ResultRet<std::vector<Process::MemoryRegion>> Process::memory_regions() const {
 	auto file = TRY(Duck::File::open("/proc/" + std::to_string(_pid) + "/vmspace", "r"));
 	auto stream = Duck::FileInputStream(file);
@@ -165,3 +199,32 @@ Duck::ResultRet<std::vector<Process::MemoryRegion>> Process::memory_regions() co
 	out.shrink_to_fit();
 	return out;
 }
+
+Duck::ResultRet<std::vector<Process::ThreadInfo>> Process::thread_info() const {
+	auto file = TRY(Duck::File::open("/proc/" + std::to_string(_pid) + "/threads", "r"));
+	auto stream = Duck::FileInputStream(file);
+	std::vector<ThreadInfo> out;
+	while (!stream.eof()) {
+		std::string line;
+		stream >> line;
+		if (line.empty())
+			continue;
+		Duck::StringInputStream line_stream {line};
+		line_stream.set_delimeter('\t');
+		std::string parts[4];
+		int idx = 0;
+		while (!line_stream.eof() && idx < 4)
+			line_stream >> parts[idx++];
+		if (idx != 4) {
+			Duck::Log::warnf("libsys: Invalid thread description for {}: {}", _pid, line);
+			continue;
+		}
+		out.push_back({
+			std::stoi(parts[0]),
+			parts[1],
+			time_from_usec(std::stoull(parts[2])),
+			time_from_usec(std::stoull(parts[3]))
+		});
+	}
+	return out;
+}
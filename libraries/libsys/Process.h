@@ -23,6 +23,7 @@
 #include "Memory.h"
 #include <map>
 #include <libapp/App.h>
+#include <libduck/Time.h>
 
 namespace Sys {
 	class Process {
@@ -49,6 +50,13 @@ namespace Sys {
 			std::string name;
 		};
 
+		struct ThreadInfo {
+			tid_t tid;
+			std::string state;
+			Duck::Time user_time;
+			Duck::Time kernel_time;
+		};
+
 		static std::map<pid_t, Process> get_all();
 		static Duck::ResultRet<Process> get(pid_t pid);
 		static Duck::ResultRet<Process> self();
@@ -66,6 +74,25 @@ namespace Sys {
 		Mem::Amount shared_mem() const { return _shared_mem; }
 		const std::vector<tid_t>& threads() const { return _threads; }
 		Duck::ResultRet<std::vector<MemoryRegion>> memory_regions() const;
+		Duck::ResultRet<std::vector<ThreadInfo>> thread_info() const;
+
+		/// The CPU time the process has spent running its own code.
+		Duck::Time user_time() const { return _user_time; }
+		/// The CPU time the process has spent in the kernel.
+		Duck::Time kernel_time() const { return _kernel_time; }
+		/// The total CPU time the process has used.
+		Duck::Time cpu_time() const { return _user_time + _kernel_time; }
+		/// The uptime of the system when the process was started.
+		Duck::Time start_time() const { return _start_time; }
+		/// The percentage of a CPU the process used; since it started, or since the sample passed to measure_since().
+		double cpu_percent() const { return _cpu_percent; }
+
+		/**
+		 * Measures the process's CPU usage since an earlier sample of the same process, so that cpu_percent() shows how
+		 * busy it is now instead of how busy it has been on average since it started.
+		 * @param previous The earlier sample of the process.
+		 */
+		void measure_since(const Process& previous);
 
 		Duck::ResultRet<App::Info> app_info() const;
 
@@ -82,6 +109,11 @@ namespace Sys {
 		Mem::Amount _virtual_mem;
 		Mem::Amount _shared_mem;
 		std::vector<tid_t> _threads;
+		Duck::Time _user_time;
+		Duck::Time _kernel_time;
+		Duck::Time _start_time;
+		Duck::Time _sample_time; ///< The uptime when this sample was taken.
+		double _cpu_percent = 0;
 	};
 }
 
@@ -45,14 +45,17 @@ void Line::resize(int new_size) {
 	chars.resize(new_size);
 	for(int i = old_size; i < new_size; i++)
 		chars[i] = fill_char;
+	dirty = true;
 }
 
 void Line::fill(Character fill_char) {
 	for(int i = 0; i < chars.size(); i++)
 		chars[i] = fill_char;
+	dirty = true;
 }
 
 void Line::clear(Attribute attr) {
 	for(int i = 0; i < chars.size(); i++)
 		chars[i] = {0, attr};
+	dirty = true;
 }
\ No newline at end of file
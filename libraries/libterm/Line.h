@@ -34,6 +34,8 @@ namespace Term {
 		void fill(Character fill_char);
 		void clear(Attribute attr);
 
+		bool dirty = true; ///< Whether the line changed since the listener last drew it
+
 	private:
 		Vector<Character> chars;
 	};
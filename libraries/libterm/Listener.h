@@ -25,6 +25,11 @@ namespace Term {
 	class Listener {
 	public:
 		virtual void on_character_change(const Position& position, const Character& character) = 0;
+		/// Called when a run of characters on one line is written at once.
+		virtual void on_characters_change(const Position& position, const Character* characters, int count) {
+			for(int i = 0; i < count; i++)
+				on_character_change({position.col + i, position.line}, characters[i]);
+		}
 		virtual void on_cursor_change(const Position& old_position) = 0;
 		virtual void on_backspace(const Position& position) = 0;
 		virtual void on_clear() = 0;
@@ -32,30 +32,20 @@
 using namespace Term;
 using namespace Keyboard;
 
-Terminal::Terminal(const Size& dimensions, Listener& listener):
-dimensions(dimensions),
+Terminal::Terminal(const Size& dimensions, Listener& listener, int scrollback):
 cursor_position({0,0}),
 current_attribute({TERM_DEFAULT_FOREGROUND, TERM_DEFAULT_BACKGROUND}),
 listener(listener)
 {
-	screen.resize(dimensions.lines);
-	for(int y = 0; y < dimensions.lines; y++)
-		screen[y].resize(dimensions.cols);
+	resize_lines(dimensions, scrollback > 0 ? scrollback : 0);
+	this->dimensions = dimensions;
 }
 
 void Terminal::set_dimensions(const Term::Size& new_size) {
 	if(new_size.lines <= 0 || new_size.cols <= 0)
 		return;
 
-	if(new_size.lines < dimensions.lines) {
-		for(int y = 0; y < new_size.lines; y++) {
-			screen[y] = screen[y + (dimensions.lines - new_size.lines)];
-		}
-	}
-
-	screen.resize(new_size.lines);
-	for(int y = 0; y < new_size.lines; y++)
-		screen[y].resize(new_size.cols);
+	resize_lines(new_size, scrollback);
 
 	if(cursor_position.col >= new_size.cols)
 		cursor_position.col = new_size.cols - 1;
@@ -71,11 +61,46 @@ Term::Size Terminal::get_dimensions() {
 	return dimensions;
 }
 
+void Terminal::set_scrollback(int new_scrollback) {
+	resize_lines(dimensions, new_scrollback > 0 ? new_scrollback : 0);
+}
+
+int Terminal::get_scrollback_lines() {
+	return history_lines;
+}
+
+void Terminal::resize_lines(const Size& new_size, int new_scrollback) {
+	//If the screen gets shorter, we keep the bottom of it and the lines above that become scrollback
+	int shift = dimensions.lines > new_size.lines ? dimensions.lines - new_size.lines : 0;
+	int new_history = history_lines + shift < new_scrollback ? history_lines + shift : new_scrollback;
+	int first_old_line = history_lines + shift - new_history;
+	int old_total = history_lines + dimensions.lines;
+	int old_capacity = lines.size();
+
+	//Copy the lines we're keeping into a new ring, oldest first
+	Vector<Line> new_lines;
+	new_lines.resize(new_size.lines + new_scrollback);
+	for(int i = 0; i < new_history + new_size.lines; i++) {
+		int old_line = first_old_line + i;
+		if(old_line < old_total)
+			new_lines[i] = lines[(top_line - history_lines + old_line + old_capacity) % old_capacity];
+		new_lines[i].resize(new_size.cols);
+		new_lines[i].dirty = true;
+	}
+
+	lines = new_lines;
+	top_line = new_history;
+	history_lines = new_history;
+	scrollback = new_scrollback;
+}
+
 void Terminal::set_cursor(const Term::Position& position) {
 	auto old_pos = cursor_position;
 	cursor_position = position;
-	if(old_pos.col >= 0 && old_pos.col < dimensions.cols && old_pos.line >= 0 && old_pos.line < dimensions.lines)
+	if(old_pos.col >= 0 && old_pos.col < dimensions.cols && old_pos.line >= 0 && old_pos.line < dimensions.lines) {
+		screen_line(old_pos.line).dirty = true;
 		listener.on_cursor_change(old_pos);
+	}
 }
 
 void Terminal::advance_cursor() {
@@ -159,12 +184,6 @@ void Terminal::emit_str(const char* str) {
 }
 
 void Terminal::write_char(char c_signed) {
-	static uint32_t utf8_buffer = 0;
-	static int utf8_index = 0;
-	static int utf8_char_length = 1;
-	static uint8_t utf8_remaining_bits = 0;
-	static uint8_t utf8_first_char_mask = 0;
-
 	char c = (unsigned char) c_signed;
 
 	if(utf8_index == 0) {
@@ -240,6 +259,10 @@ void Terminal::write_codepoint(uint32_t codepoint) {
 			break;
 	}
 
+	move_cursor(new_cursor_pos);
+}
+
+void Terminal::move_cursor(Position new_cursor_pos) {
 	if(new_cursor_pos.col == dimensions.cols) {
 		new_cursor_pos.line++;
 		new_cursor_pos.col = 0;
@@ -256,8 +279,43 @@ void Terminal::write_codepoint(uint32_t codepoint) {
 }
 
 void Terminal::write_chars(const char* buffer, size_t length) {
-	for(size_t i = 0; i < length; i++)
-		write_char(buffer[i]);
+	size_t i = 0;
+	while(i < length) {
+		//Runs of printable ASCII outside of escape and UTF-8 sequences can be written a line at a time
+		if(!escape_mode && !utf8_index && buffer[i] >= ' ' && buffer[i] <= '~') {
+			size_t run_end = i + 1;
+			while(run_end < length && buffer[run_end] >= ' ' && buffer[run_end] <= '~')
+				run_end++;
+			write_printable(buffer + i, run_end - i);
+			i = run_end;
+		} else {
+			write_char(buffer[i++]);
+		}
+	}
+}
+
+void Terminal::write_printable(const char* chars, size_t count) {
+	while(count) {
+		if(cursor_position.col < 0 || cursor_position.col >= dimensions.cols || cursor_position.line < 0 || cursor_position.line >= dimensions.lines) {
+			write_codepoint(*(chars++));
+			count--;
+			continue;
+		}
+
+		//Write as much as fits on the current line, then move the cursor once
+		auto& line = screen_line(cursor_position.line);
+		int run = dimensions.cols - cursor_position.col;
+		if((size_t) run > count)
+			run = (int) count;
+		for(int i = 0; i < run; i++)
+			line[cursor_position.col + i] = {(uint32_t) chars[i], current_attribute};
+		line.dirty = true;
+		listener.on_characters_change(cursor_position, &line[cursor_position.col], run);
+
+		chars += run;
+		count -= run;
+		move_cursor({cursor_position.col + run, cursor_position.line});
+	}
 }
 
 void Terminal::write_codepoints(const uint32_t* buffer, size_t length) {
@@ -268,53 +326,70 @@ void Terminal::write_codepoints(const uint32_t* buffer, size_t length) {
 Term::Character Terminal::get_character(const Term::Position& pos) {
 	if(pos.col >= dimensions.cols || pos.col < 0 || pos.line >= dimensions.lines || pos.line < 0)
 		return {};
-	return screen[pos.line][pos.col];
+	return screen_line(pos.line)[pos.col];
 }
 
 void Terminal::set_character(const Position& pos, const Character& character) {
 	if(pos.col >= dimensions.cols || pos.col < 0 || pos.line >= dimensions.lines || pos.line < 0)
 		return;
-	screen[pos.line][pos.col] = character;
+	auto& line = screen_line(pos.line);
+	line[pos.col] = character;
+	line.dirty = true;
 	listener.on_character_change(pos, character);
 }
 
-void Terminal::scroll(int lines) {
-	if(lines >= dimensions.lines) {
-		clear();
+Line& Terminal::get_line(int line) {
+	if(line < -history_lines)
+		line = -history_lines;
+	else if(line >= dimensions.lines)
+		line = dimensions.lines - 1;
+	return lines[(top_line + line + lines.size()) % lines.size()];
+}
+
+bool Terminal::is_line_dirty(int line) {
+	return line >= 0 && line < dimensions.lines && screen_line(line).dirty;
+}
+
+void Terminal::clear_dirty() {
+	for(int y = 0; y < dimensions.lines; y++)
+		screen_line(y).dirty = false;
+}
+
+void Terminal::scroll(int num_lines) {
+	if(num_lines <= 0)
 		return;
+
+	//Move the top of the screen down the ring. The top lines become scrollback, and the line after the bottom of the
+	//screen (either unused or the oldest scrollback) is cleared to become the new bottom line.
+	int to_move = num_lines < dimensions.lines ? num_lines : dimensions.lines;
+	for(int i = 0; i < to_move; i++) {
+		top_line = (top_line + 1) % lines.size();
+		if(history_lines < scrollback)
+			history_lines++;
+		auto& line = screen_line(dimensions.lines - 1);
+		line.resize(dimensions.cols);
+		line.clear(current_attribute);
 	}
 
-	int clear_start_line = dimensions.lines - lines;
-	for(int y = 0; y < dimensions.lines; y++) {
-		for(int x = 0; x < dimensions.cols; x++) {
-			if(y >= clear_start_line) {
-				screen[y][x] = {0, current_attribute};
-			} else {
-				screen[y][x] = screen[y + lines][x];
-			}
-		}
+	if(num_lines >= dimensions.lines) {
+		clear();
+		return;
 	}
 
-	listener.on_scroll(lines);
+	listener.on_scroll(num_lines);
 }
 
 void Terminal::clear() {
 	set_cursor({0,0});
-	for(int y = 0; y < dimensions.lines; y++) {
-		auto& line = screen[y];
-		for(int x = 0; x < dimensions.cols; x++) {
-			line[x] = {0, current_attribute};
-		}
-	}
+	for(int y = 0; y < dimensions.lines; y++)
+		screen_line(y).clear(current_attribute);
 	listener.on_clear();
 }
 
 void Terminal::clear_line(int line) {
 	if(line < 0 || line >= dimensions.lines)
 		return;
-	auto& line_vec = screen[line];
-	for(int x = 0; x < dimensions.cols; x++)
-		line_vec[x] = {0, current_attribute};
+	screen_line(line).clear(current_attribute);
 	listener.on_clear_line(line);
 }
 
@@ -28,10 +28,18 @@ namespace Term {
 	class Terminal {
 	public:
 		Terminal() = delete;
-		Terminal(const Size& dimensions, Listener& listener);
+		/**
+		 * Creates a terminal.
+		 * @param dimensions The size of the screen.
+		 * @param listener The listener to notify of changes.
+		 * @param scrollback The number of lines that scroll off the top of the screen to keep.
+		 */
+		Terminal(const Size& dimensions, Listener& listener, int scrollback = 0);
 
 		void set_dimensions(const Size& new_size);
 		Size get_dimensions();
+		void set_scrollback(int scrollback);
+		int get_scrollback_lines();
 		void set_cursor(const Position& position);
 		void advance_cursor();
 		void regress_cursor();
@@ -45,7 +53,15 @@ namespace Term {
 		void write_codepoints(const uint32_t* buffer, size_t length);
 		Character get_character(const Position& position);
 		void set_character(const Position& position, const Character& character);
-		void scroll(int lines);
+		/**
+		 * Gets a line of the screen or scrollback.
+		 * @param line The line to get. Lines 0 to dimensions.lines - 1 are on the screen, and negative lines down to
+		 *             -get_scrollback_lines() are scrollback, with -1 being the line just above the screen.
+		 */
+		Line& get_line(int line);
+		bool is_line_dirty(int line);
+		void clear_dirty();
+		void scroll(int num_lines);
 		void clear();
 		void clear_line(int line);
 		void set_current_attribute(const Attribute& attribute);
@@ -62,12 +78,30 @@ namespace Term {
 			Beginning, Value
 		};
 
+		Line& screen_line(int line) { return lines[(top_line + line) % lines.size()]; }
+		void resize_lines(const Size& new_size, int new_scrollback);
+		void move_cursor(Position new_pos);
+		void write_printable(const char* chars, size_t count);
+
 		Attribute current_attribute = {TERM_DEFAULT_FOREGROUND, TERM_DEFAULT_BACKGROUND};
 		Position cursor_position = {0, 0};
 		Size dimensions = {0, 0};
-		Vector<Line> screen;
 		Listener& listener;
 
+		/*
+		 * The screen and scrollback are kept in one ring of lines, so scrolling only moves top_line instead of copying
+		 * the whole screen. The history_lines lines before top_line are scrollback.
+		 */
+		Vector<Line> lines;
+		int top_line = 0;
+		int history_lines = 0;
+		int scrollback = 0;
+
+		uint32_t utf8_buffer = 0;
+		int utf8_index = 0;
+		int utf8_char_length = 1;
+		uint8_t utf8_remaining_bits = 0;
+
 		bool escape_mode = false;
 		EscapeStatus escape_status = Beginning;
 		char escape_parameters[10][10];
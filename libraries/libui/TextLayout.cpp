@@ -2,10 +2,55 @@
 /* Copyright © 2016-2024 Byteduck */
 
 #include "TextLayout.h"
+#include <climits>
+#include <list>
+#include <unordered_map>
+
+// Text longer than this isn't cached, since it's probably being edited rather than drawn over and over
+#define TEXT_LAYOUT_CACHE_MAX_LENGTH 256
+#define TEXT_LAYOUT_CACHE_SIZE 128
 
 using namespace UI;
 using namespace Gfx;
 
+namespace {
+	/*
+	 * Labels, buttons, menus and table cells lay out the same short strings every time they're drawn, so we keep the
+	 * most recently used layouts around and reuse them if the text, font, and layout parameters are the same.
+	 */
+	struct LayoutKey {
+		std::string text;
+		Font* font;
+		Dimensions dimensions;
+		TextLayout::TruncationMode truncation_mode;
+		TextLayout::BreakMode break_mode;
+
+		bool operator==(const LayoutKey& other) const {
+			return text == other.text && font == other.font && dimensions == other.dimensions
+				&& truncation_mode == other.truncation_mode && break_mode == other.break_mode;
+		}
+	};
+
+	struct LayoutKeyHash {
+		size_t operator()(const LayoutKey& key) const {
+			size_t hash = std::hash<std::string>()(key.text);
+			hash = hash * 31 + (size_t) key.font;
+			hash = hash * 31 + key.dimensions.width;
+			hash = hash * 31 + key.dimensions.height;
+			return hash * 31 + ((size_t) key.truncation_mode << 1 | (size_t) key.break_mode);
+		}
+	};
+
+	struct CachedLayout {
+		LayoutKey key;
+		std::vector<TextLayout::Line> lines;
+		Dimensions dimensions;
+	};
+
+	std::list<CachedLayout> cached_layouts; // Most recently used first
+	std::unordered_map<LayoutKey, std::list<CachedLayout>::iterator, LayoutKeyHash> cached_layout_map;
+}
+
 const TextLayout::CursorPos TextLayout::CursorPos::none = {{-1, -1}, {-1, -1}, (size_t) -1, (size_t) -1};
 
 TextLayout::TextLayout(Duck::Ptr<ImmutableTextStorage> storage, Gfx::Dimensions dimensions, Gfx::Font* font, TruncationMode truncation, BreakMode line_break):
@@ -82,17 +127,41 @@ TextLayout::CursorPos TextLayout::get_cursor() const {
 }
 
 void TextLayout::recalculate_layout() {
+	if (m_target_dimensions.height == -1)
+		m_target_dimensions.height = INT_MAX - (m_font->bounding_box().height * 2); // Hacky? Yes. Does it work? Also yes.
+
+	auto contents = m_storage.lock()->text();
+	if (contents.size() > TEXT_LAYOUT_CACHE_MAX_LENGTH)
+		return calculate_layout(contents);
+
+	LayoutKey key = {std::string(contents), m_font, m_target_dimensions, m_truncation_mode, m_break_mode};
+	auto cached = cached_layout_map.find(key);
+	if (cached != cached_layout_map.end()) {
+		cached_layouts.splice(cached_layouts.begin(), cached_layouts, cached->second);
+		m_lines = cached->second->lines;
+		m_dimensions = cached->second->dimensions;
+		return;
+	}
+
+	calculate_layout(contents);
+
+	if (cached_layouts.size() >= TEXT_LAYOUT_CACHE_SIZE) {
+		cached_layout_map.erase(cached_layouts.back().key);
+		cached_layouts.pop_back();
+	}
+	cached_layouts.push_front({key, m_lines, m_dimensions});
+	cached_layout_map[std::move(key)] = cached_layouts.begin();
+}
+
+void TextLayout::calculate_layout(std::string_view contents) {
 	//TODO: Unicode Support
 	Point cur_pos = {0, 0};
 	Point line_pos = {0, 0};
-	if (m_target_dimensions.height == -1)
-		m_target_dimensions.height = INT_MAX - (m_font->bounding_box().height * 2); // Hacky? Yes. Does it work? Also yes.
 	Rect rect = {0, 0, m_target_dimensions};
 	Line cur_line;
 	Dimensions total_dimensions {0, 0};
 	m_lines.clear();
 
-	auto contents = m_storage.lock()->text();
 	const char* cur_char = contents.data();
 	const char* last_word = contents.data();
 	const char* last_word_break = contents.data();
@@ -53,6 +53,8 @@ namespace UI {
 		[[nodiscard]] Duck::Ptr<ImmutableTextStorage> storage() const { return m_storage.lock(); }
 
 	private:
+		void calculate_layout(std::string_view contents);
+
 		Duck::WeakPtr<ImmutableTextStorage> m_storage;
 		CursorPos m_cursor_pos = CursorPos::none;
 		std::vector<Line> m_lines;
@@ -18,6 +18,7 @@
 */
 
 #include <sys/time.h>
+#include <cstdlib>
 #include "Window.h"
 #include "libui.h"
 #include "Theme.h"
@@ -154,10 +155,47 @@ void Window::repaint() {
 	_needs_repaint = true;
 }
 
-void Window::repaint_now() {
-	if(!_needs_repaint)
+void Window::repaint(Gfx::Rect area) {
+	_damage.add(area);
+}
+
+void Window::scroll(Gfx::Rect area, Gfx::Point delta) {
+	if(delta.x == 0 && delta.y == 0)
+		return;
+
+	// We can only keep track of one scrolled area per frame, so anything else just gets redrawn
+	if(_needs_repaint || (!_scroll_area.empty() && (_scroll_area.position() != area.position() || _scroll_area.dimensions() != area.dimensions()))) {
+		repaint(area);
 		return;
+	}
+	auto new_delta = _scroll_delta + delta;
+	if(std::abs(new_delta.x) >= area.width || std::abs(new_delta.y) >= area.height) {
+		repaint(area);
+		return;
+	}
+
+	// Whatever was already going to be redrawn in the area moves along with it, and what was scrolled into view
+	// needs to be drawn
+	Gfx::Region damage = _damage;
+	for(auto& rect : _damage.intersection(area).rects())
+		damage.add(rect.transform(delta).overlapping_area(area));
+	Gfx::Region exposed = area;
+	exposed.subtract(area.transform(delta));
+	damage.add(exposed);
+	_damage = std::move(damage);
+	_scroll_area = area;
+	_scroll_delta = new_delta;
+}
+
+void Window::repaint_now() {
+	if(!_needs_repaint) {
+		if((_damage.empty() && _scroll_area.empty()) || repaint_damage())
+			return;
+	}
 	_needs_repaint = false;
+	_damage.clear();
+	_scroll_area = {0, 0, 0, 0};
+	_scroll_delta = {0, 0};
 
 	//Next, draw the window frame
 	auto framebuffer = _window->framebuffer();
@@ -237,6 +275,110 @@ void Window::repaint_now() {
 	if(_titlebar_accessory)
 		blit_widget(_titlebar_accessory);
 	_window->invalidate();
+	_last_damage = Gfx::Rect {0, 0, framebuffer.width, framebuffer.height};
+}
+
+bool Window::repaint_damage() {
+	auto framebuffer = _window->framebuffer();
+	Gfx::Rect bounds = {0, 0, framebuffer.width, framebuffer.height};
+	_damage.intersect(bounds);
+
+	std::vector<Widget*> layers;
+	if(_contents)
+		collect_layers(_contents, layers);
+	if(_titlebar_accessory)
+		collect_layers(_titlebar_accessory, layers);
+
+	// A scrolled area can only be moved as-is if it's all one opaque widget with nothing drawn over it, since
+	// otherwise the pixels being moved aren't just that widget's. If it isn't, it just gets redrawn.
+	auto scroll_area = _scroll_area;
+	auto scroll_delta = _scroll_delta;
+	_scroll_area = {0, 0, 0, 0};
+	_scroll_delta = {0, 0};
+	if(!scroll_area.empty()) {
+		bool can_move = bounds.contains(scroll_area);
+		for(size_t i = layers.size(); i > 0 && can_move; i--) {
+			auto* layer = layers[i - 1];
+			auto layer_rect = layer->window_visible_rect();
+			if(!layer->_uses_alpha && layer_rect.contains(scroll_area))
+				break;
+			if(layer_rect.collides(scroll_area))
+				can_move = false;
+		}
+		if(!can_move) {
+			_damage.add(scroll_area);
+			scroll_area = {0, 0, 0, 0};
+		}
+	}
+	if(_damage.empty() && scroll_area.empty())
+		return true;
+
+	// Each damaged rect must be completely covered by an opaque widget, so that we can start drawing from there
+	// without redrawing the decorations or anything else underneath it. Otherwise, fall back to a full repaint.
+
+	std::vector<std::pair<Gfx::Rect, size_t>> draws;
+	for(auto& rect : _damage.rects()) {
+		auto base = layers.size();
+		for(size_t i = layers.size(); i > 0; i--) {
+			auto* layer = layers[i - 1];
+			if(!layer->_uses_alpha && layer->window_visible_rect().contains(rect)) {
+				base = i - 1;
+				break;
+			}
+		}
+		if(base == layers.size())
+			return false;
+		draws.emplace_back(rect, base);
+	}
+
+	// Widgets may request more repaints while drawing; those go into the next frame
+	Gfx::Region damage = std::move(_damage);
+	_damage.clear();
+
+	// The inactive framebuffer is a frame behind; bring over whatever was drawn last frame that we won't redraw now,
+	// and move over whatever was scrolled from where it was last frame
+	auto moved = scroll_area.overlapping_area(scroll_area.transform(scroll_delta));
+	Gfx::Region stale = _last_damage;
+	stale.subtract(damage);
+	if(!scroll_area.empty())
+		stale.subtract(moved);
+	auto front = _window->front_framebuffer();
+	for(auto& rect : stale.rects())
+		framebuffer.copy(front, rect, rect.position());
+	if(!scroll_area.empty())
+		framebuffer.copy(front, moved.transform(scroll_delta * -1), moved.position());
+
+	for(auto& draw : draws) {
+		for(size_t i = draw.second; i < layers.size(); i++) {
+			auto* layer = layers[i];
+			auto area = layer->window_visible_rect().overlapping_area(draw.first);
+			if(area.width <= 0 || area.height <= 0)
+				continue;
+			layer->repaint_now();
+			auto source = area.transform(layer->_absolute_rect.position() * -1);
+			if(layer->_uses_alpha)
+				framebuffer.copy_blitting(layer->_framebuffer, source, area.position());
+			else
+				framebuffer.copy(layer->_framebuffer, source, area.position());
+		}
+	}
+
+	if(!scroll_area.empty()) {
+		_window->scroll_area(scroll_area, scroll_delta, damage.empty() ? Gfx::Rect {0, 0, 0, 0} : damage.bounds());
+		damage.add(moved);
+	} else {
+		_window->invalidate_area(damage.bounds());
+	}
+	_last_damage = std::move(damage);
+	return true;
+}
+
+void Window::collect_layers(Duck::PtrRef<Widget> widget, std::vector<Widget*>& layers) {
+	if(widget->_hidden)
+		return;
+	layers.push_back(widget.get());
+	for(auto& child : widget->children)
+		collect_layers(child, layers);
 }
 
 void Window::close() {
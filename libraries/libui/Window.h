@@ -57,6 +57,8 @@ namespace UI {
 		void bring_to_front();
 		void focus();
 		void repaint();
+		void repaint(Gfx::Rect area);
+		void scroll(Gfx::Rect area, Gfx::Point delta);
 		void repaint_now();
 		void close();
 		void show();
@@ -94,6 +96,8 @@ namespace UI {
 	private:
 		void initialize() override;
 		void blit_widget(Duck::PtrRef<Widget> widget);
+		bool repaint_damage();
+		void collect_layers(Duck::PtrRef<Widget> widget, std::vector<Widget*>& layers);
 		void set_focused_widget(Duck::PtrRef<Widget> widget);
 
 		friend class Widget;
@@ -110,6 +114,10 @@ namespace UI {
 		bool _uses_alpha = true;
 		bool _resizable = false;
 		bool _needs_repaint = false;
+		Gfx::Region _damage; ///< Areas that need to be redrawn in the next partial repaint.
+		Gfx::Region _last_damage; ///< Areas drawn in the last frame, which are stale in the inactive framebuffer.
+		Gfx::Rect _scroll_area = {0, 0, 0, 0}; ///< The area scrolled since the last frame, if any.
+		Gfx::Point _scroll_delta = {0, 0}; ///< How far the contents of _scroll_area moved.
 		bool _focused = false;
 		bool _closed = false;
 		bool _center_on_show = true;
@@ -80,7 +80,19 @@ void Widget::set_sizing_mode(SizingMode mode) {
 void Widget::repaint() {
 	_dirty = true;	
 	if(_root_window)
-		_root_window->repaint();
+		_root_window->repaint(window_visible_rect());
+}
+
+void Widget::repaint(Gfx::Rect area) {
+	_dirty = true;
+	if(_root_window)
+		_root_window->repaint(area.transform(_absolute_rect.position()).overlapping_area(window_visible_rect()));
+}
+
+void Widget::scroll_contents(Gfx::Rect area, Gfx::Point delta) {
+	_dirty = true;
+	if(_root_window)
+		_root_window->scroll(area.transform(_absolute_rect.position()).overlapping_area(window_visible_rect()), delta);
 }
 
 void Widget::repaint_now() {
@@ -181,10 +193,14 @@ Gfx::Point Widget::position() {
 
 void Widget::hide() {
 	_hidden = true;
+	if(_root_window)
+		_root_window->repaint();
 }
 
 void Widget::show() {
 	_hidden = false;
+	if(_root_window)
+		_root_window->repaint();
 }
 
 void Widget::set_layout_bounds(Gfx::Rect new_bounds) {
@@ -195,6 +211,7 @@ void Widget::set_layout_bounds(Gfx::Rect new_bounds) {
 	}
 
 	Gfx::Rect old_rect = _rect;
+	Gfx::Rect old_window_rect = window_visible_rect();
 	_rect = new_bounds;
 	_initialized_size = true;
 	if(Gfx::Dimensions{_framebuffer.width, _framebuffer.height} != _rect.dimensions())
@@ -202,6 +219,10 @@ void Widget::set_layout_bounds(Gfx::Rect new_bounds) {
 	recalculate_rects();
 	calculate_layout();
 	on_layout_change(old_rect);
+	// If the widget moved, whatever was beneath its old position needs to be redrawn as well
+	auto new_window_rect = window_visible_rect();
+	if(_root_window && (old_window_rect.position() != new_window_rect.position() || old_window_rect.dimensions() != new_window_rect.dimensions()))
+		_root_window->repaint();
 	repaint();
 	if(!_first_layout_done) {
 		_first_layout_done = true;
@@ -349,6 +370,10 @@ void Widget::recalculate_rects() {
 		child->recalculate_rects();
 }
 
+Gfx::Rect Widget::window_visible_rect() const {
+	return {_absolute_rect.position() + _visible_rect.position(), _visible_rect.dimensions()};
+}
+
 void Widget::initialize() {}
 
 bool Widget::evt_mouse_move(Pond::MouseMoveEvent evt) {
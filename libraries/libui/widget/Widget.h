@@ -101,6 +101,22 @@ namespace UI {
 		 */
 		void repaint();
 
+		/**
+		 * Schedules a repaint of the widget, of which only the given area changed and needs to be redrawn in the
+		 * window. The widget itself is still asked to repaint as a whole.
+		 * @param area The area of the widget that changed.
+		 */
+		void repaint(Gfx::Rect area);
+
+		/**
+		 * Tells the window that the contents of an area of the widget moved, so that they can be moved instead of
+		 * redrawn. The widget must draw its contents moved the next time it's repainted, and call repaint() for
+		 * anything else that changed.
+		 * @param area The area of the widget that was scrolled.
+		 * @param delta How far its contents moved.
+		 */
+		void scroll_contents(Gfx::Rect area, Gfx::Point delta);
+
 		/**
 		 * This function immediately repaints the contents of the widget if needed.
 		 */
@@ -337,6 +353,11 @@ namespace UI {
 		 */
 		void recalculate_rects();
 
+		/**
+		 * Gets the area of the root window that the widget is currently visible in.
+		 */
+		Gfx::Rect window_visible_rect() const;
+
 		/**
 		 * Called after the constructor to initialize the widget.
 		 */
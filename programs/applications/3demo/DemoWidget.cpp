@@ -39,6 +39,7 @@ DemoWidget::DemoWidget(std::vector<std::array<Lib3D::Vertex, 3>> object, bool te
 		for(auto& face : faces) {
 			context->tri(face);
 		}
+		context->flush();
 		if (do_rot)
 			rot += {1.234, 2.312, 3.231};
 		viewport->repaint();
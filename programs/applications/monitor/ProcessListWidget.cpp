@@ -25,6 +25,14 @@
 #include <libui/Window.h>
 #include <csignal>
 
+namespace {
+	std::string cpu_string(const Sys::Process& proc) {
+		char buf[8];
+		snprintf(buf, sizeof(buf), "%.1f%%", proc.cpu_percent());
+		return buf;
+	}
+}
+
 void ProcessListWidget::update() {
 	auto old_procs = _processes;
 	_processes.resize(0);
@@ -32,7 +40,7 @@ void ProcessListWidget::update() {
 	int i = 0;
 	for(auto& proc : procs) {
 		_processes.push_back(proc.second);
-		if(i >= old_procs.size() || old_procs[i].pid() != proc.second.pid())
+		if(i >= old_procs.size() || old_procs[i].pid() != proc.second.pid() || cpu_string(old_procs[i]) != cpu_string(proc.second))
 			_table_view->update_row(i);
 		i++;
 	}
@@ -78,6 +86,9 @@ Duck::Ptr<UI::Widget> ProcessListWidget::tv_create_entry(int row, int col) {
 
 	case 6: // State
 		return UI::Label::make(proc.state_name(), UI::BEGINNING);
+
+	case 7: // CPU
+		return UI::Label::make(cpu_string(proc), UI::END);
 	}
 
 	return nullptr;
@@ -99,6 +110,8 @@ std::string ProcessListWidget::tv_column_name(int col) {
 			return "Shared";
 		case 6:
 			return "State";
+		case 7:
+			return "CPU";
 	}
 	return "";
 }
@@ -127,6 +140,8 @@ int ProcessListWidget::tv_column_width(int col) {
 			return 75;
 		case 6:
 			return 60;
+		case 7:
+			return 45;
 	}
 	return 0;
 }
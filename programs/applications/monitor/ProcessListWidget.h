@@ -44,6 +44,6 @@ protected:
 private:
 	ProcessListWidget();
 	std::vector<Sys::Process> _processes;
-	Duck::Ptr<UI::TableView> _table_view = UI::TableView::make(7, true);
+	Duck::Ptr<UI::TableView> _table_view = UI::TableView::make(8, true);
 };
 
@@ -16,7 +16,13 @@ ProcessManager& ProcessManager::inst() {
 }
 
 void ProcessManager::update() {
+	auto old_processes = std::move(m_processes);
 	m_processes = Sys::Process::get_all();
+	for(auto& proc : m_processes) {
+		auto old_proc = old_processes.find(proc.first);
+		if(old_proc != old_processes.end())
+			proc.second.measure_since(old_proc->second);
+	}
 }
 
 const std::map<pid_t, Sys::Process>& ProcessManager::processes() {
@@ -47,7 +47,7 @@ static const uint32_t color_palette[] = {
 
 TerminalWidget::TerminalWidget() {
 	font = UI::Theme::font_mono();
-	term = new Term::Terminal({1, 1}, *this);
+	term = new Term::Terminal({1, 1}, *this, TERMINAL_SCROLLBACK);
 
 	//Setup PTY
 	pty_fd = posix_openpt(O_RDWR | O_CLOEXEC);
@@ -57,9 +57,9 @@ TerminalWidget::TerminalWidget() {
 	//Set up pty poll
 	UI::Poll pty_poll = {pty_fd};
 	pty_poll.on_ready_to_read = [&]{
-		char buf[128];
+		char buf[4096];
 		size_t nread;
-		while((nread = read(pty_fd, buf, 128))) {
+		while((nread = read(pty_fd, buf, sizeof(buf)))) {
 			term->write_chars(buf, nread);
 		}
 		handle_term_events();
@@ -69,7 +69,7 @@ TerminalWidget::TerminalWidget() {
 	//Set up interval for blinking
 	blink_timer = UI::set_interval([&] {
 		blink_on = !blink_on;
-		repaint();
+		repaint_line(drawn_cursor.line);
 	}, 500);
 }
 
@@ -86,59 +86,45 @@ void TerminalWidget::do_repaint(const UI::DrawContext& ctx) {
 	if(!term)
 		return;
 
-	//If we need a full repaint, do so
-	if(needs_full_repaint) {
-		needs_full_repaint = false;
-		auto dims = term->get_dimensions();
-		for(int x = 0; x < dims.cols; x++) {
-			for(int y = 0; y < dims.lines; y++) {
-				auto character = term->get_character({x, y});
-				Gfx::Point pos = {(int) x * font->bounding_box().width, (int) y * font->size()};
-				ctx.fill({pos.x, pos.y, font->bounding_box().width, font->size()}, color_palette[character.attr.bg]);
-				ctx.draw_glyph(font, character.codepoint, pos, color_palette[character.attr.fg]);
-			}
-		}
-	}
-
-	//Go through pending events and paint them
-	for(auto evt : events) {
-		switch(evt.type) {
-			case TerminalEvent::CHARACTER: {
-				auto& data = evt.data.character;
-				Gfx::Point pos = {(int) data.pos.col * font->bounding_box().width, (int) data.pos.line * font->size()};
-				ctx.fill({pos.x, pos.y, font->bounding_box().width, font->size()}, color_palette[data.character.attr.bg]);
-				ctx.draw_glyph(font, data.character.codepoint, pos, color_palette[data.character.attr.fg]);
-				break;
-			}
+	auto dims = term->get_dimensions();
 
-			case TerminalEvent::CLEAR: {
-				ctx.fill({0, 0, ctx.width(), ctx.height()}, color_palette[evt.data.clear.attribute.bg]);
-				break;
-			}
+	//If we're looking at the scrollback, draw the whole view from there
+	if(scroll_offset) {
+		ctx.fill({0, 0, ctx.width(), ctx.height()}, color_palette[TERM_DEFAULT_BACKGROUND]);
+		for(int y = 0; y < dims.lines; y++)
+			paint_line(ctx, term->get_line(y - scroll_offset), y);
+		pending_scroll = 0;
+		needs_full_repaint = true;
+		return;
+	}
 
-			case TerminalEvent::CLEAR_LINE: {
-				auto& data = evt.data.clear_line;
-				ctx.fill({0, (int) data.line * font->size(), ctx.width(), font->size()}, color_palette[data.attribute.bg]);
-				break;
-			}
-
-			case TerminalEvent::SCROLL: {
-				auto& data = evt.data.scroll;
-				auto& framebuffer = ctx.framebuffer();
-				framebuffer.copy(framebuffer, {
-					0,
-					(int) data.lines * font->size(),
-					framebuffer.width,
-					framebuffer.height - ((int) data.lines * font->size())
-				}, {0, 0});
-				ctx.fill({0, framebuffer.height - ((int) data.lines * font->size()), framebuffer.width, (int) data.lines * font->size()}, color_palette[data.attribute.bg]);
-			}
+	//Move what we already drew up by however far the screen scrolled, instead of redrawing it
+	int stale_cursor_line = drawn_cursor.line;
+	if(pending_scroll) {
+		if(pending_scroll >= dims.lines) {
+			needs_full_repaint = true;
+		} else if(!needs_full_repaint) {
+			auto& framebuffer = ctx.framebuffer();
+			int scroll_height = pending_scroll * font->size();
+			framebuffer.copy_within({0, scroll_height, framebuffer.width, framebuffer.height - scroll_height}, {0, 0});
+			stale_cursor_line -= pending_scroll;
 		}
+		pending_scroll = 0;
 	}
-	events.clear();
+
+	//Redraw the lines that changed, and the one the cursor was drawn on if it scrolled away
+	if(needs_full_repaint)
+		ctx.fill({0, 0, ctx.width(), ctx.height()}, color_palette[TERM_DEFAULT_BACKGROUND]);
+	for(int y = 0; y < dims.lines; y++) {
+		if(needs_full_repaint || y == stale_cursor_line || term->is_line_dirty(y))
+			paint_line(ctx, term->get_line(y), y);
+	}
+	term->clear_dirty();
+	needs_full_repaint = false;
 
 	// Get cursor position
 	auto cursor = term->get_cursor();
+	drawn_cursor = cursor;
 	Gfx::Point pos = {(int) cursor.col * font->bounding_box().width, (int) cursor.line * font->size()};
 
 	// Draw character under cursor
@@ -162,9 +148,39 @@ void TerminalWidget::do_repaint(const UI::DrawContext& ctx) {
 	}
 }
 
+void TerminalWidget::paint_line(const UI::DrawContext& ctx, Term::Line& line, int y) {
+	int cell_width = font->bounding_box().width;
+	int line_y = y * font->size();
+	int cols = std::min(line.length(), term->get_dimensions().cols);
+
+	//Fill runs of cells with the same background at once, then draw the characters on top
+	int run_start = 0;
+	for(int x = 1; x <= cols; x++) {
+		if(x == cols || line[x].attr.bg != line[run_start].attr.bg) {
+			ctx.fill({run_start * cell_width, line_y, (x - run_start) * cell_width, font->size()}, color_palette[line[run_start].attr.bg]);
+			run_start = x;
+		}
+	}
+
+	for(int x = 0; x < cols; x++) {
+		auto& character = line[x];
+		if(character.codepoint && character.codepoint != ' ')
+			ctx.draw_glyph(font, character.codepoint, {x * cell_width, line_y}, color_palette[character.attr.fg]);
+	}
+}
+
+void TerminalWidget::repaint_line(int y) {
+	repaint({0, y * font->size(), current_size().width, font->size()});
+}
+
 bool TerminalWidget::on_keyboard(Pond::KeyEvent event) {
-	if(KBD_ISPRESSED(event))
+	if(KBD_ISPRESSED(event)) {
+		if(scroll_offset) {
+			scroll_offset = 0;
+			needs_repaint = true;
+		}
 		term->handle_keypress(event.scancode, event.character, event.modifiers);
+	}
 	handle_term_events();
 	return true;
 }
@@ -182,6 +198,7 @@ Duck::Ptr<UI::Menu> TerminalWidget::create_menu() {
 	std::vector<Duck::Ptr<UI::MenuItem>> items = {
 		UI::MenuItem::make("Clear", [&] {
 			term->clear();
+			handle_term_events();
 		}),
 		UI::MenuItem::Separator,
 		UI::MenuItem::make("Signals", UI::Menu::make({
@@ -209,6 +226,23 @@ void TerminalWidget::set_cursor_style(CursorStyle style) {
 	repaint();
 }
 
+bool TerminalWidget::on_mouse_scroll(Pond::MouseScrollEvent evt) {
+	int new_offset = std::clamp(scroll_offset - evt.scroll * 3, 0, term->get_scrollback_lines());
+	if(new_offset == scroll_offset)
+		return true;
+
+	//Within the scrollback, the lines still in view just move. The cursor isn't drawn there, so going in or out of it
+	//needs everything redrawn.
+	if(new_offset && scroll_offset) {
+		int lines = term->get_dimensions().lines;
+		scroll_contents({0, 0, current_size().width, lines * font->size()}, {0, (new_offset - scroll_offset) * font->size()});
+	} else {
+		repaint();
+	}
+	scroll_offset = new_offset;
+	return true;
+}
+
 bool TerminalWidget::on_mouse_button(Pond::MouseButtonEvent evt) {
 	if(!(evt.old_buttons & POND_MOUSE2) && (evt.new_buttons & POND_MOUSE2)) {
 		open_menu(create_menu());
@@ -217,8 +251,29 @@ bool TerminalWidget::on_mouse_button(Pond::MouseButtonEvent evt) {
 }
 
 void TerminalWidget::handle_term_events() {
-	if(!events.empty())
+	//However much was written, we only repaint once
+	if(!needs_repaint)
+		return;
+	needs_repaint = false;
+
+	auto dims = term->get_dimensions();
+	if(scroll_offset || needs_full_repaint || pending_scroll >= dims.lines) {
+		unreported_scroll = 0;
 		repaint();
+		return;
+	}
+
+	//Let the window move what's already on the screen when we scroll, and only redraw the lines that changed
+	if(unreported_scroll) {
+		scroll_contents({0, 0, current_size().width, dims.lines * font->size()}, {0, -unreported_scroll * font->size()});
+		unreported_scroll = 0;
+	}
+	for(int y = 0; y < dims.lines; y++) {
+		if(term->is_line_dirty(y))
+			repaint_line(y);
+	}
+	repaint_line(drawn_cursor.line - pending_scroll);
+	repaint_line(term->get_cursor().line);
 }
 
 void TerminalWidget::run(const char* command) {
@@ -281,11 +336,15 @@ void TerminalWidget::run(const char* command) {
 }
 
 void TerminalWidget::on_character_change(const Term::Position& position, const Term::Character& character) {
-	events.push_back({TerminalEvent::CHARACTER, {.character = {position, character}}});
+	needs_repaint = true;
+}
+
+void TerminalWidget::on_characters_change(const Term::Position& position, const Term::Character* characters, int count) {
+	needs_repaint = true;
 }
 
 void TerminalWidget::on_cursor_change(const Term::Position& old_position) {
-	events.push_back({TerminalEvent::CHARACTER, {.character = {old_position, term->get_character(old_position)}}});
+	needs_repaint = true;
 }
 
 void TerminalWidget::on_backspace(const Term::Position& position) {
@@ -293,22 +352,23 @@ void TerminalWidget::on_backspace(const Term::Position& position) {
 }
 
 void TerminalWidget::on_clear() {
-	events.clear();
-	//We are sent a clear event before the terminal is set, so handle that case
-	if(term)
-		events.push_back({TerminalEvent::CLEAR, {.clear = {term->get_current_attribute()}}});
-	else
-		events.push_back({TerminalEvent::CLEAR, {.clear = {{TERM_DEFAULT_FOREGROUND, TERM_DEFAULT_BACKGROUND}}}});
+	needs_repaint = true;
+	needs_full_repaint = true;
+	pending_scroll = 0;
+	unreported_scroll = 0;
 }
 
 void TerminalWidget::on_clear_line(int line) {
-	events.push_back({TerminalEvent::CLEAR_LINE, {.clear_line = {term->get_current_attribute(), line}}});
+	needs_repaint = true;
 }
 
 void TerminalWidget::on_scroll(int lines) {
-	//Redraw the cursor character, as we don't want to include it in the scroll
-	events.push_back({TerminalEvent::CHARACTER, {.character = {term->get_cursor(), term->get_character(term->get_cursor())}}});
-	events.push_back({TerminalEvent::SCROLL, {.scroll = {term->get_current_attribute(), lines}}});
+	needs_repaint = true;
+	pending_scroll += lines;
+	unreported_scroll += lines;
+	//Keep the scrollback we're looking at in place
+	if(scroll_offset)
+		scroll_offset = std::min(scroll_offset + lines, term->get_scrollback_lines());
 }
 
 void TerminalWidget::on_resize(const Term::Size& old_size, const Term::Size& new_size) {
@@ -22,6 +22,8 @@
 #include <libui/libui.h>
 #include <libterm/Terminal.h>
 
+#define TERMINAL_SCROLLBACK 1000
+
 class TerminalWidget: public UI::Widget, public Term::Listener, public UI::WindowDelegate {
 public:
 	WIDGET_DEF(TerminalWidget)
@@ -40,6 +42,7 @@ public:
 	bool on_keyboard(Pond::KeyEvent evt) override;
 	void on_layout_change(const Gfx::Rect& old_rect) override;
 	bool on_mouse_button(Pond::MouseButtonEvent evt) override;
+	bool on_mouse_scroll(Pond::MouseScrollEvent evt) override;
 
 	void handle_term_events();
 	void run(const char* command);
@@ -48,6 +51,7 @@ public:
 
 	//Terminal::Listener
 	void on_character_change(const Term::Position& position, const Term::Character& character) override;
+	void on_characters_change(const Term::Position& position, const Term::Character* characters, int count) override;
 	void on_cursor_change(const Term::Position& position) override;
 	void on_backspace(const Term::Position& position) override;
 	void on_clear() override;
@@ -62,36 +66,26 @@ public:
 private:
 	TerminalWidget();
 
+	void paint_line(const UI::DrawContext& ctx, Term::Line& line, int y);
+	void repaint_line(int y);
+
 	Gfx::Font* font = nullptr;
-	Term::Terminal* term;
+	Term::Terminal* term = nullptr;
 	int pty_fd = -1;
 	pid_t proc_pid = -1;
-	bool needs_full_repaint = false;
 	Duck::Ptr<UI::Timer> blink_timer;
 	bool blink_on = false;
 
-	struct TerminalEvent {
-		enum type {CHARACTER, CLEAR, CLEAR_LINE, SCROLL} type;
-		union event {
-			struct {
-				Term::Position pos;
-				Term::Character character;
-			} character;
-			struct {
-				Term::Attribute attribute;
-			} clear;
-			struct {
-				Term::Attribute attribute;
-				int line;
-			} clear_line;
-			struct {
-				Term::Attribute attribute;
-				int lines;
-			} scroll;
-		} data;
-	};
-
-	std::vector<TerminalEvent> events;
+	/*
+	 * The terminal marks the lines that change, so we only need to remember what it can't tell us: whether anything
+	 * changed at all, and how far the screen scrolled since we last painted it.
+	 */
+	bool needs_repaint = false;
+	bool needs_full_repaint = false;
+	int pending_scroll = 0;
+	int unreported_scroll = 0; ///< How far the screen scrolled since we last told the window
+	int scroll_offset = 0; ///< How many lines up into the scrollback we're looking
+	Term::Position drawn_cursor = {0, 0};
 	CursorStyle cursor_style = CursorStyle::Block;
 };
 
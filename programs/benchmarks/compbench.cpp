@@ -0,0 +1,175 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2024 Byteduck */
+
+// A program that benchmarks compositing many overlapping windows, with and without occlusion culling
+
+#include <libduck/Args.h>
+#include <libduck/FormatStream.h>
+#include <libduck/Time.h>
+#include <libgraphics/Framebuffer.h>
+#include <libgraphics/Geometry.h>
+#include <cstdlib>
+#include <vector>
+
+#define SCREEN_WIDTH 1024
+#define SCREEN_HEIGHT 768
+
+using Gfx::Rect, Gfx::Region, Gfx::Framebuffer;
+
+int num_windows = 32;
+int num_frames = 100;
+int alpha_percent = 25;
+
+struct BenchWindow {
+	Rect rect;
+	Framebuffer framebuffer;
+	bool alpha;
+};
+
+struct Scenario {
+	const char* name;
+	std::vector<Rect> (*damage)(const std::vector<BenchWindow>& windows, unsigned int& seed);
+};
+
+static inline unsigned int next_random(unsigned int& seed) {
+	seed = seed * 1103515245 + 12345;
+	return seed >> 8;
+}
+
+static Rect random_rect(unsigned int& seed, int min_size, int max_size) {
+	int width = min_size + next_random(seed) % (max_size - min_size);
+	int height = min_size + next_random(seed) % (max_size - min_size);
+	return {(int) (next_random(seed) % (SCREEN_WIDTH - width)), (int) (next_random(seed) % (SCREEN_HEIGHT - height)), width, height};
+}
+
+static const Scenario scenarios[] = {
+	{"full screen", [](const std::vector<BenchWindow>&, unsigned int&) {
+		return std::vector<Rect> {{0, 0, SCREEN_WIDTH, SCREEN_HEIGHT}};
+	}},
+	{"one window", [](const std::vector<BenchWindow>& windows, unsigned int& seed) {
+		return std::vector<Rect> {windows[next_random(seed) % windows.size()].rect};
+	}},
+	{"scattered", [](const std::vector<BenchWindow>&, unsigned int& seed) {
+		std::vector<Rect> ret;
+		for(int i = 0; i < 16; i++)
+			ret.push_back(random_rect(seed, 8, 96));
+		return ret;
+	}},
+};
+
+// Pond's original approach: merge colliding areas into their bounding rects, then paint every window touching each.
+long paint_merged(Framebuffer& fb, const Framebuffer& background, const std::vector<BenchWindow>& windows, std::vector<Rect> areas) {
+	long pixels = 0;
+	auto it = areas.begin();
+	while(it != areas.end()) {
+		bool remove_area = false;
+		for(auto& other_area : areas) {
+			if(&*it != &other_area && it->collides(other_area)) {
+				other_area = it->combine(other_area);
+				remove_area = true;
+				break;
+			}
+		}
+		if(remove_area)
+			areas.erase(it);
+		else
+			it++;
+	}
+
+	for(auto& area : areas) {
+		fb.copy(background, area, area.position());
+		pixels += area.area();
+		for(auto& window : windows) {
+			if(!window.rect.collides(area))
+				continue;
+			auto overlap = area.overlapping_area(window.rect);
+			auto transformed = overlap.transform({-window.rect.x, -window.rect.y});
+			if(window.alpha)
+				fb.copy_blitting(window.framebuffer, transformed, overlap.position());
+			else
+				fb.copy(window.framebuffer, transformed, overlap.position());
+			pixels += overlap.area();
+		}
+	}
+	return pixels;
+}
+
+// The region approach: opaque windows remove their area from everything beneath them.
+long paint_occluded(Framebuffer& fb, const Framebuffer& background, const std::vector<BenchWindow>& windows, const std::vector<Rect>& areas) {
+	long pixels = 0;
+	Region uncovered;
+	for(auto& area : areas)
+		uncovered.add(area);
+
+	std::vector<std::pair<const BenchWindow*, Region>> paints;
+	for(auto it = windows.rbegin(); it != windows.rend() && !uncovered.empty(); it++) {
+		if(!uncovered.intersects(it->rect))
+			continue;
+		paints.emplace_back(&*it, uncovered.intersection(it->rect));
+		if(!it->alpha)
+			uncovered.subtract(it->rect);
+	}
+
+	for(auto& area : uncovered.rects()) {
+		fb.copy(background, area, area.position());
+		pixels += area.area();
+	}
+	for(auto it = paints.rbegin(); it != paints.rend(); it++) {
+		auto& window = *it->first;
+		for(auto& area : it->second.rects()) {
+			auto transformed = area.transform({-window.rect.x, -window.rect.y});
+			if(window.alpha)
+				fb.copy_blitting(window.framebuffer, transformed, area.position());
+			else
+				fb.copy(window.framebuffer, transformed, area.position());
+			pixels += area.area();
+		}
+	}
+	return pixels;
+}
+
+int main(int argc, char** argv) {
+	Duck::Args args;
+	args.add_named(num_windows, "w", "windows", "The number of windows to composite.");
+	args.add_named(num_frames, "f", "frames", "The number of frames to composite per scenario.");
+	args.add_named(alpha_percent, "a", "alpha", "The percentage of windows that use alpha.");
+	args.parse(argc, argv);
+
+	if(num_windows < 1)
+		num_windows = 1;
+
+	unsigned int seed = 1;
+	Framebuffer screen(SCREEN_WIDTH, SCREEN_HEIGHT);
+	Framebuffer background(SCREEN_WIDTH, SCREEN_HEIGHT);
+	background.fill_gradient_v({0, 0, SCREEN_WIDTH, SCREEN_HEIGHT}, RGB(20, 40, 80), RGB(80, 40, 20));
+
+	std::vector<BenchWindow> windows;
+	windows.reserve(num_windows);
+	for(int i = 0; i < num_windows; i++) {
+		auto rect = random_rect(seed, 64, 512);
+		bool alpha = (int) (next_random(seed) % 100) < alpha_percent;
+		windows.push_back({rect, Framebuffer(rect.width, rect.height), alpha});
+		windows.back().framebuffer.fill({0, 0, rect.width, rect.height}, alpha ? RGBA(255, 255, 255, 128) : RGB(i * 8, 128, 255 - i * 8));
+	}
+
+	Duck::println("{} windows ({}% alpha), {} frames per scenario", num_windows, alpha_percent, num_frames);
+	for(auto& scenario : scenarios) {
+		for(bool occlude : {false, true}) {
+			unsigned int frame_seed = 1;
+			long pixels = 0;
+			auto start = Duck::Time::now();
+			for(int frame = 0; frame < num_frames; frame++) {
+				auto damage = scenario.damage(windows, frame_seed);
+				if(occlude)
+					pixels += paint_occluded(screen, background, windows, damage);
+				else
+					pixels += paint_merged(screen, background, windows, damage);
+			}
+			long millis = (Duck::Time::now() - start).millis();
+			Duck::println("{}, {}: {}ms ({} pixels painted per frame)",
+						  scenario.name, occlude ? "occlusion culled" : "merged rects", millis, pixels / num_frames);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,69 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2024 Byteduck */
+
+// A program that benchmarks libgraphics' drawing operations
+
+#include <libduck/Args.h>
+#include <libduck/FormatStream.h>
+#include <libduck/Time.h>
+#include <libduck/CPU.h>
+#include <libgraphics/Framebuffer.h>
+
+#define TARGET_WIDTH 1024
+#define TARGET_HEIGHT 768
+
+using Gfx::Framebuffer, Gfx::Rect;
+
+int num_iterations = 50;
+
+Framebuffer target;
+Framebuffer opaque_image;
+Framebuffer alpha_image;
+
+struct Benchmark {
+	const char* name;
+	void (*run)();
+};
+
+static const Benchmark benchmarks[] = {
+	{"fill", [] { target.fill({0, 0, TARGET_WIDTH, TARGET_HEIGHT}, RGB(10, 20, 30)); }},
+	{"fill_blitting", [] { target.fill_blitting({0, 0, TARGET_WIDTH, TARGET_HEIGHT}, RGBA(10, 20, 30, 100)); }},
+	{"fill_gradient_h", [] { target.fill_gradient_h({0, 0, TARGET_WIDTH, TARGET_HEIGHT}, RGB(0, 0, 0), RGB(255, 128, 0)); }},
+	{"fill_gradient_v", [] { target.fill_gradient_v({0, 0, TARGET_WIDTH, TARGET_HEIGHT}, RGB(0, 0, 0), RGB(255, 128, 0)); }},
+	{"copy", [] { target.copy(opaque_image, {0, 0, TARGET_WIDTH, TARGET_HEIGHT}, {0, 0}); }},
+	{"copy_blitting (opaque)", [] { target.copy_blitting(opaque_image, {0, 0, TARGET_WIDTH, TARGET_HEIGHT}, {0, 0}); }},
+	{"copy_blitting (alpha)", [] { target.copy_blitting(alpha_image, {0, 0, TARGET_WIDTH, TARGET_HEIGHT}, {0, 0}); }},
+	{"draw_image_scaled (nearest)", [] { target.draw_image_scaled(alpha_image, {0, 0, TARGET_WIDTH, TARGET_HEIGHT}); }},
+	{"draw_image_scaled (bilinear)", [] { target.draw_image_scaled(alpha_image, {0, 0, TARGET_WIDTH, TARGET_HEIGHT}, Gfx::ScaleMode::Bilinear); }},
+};
+
+int main(int argc, char** argv) {
+	Duck::Args args;
+	args.add_named(num_iterations, "i", "iterations", "The number of times to run each operation.");
+	args.parse(argc, argv);
+
+	target = Framebuffer(TARGET_WIDTH, TARGET_HEIGHT);
+	opaque_image = Framebuffer(TARGET_WIDTH, TARGET_HEIGHT);
+	opaque_image.fill_gradient_v({0, 0, TARGET_WIDTH, TARGET_HEIGHT}, RGB(255, 0, 0), RGB(0, 0, 255));
+
+	// A half-size image with a mix of transparent, translucent and opaque pixels, like a typical icon or shadow
+	alpha_image = Framebuffer(TARGET_WIDTH / 2, TARGET_HEIGHT / 2);
+	for(int y = 0; y < alpha_image.height; y++) {
+		for(int x = 0; x < alpha_image.width; x++) {
+			uint8_t alpha = (x / 16 + y / 16) % 3 == 0 ? 0 : ((x / 16 + y / 16) % 3 == 1 ? 128 : 255);
+			alpha_image.data[x + y * alpha_image.width] = RGBA(x, y, x + y, alpha);
+		}
+	}
+
+	Duck::println("{}x{}, {} iterations, SSE2 {}", TARGET_WIDTH, TARGET_HEIGHT, num_iterations, Duck::CPU::has_sse2() ? "available" : "unavailable");
+	long long pixels = (long long) TARGET_WIDTH * TARGET_HEIGHT * num_iterations;
+	for(auto& benchmark : benchmarks) {
+		auto start = Duck::Time::now();
+		for(int i = 0; i < num_iterations; i++)
+			benchmark.run();
+		long millis = (Duck::Time::now() - start).millis();
+		Duck::println("{}: {}ms ({} MP/s)", benchmark.name, millis, millis ? pixels / millis / 1000 : 0);
+	}
+
+	return 0;
+}
@@ -0,0 +1,291 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2024 Byteduck */
+
+// A program that benchmarks libgraphics' DEFLATE decoder against the previous bit-at-a-time decoder
+
+#include <libduck/Args.h>
+#include <libduck/FormatStream.h>
+#include <libduck/Time.h>
+#include <libgraphics/Deflate.h>
+#include <cstring>
+#include <vector>
+
+int num_iterations = 20;
+std::string filename = "/usr/share/wallpapers/duck.png";
+
+/*
+ * The previous decoder, kept here for comparison. It reads input one byte at a time through a callback, reads bits one
+ * at a time, decodes huffman codes bit by bit, and writes output one byte at a time through a callback.
+ */
+namespace Legacy {
+	struct DEFLATE {
+		uint8_t bit_pos;
+		uint8_t bit_buf;
+		size_t frame_pointer;
+		uint8_t reading_frame[0x8000];
+
+		void (*write)(uint8_t, void*);
+		uint8_t (*read)(void*);
+		void* arg;
+	};
+
+	struct huffman {
+		uint16_t counts[16];
+		uint16_t symbols[288];
+	};
+
+	unsigned int read_bits(DEFLATE* def, size_t num_bits) {
+		unsigned int ret = 0;
+		for(size_t i = 0; i < num_bits; i++) {
+			if(def->bit_pos == 8) {
+				def->bit_buf = def->read(def->arg);
+				def->bit_pos = 0;
+			}
+			ret |= (def->bit_buf & 0x1u) << i;
+			def->bit_buf >>= 1;
+			def->bit_pos++;
+		}
+		return ret;
+	}
+
+	void create_huffman(const uint8_t lengths[], uint32_t size, huffman* huff) {
+		for(size_t i = 0; i < 16; i++)
+			huff->counts[i] = 0;
+		for(size_t i = 0; i < size; i++)
+			huff->counts[lengths[i]]++;
+		huff->counts[0] = 0;
+		uint32_t count = 0;
+		uint16_t indexes[16];
+		for(uint16_t i = 0; i < 16; i++) {
+			indexes[i] = count;
+			count += huff->counts[i];
+		}
+		for(uint16_t i = 0; i < size; i++) {
+			if(lengths[i])
+				huff->symbols[indexes[lengths[i]]++] = i;
+		}
+	}
+
+	uint16_t huffman_decode(DEFLATE* def, huffman* huff) {
+		int count = 0;
+		int cur = 0;
+		for(int i = 1; cur >= 0; i++) {
+			cur = read_bits(def, 1) | (cur << 1);
+			count += huff->counts[i];
+			cur -= huff->counts[i];
+		}
+		return huff->symbols[count + cur];
+	}
+
+	void def_write(DEFLATE* def, uint8_t byte) {
+		if(def->frame_pointer == 0x8000)
+			def->frame_pointer = 0;
+		def->reading_frame[def->frame_pointer++] = byte;
+		def->write(byte, def->arg);
+	}
+
+	void inflate(DEFLATE* def, huffman* len_huff, huffman* dist_huff) {
+		static const uint16_t lengths[] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+		static const uint16_t lengths_extrabits[] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+		static const uint16_t distances[] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+		static const uint16_t distances_extrabits[] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+		while(1) {
+			uint16_t sym = huffman_decode(def, len_huff);
+			if(sym < 256) {
+				def_write(def, sym);
+			} else {
+				if(sym == 256)
+					break;
+				uint16_t length = read_bits(def, lengths_extrabits[sym - 257]) + lengths[sym - 257];
+				uint16_t distance_index = huffman_decode(def, dist_huff);
+				uint16_t distance = distances[distance_index] + read_bits(def, distances_extrabits[distance_index]);
+				for(uint16_t i = 0; i < length; i++) {
+					uint8_t byte = def->reading_frame[(def->frame_pointer - distance) % 0x8000];
+					def_write(def, byte);
+				}
+			}
+		}
+	}
+
+	void inflate_dynamic(DEFLATE* def) {
+		static const uint8_t codelen_alphabet[] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+		uint16_t hlit = read_bits(def, 5) + 257;
+		uint8_t hdist = read_bits(def, 5) + 1;
+		uint8_t hclen = read_bits(def, 4) + 4;
+
+		uint8_t alphabet_codelens[19] = {0};
+		for(uint32_t i = 0; i < hclen; i++)
+			alphabet_codelens[codelen_alphabet[i]] = read_bits(def, 3);
+		huffman codes_huff;
+		create_huffman(alphabet_codelens, 19, &codes_huff);
+
+		uint16_t i = 0;
+		uint8_t lengths[320];
+		while(i < hdist + hlit) {
+			uint16_t sym = huffman_decode(def, &codes_huff);
+			if(sym < 16) {
+				lengths[i++] = sym;
+			} else {
+				uint8_t num_repeats = 0;
+				uint8_t to_repeat = 0;
+				if(sym == 16) {
+					to_repeat = lengths[i - 1];
+					num_repeats = read_bits(def, 2) + 3;
+				} else if(sym == 17) {
+					num_repeats = read_bits(def, 3) + 3;
+				} else {
+					num_repeats = read_bits(def, 7) + 11;
+				}
+				for(uint8_t j = 0; j < num_repeats; j++)
+					lengths[i++] = to_repeat;
+			}
+		}
+
+		huffman length_huff;
+		create_huffman(lengths, hlit, &length_huff);
+		huffman dist_huff;
+		create_huffman(lengths + hlit, hdist, &dist_huff);
+		inflate(def, &length_huff, &dist_huff);
+	}
+
+	void inflate_uncompressed(DEFLATE* def) {
+		def->bit_buf = 0;
+		def->bit_pos = 8;
+		uint16_t len = def->read(def->arg);
+		len |= def->read(def->arg) << 8;
+		def->read(def->arg);
+		def->read(def->arg);
+		for(uint16_t i = 0; i < len; i++)
+			def_write(def, def->read(def->arg));
+	}
+
+	void decompress(DEFLATE* def) {
+		static huffman fixed_len_huff;
+		static huffman fixed_dist_huff;
+		static bool made_fixed = false;
+
+		def->bit_pos = 8;
+		def->frame_pointer = 0;
+		def->bit_buf = 0;
+
+		if(!made_fixed) {
+			made_fixed = true;
+			uint8_t len_lengths[288];
+			for(uint16_t i = 0; i < 288; i++)
+				len_lengths[i] = (i < 144 || i >= 280) ? 8 : (i < 256 ? 9 : 7);
+			create_huffman(len_lengths, 288, &fixed_len_huff);
+			uint8_t dist_lengths[30];
+			memset(dist_lengths, 5, 30);
+			create_huffman(dist_lengths, 30, &fixed_dist_huff);
+		}
+
+		uint8_t bfinal = 0;
+		while(!bfinal) {
+			bfinal = read_bits(def, 1);
+			uint8_t btype = read_bits(def, 2);
+			if(btype == 0b00)
+				inflate_uncompressed(def);
+			else if(btype == 0b01)
+				inflate(def, &fixed_len_huff, &fixed_dist_huff);
+			else if(btype == 0b10)
+				inflate_dynamic(def);
+			else
+				return;
+		}
+	}
+}
+
+struct LegacyState {
+	const std::vector<uint8_t>* input;
+	size_t in_pos;
+	std::vector<uint8_t>* output;
+};
+
+std::vector<uint8_t> decode_legacy(const std::vector<uint8_t>& input) {
+	std::vector<uint8_t> output;
+	LegacyState state = {&input, 2, &output}; // Skip the zlib header, which the old decoder didn't handle
+	auto* def = new Legacy::DEFLATE;
+	def->arg = &state;
+	def->read = [](void* arg) -> uint8_t {
+		auto* state = (LegacyState*) arg;
+		return state->in_pos < state->input->size() ? (*state->input)[state->in_pos++] : 0;
+	};
+	def->write = [](uint8_t byte, void* arg) {
+		((LegacyState*) arg)->output->push_back(byte);
+	};
+	Legacy::decompress(def);
+	delete def;
+	return output;
+}
+
+std::vector<uint8_t> decode_inflate(const std::vector<uint8_t>& input, size_t out_size) {
+	std::vector<uint8_t> output(out_size);
+	auto* inf = new INFLATE;
+	inflate_init(inf, 1);
+	size_t in_used, out_written;
+	int status = inflate_stream(inf, input.data(), input.size(), &in_used, output.data(), output.size(), &out_written);
+	delete inf;
+	if(status != INFLATE_DONE)
+		Duck::printerrln("inflate_stream returned {}", status);
+	output.resize(out_written);
+	return output;
+}
+
+// Concatenates the contents of the IDAT chunks of a PNG, which together make up one zlib stream
+bool read_png_stream(const std::string& path, std::vector<uint8_t>& stream) {
+	auto* file = fopen(path.c_str(), "r");
+	if(!file)
+		return false;
+	fseek(file, 8, SEEK_SET);
+	uint8_t header[8];
+	while(fread(header, 8, 1, file) == 1) {
+		uint32_t size = (header[0] << 24) | (header[1] << 16) | (header[2] << 8) | header[3];
+		if(!memcmp(header + 4, "IDAT", 4)) {
+			size_t offset = stream.size();
+			stream.resize(offset + size);
+			if(fread(stream.data() + offset, 1, size, file) != size)
+				break;
+			fseek(file, 4, SEEK_CUR);
+		} else {
+			fseek(file, size + 4, SEEK_CUR);
+		}
+	}
+	fclose(file);
+	return !stream.empty();
+}
+
+int main(int argc, char** argv) {
+	Duck::Args args;
+	args.add_named(num_iterations, "i", "iterations", "The number of times to decode the image data.");
+	args.add_positional(filename, false, "FILE", "The PNG file whose image data to decode.");
+	args.parse(argc, argv);
+
+	std::vector<uint8_t> stream;
+	if(!read_png_stream(filename, stream)) {
+		Duck::printerrln("Couldn't read image data from {}", filename);
+		return 1;
+	}
+
+	auto reference = decode_legacy(stream);
+	auto decoded = decode_inflate(stream, reference.size());
+	if(decoded != reference) {
+		Duck::printerrln("Output mismatch! ({} vs {} bytes)", decoded.size(), reference.size());
+		return 1;
+	}
+	Duck::println("{}: {} bytes compressed, {} bytes decompressed, {} iterations", filename, stream.size(), reference.size(), num_iterations);
+
+	auto time = [&](const char* name, auto decode) {
+		auto start = Duck::Time::now();
+		for(int i = 0; i < num_iterations; i++)
+			decode();
+		long millis = (Duck::Time::now() - start).millis();
+		long long bytes = (long long) reference.size() * num_iterations;
+		Duck::println("{}: {}ms ({} MB/s)", name, millis, millis ? bytes / millis / 1000 : 0);
+	};
+	time("legacy", [&] { decode_legacy(stream); });
+	time("inflate_stream", [&] { decode_inflate(stream, reference.size()); });
+
+	return 0;
+}
@@ -0,0 +1,119 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2024 Byteduck */
+
+// A program that benchmarks the userspace heap
+
+#include <libduck/Args.h>
+#include <libduck/FormatStream.h>
+#include <libduck/Time.h>
+#include <pthread.h>
+#include <malloc.h>
+#include <cstdlib>
+#include <cstring>
+
+#define MAX_LIVE 512
+
+int iterations = 200000;
+int num_threads = 4;
+bool print_stats = false;
+
+struct Workload {
+	const char* name;
+	size_t min_size;
+	size_t max_size;
+	bool touch;
+};
+
+static const Workload workloads[] = {
+	{"small", 8, 128, false},
+	{"medium", 128, 4096, false},
+	{"mixed", 8, 65536, true},
+	{"large", 65536, 262144, false},
+};
+
+struct ThreadArgs {
+	const Workload* workload;
+	int iterations;
+	unsigned int seed;
+};
+
+static inline unsigned int next_random(unsigned int& seed) {
+	seed = seed * 1103515245 + 12345;
+	return seed >> 8;
+}
+
+void* run_workload(void* arg) {
+	auto& args = *((ThreadArgs*) arg);
+	auto& workload = *args.workload;
+	void* live[MAX_LIVE] = {};
+	size_t range = workload.max_size - workload.min_size + 1;
+
+	for(int i = 0; i < args.iterations; i++) {
+		auto& slot = live[next_random(args.seed) % MAX_LIVE];
+		if(slot) {
+			free(slot);
+			slot = nullptr;
+		} else {
+			size_t size = workload.min_size + next_random(args.seed) % range;
+			slot = malloc(size);
+			if(workload.touch)
+				memset(slot, 0, size);
+		}
+	}
+
+	for(auto* ptr : live)
+		free(ptr);
+
+	return nullptr;
+}
+
+long time_workload(const Workload& workload, int threads) {
+	pthread_t thread_ids[threads];
+	ThreadArgs thread_args[threads];
+	auto start = Duck::Time::now();
+
+	for(int i = 0; i < threads; i++) {
+		thread_args[i] = {&workload, iterations, (unsigned int) i + 1};
+		if(i == threads - 1)
+			run_workload(&thread_args[i]);
+		else
+			pthread_create(&thread_ids[i], nullptr, run_workload, &thread_args[i]);
+	}
+
+	for(int i = 0; i < threads - 1; i++)
+		pthread_join(thread_ids[i], nullptr);
+
+	return (Duck::Time::now() - start).millis();
+}
+
+int main(int argc, char** argv) {
+	Duck::Args args;
+	args.add_named(iterations, "i", "iterations", "The number of malloc/free operations per thread.");
+	args.add_named(num_threads, "t", "threads", "The number of threads for the multi-threaded runs.");
+	args.add_flag(print_stats, "s", "stats", "Print heap statistics after running.");
+	args.parse(argc, argv);
+
+	if(num_threads < 1)
+		num_threads = 1;
+
+	Duck::println("{} operations per thread, {} threads", iterations, num_threads);
+	for(auto& workload : workloads) {
+		for(int threads : {1, num_threads}) {
+			long millis = time_workload(workload, threads);
+			long ops = (long) iterations * threads;
+			Duck::println("{}, {} thread(s): {}ms ({} ops/s)", workload.name, threads, millis, millis ? ops * 1000 / millis : ops * 1000);
+			if(threads == num_threads)
+				break;
+		}
+	}
+
+	if(print_stats) {
+		auto info = mallinfo();
+		Duck::println("In use: {} bytes, mapped: {} bytes, large: {} bytes, trimmable: {} bytes",
+					  info.uordblks, info.arena, info.hblkhd, info.keepcost);
+		malloc_stats();
+		malloc_trim(0);
+	}
+
+	return 0;
+}
@@ -0,0 +1,122 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2024 Byteduck */
+
+// A program that benchmarks libc's memory and string functions against simple reference implementations
+
+#include <libduck/Args.h>
+#include <libduck/FormatStream.h>
+#include <libduck/Time.h>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+#define MAX_SIZE (1024 * 1024)
+#define MAX_ALIGN 16
+
+long megabytes = 64;
+bool only_libc = false;
+
+static const size_t sizes[] = {16, 64, 256, 1024, 4096, 65536, MAX_SIZE};
+static const size_t alignments[] = {0, 1, 7};
+
+uint8_t* buffer_a;
+uint8_t* buffer_b;
+
+__attribute__((noinline)) void* reference_memcpy(void* dest, const void* src, size_t n) {
+	void* odest = dest;
+	asm volatile("rep movsb" : "+D"(dest), "+S"(src), "+c"(n) :: "memory");
+	return odest;
+}
+
+__attribute__((noinline)) void* reference_memmove(void* dest, const void* src, size_t n) {
+	auto* dest8 = (volatile uint8_t*) dest + n;
+	auto* src8 = (const volatile uint8_t*) src + n;
+	while(n--)
+		*--dest8 = *--src8;
+	return dest;
+}
+
+__attribute__((noinline)) void* reference_memset(void* dest, int c, size_t n) {
+	void* odest = dest;
+	asm volatile("rep stosb" : "+D"(dest), "+c"(n) : "a"(c) : "memory");
+	return odest;
+}
+
+__attribute__((noinline)) size_t reference_strlen(const char* str) {
+	auto* s = (const volatile char*) str;
+	while(*s)
+		s++;
+	return s - str;
+}
+
+struct Benchmark {
+	const char* name;
+	void (*libc)(size_t size, size_t align);
+	void (*reference)(size_t size, size_t align);
+};
+
+static const Benchmark benchmarks[] = {
+	{"memcpy",
+		[](size_t size, size_t align) { memcpy(buffer_a + align, buffer_b, size); },
+		[](size_t size, size_t align) { reference_memcpy(buffer_a + align, buffer_b, size); }},
+	{"memmove",
+		[](size_t size, size_t align) { memmove(buffer_a + align + 8, buffer_a + align, size); },
+		[](size_t size, size_t align) { reference_memmove(buffer_a + align + 8, buffer_a + align, size); }},
+	{"memset",
+		[](size_t size, size_t align) { memset(buffer_a + align, (int) size, size); },
+		[](size_t size, size_t align) { reference_memset(buffer_a + align, (int) size, size); }},
+	{"strlen",
+		[](size_t size, size_t align) { buffer_b[align + size - 1] = '\0'; (void) strlen((char*) buffer_b + align); buffer_b[align + size - 1] = 'a'; },
+		[](size_t size, size_t align) { buffer_b[align + size - 1] = '\0'; (void) reference_strlen((char*) buffer_b + align); buffer_b[align + size - 1] = 'a'; }},
+};
+
+// Returns the throughput of the function in MiB/s.
+long run(void (*func)(size_t, size_t), size_t size, size_t align) {
+	long iterations = (megabytes * 1024 * 1024) / (long) size;
+	if(!iterations)
+		iterations = 1;
+	auto start = Duck::Time::now();
+	for(long i = 0; i < iterations; i++)
+		func(size, align);
+	auto elapsed = Duck::Time::now() - start;
+	long usec = (long) elapsed.epoch() * 1000000 + elapsed.interval_usec();
+	if(!usec)
+		usec = 1;
+	return (long) ((int64_t) iterations * (int64_t) size * 1000000 / usec / (1024 * 1024));
+}
+
+int main(int argc, char** argv) {
+	Duck::Args args;
+	args.add_named(megabytes, "m", "megabytes", "The number of megabytes to process per size and alignment.");
+	args.add_flag(only_libc, "l", "libc-only", "Only benchmark the libc implementations.");
+	args.parse(argc, argv);
+
+	if(megabytes < 1)
+		megabytes = 1;
+
+	// Leave room for the memmove offset and misalignment
+	buffer_a = (uint8_t*) malloc(MAX_SIZE + MAX_ALIGN * 2);
+	buffer_b = (uint8_t*) malloc(MAX_SIZE + MAX_ALIGN * 2);
+	memset(buffer_a, 'a', MAX_SIZE + MAX_ALIGN * 2);
+	memset(buffer_b, 'a', MAX_SIZE + MAX_ALIGN * 2);
+
+	Duck::println("{} MiB per run, throughput in MiB/s (libc / reference)", megabytes);
+	for(auto& benchmark : benchmarks) {
+		Duck::println("{}:", benchmark.name);
+		for(auto size : sizes) {
+			for(auto align : alignments) {
+				long libc = run(benchmark.libc, size, align);
+				if(only_libc) {
+					Duck::println("  {} bytes, +{}: {}", size, align, libc);
+					continue;
+				}
+				long reference = run(benchmark.reference, size, align);
+				Duck::println("  {} bytes, +{}: {} / {}", size, align, libc, reference);
+			}
+		}
+	}
+
+	free(buffer_a);
+	free(buffer_b);
+	return 0;
+}
@@ -0,0 +1,123 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2024 Byteduck */
+
+// A program that benchmarks River function call round trips, one at a time and pipelined
+
+#include <libduck/Args.h>
+#include <libduck/FormatStream.h>
+#include <libduck/Time.h>
+#include <libriver/river.h>
+#include <csignal>
+#include <unistd.h>
+#include <vector>
+#include <sys/wait.h>
+
+int num_calls = 10000;
+int max_depth = 32;
+
+struct EchoPkt {
+	int value;
+	int padding[7];
+};
+
+int host(const std::string& socket_name, int ready_fd) {
+	auto bus = River::BusConnection::connect(socket_name);
+	if(bus.is_error())
+		return 1;
+	auto endpoint = bus.value()->register_endpoint("riverbench");
+	if(endpoint.is_error())
+		return 1;
+	auto res = endpoint.value()->register_function<EchoPkt, EchoPkt>("echo", [](sockid_t, EchoPkt pkt) {
+		pkt.value++;
+		return pkt;
+	});
+	if(res.is_error())
+		return 1;
+
+	char ready = 1;
+	write(ready_fd, &ready, 1);
+	close(ready_fd);
+	while(true)
+		bus.value()->read_and_handle_packets(true);
+}
+
+int main(int argc, char** argv) {
+	Duck::Args args;
+	args.add_named(num_calls, "n", "calls", "The number of calls to make per test.");
+	args.add_named(max_depth, "d", "depth", "The largest number of calls to have in flight at once.");
+	args.parse(argc, argv);
+
+	if(num_calls < 1)
+		num_calls = 1;
+	if(max_depth < 1)
+		max_depth = 1;
+
+	auto socket_name = "riverbench-" + std::to_string(getpid());
+	auto server = River::BusServer::create(socket_name);
+	if(server.is_error()) {
+		Duck::printerrln("riverbench: Couldn't create bus: {}", server.message());
+		return 1;
+	}
+	server.value()->spawn_thread();
+
+	int ready_pipe[2];
+	if(pipe(ready_pipe) < 0) {
+		perror("pipe");
+		return 1;
+	}
+
+	pid_t host_pid = fork();
+	if(!host_pid) {
+		close(ready_pipe[0]);
+		exit(host(socket_name, ready_pipe[1]));
+	}
+	close(ready_pipe[1]);
+
+	char ready = 0;
+	if(read(ready_pipe[0], &ready, 1) != 1 || !ready) {
+		Duck::printerrln("riverbench: Host failed to start");
+		return 1;
+	}
+	close(ready_pipe[0]);
+
+	auto bus = River::BusConnection::connect(socket_name);
+	if(bus.is_error())
+		return 1;
+	auto endpoint = bus.value()->get_endpoint("riverbench");
+	if(endpoint.is_error())
+		return 1;
+	auto echo = endpoint.value()->get_function<EchoPkt, EchoPkt>("echo");
+	if(echo.is_error())
+		return 1;
+	auto& function = echo.value();
+
+	Duck::println("{} calls per test", num_calls);
+	int errors = 0;
+	for(int depth = 1; depth <= max_depth; depth *= 2) {
+		std::vector<River::Future<EchoPkt>> in_flight;
+		in_flight.reserve(depth);
+		auto start = Duck::Time::now();
+		for(int call = 0; call < num_calls; call += depth) {
+			int batch = std::min(depth, num_calls - call);
+			for(int i = 0; i < batch; i++) {
+				if(depth == 1)
+					errors += function({call + i}).value != call + i + 1;
+				else
+					in_flight.push_back(function.call_async({call + i}));
+			}
+			for(int i = 0; i < (int) in_flight.size(); i++)
+				errors += in_flight[i].get().value != call + i + 1;
+			in_flight.clear();
+		}
+		auto time = Duck::Time::now() - start;
+		long micros = time.epoch() * 1000000 + time.interval_usec();
+		Duck::println("{} in flight: {}ms ({}us per call)", depth, micros / 1000, micros / num_calls);
+	}
+
+	if(errors)
+		Duck::printerrln("riverbench: {} calls returned the wrong value!", errors);
+
+	kill(host_pid, SIGTERM);
+	waitpid(host_pid, nullptr, 0);
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,96 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2024 Byteduck */
+
+// A program that shows the most contended kernel locks
+
+#include <libduck/Args.h>
+#include <libduck/File.h>
+#include <libduck/FileStream.h>
+#include <libduck/FormatStream.h>
+#include <libduck/StringStream.h>
+#include <vector>
+#include <algorithm>
+
+struct LockStats {
+	std::string name;
+	unsigned long long acquisitions;
+	unsigned long long contentions;
+	unsigned long long total_wait;
+	unsigned long long max_wait;
+	unsigned long long max_hold;
+};
+
+int num_locks = 10;
+std::string sort_by = "contentions";
+
+Duck::ResultRet<std::vector<LockStats>> read_lock_info() {
+	auto file = TRY(Duck::File::open("/proc/lockinfo", "r"));
+	auto stream = Duck::FileInputStream(file);
+	std::vector<LockStats> out;
+	while (!stream.eof()) {
+		std::string line;
+		stream >> line;
+		if (line.empty())
+			continue;
+		Duck::StringInputStream line_stream {line};
+		line_stream.set_delimeter('\t');
+		std::string parts[6];
+		int idx = 0;
+		while (!line_stream.eof() && idx < 6)
+			line_stream >> parts[idx++];
+		if (idx != 6)
+			continue;
+		out.push_back({
+			parts[0],
+			std::stoull(parts[1]),
+			std::stoull(parts[2]),
+			std::stoull(parts[3]),
+			std::stoull(parts[4]),
+			std::stoull(parts[5])
+		});
+	}
+	return out;
+}
+
+int main(int argc, char** argv) {
+	Duck::Args args;
+	args.add_named(num_locks, "n", "number", "The number of locks to show. (Default: 10)");
+	args.add_named(sort_by, "s", "sort", "What to sort locks by: contentions, wait, hold, or acquisitions. (Default: contentions)");
+	args.parse(argc, argv);
+
+	unsigned long long LockStats::* key;
+	if (sort_by == "contentions")
+		key = &LockStats::contentions;
+	else if (sort_by == "wait")
+		key = &LockStats::total_wait;
+	else if (sort_by == "hold")
+		key = &LockStats::max_hold;
+	else if (sort_by == "acquisitions")
+		key = &LockStats::acquisitions;
+	else {
+		Duck::printerrln("lockstat: Unknown sort key {}", sort_by);
+		return EINVAL;
+	}
+
+	auto locks_res = read_lock_info();
+	if (locks_res.is_error()) {
+		Duck::printerrln("lockstat: Couldn't read /proc/lockinfo: {}", locks_res.result());
+		return locks_res.code();
+	}
+	auto locks = locks_res.value();
+	std::sort(locks.begin(), locks.end(), [&] (const LockStats& a, const LockStats& b) {
+		return a.*key > b.*key;
+	});
+
+	printf("%-26s %10s %10s %6s %12s %10s %10s %10s\n", "LOCK", "ACQUIRED", "CONTENDED", "%CONT", "WAIT(us)", "AVG(us)", "MAX(us)", "HOLD(us)");
+	for (size_t i = 0; i < locks.size() && i < (size_t) num_locks; i++) {
+		auto& lock = locks[i];
+		auto percent = lock.acquisitions ? (double) lock.contentions * 100.0 / (double) lock.acquisitions : 0.0;
+		auto avg_wait = lock.contentions ? lock.total_wait / lock.contentions : 0;
+		printf("%-26s %10llu %10llu %5.1f%% %12llu %10llu %10llu %10llu\n",
+			   lock.name.c_str(), lock.acquisitions, lock.contentions, percent,
+			   lock.total_wait, avg_wait, lock.max_wait, lock.max_hold);
+	}
+
+	return 0;
+}
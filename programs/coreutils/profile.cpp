@@ -2,108 +2,161 @@
 /* Copyright © 2016-2023 Byteduck */
 
 #include <libdebug/LiveDebugger.h>
-#include <csignal>
 #include <memory>
-#include <sys/wait.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <kernel/api/profile.h>
 #include <libduck/FormatStream.h>
 #include <libduck/Args.h>
 #include <libduck/Socket.h>
+#include <libduck/File.h>
+#include <libduck/Time.h>
 #include <ctime>
+#include <map>
+#include <algorithm>
 
 constexpr int debugd_port = 59336;
 constexpr const char* debugd_start = "DEBUGD\nPROFILE\n";
+constexpr const char* kernel_map_path = "/boot/kernel.map";
 
 using namespace Debug;
 using Duck::OutputStream;
 
-int pid;
+int pid = PROFILE_ALL_PROCESSES;
 int interval = 10;
 int duration = 5000;
 bool remote = false;
 std::string filename;
 
-struct Thread {
-	tid_t tid;
+struct Process {
+	std::string name;
 	LiveDebugger debugger;
-	std::vector<std::vector<size_t>> stacks;
 };
 
-Duck::Result output_profile(
-		Duck::OutputStream& stream,
-		std::map<size_t, AddressInfo>& symbols,
-		std::vector<Duck::Ptr<Thread>>& threads) {
-	for (auto& thread : threads){
-		for (auto& stk : thread->stacks) {
-			stream << "thread " << thread->tid << ";";
-			for(size_t i = stk.size(); i > 0; i--) {
-				auto pos = stk[i - 1];
-				auto info = symbols.find(pos);
-				if (info == symbols.end()) {
-					auto info_res = thread->debugger.info_at(pos);
-					if(info_res.is_error())
-						symbols[pos] = {"???", pos, nullptr};
-					else
-						symbols[pos] = info_res.value();
-					info = symbols.find(pos);
-				}
-
-				auto& symbol = info->second;
-				if (!symbol.object)
-					stream % "?? @ {#x}" % symbol.symbol_offset;
-				else if(symbol.symbol_name == "__syscall_trap__")
-					stream << "<kernel>";
-				else
-					stream % "{} @ {}" % symbol.symbol_name % symbol.object->name;
-
-				if (i != 1)
-					stream << ";";
-			}
-			stream << " 1\n";
-		}
+std::map<pid_t, Duck::Ptr<Process>> processes;
+std::vector<profile_sample> samples;
+std::vector<std::pair<size_t, std::string>> kernel_symbols;
+
+void load_kernel_symbols() {
+	// The map is the output of nm -n, so the symbols are already sorted by address
+	auto file_res = Duck::File::open(kernel_map_path, "r");
+	if (file_res.is_error()) {
+		Duck::printerrln("Warning: Couldn't open {}, kernel frames won't be symbolicated: {}", kernel_map_path, file_res.result());
+		return;
+	}
+	Duck::FileInputStream stream {file_res.value()};
+	while (!stream.eof()) {
+		std::string line;
+		stream >> line;
+		if (line.size() < 12)
+			continue;
+		kernel_symbols.emplace_back(strtoul(line.substr(0, 8).c_str(), nullptr, 16), line.substr(11));
+	}
+}
+
+void add_process(pid_t proc_pid) {
+	if (processes.count(proc_pid))
+		return;
+	auto process = std::make_shared<Process>();
+	auto proc_res = Sys::Process::get(proc_pid);
+	process->name = proc_res.is_error() ? "pid " + std::to_string(proc_pid) : proc_res.value().name();
+	// The kernel process has no memory map to load, and every one of its frames is in the kernel anyway
+	if (proc_pid)
+		process->debugger.inspect(proc_pid);
+	processes[proc_pid] = process;
+}
+
+std::string frame_name(Process& process, size_t addr, bool kernel, std::map<size_t, std::string>& names) {
+	auto name = names.find(addr);
+	if (name != names.end())
+		return name->second;
+
+	std::string ret;
+	if (kernel) {
+		auto symbol = std::upper_bound(kernel_symbols.begin(), kernel_symbols.end(), std::make_pair(addr, std::string()));
+		if (symbol == kernel_symbols.begin())
+			ret = Duck::format("?? @ kernel {#x}", addr);
+		else
+			ret = (symbol - 1)->second + " @ kernel";
+	} else {
+		auto info_res = process.debugger.info_at(addr);
+		if (info_res.is_error() || !info_res.value().object)
+			ret = Duck::format("?? @ {#x}", addr);
+		else
+			ret = info_res.value().symbol_name + " @ " + info_res.value().object->name;
 	}
 
+	names[addr] = ret;
+	return ret;
+}
+
+Duck::Result output_profile(Duck::OutputStream& stream) {
+	// Fold identical stacks together, outermost frame first
+	std::map<std::string, int> folded;
+	std::map<pid_t, std::map<size_t, std::string>> names;
+	for (auto& sample : samples) {
+		auto& process = *processes[sample.pid];
+		auto& process_names = names[sample.pid];
+		std::string stack = process.name + ";thread " + std::to_string(sample.tid);
+		for (size_t i = sample.num_frames; i > 0; i--)
+			stack += ";" + frame_name(process, sample.frames[i - 1], i <= sample.num_kernel_frames || !sample.pid, process_names);
+		folded[stack]++;
+	}
+
+	for (auto& stack : folded)
+		stream << stack.first << " " << stack.second << "\n";
+
 	return Duck::Result::SUCCESS;
 }
 
+Duck::Result read_samples(Duck::File& device) {
+	profile_sample buffer[64];
+	while (true) {
+		auto nread = TRY(device.read(buffer, sizeof(buffer))) / sizeof(profile_sample);
+		for (size_t i = 0; i < nread; i++) {
+			add_process(buffer[i].pid);
+			samples.push_back(buffer[i]);
+		}
+		if (nread < sizeof(buffer) / sizeof(profile_sample))
+			return Duck::Result::SUCCESS;
+	}
+}
+
 Duck::Result profile() {
-	auto proc = TRY(Sys::Process::get(pid));
-
-	// First, attach to all the threads
-	const int loops = duration / interval;
-	std::vector<Duck::Ptr<Thread>> threads;
-	for (auto tid : proc.threads()) {
-		auto thread = std::make_shared<Thread>();
-		thread->tid = tid;
-		thread->stacks.reserve(loops);
-		auto attach_res = thread->debugger.attach(pid, tid);
-		if (attach_res.is_error())
-			Duck::printerrln("Warning: Failed to attach to thread {}: {}", tid, attach_res);
-		else
-			threads.push_back(thread);
+	auto device = TRY(Duck::File::open("/dev/profile", "r"));
+	std::string target = "the whole system";
+	if (pid != PROFILE_ALL_PROCESSES) {
+		auto proc = TRY(Sys::Process::get(pid));
+		target = proc.name();
+		add_process(pid);
 	}
 
-	if (threads.empty())
-		return Duck::Result("Could not attach to any threads");
-
-	Duck::println("Sampling {} for ~{}ms...", proc.name(), duration);
-	for (size_t i = 0; i < loops; i++) {
-		waitpid(pid, nullptr, 0);
-		for (auto& thread : threads)
-			thread->stacks.push_back(TRY(thread->debugger.walk_stack_unsymbolicated()));
-		kill(pid, SIGCONT);
-		usleep(interval * 1000);
-		kill(pid, SIGSTOP);
+	profile_config config = {
+		.pid = pid,
+		.interval = interval * 1000
+	};
+	if (ioctl(device.fd(), IO_PROFILE_START, &config) < 0)
+		return Duck::Result(errno);
+
+	// The kernel keeps the samples in a ring buffer, so read them out often enough that it doesn't overflow
+	Duck::println("Sampling {} for ~{}ms...", target, duration);
+	auto end_time = Duck::Time::now() + Duck::Time::millis(duration);
+	Duck::Result read_res = Duck::Result::SUCCESS;
+	while (Duck::Time::now() < end_time && !read_res.is_error()) {
+		usleep(100 * 1000);
+		read_res = read_samples(device);
 	}
-	waitpid(pid, nullptr, 0);
-	kill(pid, SIGCONT);
+	ioctl(device.fd(), IO_PROFILE_STOP, nullptr);
+	TRYRES(read_res);
+	TRYRES(read_samples(device));
 
-	Duck::println("Done! Symbolicating and dumping...");
-	std::map<size_t, AddressInfo> symbols;
+	Duck::println("Done! Took {} samples. Symbolicating and dumping...", samples.size());
+	load_kernel_symbols();
 
 	if (remote) {
 		// Collect into StringOutputStream
 		Duck::StringOutputStream stream;
-		TRYRES(output_profile(stream, symbols, threads));
+		TRYRES(output_profile(stream));
 
 		// Connect to socket
 		Duck::print("Connecting to debug daemon... ", debugd_port);
@@ -125,22 +178,23 @@ Duck::Result profile() {
 		sock.close();
 	} else {
 		// Write to file
-		if (filename.empty())
-			filename = "profile-" + proc.name() + "-" + std::to_string(std::time(nullptr)) + ".txt";
+		if (filename.empty()) {
+			auto name = pid == PROFILE_ALL_PROCESSES ? std::string("system") : processes[pid]->name;
+			filename = "profile-" + name + "-" + std::to_string(std::time(nullptr)) + ".txt";
+		}
 		auto out = TRY(Duck::File::open(filename, "w"));
 		Duck::FileOutputStream fs {out};
-		TRYRES(output_profile(fs, symbols, threads));
+		TRYRES(output_profile(fs));
 		out.close();
 		Duck::println("Done! Saved to {}.", filename);
 	}
 
-
 	return Duck::Result::SUCCESS;
 }
 
 int main(int argc, char** argv) {
 	Duck::Args args;
-	args.add_positional(pid, true, "pid", "The PID of the program to profile.");
+	args.add_positional(pid, false, "pid", "The PID of the program to profile. (Default: the whole system)");
 	args.add_named(interval, "i", "interval", "The interval with which to sample, in ms. (Default: 10)");
 	args.add_named(duration, "d", "duration", "The duration to sample for, in ms. (Default: 5000)");
 	args.add_named(filename, "o", "output", "The output file.");
@@ -22,11 +22,13 @@
 int main(int argc, char** argv, char** envp) {
 	auto procs = Sys::Process::get_all();
 
-	printf("PID\tPPID\tState\tName\n");
+	printf("PID\tPPID\tState\t%%CPU\tTIME\tName\n");
 
 	for(auto& proc_pair : procs) {
 		auto& proc = proc_pair.second;
-		printf("%d\t%d\t%c\t%s\n", proc.pid(), proc.ppid(), proc.state_name()[0], proc.name().c_str());
+		auto cpu_time = (long long) proc.cpu_time().epoch();
+		printf("%d\t%d\t%c\t%.1f\t%lld:%02lld\t%s\n", proc.pid(), proc.ppid(), proc.state_name()[0], proc.cpu_percent(),
+			   cpu_time / 60, cpu_time % 60, proc.name().c_str());
 	}
 
 	return 0;
@@ -0,0 +1,258 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2024 Byteduck */
+
+// A program that records events from the kernel's tracepoints and dumps or summarizes them
+
+#include <kernel/api/trace.h>
+#include <libduck/Args.h>
+#include <libduck/FormatStream.h>
+#include <libduck/File.h>
+#include <libduck/StringStream.h>
+#include <libduck/Time.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <map>
+#include <vector>
+#include <algorithm>
+
+int duration = 1000;
+std::string events_arg;
+bool summarize = false;
+
+const char* event_names[TRACE_NUM_EVENTS] = {
+	"switch", "syscall", "sysret", "fault", "blk_submit", "blk_done", "irq", "rx", "tx", "contend"
+};
+
+std::vector<trace_event> events;
+
+Duck::ResultRet<uint32_t> parse_events() {
+	if (events_arg.empty())
+		return TRACE_ALL_EVENTS;
+
+	uint32_t mask = 0;
+	Duck::StringInputStream stream {events_arg};
+	stream.set_delimeter(',');
+	while (!stream.eof()) {
+		std::string name;
+		stream >> name;
+		auto event = std::find_if(std::begin(event_names), std::end(event_names), [&] (const char* event_name) {
+			return name == event_name;
+		});
+		if (event == std::end(event_names))
+			return Duck::Result("Unknown event " + name);
+		mask |= TRACE_EVENT_MASK(event - std::begin(event_names));
+	}
+	return mask;
+}
+
+Duck::Result read_events(Duck::File& device) {
+	trace_event buffer[128];
+	while (true) {
+		auto nread = TRY(device.read(buffer, sizeof(buffer))) / sizeof(trace_event);
+		events.insert(events.end(), buffer, buffer + nread);
+		if (nread < sizeof(buffer) / sizeof(trace_event))
+			return Duck::Result::SUCCESS;
+	}
+}
+
+void dump() {
+	uint64_t start = events.empty() ? 0 : events[0].time;
+	for (auto& event : events) {
+		printf("%10llu [%d] %-10s ", event.time - start, event.tid, event.type < TRACE_NUM_EVENTS ? event_names[event.type] : "?");
+		switch (event.type) {
+			case TRACE_CONTEXT_SWITCH:
+				printf("to %d (state %d)\n", event.args[0], event.args[1]);
+				break;
+			case TRACE_SYSCALL_ENTER:
+				printf("%u (0x%x)\n", event.args[0], event.args[1]);
+				break;
+			case TRACE_SYSCALL_EXIT:
+				printf("%u = %d\n", event.args[0], event.args[1]);
+				break;
+			case TRACE_PAGE_FAULT:
+				printf("0x%x (error %u)\n", event.args[0], event.args[1]);
+				break;
+			case TRACE_BLOCK_SUBMIT:
+			case TRACE_BLOCK_COMPLETE:
+				printf("%s %u+%u\n", (event.args[1] & TRACE_BLOCK_WRITE) ? "write" : "read", event.args[0], event.args[1] & ~TRACE_BLOCK_WRITE);
+				break;
+			case TRACE_IRQ:
+				printf("%u\n", event.args[0]);
+				break;
+			case TRACE_PACKET_RX:
+			case TRACE_PACKET_TX:
+				printf("%u bytes\n", event.args[0]);
+				break;
+			case TRACE_LOCK_CONTENDED:
+				printf("0x%x held by %d\n", event.args[0], event.args[1]);
+				break;
+			default:
+				printf("0x%x 0x%x\n", event.args[0], event.args[1]);
+		}
+	}
+}
+
+struct Latency {
+	unsigned count = 0;
+	uint64_t total = 0;
+	uint64_t max = 0;
+
+	void add(uint64_t time) {
+		count++;
+		total += time;
+		max = std::max(max, time);
+	}
+};
+
+template<typename K>
+void print_top(const char* title, const std::map<K, Latency>& stats, const char* key_format) {
+	if (stats.empty())
+		return;
+	std::vector<std::pair<K, Latency>> sorted(stats.begin(), stats.end());
+	std::sort(sorted.begin(), sorted.end(), [] (const auto& a, const auto& b) { return a.second.total > b.second.total; });
+	printf("\n%s\n", title);
+	printf("%-12s %8s %12s %10s %10s\n", "", "COUNT", "TOTAL(us)", "AVG(us)", "MAX(us)");
+	for (size_t i = 0; i < sorted.size() && i < 10; i++) {
+		auto& stat = sorted[i].second;
+		char key[16];
+		snprintf(key, sizeof(key), key_format, sorted[i].first);
+		printf("%-12s %8u %12llu %10llu %10llu\n", key, stat.count, stat.total, stat.total / stat.count, stat.max);
+	}
+}
+
+void summary() {
+	unsigned counts[TRACE_NUM_EVENTS] = {0};
+	std::map<unsigned, Latency> syscalls;
+	std::map<unsigned, Latency> block_io;
+	std::map<unsigned, unsigned> irqs;
+	std::map<uintptr_t, Latency> locks;
+	std::map<tid_t, trace_event> syscall_starts;
+	std::map<uint32_t, uint64_t> block_starts;
+	std::map<tid_t, std::pair<uint64_t, uint32_t>> contention_starts; // When each thread started waiting, and on which lock
+	uint64_t rx_bytes = 0, tx_bytes = 0;
+
+	for (auto& event : events) {
+		if (event.type >= TRACE_NUM_EVENTS)
+			continue;
+		counts[event.type]++;
+		switch (event.type) {
+			case TRACE_SYSCALL_ENTER:
+				syscall_starts[event.tid] = event;
+				break;
+			case TRACE_SYSCALL_EXIT: {
+				auto start = syscall_starts.find(event.tid);
+				if (start != syscall_starts.end() && start->second.args[0] == event.args[0])
+					syscalls[event.args[0]].add(event.time - start->second.time);
+				syscall_starts.erase(event.tid);
+				break;
+			}
+			case TRACE_BLOCK_SUBMIT:
+				block_starts[event.args[0]] = event.time;
+				break;
+			case TRACE_BLOCK_COMPLETE: {
+				auto start = block_starts.find(event.args[0]);
+				if (start != block_starts.end())
+					block_io[(event.args[1] & TRACE_BLOCK_WRITE) ? 1 : 0].add(event.time - start->second);
+				block_starts.erase(event.args[0]);
+				break;
+			}
+			case TRACE_IRQ:
+				irqs[event.args[0]]++;
+				break;
+			case TRACE_PACKET_RX:
+				rx_bytes += event.args[0];
+				break;
+			case TRACE_PACKET_TX:
+				tx_bytes += event.args[0];
+				break;
+			case TRACE_LOCK_CONTENDED:
+				// A contending thread waits until it runs again, so measure until it's next switched back to
+				contention_starts[event.tid] = {event.time, event.args[0]};
+				locks[event.args[0]].count++;
+				break;
+			case TRACE_CONTEXT_SWITCH: {
+				auto start = contention_starts.find(event.args[0]);
+				if (start == contention_starts.end())
+					break;
+				auto& lock = locks[start->second.second];
+				auto wait = event.time - start->second.first;
+				lock.total += wait;
+				lock.max = std::max(lock.max, wait);
+				contention_starts.erase(start);
+				break;
+			}
+		}
+	}
+
+	auto elapsed = events.empty() ? 0 : events.back().time - events.front().time;
+	printf("%zu events over %llu us\n\n", events.size(), elapsed);
+	printf("%-12s %8s\n", "EVENT", "COUNT");
+	for (int i = 0; i < TRACE_NUM_EVENTS; i++)
+		printf("%-12s %8u\n", event_names[i], counts[i]);
+	if (counts[TRACE_PACKET_RX] || counts[TRACE_PACKET_TX])
+		printf("\nNetwork: %llu bytes received, %llu bytes sent\n", rx_bytes, tx_bytes);
+
+	if (!irqs.empty()) {
+		printf("\n%-12s %8s\n", "IRQ", "COUNT");
+		for (auto& irq : irqs)
+			printf("%-12u %8u\n", irq.first, irq.second);
+	}
+
+	print_top("Syscalls by time spent:", syscalls, "%u");
+	print_top("Block I/O (0 = read, 1 = write):", block_io, "%u");
+	print_top("Contended locks by time waited (approximate):", locks, "0x%x");
+}
+
+int main(int argc, char** argv) {
+	Duck::Args args;
+	args.add_named(duration, "d", "duration", "The duration to trace for, in ms. (Default: 1000)");
+	args.add_named(events_arg, "e", "events", "A comma-separated list of the events to trace: switch, syscall, sysret, fault, blk_submit, blk_done, irq, rx, tx, contend. (Default: all)");
+	args.add_flag(summarize, "s", "summary", "Shows a summary of the events instead of each one.");
+	args.parse(argc, argv);
+
+	auto mask_res = parse_events();
+	if (mask_res.is_error()) {
+		Duck::printerrln("trace: {}", mask_res.result());
+		return EINVAL;
+	}
+	uint32_t mask = mask_res.value();
+
+	auto device_res = Duck::File::open("/dev/trace", "r");
+	if (device_res.is_error()) {
+		Duck::printerrln("trace: Couldn't open /dev/trace: {}", device_res.result());
+		return device_res.code();
+	}
+	auto device = device_res.value();
+
+	if (ioctl(device.fd(), IO_TRACE_START, &mask) < 0) {
+		perror("trace");
+		return errno;
+	}
+
+	// The kernel keeps the events in a ring buffer, so read them out often enough that it doesn't overflow
+	auto end_time = Duck::Time::now() + Duck::Time::millis(duration);
+	Duck::Result read_res = Duck::Result::SUCCESS;
+	while (Duck::Time::now() < end_time && !read_res.is_error()) {
+		usleep(20 * 1000);
+		read_res = read_events(device);
+	}
+	ioctl(device.fd(), IO_TRACE_STOP, nullptr);
+	if (!read_res.is_error())
+		read_res = read_events(device);
+	if (read_res.is_error()) {
+		Duck::printerrln("trace: Couldn't read events: {}", read_res);
+		return read_res.code();
+	}
+
+	uint32_t lost = 0;
+	ioctl(device.fd(), IO_TRACE_LOST, &lost);
+	if (lost)
+		Duck::printerrln("trace: {} events were lost because they weren't read in time", lost);
+
+	if (summarize)
+		summary();
+	else
+		dump();
+
+	return 0;
+}
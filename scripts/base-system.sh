@@ -35,6 +35,8 @@ mknod "$FS_DIR"/dev/random c 1 8
 mknod "$FS_DIR"/dev/null c 1 3
 mknod "$FS_DIR"/dev/zero c 1 5
 mknod "$FS_DIR"/dev/klog c 1 16
+mknod -m 600 "$FS_DIR"/dev/profile c 1 17
+mknod -m 600 "$FS_DIR"/dev/trace c 1 18
 mknod "$FS_DIR"/dev/fb0 b 29 0
 mkdir -p "$FS_DIR"/dev/input
 mknod "$FS_DIR"/dev/input/keyboard c 13 0
@@ -53,6 +55,14 @@ msg "Setting up /sock/..."
 mkdir -p "$FS_DIR"/sock
 chmod 777 "$FS_DIR"/sock
 
+msg "Setting up /var/..."
+mkdir -p "$FS_DIR"/var/cache/ld
+chown 0:0 "$FS_DIR"/var/cache/ld
+chmod 755 "$FS_DIR"/var/cache/ld
+mkdir -p "$FS_DIR"/var/cache/images
+chown 0:0 "$FS_DIR"/var/cache/images
+chmod 1777 "$FS_DIR"/var/cache/images
+
 msg "Setting up /etc/..."
 chown -R 0:0 "$FS_DIR"/etc
 
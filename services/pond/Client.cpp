@@ -169,6 +169,30 @@ bool Client::invalidate_window(WindowInvalidatePkt& params) {
 	return false;
 }
 
+bool Client::scroll_window(WindowScrollPkt& params) {
+	auto window_it = windows.find(params.window_id);
+	if(window_it == windows.end())
+		return false;
+	auto window = window_it->second;
+
+	//Move what's already on the screen of the area if we can, and only redraw what was scrolled into view
+	auto area = params.area.overlapping_area({0, 0, window->rect().width, window->rect().height});
+	auto moved = area.overlapping_area(area.transform(params.delta));
+	auto source = moved.transform(params.delta * -1).transform(window->absolute_rect().position());
+	if(!moved.empty() && Display::inst().move_pixels(window, source, params.delta)) {
+		Gfx::Region exposed = area;
+		exposed.subtract(moved);
+		for(auto& rect : exposed.rects())
+			window->invalidate(rect);
+	} else {
+		window->invalidate(area);
+	}
+
+	if(!params.damage.empty())
+		window->invalidate(params.damage);
+	return window->flip();
+}
+
 FontResponsePkt Client::get_font(GetFontPkt& params) {
 	auto* font = FontManager::inst().get_font(params.font_name.str());
 
@@ -227,6 +251,10 @@ void Client::set_minimum_size(Pond::WindowMinSizePkt& pkt) {
 		window->second->set_minimum_size(pkt.minimum_size);
 }
 
+Pond::FrameStatsPkt Client::get_frame_stats(Pond::GetFrameStatsPkt& pkt) {
+	return Display::inst().frame_stats();
+}
+
 void Client::set_unresponsive(bool new_val) {
 	if(unresponsive == new_val)
 		return;
@@ -49,6 +49,7 @@ public:
 	void move_window(Pond::WindowMovePkt& packet);
 	Pond::WindowResizedPkt resize_window(Pond::WindowResizePkt& packet);
 	bool invalidate_window(Pond::WindowInvalidatePkt& packet);
+	bool scroll_window(Pond::WindowScrollPkt& packet);
 	Pond::FontResponsePkt get_font(Pond::GetFontPkt& packet);
 	void set_title(Pond::SetTitlePkt& packet);
 	void reparent(Pond::WindowReparentPkt& packet);
@@ -59,6 +60,7 @@ public:
 	const App::Info& get_app_info();
 	void focus_window(Pond::WindowFocusPkt& pkt);
 	void set_minimum_size(Pond::WindowMinSizePkt& pkt);
+	Pond::FrameStatsPkt get_frame_stats(Pond::GetFrameStatsPkt& pkt);
 
 	bool is_unresponsive() const { return unresponsive; }
 
@@ -29,7 +29,8 @@
 #include <sys/ioctl.h>
 #include <kernel/device/VGADevice.h>
 #include <sys/input.h>
-#include <libgraphics/Memory.h>
+#include <libduck/Time.h>
+#include <algorithm>
 
 using namespace Gfx;
 using Duck::Log, Duck::Config, Duck::ResultRet;
@@ -71,12 +72,15 @@ Display::Display(): _dimensions({0, 0, 0, 0}) {
 		_buffer_mode = BufferMode::Double;
 
 	_framebuffer = {buffer, _dimensions.width, _dimensions.height};
+	_flip_buffers[0] = {buffer, _dimensions.width, _dimensions.height};
+	_flip_buffers[1] = {buffer + _dimensions.area(), _dimensions.width, _dimensions.height};
 	Log::info("Display opened and mapped (", _dimensions.width, " x ", _dimensions.height, ")");
 
+	if(ioctl(framebuffer_fd, IO_VIDEO_REFRESH, &_frame_stats.refresh_rate) < 0)
+		_frame_stats.refresh_rate = VIDEO_REFRESH_RATE;
+
 	if((_keyboard_fd = open("/dev/input/keyboard", O_RDONLY | O_CLOEXEC)) < 0)
 		perror("Failed to open keyboard");
-
-	gettimeofday(&paint_time, NULL);
 }
 
 Gfx::Rect Display::dimensions() {
@@ -160,113 +164,218 @@ void Display::remove_window(Window* window) {
 }
 
 void Display::invalidate(const Gfx::Rect& rect) {
-	if(!rect.empty())
-		invalid_areas.push_back(rect);
+	invalid_region.add(rect);
+	request_frame();
 }
 
-//#define DEBUG_REPAINT_PERF
-void Display::repaint() {
-#ifdef DEBUG_REPAINT_PERF
-	timeval t0, t1;
-	gettimeofday(&t0, nullptr);
-#endif
+void Display::invalidate_cursor() {
+	_cursor_dirty = true;
+	request_frame();
+}
 
-	if(!invalid_areas.empty())
-		display_buffer_dirty = true;
-	else
+bool Display::move_pixels(Window* window, Gfx::Rect area, Gfx::Point delta) {
+	//We can only move what's on the screen as-is if it's exactly the window's pixels, so nothing can be blended in
+	//or drawn over them
+	if(_resize_window || window->hidden() || window->uses_alpha() || !window->old_absolute_shadow_rect().empty())
+		return false;
+	if(window->parent() && window->parent() != _root_window)
+		return false;
+
+	//Only copy what'll end up on the screen, from somewhere on the screen
+	auto dest = area.transform(delta).overlapping_area(_dimensions).overlapping_area(area.overlapping_area(_dimensions).transform(delta));
+	if(dest.empty())
+		return false;
+	auto source = dest.transform(delta * -1);
+
+	auto window_it = std::find(_windows.begin(), _windows.end(), window);
+	if(window_it == _windows.end())
+		return false;
+	for(auto it = window_it + 1; it != _windows.end(); it++) {
+		auto above = *it;
+		if(above == _mouse_window || above->hidden())
+			continue;
+		if(above->absolute_shadow_rect().collides(source) || above->absolute_shadow_rect().collides(dest))
+			return false;
+		if(!above->old_absolute_shadow_rect().empty() && (above->old_absolute_shadow_rect().collides(source) || above->old_absolute_shadow_rect().collides(dest)))
+			return false;
+	}
+
+	//Whatever in the source hasn't been painted yet will be wrong wherever it's moved to, so it needs painting there
+	for(auto& rect : invalid_region.intersection(source).rects())
+		invalid_region.add(rect.transform(delta));
+
+	//And whatever we couldn't copy into the destination needs painting from scratch
+	Gfx::Region uncopied = area.transform(delta).overlapping_area(_dimensions);
+	uncopied.subtract(dest);
+	invalid_region.add(uncopied);
+
+	_moves.push_back({source, delta});
+	request_frame();
+	return true;
+}
+
+void Display::move_window(Window* window, const Gfx::Point& position) {
+	auto old_rect = window->absolute_rect();
+	auto old_shadow_rect = window->absolute_shadow_rect();
+	auto delta = position - window->rect().position();
+	if(delta.x == 0 && delta.y == 0)
 		return;
 
-	//If it hasn't been 1/60 of a second since the last repaint, don't bother
-	if(millis_until_next_flip())
+	if(!move_pixels(window, old_rect, delta)) {
+		window->set_position(position);
 		return;
-	gettimeofday(&paint_time, NULL);
+	}
+
+	//The window's contents were moved, so only the area around them needs painting
+	window->set_position(position, true, false);
+	Gfx::Region exposed = old_shadow_rect;
+	exposed.add(window->absolute_shadow_rect());
+	exposed.subtract(window->absolute_rect());
+	exposed.intersect(_dimensions);
+	invalid_region.add(exposed);
+}
+
+void Display::request_frame() {
+	//Wake up the compositor if it's waiting for something to paint
+	if(!_frame_requested) {
+		_frame_requested = true;
+		futex_signal(&_frame_futex);
+	}
+}
+
+bool Display::take_snapshot() {
+	if(invalid_region.empty() && !_cursor_dirty && _moves.empty())
+		return false;
 
 	//If we're resizing a window, always invalidate the resize rect so we don't screw up the inverted outline effect
 	if(_resize_window)
 		invalidate(_resize_rect);
 
-	auto& fb = _buffer_mode == BufferMode::Single ? _framebuffer : _root_window->framebuffer();
-
-	//Combine areas that overlap
-	auto it = invalid_areas.begin();
-	while(it != invalid_areas.end()) {
-		bool remove_area = false;
-		for(auto & other_area : invalid_areas) {
-			if(&*it != &other_area && it->collides(other_area)) {
-				other_area = it->combine(other_area);
-				remove_area = true;
-				break;
-			}
+	invalid_region.intersect(_dimensions);
+	auto& scene = _scene;
+	scene.moves = std::move(_moves);
+	_moves.clear();
+
+	//When flipping, the back buffer is missing whatever changed in the front buffer last frame, so we copy that over
+	//from the front buffer. The cursor and resize outline drawn in the front buffer come with it, so whatever parts of
+	//those are copied (and wherever they get moved to) need to be painted over.
+	if(_buffer_mode == BufferMode::DoubleFlip) {
+		int front_index = !_back_buffer_index;
+		Gfx::Region overlays = _back_buffer_stale.intersection(_cursor_save_under[front_index].rect);
+		overlays.add(_back_buffer_stale.intersection(_drawn_outline[front_index]));
+		for(auto& move : scene.moves) {
+			for(auto& rect : overlays.intersection(move.area).rects())
+				overlays.add(rect.transform(move.delta));
 		}
-		if(remove_area)
-			invalid_areas.erase(it);
-		else
-			it++;
+		invalid_region.add(overlays);
+
+		scene.stale = std::move(_back_buffer_stale);
+		_back_buffer_stale = invalid_region;
+		for(auto& move : scene.moves)
+			_back_buffer_stale.add(move.area.transform(move.delta));
 	}
 
 	//If double buffering, combine the invalid areas together to calculate the portion of the framebuffer to be redrawn
-	if(_buffer_mode == BufferMode::Double) {
-		//If the invalid buffer area is empty (has an x of -1), initialize it to the first invalid area
-		if(_invalid_buffer_area.x == -1)
-			_invalid_buffer_area = invalid_areas[0];
-		for(auto& area : invalid_areas)
-			_invalid_buffer_area = _invalid_buffer_area.combine(area);
+	if(!invalid_region.empty())
+		invalidate_buffer_area(invalid_region.bounds());
+
+	//Work out what is visible of each window from front to back. Opaque windows hide everything beneath them, so
+	//those parts are taken out of the region left over for the windows below.
+	scene.windows.clear();
+	Gfx::Region uncovered = invalid_region;
+	for(auto it = _windows.rbegin(); it != _windows.rend() && !uncovered.empty(); it++) {
+		auto window = *it;
+		//Don't bother with the mouse window or hidden windows, we draw it separately so it's always on top
+		if(window == _mouse_window || window->hidden())
+			continue;
+
+		//While a resize is pending, only the part of the window that was already there is drawn
+		auto window_old_rect = window->old_absolute_shadow_rect();
+		auto window_visible_rect = window_old_rect.empty() ? window->absolute_shadow_rect() : window_old_rect;
+		if(!uncovered.intersects(window_visible_rect))
+			continue;
+
+		auto content_rect = window_visible_rect.overlapping_area(window->absolute_rect());
+		auto& paint = scene.windows.emplace_back();
+		paint.framebuffer = window->framebuffer();
+		for(int i = 0; i < 4; i++)
+			paint.shadow_buffers[i] = window->shadow_buffers()[i];
+		paint.rect = window->absolute_rect();
+		paint.shadow_rect = window->absolute_shadow_rect();
+		paint.content = uncovered.intersection(content_rect);
+		paint.shadow = window->has_shadow() ? uncovered.intersection(window_visible_rect) : Gfx::Region();
+		paint.uses_alpha = window->uses_alpha();
+		paint.dimmed = window->client()->is_unresponsive();
+		if(!window->uses_alpha())
+			uncovered.subtract(content_rect);
+	}
+	scene.background = std::move(uncovered);
+	invalid_region.clear();
+
+	scene.resize_rect = _resize_window ? _resize_rect : Gfx::Rect {0, 0, 0, 0};
+	if(_mouse_window) {
+		scene.cursor = _mouse_window->framebuffer();
+		scene.cursor_rect = _mouse_window->absolute_rect();
+	} else {
+		scene.cursor_rect = {0, 0, 0, 0};
 	}
+	_cursor_dirty = false;
 
-	for(auto& area : invalid_areas) {
-		// Fill the invalid area with the background.
-		fb.copy(_background_framebuffer, area, area.position());
+	scene.input_time = _input_time;
+	_input_time.reset();
+	return true;
+}
 
-		// See if each window overlaps the invalid area.
-		for(auto window : _windows) {
-			//Don't bother with the mouse window or hidden windows, we draw it separately so it's always on top
-			if(window == _mouse_window || window->hidden())
-				continue;
+//#define DEBUG_REPAINT_PERF
+void Display::paint() {
+#ifdef DEBUG_REPAINT_PERF
+	timeval t0, t1;
+	gettimeofday(&t0, nullptr);
+#endif
 
-			auto window_old_rect = window->old_absolute_shadow_rect();
-			auto window_shabs = window->absolute_shadow_rect();
-			auto window_collision_rect = window_old_rect.empty() ? window_shabs : window_old_rect;
-			if(window_collision_rect.collides(area)) {
-				//If it does, redraw the intersection of the window in question and the invalid area
-				Gfx::Rect window_abs = window->absolute_rect();
-				Gfx::Rect overlap_abs = area.overlapping_area(window_abs);
-				auto transformed_overlap = overlap_abs.transform({-window_abs.x, -window_abs.y});
-				if(window->uses_alpha())
-					fb.copy_blitting(window->framebuffer(), transformed_overlap, overlap_abs.position());
-				else
-					fb.copy(window->framebuffer(), transformed_overlap, overlap_abs.position());
-
-				// If the client is unresponsive, dim the window
-				if (window->client()->is_unresponsive())
-					fb.fill_blitting(overlap_abs, {0, 0, 0, 180});
-
-				// Draw the shadow
-				if(window->has_shadow()) {
-					auto draw_shadow = [&](Gfx::Framebuffer& shadow_buffer, Rect rect) {
-						Gfx::Rect shadow_abs = area.overlapping_area(rect);
-						if(shadow_abs.empty())
-							return;
-						fb.copy_blitting(shadow_buffer, shadow_abs.transform(rect.position() * -1), shadow_abs.position());
-					};
-
-					auto shadow_size = window_abs.x - window_shabs.x;
-					draw_shadow(window->shadow_buffers()[0], window_shabs.inset(0, 0, window_shabs.height - shadow_size, 0));
-					draw_shadow(window->shadow_buffers()[1], window_shabs.inset(window_shabs.height - shadow_size, 0, 0, 0));
-					draw_shadow(window->shadow_buffers()[2], window_shabs.inset(shadow_size, window_shabs.width - shadow_size, shadow_size, 0));
-					draw_shadow(window->shadow_buffers()[3], window_shabs.inset(shadow_size, 0, shadow_size, window_shabs.width - shadow_size));
-				}
-			}
-		}
+	auto& fb = back_buffer();
+	auto& scene = _scene;
+	auto& save_under = _cursor_save_under[_buffer_mode == BufferMode::DoubleFlip ? _back_buffer_index : 0];
+
+	//Take the cursor out of the buffer by putting back what was under it. Anything under it that changed since is
+	//part of the invalid region, so it gets painted over below.
+	if(!save_under.rect.empty()) {
+		fb.copy(save_under.pixels, {0, 0, save_under.rect.width, save_under.rect.height}, save_under.rect.position());
+		invalidate_buffer_area(save_under.rect);
 	}
-	invalid_areas.resize(0);
 
-	//If we're resizing a window, draw the outline
-	if(_resize_window)
-		fb.outline_inverting_checkered(_resize_rect);
+	//Catch up on what changed in the front buffer last frame, then move whatever was moved since
+	if(!scene.stale.empty()) {
+		auto& front = _flip_buffers[!_back_buffer_index];
+		for(auto& area : scene.stale.rects())
+			fb.copy(front, area, area.position());
+	}
+	for(auto& move : scene.moves) {
+		fb.copy_within(move.area, move.area.position() + move.delta);
+		invalidate_buffer_area(move.area.transform(move.delta));
+	}
 
-	//Draw the mouse.
-	fb.draw_image(_mouse_window->framebuffer(), {0, 0, _mouse_window->rect().width, _mouse_window->rect().height},
-				  _mouse_window->absolute_rect().position());
+	//Fill whatever isn't covered by an opaque window with the background, then paint the windows back to front
+	for(auto& area : scene.background.rects())
+		fb.copy(_background_framebuffer, area, area.position());
+	for(auto it = scene.windows.rbegin(); it != scene.windows.rend(); it++)
+		paint_window(fb, *it);
+
+	//If we're resizing a window, draw the outline
+	if(!scene.resize_rect.empty())
+		fb.outline_inverting_checkered(scene.resize_rect);
+	if(_buffer_mode == BufferMode::DoubleFlip)
+		_drawn_outline[_back_buffer_index] = scene.resize_rect;
+
+	//Save what's under the cursor so that moving it doesn't need anything beneath it to be repainted, then draw it
+	save_under.rect = scene.cursor_rect.overlapping_area(_dimensions);
+	if(!save_under.rect.empty()) {
+		if(save_under.pixels.width < save_under.rect.width || save_under.pixels.height < save_under.rect.height)
+			save_under.pixels = Gfx::Framebuffer(scene.cursor_rect.width, scene.cursor_rect.height);
+		save_under.pixels.copy(fb, save_under.rect, {0, 0});
+		fb.draw_image(scene.cursor, {0, 0, scene.cursor_rect.width, scene.cursor_rect.height}, scene.cursor_rect.position());
+		invalidate_buffer_area(save_under.rect);
+	}
 
 #ifdef DEBUG_REPAINT_PERF
 	gettimeofday(&t1, nullptr);
@@ -281,35 +390,160 @@ void Display::repaint() {
 	fb.fill({0, 0, 50, 14}, RGB(0, 0, 0));
 	fb.draw_text(buf, {0, 0}, FontManager::inst().get_font("gohu-14"), RGB(255, 255, 255));
 #endif
+}
 
-	//Flip the display buffers.
-	flip_buffers();
+void Display::paint_window(const Gfx::Framebuffer& fb, const WindowPaint& window) {
+	Gfx::Rect window_abs = window.rect;
+	for(auto& area : window.content.rects()) {
+		auto transformed_area = area.transform({-window_abs.x, -window_abs.y});
+		if(window.uses_alpha)
+			fb.copy_blitting(window.framebuffer, transformed_area, area.position());
+		else
+			fb.copy(window.framebuffer, transformed_area, area.position());
+
+		// If the client is unresponsive, dim the window
+		if (window.dimmed)
+			fb.fill_blitting(area, {0, 0, 0, 180});
+	}
+
+	// Draw the shadow
+	if(window.shadow.empty())
+		return;
+	auto window_shabs = window.shadow_rect;
+	auto shadow_size = window_abs.x - window_shabs.x;
+	Gfx::Rect shadow_rects[] = {
+		window_shabs.inset(0, 0, window_shabs.height - shadow_size, 0),
+		window_shabs.inset(window_shabs.height - shadow_size, 0, 0, 0),
+		window_shabs.inset(shadow_size, window_shabs.width - shadow_size, shadow_size, 0),
+		window_shabs.inset(shadow_size, 0, shadow_size, window_shabs.width - shadow_size)
+	};
+	for(auto& area : window.shadow.rects()) {
+		for(int i = 0; i < 4; i++) {
+			auto& rect = shadow_rects[i];
+			if(!area.collides(rect))
+				continue;
+			Gfx::Rect shadow_abs = area.overlapping_area(rect);
+			if(shadow_abs.empty())
+				continue;
+			fb.copy_blitting(window.shadow_buffers[i], shadow_abs.transform(rect.position() * -1), shadow_abs.position());
+		}
+	}
 }
 
-bool flipped = false;
-void Display::flip_buffers() {
-	//If the screen buffer isn't dirty, don't bother
-	if(!display_buffer_dirty)
+void Display::invalidate_buffer_area(const Gfx::Rect& rect) {
+	if(_buffer_mode != BufferMode::Double)
 		return;
+	//If the invalid buffer area is empty (has an x of -1), initialize it to the invalid area
+	if(_invalid_buffer_area.x == -1)
+		_invalid_buffer_area = rect;
+	else
+		_invalid_buffer_area = _invalid_buffer_area.combine(rect);
+}
+
+const Gfx::Framebuffer& Display::back_buffer() {
+	switch(_buffer_mode) {
+		case BufferMode::Single:
+			return _framebuffer;
+		case BufferMode::Double:
+			return _root_window->framebuffer();
+		case BufferMode::DoubleFlip:
+			return _flip_buffers[_back_buffer_index];
+	}
+	return _framebuffer;
+}
 
+void Display::flip_buffers() {
 	if(_buffer_mode == BufferMode::DoubleFlip) {
-		auto* video_buf = &_framebuffer.data[flipped ? _framebuffer.height * _framebuffer.width : 0];
-		memcpy_uint32((uint32_t*) video_buf, (uint32_t*) _root_window->framebuffer().data, _framebuffer.width * _framebuffer.height);
-		ioctl(framebuffer_fd, IO_VIDEO_OFFSET, flipped ? _framebuffer.height : 0);
-		flipped = !flipped;
+		//We painted straight into the hidden half of video memory, so all we need to do is show it
+		ioctl(framebuffer_fd, IO_VIDEO_OFFSET, _back_buffer_index * _dimensions.height);
+		_back_buffer_index = !_back_buffer_index;
 	} else if(_buffer_mode == BufferMode::Double) {
 		_framebuffer.copy(_root_window->framebuffer(), _invalid_buffer_area, _invalid_buffer_area.position());
 		_invalid_buffer_area.x = -1;
 	}
+}
+
+Duck::Mutex& Display::lock() {
+	return _lock;
+}
+
+Duck::Mutex& Display::paint_lock() {
+	return _paint_lock;
+}
+
+void Display::run_compositor() {
+	while(true) {
+		futex_wait(&_frame_futex);
+		while(frame());
+	}
+}
+
+void Display::input_received(Duck::Time time) {
+	if((!invalid_region.empty() || _cursor_dirty) && !_input_time)
+		_input_time = time;
+}
+
+bool Display::frame() {
+	//Wait for the next frame to start. If the display can't tell us, just paint now.
+	video_frame frame;
+	if(read(framebuffer_fd, &frame, sizeof(video_frame)) != sizeof(video_frame))
+		frame = {0, 0};
+
+	auto paint_start = Duck::Time::now();
+
+	//Take the paint lock before letting go of the scene, so nothing in the snapshot can be freed before it's painted
+	_lock.acquire();
+	if(!take_snapshot()) {
+		_frame_requested = false;
+		_lock.release();
+		return false;
+	}
+	_paint_lock.acquire();
+	_lock.release();
+	paint();
+	_paint_lock.release();
+	flip_buffers();
+
+	auto paint_end = Duck::Time::now();
+	auto paint_time = paint_end - paint_start;
+
+	LOCK(_lock);
+
+	//Keep running averages over roughly the last 16 frames
+	auto& stats = _frame_stats;
+	auto paint_usec = (uint32_t) (paint_time.epoch() * 1000000 + paint_time.interval_usec());
+	auto latency_usec = frame.usec + paint_usec;
+	stats.last_paint_usec = paint_usec;
+	stats.max_paint_usec = std::max(stats.max_paint_usec, paint_usec);
+	if(stats.frames++) {
+		stats.average_paint_usec += ((int) paint_usec - (int) stats.average_paint_usec) / 16;
+		stats.average_latency_usec += ((int) latency_usec - (int) stats.average_latency_usec) / 16;
+	} else {
+		stats.average_paint_usec = paint_usec;
+		stats.average_latency_usec = latency_usec;
+	}
+	if(latency_usec > 1000000 / stats.refresh_rate)
+		stats.missed_frames++;
+
+	if(_scene.input_time) {
+		auto input_time = paint_end - *_scene.input_time;
+		auto input_usec = (uint32_t) (input_time.epoch() * 1000000 + input_time.interval_usec());
+		stats.max_input_latency_usec = std::max(stats.max_input_latency_usec, input_usec);
+		if(stats.input_frames++)
+			stats.average_input_latency_usec += ((int) input_usec - (int) stats.average_input_latency_usec) / 16;
+		else
+			stats.average_input_latency_usec = input_usec;
+	}
 
-	display_buffer_dirty = false;
+	if(invalid_region.empty() && !_cursor_dirty && _moves.empty()) {
+		_frame_requested = false;
+		return false;
+	}
+	return true;
 }
 
-int Display::millis_until_next_flip() const {
-	timeval new_time = {0, 0};
-	gettimeofday(&new_time, NULL);
-	int diff = (int) (((new_time.tv_sec - paint_time.tv_sec) * 1000000) + (new_time.tv_usec - paint_time.tv_usec))/1000;
-	return diff >= 16 ? 0 : 16 - diff;
+const Pond::FrameStatsPkt& Display::frame_stats() {
+	return _frame_stats;
 }
 
 void Display::move_to_front(Window* window) {
@@ -350,7 +584,7 @@ void Display::create_mouse_events(int delta_x, int delta_y, int scroll, uint8_t
 		if(!(buttons & 1) || !_drag_window->draggable())
 			_drag_window = nullptr;
 		else
-			_drag_window->set_position(_drag_window->rect().position() + delta);
+			move_window(_drag_window, _drag_window->rect().position() + delta);
 	}
 
 	//If we're resizing the window, check if the user let go of the mouse button or if the window is no longer resizable
@@ -490,10 +724,6 @@ void Display::create_mouse_events(int delta_x, int delta_y, int scroll, uint8_t
 	prev_mouse_buttons = buttons;
 }
 
-bool Display::buffer_is_dirty() {
-	return display_buffer_dirty;
-}
-
 bool Display::update_keyboard() {
 	KeyboardEvent events[32];
 	ssize_t nread = read(_keyboard_fd, &events, sizeof(KeyboardEvent) * 32);
@@ -25,7 +25,11 @@
 #include "Window.h"
 #include "Mouse.h"
 #include <libgraphics/Image.h>
-#include <sys/time.h>
+#include <libpond/packet.h>
+#include <libduck/Mutex.h>
+#include <libduck/Time.h>
+#include <sys/futex.h>
+#include <optional>
 
 class Window;
 class Mouse;
@@ -79,20 +83,58 @@ public:
 	void invalidate(const Gfx::Rect& rect);
 
 	/**
-	 * Repaints the needed areas of the screen to the hidden screen buffer.
+	 * Marks the cursor to be redrawn. The cursor is drawn over everything else with the pixels under it saved, so
+	 * moving it or changing its image doesn't need anything beneath it to be repainted.
 	 */
-	void repaint();
+	void invalidate_cursor();
 
 	/**
-	 * Copies the screen buffer to libgraphics memory if necessary
+	 * Moves pixels that are already on the screen instead of repainting them, for when an area of a window shifts
+	 * without otherwise changing (because the window was dragged or its contents were scrolled). Only works if nothing
+	 * is drawn over the area, so if anything might be, nothing is moved. Whatever couldn't be copied into the
+	 * destination (because it was off-screen) is invalidated.
+	 * @param window The window whose pixels are being moved.
+	 * @param area The absolute rect of the pixels to move.
+	 * @param delta How far to move them.
+	 * @return Whether the pixels will be moved. If not, the caller should invalidate the destination itself.
 	 */
-	void flip_buffers();
+	bool move_pixels(Window* window, Gfx::Rect area, Gfx::Point delta);
+
+	/**
+	 * Moves a window, moving what's already on the screen of it if possible instead of repainting it.
+	 */
+	void move_window(Window* window, const Gfx::Point& position);
+
+	/**
+	 * The lock protecting the scene: the windows, their geometry and the invalid region. The input and protocol
+	 * threads hold it while handling events and packets, and the compositor only holds it long enough to take a
+	 * snapshot of what needs to be painted.
+	 */
+	Duck::Mutex& lock();
+
+	/**
+	 * Held by the compositor while it paints from its snapshot of the scene. Anything that frees pixel memory a
+	 * snapshot could point to (window framebuffers and shadows) must hold it while doing so.
+	 */
+	Duck::Mutex& paint_lock();
+
+	/**
+	 * Runs the compositor, which waits for something to be invalidated and then paints on each tick of the display's
+	 * frame clock until there's nothing left to paint. Never returns.
+	 */
+	void run_compositor();
+
+	/**
+	 * Notes that input read at the given time was just handled, for measuring input-to-photon latency. Only input
+	 * that changed the screen directly (by moving the cursor or a window, for instance) is measured, since changes
+	 * clients make in response can't be tied back to it. Must be called with the lock held.
+	 */
+	void input_received(Duck::Time time);
 
 	/**
-	 * Calculates the number of milliseconds until the next buffer flip should occur.
-	 * @return The number of milliseconds until the next buffer flip should occur.
+	 * Returns timing statistics for the frames painted so far. Must be called with the lock held.
 	 */
-	int millis_until_next_flip() const;
+	const Pond::FrameStatsPkt& frame_stats();
 
 	/**
 	 * Moves a window to the front.
@@ -109,11 +151,6 @@ public:
 	 */
 	void create_mouse_events(int delta_x, int delta_y, int scroll, uint8_t buttons);
 
-	/**
-	 * Whether or not the display buffer is dirty.
-	 */
-	bool buffer_is_dirty();
-
 	/**
 	 * Handles keyboard events if there are any.
 	 * @return Whether or not there were any keyboard events.
@@ -149,6 +186,93 @@ private:
 	 */
 	Gfx::Rect calculate_resize_rect();
 
+	/**
+	 * What the compositor needs to paint one window, copied out of the scene so that it can paint without the lock.
+	 */
+	struct WindowPaint {
+		Gfx::Framebuffer framebuffer;
+		Gfx::Framebuffer shadow_buffers[4];
+		Gfx::Rect rect;
+		Gfx::Rect shadow_rect;
+		Gfx::Region content; ///The part of the window's contents to paint.
+		Gfx::Region shadow; ///The part of the window's shadow to paint.
+		bool uses_alpha;
+		bool dimmed; ///Whether the window's client is unresponsive.
+	};
+
+	/**
+	 * An area of the screen to be moved by copying it within the buffer being painted.
+	 */
+	struct MovedArea {
+		Gfx::Rect area; ///The area to move.
+		Gfx::Point delta; ///How far to move it.
+	};
+
+	/**
+	 * A snapshot of everything that needs to be painted in a frame.
+	 */
+	struct Scene {
+		Gfx::Region stale; ///The parts of the buffer to copy from the front buffer before painting, when flipping.
+		std::vector<MovedArea> moves; ///The areas to move before painting, in order.
+		std::vector<WindowPaint> windows; ///The windows to paint, from back to front.
+		Gfx::Region background; ///The parts of the display not covered by an opaque window.
+		Gfx::Rect resize_rect; ///The outline of the window being resized, if any.
+		Gfx::Framebuffer cursor;
+		Gfx::Rect cursor_rect;
+		std::optional<Duck::Time> input_time; ///When the oldest input shown in this frame was read.
+	};
+
+	/**
+	 * The pixels under the cursor in one of the buffers we paint into, so that the cursor can be taken back out.
+	 */
+	struct CursorSaveUnder {
+		Gfx::Framebuffer pixels;
+		Gfx::Rect rect = {0, 0, 0, 0}; ///Where the cursor was drawn, or empty if it wasn't.
+	};
+
+	/**
+	 * Wakes the compositor up to paint a frame if it isn't already going to.
+	 */
+	void request_frame();
+
+	/**
+	 * Paints a frame if there's anything to paint and then flips the display buffers.
+	 * @return Whether there's still anything left to paint afterward.
+	 */
+	bool frame();
+
+	/**
+	 * Takes a snapshot of the invalid parts of the scene into _scene and clears the invalid region. Must be called
+	 * with the lock held.
+	 * @return Whether there's anything to paint.
+	 */
+	bool take_snapshot();
+
+	/**
+	 * Paints the snapshot in _scene to the hidden screen buffer. Must be called with the paint lock held.
+	 */
+	void paint();
+
+	/**
+	 * Shows the hidden screen buffer, either by flipping to it or copying it to video memory.
+	 */
+	void flip_buffers();
+
+	/**
+	 * When double buffering, marks an area of the hidden screen buffer to be copied to video memory on the next flip.
+	 */
+	void invalidate_buffer_area(const Gfx::Rect& rect);
+
+	/**
+	 * Returns the framebuffer that the next frame should be painted into.
+	 */
+	const Gfx::Framebuffer& back_buffer();
+
+	/**
+	 * Paints the parts of a window (and its shadow) from a snapshot.
+	 */
+	void paint_window(const Gfx::Framebuffer& fb, const WindowPaint& window);
+
 	int framebuffer_fd = 0; ///The file descriptor of the framebuffer.
 	Gfx::Framebuffer _framebuffer; ///The display framebuffer.
 	Gfx::Framebuffer _background_framebuffer; ///The framebuffer for the background.
@@ -156,7 +280,7 @@ private:
 	Gfx::Color _background_a = RGB(0,0,0); /// The first color of the wallpaper gradient.
 	Gfx::Color _background_b = RGB(0,0,0); /// The second color of the wallpaper gradient.
 	Gfx::Rect _dimensions; ///The dimensions of the display.
-	std::vector<Gfx::Rect> invalid_areas; ///The invalidated areas that need to be redrawn.
+	Gfx::Region invalid_region; ///The invalidated area that needs to be redrawn.
 	std::vector<Window*> _windows; ///The windows on the display.
 	Mouse* _mouse_window = nullptr; ///The window representing the mouse cursor.
 	Window* _prev_mouse_window = nullptr; ///The previous window that the mouse cursor was in.
@@ -167,12 +291,24 @@ private:
 	Gfx::Rect _resize_rect; ///The rect representing the new size of the resized window.
 	ResizeMode _resize_mode = NONE; ///The current resize mode.
 	Window* _root_window = nullptr; ///The root window of the display.
-	timeval paint_time = {0, 0}; ///The last time that the display was painted.
-	bool display_buffer_dirty = true; ///Whether or not the buffer is dirty and needs to be flipped.
 	int _keyboard_fd; ///The file descriptor of the keyboard.
 	Window* _focused_window = nullptr; ///The currently focused window.
 	BufferMode _buffer_mode = BufferMode::Single; ///Whether to use single or double buffering, or a flippable display buffer.
 	Gfx::Rect _invalid_buffer_area = {-1, -1, -1, -1}; ///The invalid area of the display buffer that needs to be redrawn next flip
+	Gfx::Framebuffer _flip_buffers[2]; ///The two halves of video memory when flipping buffers.
+	int _back_buffer_index = 1; ///Which of the flip buffers isn't being shown.
+	Gfx::Region _back_buffer_stale; ///What changed in the front buffer last frame, and is out of date in the back buffer.
+	Gfx::Rect _drawn_outline[2] = {{0, 0, 0, 0}, {0, 0, 0, 0}}; ///Where the resize outline was drawn in each flip buffer.
+	std::vector<MovedArea> _moves; ///Areas of the screen to be moved in the next frame.
+	Pond::FrameStatsPkt _frame_stats = {}; ///Timing statistics for painted frames.
+	Duck::Mutex _lock; ///The lock protecting the scene.
+	Duck::Mutex _paint_lock; ///Held while painting from a snapshot.
+	Scene _scene; ///The snapshot of the scene being painted. Only used by the compositor.
+	futex_t _frame_futex = 0; ///Signalled to wake the compositor when something is invalidated.
+	bool _frame_requested = false; ///Whether the compositor has been woken to paint.
+	bool _cursor_dirty = false; ///Whether the cursor needs to be redrawn.
+	CursorSaveUnder _cursor_save_under[2]; ///What's under the cursor in each buffer we paint into.
+	std::optional<Duck::Time> _input_time; ///When the oldest input that hasn't been shown yet was read.
 
 	static Display* _inst; ///The main instance of the display.
 };
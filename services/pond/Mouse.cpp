@@ -114,6 +114,7 @@ void Mouse::set_cursor(Pond::CursorType cursor) {
 
 	set_dimensions(cursor_image->size());
 	cursor_image->draw(_framebuffer, {0, 0});
+	invalidate();
 }
 
 Duck::Result Mouse::load_cursor(Duck::Ptr<Gfx::Image>& storage, const std::string& filename) {
@@ -24,6 +24,7 @@
 #include <sys/socketfs.h>
 #include <libpond/packet.h>
 #include "Client.h"
+#include "Display.h"
 
 using namespace River;
 using namespace Pond;
@@ -31,6 +32,7 @@ using Duck::Log;
 
 #define REGISTER_FUNC(name, ret_t, arg_t, client_func) \
 auto __funcres_##name = _endpoint->register_function<ret_t, arg_t>((#name), [&] (sockid_t id, arg_t pkt) -> ret_t { \
+	LOCK(Display::inst().lock()); \
 	auto& client = clients[id]; \
 	if(!client) { \
 		Log::warn("Function ", #name, " called by unregistered client ", id); \
@@ -75,11 +77,13 @@ Server::Server() {
 	_server->set_allow_new_endpoints(false);
 
 	_endpoint->on_client_connect = [this](sockid_t id, pid_t pid) {
+		LOCK(Display::inst().lock());
 		Log::infof("New client connected: {x}", id);
 		this->clients[id] = new Client(this, id, pid);
 	};
 
 	_endpoint->on_client_disconnect = [this](sockid_t id, pid_t pid) {
+		LOCK(Display::inst().lock());
 		auto client = clients[id];
 		if(client) {
 			Log::infof("Client {x} disconnected", id);
@@ -95,6 +99,7 @@ Server::Server() {
 	REGISTER_FUNC(move_window, void, WindowMovePkt, move_window);
 	REGISTER_FUNC(resize_window, WindowResizedPkt, WindowResizePkt, resize_window);
 	REGISTER_FUNC(invalidate_window, bool, WindowInvalidatePkt, invalidate_window);
+	REGISTER_FUNC(scroll_window, bool, WindowScrollPkt, scroll_window);
 	REGISTER_FUNC(get_font, FontResponsePkt, GetFontPkt, get_font);
 	REGISTER_FUNC(set_title, void, SetTitlePkt, set_title);
 	REGISTER_FUNC(reparent, void, WindowReparentPkt, reparent);
@@ -104,6 +109,7 @@ Server::Server() {
 	REGISTER_FUNC(set_app_info, void, App::Info, set_app_info);
 	REGISTER_FUNC(focus_window, void, WindowFocusPkt, focus_window);
 	REGISTER_FUNC(set_minimum_size, void, WindowMinSizePkt, set_minimum_size);
+	REGISTER_FUNC(get_frame_stats, FrameStatsPkt, GetFrameStatsPkt, get_frame_stats);
 
 	/** Messages (server --> client) **/
 	REGISTER_MSG(window_moved, WindowMovePkt);
@@ -122,7 +128,7 @@ int Server::fd() {
 }
 
 void Server::handle_packets() {
-	_connection->read_and_handle_packets(false);
+	_connection->read_and_handle_packets(true);
 }
 
 const std::shared_ptr<River::Endpoint>& Server::endpoint() {
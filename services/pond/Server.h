@@ -29,6 +29,10 @@ public:
 	Server();
 
 	int fd();
+
+	/**
+	 * Waits for packets from clients and handles them. Each packet is handled with the display's lock held.
+	 */
 	void handle_packets();
 	const std::shared_ptr<River::Endpoint>& endpoint();
 
@@ -63,6 +63,11 @@ Window::~Window() {
 	if(_parent)
 		_parent->remove_child(this);
 	invalidate();
+
+	//The compositor might be painting from our buffers, so wait for it to finish before freeing them
+	LOCK(_display->paint_lock());
+	for(auto& buffer : _shadow_buffers)
+		buffer = Gfx::Framebuffer();
 	if(_framebuffer.data) {
 		//Deallocate the old framebuffer since there is one
 		if(shmdetach(_framebuffer_shm.id) < 0) {
@@ -156,11 +161,13 @@ void Window::set_dimensions(const Gfx::Dimensions& new_dims, bool notify_client)
 	set_rect({_rect.position(), new_dims}, notify_client);
 }
 
-void Window::set_position(const Gfx::Point& position, bool notify_client) {
-	invalidate();
+void Window::set_position(const Gfx::Point& position, bool notify_client, bool repaint) {
+	if(repaint)
+		invalidate();
 	_rect = {position.x, position.y, _rect.width, _rect.height};
 	recalculate_rects();
-	invalidate();
+	if(repaint)
+		invalidate();
 	if(notify_client && _client)
 		_client->window_moved(this);
 }
@@ -188,6 +195,10 @@ void Window::set_rect(const Gfx::Rect& rect, bool notify_client) {
 }
 
 void Window::invalidate() {
+	if(this == _display->mouse_window()) {
+		invalidate_cursor();
+		return;
+	}
 	finalize_resize();
 	if(!hidden()) {
 		if(_parent)
@@ -198,6 +209,10 @@ void Window::invalidate() {
 }
 
 void Window::invalidate(const Gfx::Rect& area) {
+	if(this == _display->mouse_window()) {
+		invalidate_cursor();
+		return;
+	}
 	finalize_resize();
 	if(hidden())
 		return;
@@ -207,6 +222,12 @@ void Window::invalidate(const Gfx::Rect& area) {
 		_display->invalidate(area.transform(_absolute_rect.position()).overlapping_area(_display->dimensions()));
 }
 
+void Window::invalidate_cursor() {
+	//The cursor is painted separately from the other windows, so nothing under it needs to be repainted
+	_pending_resize_invalidation_rect = {0, 0, 0, 0};
+	_display->invalidate_cursor();
+}
+
 void Window::move_to_front() {
 	_display->move_to_front(this);
 	for(auto child : _children)
@@ -321,10 +342,13 @@ void Window::alloc_framebuffer() {
 	// Only reallocate if we need more space in the buffer
 	auto new_buffer_size = IMGSIZE(_rect.width, _rect.height) * 2;
 	if(!_framebuffer.data || new_buffer_size > _framebuffer_shm.size) {
-		//Deallocate the old framebuffer if there is one
-		if(_framebuffer.data && shmdetach(_framebuffer_shm.id) < 0) {
-			perror("Failed to deallocate framebuffer for window");
-			return;
+		//Deallocate the old framebuffer if there is one, once the compositor isn't painting from it
+		if(_framebuffer.data) {
+			LOCK(_display->paint_lock());
+			if(shmdetach(_framebuffer_shm.id) < 0) {
+				perror("Failed to deallocate framebuffer for window");
+				return;
+			}
 		}
 
 		// Allocate the new framebuffer
@@ -345,10 +369,12 @@ void Window::alloc_framebuffer() {
 }
 
 void Window::alloc_shadow_buffers() {
-	_shadow_buffers[0] = Gfx::Framebuffer(_rect.width + SHADOW_SIZE * 2, SHADOW_SIZE); // Top
-	_shadow_buffers[1] = Gfx::Framebuffer(_rect.width + SHADOW_SIZE * 2, SHADOW_SIZE); // Bottom
-	_shadow_buffers[2] = Gfx::Framebuffer(SHADOW_SIZE, _rect.height); // Left
-	_shadow_buffers[3] = Gfx::Framebuffer(SHADOW_SIZE, _rect.height); // Right
+	Gfx::Framebuffer shadow_buffers[4] = {
+		{_rect.width + SHADOW_SIZE * 2, SHADOW_SIZE}, // Top
+		{_rect.width + SHADOW_SIZE * 2, SHADOW_SIZE}, // Bottom
+		{SHADOW_SIZE, _rect.height}, // Left
+		{SHADOW_SIZE, _rect.height} // Right
+	};
 
 	// Poor man's box-shadow :)
 	auto make_shadow_buffer = [&](Gfx::Framebuffer& buffer, Gfx::Rect window_rect) {
@@ -365,10 +391,15 @@ void Window::alloc_shadow_buffers() {
 		}
 	};
 
-	make_shadow_buffer(_shadow_buffers[0], { SHADOW_SIZE, SHADOW_SIZE, _rect.width, _rect.height });
-	make_shadow_buffer(_shadow_buffers[1], { SHADOW_SIZE, -_rect.height, _rect.width, _rect.height });
-	make_shadow_buffer(_shadow_buffers[2], { SHADOW_SIZE, 0, _rect.width, _rect.height });
-	make_shadow_buffer(_shadow_buffers[3], { -_rect.width, 0, _rect.width, _rect.height });
+	make_shadow_buffer(shadow_buffers[0], { SHADOW_SIZE, SHADOW_SIZE, _rect.width, _rect.height });
+	make_shadow_buffer(shadow_buffers[1], { SHADOW_SIZE, -_rect.height, _rect.width, _rect.height });
+	make_shadow_buffer(shadow_buffers[2], { SHADOW_SIZE, 0, _rect.width, _rect.height });
+	make_shadow_buffer(shadow_buffers[3], { -_rect.width, 0, _rect.width, _rect.height });
+
+	//The old buffers are freed when they're replaced, so make sure the compositor isn't painting from them
+	LOCK(_display->paint_lock());
+	for(int i = 0; i < 4; i++)
+		_shadow_buffers[i] = std::move(shadow_buffers[i]);
 }
 
 void Window::recalculate_rects() {
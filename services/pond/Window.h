@@ -88,8 +88,10 @@ public:
 
 	/**
 	 * Sets the position of the window relative to its parent constrained to stay inside the parent.
+	 * @param repaint Whether to invalidate the old and new areas of the window. Only pass false if whatever is on the
+	 * screen has already been taken care of (see Display::move_pixels).
 	 */
-	void set_position(const Gfx::Point& position, bool notify_client = true);
+	void set_position(const Gfx::Point& position, bool notify_client = true, bool repaint = true);
 
 	/**
 	 * Resizes the window with the given mouse movement and resize mode.
@@ -284,6 +286,7 @@ private:
 	void alloc_shadow_buffers();
 	void recalculate_rects();
 	void finalize_resize();
+	void invalidate_cursor();
 
 	Gfx::Framebuffer _framebuffer = {nullptr, 0, 0};
 	bool _flipped = false;
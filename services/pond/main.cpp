@@ -26,6 +26,41 @@
 #include <string.h>
 #include <poll.h>
 #include <unistd.h>
+#include <pthread.h>
+
+/*
+ * Pond runs on three threads so that they can't hold each other up: the input thread moves the cursor and routes
+ * input events as soon as they arrive, the protocol thread handles packets from clients, and the main thread
+ * composites frames. The first two share the scene under Display::lock(), and the compositor only takes it long
+ * enough to snapshot what it needs to paint.
+ */
+
+void* input_thread(void* arg) {
+	auto* mouse = (Mouse*) arg;
+	auto& display = Display::inst();
+
+	struct pollfd polls[2];
+	polls[0].fd = mouse->fd();
+	polls[0].events = POLLIN;
+	polls[1].fd = display.keyboard_fd();
+	polls[1].events = POLLIN;
+
+	while(true) {
+		poll(polls, 2, -1);
+		auto time = Duck::Time::now();
+		LOCK(display.lock());
+		bool got_mouse = mouse->update();
+		bool got_keyboard = display.update_keyboard();
+		if(got_mouse || got_keyboard)
+			display.input_received(time);
+	}
+}
+
+void* protocol_thread(void* arg) {
+	auto* server = (Server*) arg;
+	while(true)
+		server->handle_packets();
+}
 
 int main(int argc, char** argv, char** envp) {
 	auto* display = new Display;
@@ -35,14 +70,6 @@ int main(int argc, char** argv, char** envp) {
 	auto* mouse = new Mouse(main_window);
 	auto* font_manager = new FontManager();
 
-	struct pollfd polls[3];
-	polls[0].fd = mouse->fd();
-	polls[0].events = POLLIN;
-	polls[1].fd = server->fd();
-	polls[1].events = POLLIN;
-	polls[2].fd = display->keyboard_fd();
-	polls[2].events = POLLIN;
-
 	if(!fork()) {
 		char* argv[] = {NULL};
 		char* envp[] = {NULL};
@@ -52,15 +79,11 @@ int main(int argc, char** argv, char** envp) {
 
 	Duck::Log::success("Pond started!");
 
-#pragma clang diagnostic push
-#pragma ide diagnostic ignored "EndlessLoop"
-	while(true) {
-		poll(polls, 3, display->buffer_is_dirty() ? display->millis_until_next_flip() : -1);
-		mouse->update();
-		display->update_keyboard();
-		server->handle_packets();
-		display->repaint();
+	pthread_t input, protocol;
+	if(pthread_create(&input, nullptr, input_thread, mouse) || pthread_create(&protocol, nullptr, protocol_thread, server)) {
+		Duck::Log::crit("Couldn't start pond's threads");
+		exit(-1);
 	}
-#pragma clang diagnostic pop
 
+	display->run_compositor();
 }
\ No newline at end of file
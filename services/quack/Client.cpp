@@ -18,9 +18,12 @@
 */
 
 #include "Client.h"
+#include <libsound/Mix.h>
 
 using namespace Sound;
 
+#define MIX_CHUNK_SIZE 512
+
 Client::Client(sockid_t id, pid_t pid): m_id(id), m_pid(pid) {
 	auto buffer_res = Duck::AtomicCircularQueue<Sample, LIBSOUND_QUEUE_SIZE>::alloc("Quack::AudioQueue");
 	if(buffer_res.is_error()) {
@@ -38,8 +41,17 @@ sockid_t Client::id() const {
 bool Client::mix_samples(Sound::Sample buffer[], size_t max_samples) {
 	if(m_buffer.empty())
 		return false;
-	for(size_t i = 0; i < max_samples; i++)
-		buffer[i] += m_buffer.pop().value_or(Sample{});
+
+	// Pop the samples out in chunks; anything the client hasn't queued yet is silence.
+	Sample samples[MIX_CHUNK_SIZE];
+	size_t offset = 0;
+	while(offset < max_samples) {
+		size_t popped = m_buffer.pop(samples, std::min(max_samples - offset, (size_t) MIX_CHUNK_SIZE));
+		if(!popped)
+			break;
+		Sound::mix_samples(buffer + offset, samples, popped, m_volume);
+		offset += popped;
+	}
 	return true;
 }
 
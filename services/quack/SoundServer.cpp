@@ -20,7 +20,10 @@
 #include "SoundServer.h"
 #include <libduck/Log.h>
 #include <libsound/Sample.h>
+#include <libsound/Mix.h>
 #include <sys/thread.h>
+#include <sys/ioctl.h>
+#include <cstring>
 
 using Duck::Log, Duck::SharedBuffer, Duck::File, Sound::Sample;
 
@@ -32,6 +35,15 @@ SoundServer::SoundServer() {
 	else
 		m_soundcard = sound_res.value();
 
+	//Map the sound card's output ring so we can mix straight into it
+	void* ring;
+	if(m_soundcard.is_open()) {
+		if(ioctl(m_soundcard.fd(), IO_SOUND_MAP, &ring) < 0)
+			Log::warn("Couldn't map sound card buffer, falling back to write(): ", strerror(errno));
+		else
+			m_soundcard_ring = (uint32_t*) ring;
+	}
+
 	//Create bus
 	auto bus_res = River::BusServer::create("quack");
 	if(bus_res.is_error()) {
@@ -66,7 +78,8 @@ SoundServer::SoundServer() {
 	};
 
 	m_endpoint->bind_function<uint32_t>("get_sample_rate", &SoundServer::get_sample_rate, this);
-	m_endpoint->bind_function<int>("request_buffer", &SoundServer::request_buffer, this);
+	m_endpoint->bind_function<Duck::Ptr<Duck::SharedBuffer>>("request_buffer", &SoundServer::request_buffer, this);
+	m_endpoint->bind_function<void, float>("set_volume", &SoundServer::set_volume, this);
 }
 
 Sound::Sample mixed_samples[SOUNDCARD_BUFFER_SIZE];
@@ -75,22 +88,41 @@ uint32_t pcm_samples[SOUNDCARD_BUFFER_SIZE];
 void SoundServer::pump() {
 	m_connection->read_and_handle_packets(!m_soundcard.is_open() || m_clients.empty());
 
+	// Get the next free period of the sound card's ring to mix into
+	if(m_soundcard_ring && m_soundcard_period < 0 && ioctl(m_soundcard.fd(), IO_SOUND_NEXT_PERIOD, &m_soundcard_period) < 0) {
+		m_soundcard_period = -1;
+		return;
+	}
+
 	// Mix samples together from client queues
 	memset(mixed_samples, 0, sizeof(Sound::Sample) * SOUNDCARD_BUFFER_SIZE);
 	for (auto& client: m_clients)
 		client.second->mix_samples(mixed_samples, SOUNDCARD_BUFFER_SIZE);
 
-	// Write PCM samples to card
-	for (int i = 0; i < SOUNDCARD_BUFFER_SIZE; i++)
-		pcm_samples[i] = mixed_samples[i].as_16bit_lpcm();
-
-	m_soundcard.write(pcm_samples, SOUNDCARD_BUFFER_SIZE * sizeof(uint32_t));
+	// Convert to PCM samples and hand them to the card
+	if(m_soundcard_ring) {
+		Sound::convert_to_16bit_lpcm(m_soundcard_ring + m_soundcard_period * SOUND_PERIOD_FRAMES, mixed_samples, SOUNDCARD_BUFFER_SIZE);
+		if(ioctl(m_soundcard.fd(), IO_SOUND_NEXT_PERIOD, &m_soundcard_period) < 0)
+			m_soundcard_period = -1;
+	} else {
+		Sound::convert_to_16bit_lpcm(pcm_samples, mixed_samples, SOUNDCARD_BUFFER_SIZE);
+		m_soundcard.write(pcm_samples, SOUNDCARD_BUFFER_SIZE * sizeof(uint32_t));
+	}
 }
 
 uint32_t SoundServer::get_sample_rate(sockid_t) {
     return m_sample_rate;
 }
 
-int SoundServer::request_buffer(sockid_t id) {
-	return m_clients[id]->sample_buffer().buffer()->id();
+Duck::Ptr<Duck::SharedBuffer> SoundServer::request_buffer(sockid_t id) {
+	auto client = m_clients.find(id);
+	if(client == m_clients.end())
+		return nullptr;
+	return client->second->sample_buffer().buffer();
+}
+
+void SoundServer::set_volume(sockid_t id, float volume) {
+	auto client = m_clients.find(id);
+	if(client != m_clients.end())
+		client->second->set_volume(volume);
 }
\ No newline at end of file
@@ -23,8 +23,9 @@
 #include <sys/shm.h>
 #include "Client.h"
 #include <libduck/File.h>
+#include <kernel/api/sound.h>
 
-#define SOUNDCARD_BUFFER_SIZE 512
+#define SOUNDCARD_BUFFER_SIZE SOUND_PERIOD_FRAMES
 
 class SoundServer {
 public:
@@ -33,7 +34,8 @@ public:
 
 private:
     uint32_t get_sample_rate(sockid_t id);
-	int request_buffer(sockid_t id);
+	Duck::Ptr<Duck::SharedBuffer> request_buffer(sockid_t id);
+	void set_volume(sockid_t id, float volume);
 
 	River::BusServer* m_bus;
 	std::shared_ptr<River::BusConnection> m_connection;
@@ -41,6 +43,8 @@ private:
 	size_t m_sample_rate = 48000;
 	std::map<sockid_t, std::shared_ptr<Client>> m_clients;
 	Duck::File m_soundcard;
+	uint32_t* m_soundcard_ring = nullptr;
+	int m_soundcard_period = -1;
 };
 
 